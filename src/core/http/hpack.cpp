@@ -0,0 +1,442 @@
+#include "core/http/hpack.h"
+
+#include <algorithm>
+#include <string.h>
+
+namespace core {
+
+namespace {
+
+const size_t kEntryOverhead = 32;  // 动态表中每项额外计入的大小(RFC 7541 4.1)
+
+struct HuffmanCode {
+    uint32_t code;
+    uint8_t bits;
+};
+
+// RFC 7541附录B，下标为符号，256为EOS
+const HuffmanCode kHuffmanCodes[257] = {
+    {0x1ff8, 13}, {0x7fffd8, 23}, {0xfffffe2, 28}, {0xfffffe3, 28}, {0xfffffe4, 28}, {0xfffffe5, 28}, {0xfffffe6, 28}, {0xfffffe7, 28},
+    {0xfffffe8, 28}, {0xffffea, 24}, {0x3ffffffc, 30}, {0xfffffe9, 28}, {0xfffffea, 28}, {0x3ffffffd, 30}, {0xfffffeb, 28}, {0xfffffec, 28},
+    {0xfffffed, 28}, {0xfffffee, 28}, {0xfffffef, 28}, {0xffffff0, 28}, {0xffffff1, 28}, {0xffffff2, 28}, {0x3ffffffe, 30}, {0xffffff3, 28},
+    {0xffffff4, 28}, {0xffffff5, 28}, {0xffffff6, 28}, {0xffffff7, 28}, {0xffffff8, 28}, {0xffffff9, 28}, {0xffffffa, 28}, {0xffffffb, 28},
+    {0x14, 6}, {0x3f8, 10}, {0x3f9, 10}, {0xffa, 12}, {0x1ff9, 13}, {0x15, 6}, {0xf8, 8}, {0x7fa, 11},
+    {0x3fa, 10}, {0x3fb, 10}, {0xf9, 8}, {0x7fb, 11}, {0xfa, 8}, {0x16, 6}, {0x17, 6}, {0x18, 6},
+    {0x0, 5}, {0x1, 5}, {0x2, 5}, {0x19, 6}, {0x1a, 6}, {0x1b, 6}, {0x1c, 6}, {0x1d, 6},
+    {0x1e, 6}, {0x1f, 6}, {0x5c, 7}, {0xfb, 8}, {0x7ffc, 15}, {0x20, 6}, {0xffb, 12}, {0x3fc, 10},
+    {0x1ffa, 13}, {0x21, 6}, {0x5d, 7}, {0x5e, 7}, {0x5f, 7}, {0x60, 7}, {0x61, 7}, {0x62, 7},
+    {0x63, 7}, {0x64, 7}, {0x65, 7}, {0x66, 7}, {0x67, 7}, {0x68, 7}, {0x69, 7}, {0x6a, 7},
+    {0x6b, 7}, {0x6c, 7}, {0x6d, 7}, {0x6e, 7}, {0x6f, 7}, {0x70, 7}, {0x71, 7}, {0x72, 7},
+    {0xfc, 8}, {0x73, 7}, {0xfd, 8}, {0x1ffb, 13}, {0x7fff0, 19}, {0x1ffc, 13}, {0x3ffc, 14}, {0x22, 6},
+    {0x7ffd, 15}, {0x3, 5}, {0x23, 6}, {0x4, 5}, {0x24, 6}, {0x5, 5}, {0x25, 6}, {0x26, 6},
+    {0x27, 6}, {0x6, 5}, {0x74, 7}, {0x75, 7}, {0x28, 6}, {0x29, 6}, {0x2a, 6}, {0x7, 5},
+    {0x2b, 6}, {0x76, 7}, {0x2c, 6}, {0x8, 5}, {0x9, 5}, {0x2d, 6}, {0x77, 7}, {0x78, 7},
+    {0x79, 7}, {0x7a, 7}, {0x7b, 7}, {0x7ffe, 15}, {0x7fc, 11}, {0x3ffd, 14}, {0x1ffd, 13}, {0xffffffc, 28},
+    {0xfffe6, 20}, {0x3fffd2, 22}, {0xfffe7, 20}, {0xfffe8, 20}, {0x3fffd3, 22}, {0x3fffd4, 22}, {0x3fffd5, 22}, {0x7fffd9, 23},
+    {0x3fffd6, 22}, {0x7fffda, 23}, {0x7fffdb, 23}, {0x7fffdc, 23}, {0x7fffdd, 23}, {0x7fffde, 23}, {0xffffeb, 24}, {0x7fffdf, 23},
+    {0xffffec, 24}, {0xffffed, 24}, {0x3fffd7, 22}, {0x7fffe0, 23}, {0xffffee, 24}, {0x7fffe1, 23}, {0x7fffe2, 23}, {0x7fffe3, 23},
+    {0x7fffe4, 23}, {0x1fffdc, 21}, {0x3fffd8, 22}, {0x7fffe5, 23}, {0x3fffd9, 22}, {0x7fffe6, 23}, {0x7fffe7, 23}, {0xffffef, 24},
+    {0x3fffda, 22}, {0x1fffdd, 21}, {0xfffe9, 20}, {0x3fffdb, 22}, {0x3fffdc, 22}, {0x7fffe8, 23}, {0x7fffe9, 23}, {0x1fffde, 21},
+    {0x7fffea, 23}, {0x3fffdd, 22}, {0x3fffde, 22}, {0xfffff0, 24}, {0x1fffdf, 21}, {0x3fffdf, 22}, {0x7fffeb, 23}, {0x7fffec, 23},
+    {0x1fffe0, 21}, {0x1fffe1, 21}, {0x3fffe0, 22}, {0x1fffe2, 21}, {0x7fffed, 23}, {0x3fffe1, 22}, {0x7fffee, 23}, {0x7fffef, 23},
+    {0xfffea, 20}, {0x3fffe2, 22}, {0x3fffe3, 22}, {0x3fffe4, 22}, {0x7ffff0, 23}, {0x3fffe5, 22}, {0x3fffe6, 22}, {0x7ffff1, 23},
+    {0x3ffffe0, 26}, {0x3ffffe1, 26}, {0xfffeb, 20}, {0x7fff1, 19}, {0x3fffe7, 22}, {0x7ffff2, 23}, {0x3fffe8, 22}, {0x1ffffec, 25},
+    {0x3ffffe2, 26}, {0x3ffffe3, 26}, {0x3ffffe4, 26}, {0x7ffffde, 27}, {0x7ffffdf, 27}, {0x3ffffe5, 26}, {0xfffff1, 24}, {0x1ffffed, 25},
+    {0x7fff2, 19}, {0x1fffe3, 21}, {0x3ffffe6, 26}, {0x7ffffe0, 27}, {0x7ffffe1, 27}, {0x3ffffe7, 26}, {0x7ffffe2, 27}, {0xfffff2, 24},
+    {0x1fffe4, 21}, {0x1fffe5, 21}, {0x3ffffe8, 26}, {0x3ffffe9, 26}, {0xffffffd, 28}, {0x7ffffe3, 27}, {0x7ffffe4, 27}, {0x7ffffe5, 27},
+    {0xfffec, 20}, {0xfffff3, 24}, {0xfffed, 20}, {0x1fffe6, 21}, {0x3fffe9, 22}, {0x1fffe7, 21}, {0x1fffe8, 21}, {0x7ffff3, 23},
+    {0x3fffea, 22}, {0x3fffeb, 22}, {0x1ffffee, 25}, {0x1ffffef, 25}, {0xfffff4, 24}, {0xfffff5, 24}, {0x3ffffea, 26}, {0x7ffff4, 23},
+    {0x3ffffeb, 26}, {0x7ffffe6, 27}, {0x3ffffec, 26}, {0x3ffffed, 26}, {0x7ffffe7, 27}, {0x7ffffe8, 27}, {0x7ffffe9, 27}, {0x7ffffea, 27},
+    {0x7ffffeb, 27}, {0xffffffe, 28}, {0x7ffffec, 27}, {0x7ffffed, 27}, {0x7ffffee, 27}, {0x7ffffef, 27}, {0x7fffff0, 27}, {0x3ffffee, 26},
+    {0x3fffffff, 30},};
+
+struct StaticEntry {
+    std::string_view name;
+    std::string_view value;
+};
+
+// RFC 7541附录A，下标加1为索引
+const StaticEntry kStaticTable[] = {
+    {":authority", ""},
+    {":method", "GET"},
+    {":method", "POST"},
+    {":path", "/"},
+    {":path", "/index.html"},
+    {":scheme", "http"},
+    {":scheme", "https"},
+    {":status", "200"},
+    {":status", "204"},
+    {":status", "206"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "500"},
+    {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"},
+    {"accept-language", ""},
+    {"accept-ranges", ""},
+    {"accept", ""},
+    {"access-control-allow-origin", ""},
+    {"age", ""},
+    {"allow", ""},
+    {"authorization", ""},
+    {"cache-control", ""},
+    {"content-disposition", ""},
+    {"content-encoding", ""},
+    {"content-language", ""},
+    {"content-length", ""},
+    {"content-location", ""},
+    {"content-range", ""},
+    {"content-type", ""},
+    {"cookie", ""},
+    {"date", ""},
+    {"etag", ""},
+    {"expect", ""},
+    {"expires", ""},
+    {"from", ""},
+    {"host", ""},
+    {"if-match", ""},
+    {"if-modified-since", ""},
+    {"if-none-match", ""},
+    {"if-range", ""},
+    {"if-unmodified-since", ""},
+    {"last-modified", ""},
+    {"link", ""},
+    {"location", ""},
+    {"max-forwards", ""},
+    {"proxy-authenticate", ""},
+    {"proxy-authorization", ""},
+    {"range", ""},
+    {"referer", ""},
+    {"refresh", ""},
+    {"retry-after", ""},
+    {"server", ""},
+    {"set-cookie", ""},
+    {"strict-transport-security", ""},
+    {"transfer-encoding", ""},
+    {"user-agent", ""},
+    {"vary", ""},
+    {"via", ""},
+    {"www-authenticate", ""},
+};
+
+const size_t kStaticTableSize = sizeof kStaticTable / sizeof kStaticTable[0];
+
+// 码表是规范Huffman码：同一码长的码字按符号顺序连续递增，且短码字左对齐后总小于长码字。
+// 因此按码长分组，记录每组的首个码字和符号，解码时从短到长比较前缀即可确定符号
+struct HuffmanDecodeTable {
+    static const int kMaxBits = 30;
+    
+    uint32_t first_code[kMaxBits + 1];
+    uint16_t count[kMaxBits + 1];
+    uint16_t offset[kMaxBits + 1];
+    uint16_t symbols[257];
+    
+    HuffmanDecodeTable() {
+        memset(first_code, 0, sizeof first_code);
+        memset(count, 0, sizeof count);
+        memset(offset, 0, sizeof offset);
+        for (uint16_t i = 0; i < 257; ++i) {
+            symbols[i] = i;
+        }
+        std::stable_sort(symbols, symbols + 257, [](uint16_t a, uint16_t b) {
+            return kHuffmanCodes[a].bits < kHuffmanCodes[b].bits;
+        });
+        for (uint16_t i = 0; i < 257; ++i) {
+            const HuffmanCode& h = kHuffmanCodes[symbols[i]];
+            if (count[h.bits]++ == 0) {
+                first_code[h.bits] = h.code;
+                offset[h.bits] = i;
+            }
+        }
+    }
+};
+
+const HuffmanDecodeTable& huffmanDecodeTable() {
+    static const HuffmanDecodeTable table;
+    return table;
+}
+
+void encodeInteger(uint64_t value, int prefix_bits, uint8_t flags, std::string* out) {
+    uint64_t max = (1u << prefix_bits) - 1;
+    if (value < max) {
+        out->push_back(static_cast<char>(flags | value));
+        return;
+    }
+    out->push_back(static_cast<char>(flags | max));
+    value -= max;
+    while (value >= 0x80) {
+        out->push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out->push_back(static_cast<char>(value));
+}
+
+bool decodeInteger(const uint8_t*& p, const uint8_t* end, int prefix_bits, uint64_t* value) {
+    if (p == end) {
+        return false;
+    }
+    uint64_t max = (1u << prefix_bits) - 1;
+    uint64_t v = *p++ & max;
+    if (v < max) {
+        *value = v;
+        return true;
+    }
+    for (int shift = 0; p < end && shift <= 56; shift += 7) {
+        uint8_t b = *p++;
+        v += static_cast<uint64_t>(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *value = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+void encodeString(std::string_view s, std::string* out) {
+    size_t huffman_len = hpack::huffmanEncodedLength(s);
+    if (huffman_len < s.size()) {
+        encodeInteger(huffman_len, 7, 0x80, out);
+        hpack::huffmanEncode(s, out);
+    } else {
+        encodeInteger(s.size(), 7, 0, out);
+        out->append(s.data(), s.size());
+    }
+}
+
+bool decodeString(const uint8_t*& p, const uint8_t* end, std::string* out) {
+    if (p == end) {
+        return false;
+    }
+    bool huffman = (*p & 0x80) != 0;
+    uint64_t len;
+    if (!decodeInteger(p, end, 7, &len) || len > static_cast<uint64_t>(end - p)) {
+        return false;
+    }
+    out->clear();
+    if (huffman) {
+        if (!hpack::huffmanDecode(reinterpret_cast<const char*>(p), len, out)) {
+            return false;
+        }
+    } else {
+        out->assign(reinterpret_cast<const char*>(p), len);
+    }
+    p += len;
+    return true;
+}
+
+int staticNameIndex(std::string_view name) {
+    for (size_t i = 0; i < kStaticTableSize; ++i) {
+        if (kStaticTable[i].name == name) {
+            return static_cast<int>(i + 1);
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+namespace hpack {
+
+size_t huffmanEncodedLength(std::string_view input) {
+    uint64_t bits = 0;
+    for (char c : input) {
+        bits += kHuffmanCodes[static_cast<uint8_t>(c)].bits;
+    }
+    return (bits + 7) / 8;
+}
+
+void huffmanEncode(std::string_view input, std::string* out) {
+    uint64_t acc = 0;
+    int bits = 0;
+    for (char c : input) {
+        const HuffmanCode& h = kHuffmanCodes[static_cast<uint8_t>(c)];
+        acc = (acc << h.bits) | h.code;
+        bits += h.bits;
+        while (bits >= 8) {
+            bits -= 8;
+            out->push_back(static_cast<char>(acc >> bits));
+        }
+        acc &= (1u << bits) - 1;
+    }
+    if (bits > 0) {
+        // 用EOS的高位(全1)填充到字节边界
+        out->push_back(static_cast<char>((acc << (8 - bits)) | (0xff >> bits)));
+    }
+}
+
+bool huffmanDecode(const char* data, size_t len, std::string* out) {
+    const HuffmanDecodeTable& table = huffmanDecodeTable();
+    uint64_t acc = 0;
+    int bits = 0;
+    for (size_t i = 0; i < len; ++i) {
+        acc = (acc << 8) | static_cast<uint8_t>(data[i]);
+        bits += 8;
+        // 最短的码字为5位
+        while (bits >= 5) {
+            bool found = false;
+            for (int n = 5; n <= bits && n <= HuffmanDecodeTable::kMaxBits; ++n) {
+                uint32_t code = static_cast<uint32_t>(acc >> (bits - n)) & ((1u << n) - 1);
+                if (table.count[n] > 0 && code >= table.first_code[n] && code - table.first_code[n] < table.count[n]) {
+                    uint16_t symbol = table.symbols[table.offset[n] + code - table.first_code[n]];
+                    if (symbol == 256) {
+                        // 主体中出现EOS是解码错误
+                        return false;
+                    }
+                    out->push_back(static_cast<char>(symbol));
+                    bits -= n;
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) {
+                if (bits >= HuffmanDecodeTable::kMaxBits) {
+                    return false;
+                }
+                break;
+            }
+        }
+        acc &= (static_cast<uint64_t>(1) << bits) - 1;
+    }
+    // 末尾只能是不超过7位的EOS前缀(全1)
+    uint64_t mask = (static_cast<uint64_t>(1) << bits) - 1;
+    return bits <= 7 && (acc & mask) == mask;
+}
+
+} // namespace hpack
+
+HpackDecoder::HpackDecoder(size_t max_table_size)
+    : table_size_(0),
+      max_table_size_(max_table_size),
+      settings_limit_(max_table_size) {
+}
+
+HpackDecoder::Status HpackDecoder::decode(const char* data, size_t len, HeaderList* headers, size_t max_list_size) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    const uint8_t* end = p + len;
+    size_t list_size = 0;
+    bool header_seen = false;
+    std::string name;
+    std::string value;
+    
+    while (p < end) {
+        uint8_t b = *p;
+        if (b & 0x80) {
+            // 索引的头部
+            uint64_t index;
+            if (!decodeInteger(p, end, 7, &index) || !lookup(index, &name, &value)) {
+                return kError;
+            }
+        } else if ((b & 0xe0) == 0x20) {
+            // 动态表大小更新，只能出现在头部块的开头
+            uint64_t size;
+            if (header_seen || !decodeInteger(p, end, 5, &size) || size > settings_limit_) {
+                return kError;
+            }
+            max_table_size_ = size;
+            evict(max_table_size_);
+            continue;
+        } else {
+            // 字面值：01增量索引(6位前缀)，0000不索引/0001永不索引(4位前缀)
+            bool indexing = (b & 0xc0) == 0x40;
+            uint64_t index;
+            if (!decodeInteger(p, end, indexing ? 6 : 4, &index)) {
+                return kError;
+            }
+            if (index == 0) {
+                if (!decodeString(p, end, &name)) {
+                    return kError;
+                }
+            } else if (!lookup(index, &name, &value)) {
+                return kError;
+            }
+            if (!decodeString(p, end, &value)) {
+                return kError;
+            }
+            if (indexing) {
+                insert(name, value);
+            }
+        }
+        
+        header_seen = true;
+        list_size += name.size() + value.size() + kEntryOverhead;
+        // 超限后继续解码以保持动态表同步，只是不再保存
+        if (list_size <= max_list_size) {
+            headers->emplace_back(name, value);
+        }
+    }
+    return list_size <= max_list_size ? kOk : kTooLarge;
+}
+
+bool HpackDecoder::lookup(uint64_t index, std::string* name, std::string* value) const {
+    if (index == 0) {
+        return false;
+    }
+    if (index <= kStaticTableSize) {
+        const StaticEntry& entry = kStaticTable[index - 1];
+        name->assign(entry.name.data(), entry.name.size());
+        value->assign(entry.value.data(), entry.value.size());
+        return true;
+    }
+    index -= kStaticTableSize + 1;
+    if (index >= dynamic_table_.size()) {
+        return false;
+    }
+    *name = dynamic_table_[index].first;
+    *value = dynamic_table_[index].second;
+    return true;
+}
+
+void HpackDecoder::insert(const std::string& name, const std::string& value) {
+    size_t size = name.size() + value.size() + kEntryOverhead;
+    if (size > max_table_size_) {
+        // 比整个表还大的项清空动态表，自身也不插入
+        evict(0);
+        return;
+    }
+    evict(max_table_size_ - size);
+    dynamic_table_.emplace_front(name, value);
+    table_size_ += size;
+}
+
+void HpackDecoder::evict(size_t limit) {
+    while (table_size_ > limit && !dynamic_table_.empty()) {
+        const auto& entry = dynamic_table_.back();
+        table_size_ -= entry.first.size() + entry.second.size() + kEntryOverhead;
+        dynamic_table_.pop_back();
+    }
+}
+
+void HpackEncoder::encode(std::string_view name, std::string_view value, std::string* out) {
+    // 不索引的字面值，名字在静态表中时引用其索引
+    int index = staticNameIndex(name);
+    if (index > 0) {
+        encodeInteger(index, 4, 0x00, out);
+    } else {
+        out->push_back(0x00);
+        encodeString(name, out);
+    }
+    encodeString(value, out);
+}
+
+void HpackEncoder::encodeStatus(int code, std::string* out) {
+    int index = 0;
+    switch (code) {
+        case 200: index = 8; break;
+        case 204: index = 9; break;
+        case 206: index = 10; break;
+        case 304: index = 11; break;
+        case 400: index = 12; break;
+        case 404: index = 13; break;
+        case 500: index = 14; break;
+        default: break;
+    }
+    if (index > 0) {
+        encodeInteger(index, 7, 0x80, out);
+        return;
+    }
+    encodeInteger(8, 4, 0x00, out);
+    encodeString(std::to_string(code), out);
+}
+
+} // namespace core
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <deque>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace core {
+
+// HPACK(RFC 7541)头部压缩
+
+// 解码器，每个HTTP/2连接一个，维护对端编码器对应的动态表
+class HpackDecoder {
+public:
+    using HeaderList = std::vector<std::pair<std::string, std::string>>;
+    
+    enum Status {
+        kOk,
+        kTooLarge,  // 解码后超过头部列表大小限制，动态表仍保持同步
+        kError,     // 格式错误，连接级COMPRESSION_ERROR
+    };
+    
+    static const size_t kDefaultTableSize = 4096;
+    
+    explicit HpackDecoder(size_t max_table_size = kDefaultTableSize);
+    
+    // 解码一个完整的头部块，追加到headers。
+    // max_list_size限制解码后头部的总大小(名字+值+32)，防止少量引用动态表的字节膨胀成大量头部
+    Status decode(const char* data, size_t len, HeaderList* headers, size_t max_list_size);
+    
+private:
+    // 取第index项(1开始，静态表之后是动态表)
+    bool lookup(uint64_t index, std::string* name, std::string* value) const;
+    void insert(const std::string& name, const std::string& value);
+    void evict(size_t limit);
+    
+    std::deque<std::pair<std::string, std::string>> dynamic_table_;  // 新插入的在前
+    size_t table_size_;       // 动态表当前大小
+    size_t max_table_size_;   // 对端通过大小更新设定的上限
+    size_t settings_limit_;   // 我方SETTINGS_HEADER_TABLE_SIZE，大小更新不能超过它
+};
+
+// 编码器：不使用动态表，名字尽量引用静态表，值在更短时使用Huffman编码。
+// 不插入动态表意味着对端的SETTINGS_HEADER_TABLE_SIZE不影响编码结果
+class HpackEncoder {
+public:
+    // 编码一个头部，name须为小写
+    static void encode(std::string_view name, std::string_view value, std::string* out);
+    // 编码:status，常见状态码直接引用静态表
+    static void encodeStatus(int code, std::string* out);
+};
+
+// Huffman编解码
+namespace hpack {
+
+size_t huffmanEncodedLength(std::string_view input);
+void huffmanEncode(std::string_view input, std::string* out);
+bool huffmanDecode(const char* data, size_t len, std::string* out);
+
+} // namespace hpack
+
+} // namespace core
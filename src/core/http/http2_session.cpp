@@ -0,0 +1,977 @@
+#include "core/http/http2_session.h"
+
+#include <ctype.h>
+#include <string.h>
+#include <algorithm>
+#include "core/http/http_date.h"
+#include "core/http/http_deferred_response.h"
+#include "core/http/http_request.h"
+#include "core/http/http_response.h"
+#include "core/net/tcp_connection.h"
+#include "core/utils/int_format.h"
+#include "core/utils/logger.h"
+
+namespace core {
+
+namespace {
+
+// 帧类型(RFC 7540 6)
+enum FrameType : uint8_t {
+    kFrameData = 0x0,
+    kFrameHeaders = 0x1,
+    kFramePriority = 0x2,
+    kFrameRstStream = 0x3,
+    kFrameSettings = 0x4,
+    kFramePushPromise = 0x5,
+    kFramePing = 0x6,
+    kFrameGoaway = 0x7,
+    kFrameWindowUpdate = 0x8,
+    kFrameContinuation = 0x9,
+};
+
+const uint8_t kFlagEndStream = 0x1;
+const uint8_t kFlagAck = 0x1;
+const uint8_t kFlagEndHeaders = 0x4;
+const uint8_t kFlagPadded = 0x8;
+const uint8_t kFlagPriority = 0x20;
+
+// 错误码(RFC 7540 7)
+enum ErrorCode : uint32_t {
+    kNoError = 0x0,
+    kProtocolError = 0x1,
+    kInternalError = 0x2,
+    kFlowControlError = 0x3,
+    kStreamClosed = 0x5,
+    kFrameSizeError = 0x6,
+    kRefusedStream = 0x7,
+    kCancel = 0x8,
+    kCompressionError = 0x9,
+    kEnhanceYourCalm = 0xb,
+};
+
+// SETTINGS参数
+enum SettingId : uint16_t {
+    kSettingsHeaderTableSize = 0x1,
+    kSettingsEnablePush = 0x2,
+    kSettingsMaxConcurrentStreams = 0x3,
+    kSettingsInitialWindowSize = 0x4,
+    kSettingsMaxFrameSize = 0x5,
+    kSettingsMaxHeaderListSize = 0x6,
+};
+
+const size_t kFrameHeaderSize = 9;
+const uint32_t kDefaultWindowSize = 65535;
+const int64_t kMaxWindowSize = 0x7fffffff;
+const uint32_t kMinFrameSize = 16384;
+const uint32_t kMaxFrameSize = 16777215;
+const size_t kMaxHeaderBlockSize = 256 * 1024;  // HEADERS + CONTINUATION累积的上限
+const size_t kOutputHighWater = 256 * 1024;     // 连接输出积压超过该值时暂停发送DATA帧
+
+uint16_t readUint16(const char* p) {
+    const uint8_t* b = reinterpret_cast<const uint8_t*>(p);
+    return static_cast<uint16_t>(b[0] << 8 | b[1]);
+}
+
+uint32_t readUint24(const char* p) {
+    const uint8_t* b = reinterpret_cast<const uint8_t*>(p);
+    return static_cast<uint32_t>(b[0]) << 16 | static_cast<uint32_t>(b[1]) << 8 | b[2];
+}
+
+uint32_t readUint32(const char* p) {
+    const uint8_t* b = reinterpret_cast<const uint8_t*>(p);
+    return static_cast<uint32_t>(b[0]) << 24 | static_cast<uint32_t>(b[1]) << 16
+         | static_cast<uint32_t>(b[2]) << 8 | b[3];
+}
+
+void appendUint32(Buffer* buf, uint32_t v) {
+    char b[4] = {
+        static_cast<char>(v >> 24), static_cast<char>(v >> 16),
+        static_cast<char>(v >> 8), static_cast<char>(v),
+    };
+    buf->append(b, sizeof b);
+}
+
+// 1xx、204、304响应不能携带主体
+bool statusAllowsBody(int code) {
+    return code >= 200 && code != 204 && code != 304;
+}
+
+// HTTP/2中没有意义的逐跳头部(RFC 7540 8.1.2.2)
+bool hopByHopHeader(std::string_view name) {
+    return name == "connection" || name == "keep-alive" || name == "proxy-connection"
+        || name == "transfer-encoding" || name == "upgrade";
+}
+
+bool hasUppercase(std::string_view s) {
+    for (char c : s) {
+        if (c >= 'A' && c <= 'Z') {
+            return true;
+        }
+    }
+    return false;
+}
+
+// HTTP2-Settings是base64url编码(不带填充)的SETTINGS负载
+bool decodeBase64Url(std::string_view in, std::string* out) {
+    uint32_t acc = 0;
+    int bits = 0;
+    for (char c : in) {
+        int v;
+        if (c >= 'A' && c <= 'Z') v = c - 'A';
+        else if (c >= 'a' && c <= 'z') v = c - 'a' + 26;
+        else if (c >= '0' && c <= '9') v = c - '0' + 52;
+        else if (c == '-' || c == '+') v = 62;
+        else if (c == '_' || c == '/') v = 63;
+        else if (c == '=') break;
+        else return false;
+        acc = (acc << 6) | v;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out->push_back(static_cast<char>(acc >> bits));
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+struct Http2Session::Stream {
+    Stream(uint32_t stream_id, int64_t send, int64_t recv)
+        : id(stream_id),
+          send_window(send),
+          recv_window(recv) {
+    }
+
+    uint32_t id;
+    HpackDecoder::HeaderList headers;  // 请求头部，HttpRequest中的视图指向这里
+    std::string body;                  // 请求体
+    std::string cookie;                // 拆分的cookie合并后的值
+    bool remote_closed = false;        // 已收到END_STREAM
+    bool responded = false;            // 已提交响应
+    bool blocked = false;              // 发送窗口耗尽，等待WINDOW_UPDATE
+    int64_t send_window;
+    int64_t recv_window;
+
+    // 正在发送主体的响应
+    std::unique_ptr<HttpResponse> response;
+    size_t sent = 0;                   // 已发送的主体字节数
+    size_t remaining = 0;              // 未发送的主体字节数
+
+    std::shared_ptr<HttpDeferredState> deferred;  // 等待完成的延迟响应
+};
+
+Http2Session::Http2Session(TcpConnection* conn, const Options& options, RequestCallback cb)
+    : conn_(conn),
+      options_(options),
+      request_callback_(std::move(cb)),
+      last_stream_id_(0),
+      header_stream_id_(0),
+      header_flags_(0),
+      send_window_(kDefaultWindowSize),
+      recv_window_(kDefaultWindowSize),
+      peer_initial_window_(kDefaultWindowSize),
+      peer_max_frame_size_(kMinFrameSize),
+      preface_received_(false),
+      settings_received_(false),
+      goaway_received_(false),
+      closed_(false) {
+    options_.max_frame_size = std::min(std::max(options_.max_frame_size, kMinFrameSize), kMaxFrameSize);
+    options_.initial_window_size = static_cast<uint32_t>(
+        std::min<int64_t>(options_.initial_window_size, kMaxWindowSize));
+    options_.connection_window_size = static_cast<uint32_t>(
+        std::min<int64_t>(std::max(options_.connection_window_size, kDefaultWindowSize), kMaxWindowSize));
+}
+
+Http2Session::~Http2Session() {
+    // 连接断开，取消各流尚未完成的延迟响应
+    for (auto& entry : streams_) {
+        if (entry.second->deferred) {
+            entry.second->deferred->cancel();
+        }
+    }
+}
+
+void Http2Session::start() {
+    const struct {
+        uint16_t id;
+        uint32_t value;
+    } settings[] = {
+        {kSettingsMaxConcurrentStreams, options_.max_concurrent_streams},
+        {kSettingsInitialWindowSize, options_.initial_window_size},
+        {kSettingsMaxFrameSize, options_.max_frame_size},
+        {kSettingsMaxHeaderListSize, static_cast<uint32_t>(options_.max_header_list_size)},
+    };
+    writeFrameHeader(sizeof settings / sizeof settings[0] * 6, kFrameSettings, 0, 0);
+    for (const auto& setting : settings) {
+        char id[2] = {static_cast<char>(setting.id >> 8), static_cast<char>(setting.id)};
+        output_.append(id, sizeof id);
+        appendUint32(&output_, setting.value);
+    }
+
+    // 连接级窗口不受SETTINGS控制，只能通过WINDOW_UPDATE扩大
+    if (options_.connection_window_size > kDefaultWindowSize) {
+        writeWindowUpdate(0, options_.connection_window_size - kDefaultWindowSize);
+        recv_window_ = options_.connection_window_size;
+    }
+    flush();
+}
+
+bool Http2Session::upgrade(std::string_view settings, const HttpRequest& req) {
+    std::string payload;
+    if (!decodeBase64Url(settings, &payload) || payload.size() % 6 != 0
+        || applySettings(payload.data(), payload.size()) != kNoError) {
+        return false;
+    }
+
+    static const char kSwitching[] = "HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n";
+    output_.append(kSwitching, sizeof kSwitching - 1);
+    start();
+
+    // 升级前的请求成为流1，处于半关闭(远端)状态，响应在流1上发送
+    last_stream_id_ = 1;
+    streams_.emplace(1, std::make_unique<Stream>(1, peer_initial_window_, options_.initial_window_size));
+    streams_[1]->remote_closed = true;
+    request_callback_(1, req);
+    flush();
+    return true;
+}
+
+void Http2Session::onMessage(Buffer* buf) {
+    if (!preface_received_) {
+        size_t n = std::min(buf->readableBytes(), kPreface.size());
+        if (memcmp(buf->peek(), kPreface.data(), n) != 0) {
+            buf->retrieveAll();
+            connectionError(kProtocolError, "invalid connection preface");
+            return;
+        }
+        if (n < kPreface.size()) {
+            return;
+        }
+        buf->retrieve(kPreface.size());
+        preface_received_ = true;
+    }
+
+    while (!closed_ && buf->readableBytes() >= kFrameHeaderSize) {
+        const char* p = buf->peek();
+        size_t length = readUint24(p);
+        uint8_t type = static_cast<uint8_t>(p[3]);
+        uint8_t flags = static_cast<uint8_t>(p[4]);
+        uint32_t stream_id = readUint32(p + 5) & 0x7fffffff;
+        if (length > options_.max_frame_size) {
+            connectionError(kFrameSizeError, "frame exceeds SETTINGS_MAX_FRAME_SIZE");
+            break;
+        }
+        if (buf->readableBytes() < kFrameHeaderSize + length) {
+            // 等待完整的帧
+            break;
+        }
+        handleFrame(type, flags, stream_id, p + kFrameHeaderSize, length);
+        buf->retrieve(kFrameHeaderSize + length);
+    }
+
+    if (closed_) {
+        buf->retrieveAll();
+    }
+    flush();
+}
+
+void Http2Session::onWriteComplete() {
+    if (!send_queue_.empty()) {
+        pumpData();
+        flush();
+    }
+}
+
+void Http2Session::handleFrame(uint8_t type, uint8_t flags, uint32_t stream_id, const char* payload, size_t len) {
+    if (header_stream_id_ != 0 && type != kFrameContinuation) {
+        connectionError(kProtocolError, "expected CONTINUATION");
+        return;
+    }
+    if (!settings_received_ && type != kFrameSettings) {
+        connectionError(kProtocolError, "first frame is not SETTINGS");
+        return;
+    }
+
+    switch (type) {
+        case kFrameData:
+            handleData(flags, stream_id, payload, len);
+            break;
+        case kFrameHeaders:
+            handleHeaders(flags, stream_id, payload, len);
+            break;
+        case kFrameContinuation:
+            handleContinuation(flags, stream_id, payload, len);
+            break;
+        case kFrameSettings:
+            handleSettings(flags, stream_id, payload, len);
+            break;
+        case kFrameWindowUpdate:
+            handleWindowUpdate(stream_id, payload, len);
+            break;
+        case kFrameRstStream:
+            handleRstStream(stream_id, payload, len);
+            break;
+        case kFramePriority:
+            // 不按优先级调度，各流轮流发送
+            if (stream_id == 0) {
+                connectionError(kProtocolError, "PRIORITY on stream 0");
+            } else if (len != 5) {
+                resetStream(stream_id, kFrameSizeError);
+            }
+            break;
+        case kFramePing:
+            if (stream_id != 0) {
+                connectionError(kProtocolError, "PING on non-zero stream");
+            } else if (len != 8) {
+                connectionError(kFrameSizeError, "invalid PING length");
+            } else if (!(flags & kFlagAck)) {
+                writeFrameHeader(8, kFramePing, kFlagAck, 0);
+                output_.append(payload, 8);
+            }
+            break;
+        case kFrameGoaway:
+            if (stream_id != 0) {
+                connectionError(kProtocolError, "GOAWAY on non-zero stream");
+                break;
+            }
+            // 客户端不再发起新的流，已有的流处理完后关闭连接
+            goaway_received_ = true;
+            if (streams_.empty()) {
+                closed_ = true;
+                flush();
+                conn_->shutdown();
+            }
+            break;
+        case kFramePushPromise:
+            connectionError(kProtocolError, "PUSH_PROMISE from client");
+            break;
+        default:
+            // 未知类型的帧直接忽略
+            break;
+    }
+}
+
+void Http2Session::handleHeaders(uint8_t flags, uint32_t stream_id, const char* payload, size_t len) {
+    if (stream_id == 0 || stream_id % 2 == 0) {
+        connectionError(kProtocolError, "HEADERS on invalid stream");
+        return;
+    }
+
+    size_t pos = 0;
+    size_t padding = 0;
+    if (flags & kFlagPadded) {
+        if (len < 1) {
+            connectionError(kFrameSizeError, "HEADERS too short");
+            return;
+        }
+        padding = static_cast<uint8_t>(payload[0]);
+        pos = 1;
+    }
+    if (flags & kFlagPriority) {
+        // 依赖关系和权重不使用
+        pos += 5;
+    }
+    if (pos + padding > len) {
+        connectionError(kProtocolError, "HEADERS padding exceeds payload");
+        return;
+    }
+
+    header_stream_id_ = stream_id;
+    header_flags_ = flags;
+    header_block_.assign(payload + pos, len - pos - padding);
+    if (flags & kFlagEndHeaders) {
+        finishHeaderBlock();
+    }
+}
+
+void Http2Session::handleContinuation(uint8_t flags, uint32_t stream_id, const char* payload, size_t len) {
+    if (header_stream_id_ == 0 || stream_id != header_stream_id_) {
+        connectionError(kProtocolError, "unexpected CONTINUATION");
+        return;
+    }
+    if (header_block_.size() + len > kMaxHeaderBlockSize) {
+        connectionError(kEnhanceYourCalm, "header block too large");
+        return;
+    }
+    header_block_.append(payload, len);
+    if (flags & kFlagEndHeaders) {
+        finishHeaderBlock();
+    }
+}
+
+void Http2Session::finishHeaderBlock() {
+    uint32_t stream_id = header_stream_id_;
+    uint8_t flags = header_flags_;
+    header_stream_id_ = 0;
+
+    // 无论流最终是否被接受，头部块都必须解码，保持动态表与对端同步
+    HpackDecoder::HeaderList headers;
+    HpackDecoder::Status status = decoder_.decode(header_block_.data(), header_block_.size(), &headers,
+                                                  options_.max_header_list_size);
+    header_block_.clear();
+    if (status == HpackDecoder::kError) {
+        connectionError(kCompressionError, "HPACK decoding failed");
+        return;
+    }
+
+    auto it = streams_.find(stream_id);
+    if (it != streams_.end()) {
+        // 已打开的流上的第二个头部块是trailers，必须结束流；内容不使用
+        Stream* stream = it->second.get();
+        if (stream->remote_closed) {
+            resetStream(stream_id, kStreamClosed);
+        } else if (!(flags & kFlagEndStream)) {
+            resetStream(stream_id, kProtocolError);
+        } else {
+            stream->remote_closed = true;
+            if (!stream->responded) {
+                dispatch(stream);
+            }
+        }
+        return;
+    }
+    if (stream_id <= last_stream_id_) {
+        // 已经关闭或被重置的流，对端可能还没收到RST_STREAM
+        return;
+    }
+
+    last_stream_id_ = stream_id;
+    if (goaway_received_ || streams_.size() >= options_.max_concurrent_streams) {
+        resetStream(stream_id, kRefusedStream);
+        return;
+    }
+
+    auto stream = std::make_unique<Stream>(stream_id, peer_initial_window_, options_.initial_window_size);
+    Stream* raw = stream.get();
+    streams_.emplace(stream_id, std::move(stream));
+    raw->remote_closed = (flags & kFlagEndStream) != 0;
+    if (status == HpackDecoder::kTooLarge) {
+        respondError(stream_id, HttpResponse::k431RequestHeaderFieldsTooLarge);
+        return;
+    }
+    raw->headers.swap(headers);
+    if (raw->remote_closed) {
+        dispatch(raw);
+    }
+}
+
+void Http2Session::handleData(uint8_t flags, uint32_t stream_id, const char* payload, size_t len) {
+    if (stream_id == 0) {
+        connectionError(kProtocolError, "DATA on stream 0");
+        return;
+    }
+
+    // 整个帧负载(含填充)计入流控
+    recv_window_ -= len;
+    if (recv_window_ < 0) {
+        connectionError(kFlowControlError, "connection receive window exceeded");
+        return;
+    }
+    // 数据立即从输入缓冲区取出，连接窗口消耗过半就归还，避免每帧一个WINDOW_UPDATE
+    if (recv_window_ <= options_.connection_window_size / 2) {
+        writeWindowUpdate(0, static_cast<uint32_t>(options_.connection_window_size - recv_window_));
+        recv_window_ = options_.connection_window_size;
+    }
+
+    size_t pos = 0;
+    size_t padding = 0;
+    if (flags & kFlagPadded) {
+        if (len < 1) {
+            connectionError(kFrameSizeError, "DATA too short");
+            return;
+        }
+        padding = static_cast<uint8_t>(payload[0]);
+        pos = 1;
+    }
+    if (pos + padding > len) {
+        connectionError(kProtocolError, "DATA padding exceeds payload");
+        return;
+    }
+
+    auto it = streams_.find(stream_id);
+    if (it == streams_.end() || it->second->remote_closed) {
+        if (stream_id > last_stream_id_) {
+            connectionError(kProtocolError, "DATA on idle stream");
+        } else if (it != streams_.end()) {
+            resetStream(stream_id, kStreamClosed);
+        }
+        // 已重置的流上仍在路上的数据直接丢弃
+        return;
+    }
+
+    Stream* stream = it->second.get();
+    stream->recv_window -= len;
+    if (stream->recv_window < 0) {
+        resetStream(stream_id, kFlowControlError);
+        return;
+    }
+
+    if (!stream->responded) {
+        size_t data_len = len - pos - padding;
+        if (stream->body.size() + data_len > options_.max_body_size) {
+            // 先回复413，响应发完后用RST_STREAM(NO_ERROR)让对端停止发送
+            stream->body.clear();
+            respondError(stream_id, HttpResponse::k413PayloadTooLarge);
+            return;
+        }
+        stream->body.append(payload + pos, data_len);
+    }
+
+    if (flags & kFlagEndStream) {
+        stream->remote_closed = true;
+        if (!stream->responded) {
+            dispatch(stream);
+        }
+    } else if (stream->recv_window <= options_.initial_window_size / 2) {
+        writeWindowUpdate(stream_id, static_cast<uint32_t>(options_.initial_window_size - stream->recv_window));
+        stream->recv_window = options_.initial_window_size;
+    }
+}
+
+void Http2Session::handleSettings(uint8_t flags, uint32_t stream_id, const char* payload, size_t len) {
+    if (stream_id != 0) {
+        connectionError(kProtocolError, "SETTINGS on non-zero stream");
+        return;
+    }
+    if (flags & kFlagAck) {
+        if (len != 0) {
+            connectionError(kFrameSizeError, "SETTINGS ACK with payload");
+        }
+        return;
+    }
+    if (len % 6 != 0) {
+        connectionError(kFrameSizeError, "invalid SETTINGS length");
+        return;
+    }
+
+    uint32_t error = applySettings(payload, len);
+    if (error != kNoError) {
+        connectionError(error, "invalid SETTINGS value");
+        return;
+    }
+    settings_received_ = true;
+    writeFrameHeader(0, kFrameSettings, kFlagAck, 0);
+    // 初始窗口可能变大，继续发送被阻塞的流
+    pumpData();
+}
+
+uint32_t Http2Session::applySettings(const char* payload, size_t len) {
+    for (size_t i = 0; i + 6 <= len; i += 6) {
+        uint16_t id = readUint16(payload + i);
+        uint32_t value = readUint32(payload + i + 2);
+        switch (id) {
+            case kSettingsEnablePush:
+                if (value > 1) {
+                    return kProtocolError;
+                }
+                break;
+            case kSettingsInitialWindowSize: {
+                if (value > kMaxWindowSize) {
+                    return kFlowControlError;
+                }
+                // 新的初始窗口按差值调整所有流的发送窗口，可能变为负数
+                int64_t delta = static_cast<int64_t>(value) - peer_initial_window_;
+                peer_initial_window_ = value;
+                for (auto& entry : streams_) {
+                    Stream* stream = entry.second.get();
+                    stream->send_window += delta;
+                    if (stream->send_window > kMaxWindowSize) {
+                        return kFlowControlError;
+                    }
+                    if (stream->blocked && stream->send_window > 0) {
+                        stream->blocked = false;
+                        send_queue_.push_back(stream->id);
+                    }
+                }
+                break;
+            }
+            case kSettingsMaxFrameSize:
+                if (value < kMinFrameSize || value > kMaxFrameSize) {
+                    return kProtocolError;
+                }
+                peer_max_frame_size_ = value;
+                break;
+            default:
+                // 编码器不使用动态表，HEADER_TABLE_SIZE不影响输出；未知参数忽略
+                break;
+        }
+    }
+    return kNoError;
+}
+
+void Http2Session::handleWindowUpdate(uint32_t stream_id, const char* payload, size_t len) {
+    if (len != 4) {
+        connectionError(kFrameSizeError, "invalid WINDOW_UPDATE length");
+        return;
+    }
+    uint32_t increment = readUint32(payload) & 0x7fffffff;
+
+    if (stream_id == 0) {
+        if (increment == 0) {
+            connectionError(kProtocolError, "zero WINDOW_UPDATE increment");
+            return;
+        }
+        send_window_ += increment;
+        if (send_window_ > kMaxWindowSize) {
+            connectionError(kFlowControlError, "connection send window overflow");
+            return;
+        }
+        pumpData();
+        return;
+    }
+
+    auto it = streams_.find(stream_id);
+    if (it == streams_.end()) {
+        if (stream_id > last_stream_id_) {
+            connectionError(kProtocolError, "WINDOW_UPDATE on idle stream");
+        }
+        return;
+    }
+    Stream* stream = it->second.get();
+    if (increment == 0) {
+        resetStream(stream_id, kProtocolError);
+        return;
+    }
+    stream->send_window += increment;
+    if (stream->send_window > kMaxWindowSize) {
+        resetStream(stream_id, kFlowControlError);
+        return;
+    }
+    if (stream->blocked && stream->send_window > 0) {
+        stream->blocked = false;
+        send_queue_.push_back(stream_id);
+        pumpData();
+    }
+}
+
+void Http2Session::handleRstStream(uint32_t stream_id, const char* payload, size_t len) {
+    (void)payload;
+    if (stream_id == 0 || stream_id > last_stream_id_) {
+        connectionError(kProtocolError, "RST_STREAM on idle stream");
+        return;
+    }
+    if (len != 4) {
+        connectionError(kFrameSizeError, "invalid RST_STREAM length");
+        return;
+    }
+    closeStream(stream_id);
+}
+
+void Http2Session::dispatch(Stream* stream) {
+    // cookie可能被拆成多个头部(RFC 7540 8.1.2.5)，合并成一个，兼容只取第一个Cookie头部的处理函数
+    size_t cookies = 0;
+    for (const auto& header : stream->headers) {
+        if (header.first == "cookie") {
+            if (cookies++ > 0) {
+                stream->cookie.append("; ", 2);
+            }
+            stream->cookie.append(header.second);
+        }
+    }
+
+    HttpRequest req;
+    std::string_view method;
+    std::string_view path;
+    std::string_view authority;
+    bool regular_seen = false;
+    for (const auto& header : stream->headers) {
+        std::string_view name = header.first;
+        std::string_view value = header.second;
+        if (!name.empty() && name[0] == ':') {
+            // 伪头部必须在普通头部之前
+            if (regular_seen) {
+                resetStream(stream->id, kProtocolError);
+                return;
+            }
+            if (name == ":method") {
+                method = value;
+            } else if (name == ":path") {
+                path = value;
+            } else if (name == ":authority") {
+                authority = value;
+            } else if (name != ":scheme") {
+                resetStream(stream->id, kProtocolError);
+                return;
+            }
+            continue;
+        }
+
+        regular_seen = true;
+        if (hasUppercase(name)) {
+            resetStream(stream->id, kProtocolError);
+            return;
+        }
+        if (hopByHopHeader(name)) {
+            continue;
+        }
+        if (name == "cookie" && cookies > 1) {
+            continue;
+        }
+        req.addHeader(name, value);
+    }
+    if (method.empty() || path.empty()) {
+        resetStream(stream->id, kProtocolError);
+        return;
+    }
+    if (cookies > 1) {
+        req.addHeader("cookie", stream->cookie);
+    }
+    if (!authority.empty() && req.getHeader("Host").empty()) {
+        req.addHeader("host", authority);
+    }
+
+    req.setMethod(HttpRequest::stringToMethod(method));
+    if (req.method() == HttpRequest::INVALID) {
+        // 与HTTP/1.1解析器一致，不支持的方法回复400
+        respondError(stream->id, HttpResponse::k400BadRequest);
+        return;
+    }
+    req.setPath(path);
+    req.setVersion(HttpRequest::HTTP20);
+    req.setBody(stream->body);
+
+    // 回调中可能已经提交响应并关闭了流，之后不能再访问stream
+    request_callback_(stream->id, req);
+}
+
+void Http2Session::submitResponse(uint32_t stream_id, HttpResponse* response) {
+    auto it = streams_.find(stream_id);
+    if (closed_ || it == streams_.end() || it->second->responded) {
+        return;
+    }
+    Stream* stream = it->second.get();
+    stream->responded = true;
+    stream->deferred.reset();
+
+    int code = responseStatus(*response);
+    HttpResponse error;
+    if (response->chunked()) {
+        LOG_ERROR("Http2Session::submitResponse - chunked response is not supported over HTTP/2, stream {}", stream_id);
+        error.setStatusCode(HttpResponse::k500InternalServerError);
+        response = &error;
+    }
+
+    bool has_body = statusAllowsBody(code);
+    size_t length = response->hasFileBody() ? response->fileBody().length : response->bodyData().size();
+
+    std::string block;
+    HpackEncoder::encodeStatus(code, &block);
+    if (has_body) {
+        char length_buf[kMaxUIntDigits];
+        size_t n = formatUInt(length, length_buf);
+        HpackEncoder::encode("content-length", std::string_view(length_buf, n), &block);
+    }
+
+    // Date和Server取自每线程缓存的"Name: value\r\n"头部块
+    std::string_view date_block = HttpDateCache::headerBlock();
+    std::string name;
+    while (!date_block.empty()) {
+        size_t eol = date_block.find("\r\n");
+        std::string_view line = date_block.substr(0, eol);
+        date_block = eol == std::string_view::npos ? std::string_view() : date_block.substr(eol + 2);
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos) {
+            continue;
+        }
+        name.assign(line.data(), colon);
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        HpackEncoder::encode(name, line.substr(colon + 2), &block);
+    }
+
+    // HTTP/2的头部名必须小写；Connection等逐跳头部不发送，closeConnection对单个流没有意义
+    for (const auto& header : response->headers()) {
+        name = header.first;
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        if (hopByHopHeader(name) || name == "content-length") {
+            continue;
+        }
+        HpackEncoder::encode(name, header.second, &block);
+    }
+
+    bool send_body = has_body && length > 0 && !response->omitBody();
+    writeHeaders(stream_id, block, !send_body);
+    if (!send_body) {
+        finishStream(stream);
+        flush();
+        return;
+    }
+
+    // 保存响应，主体按流控窗口分成DATA帧陆续发送
+    stream->response.reset(new HttpResponse(std::move(*response)));
+    stream->sent = 0;
+    stream->remaining = length;
+    send_queue_.push_back(stream_id);
+    pumpData();
+    flush();
+}
+
+int Http2Session::responseStatus(const HttpResponse& response) {
+    // 流上不承载WebSocket，HttpServer改为回复400
+    if (response.webSocket()) {
+        return HttpResponse::k400BadRequest;
+    }
+    // chunked生产者直接写连接，无法转成DATA帧
+    if (response.chunked() || response.statusCode() < 200) {
+        return HttpResponse::k500InternalServerError;
+    }
+    return response.statusCode();
+}
+
+void Http2Session::respondError(uint32_t stream_id, int status_code) {
+    HttpResponse response;
+    response.setStatusCode(static_cast<HttpResponse::StatusCode>(status_code));
+    submitResponse(stream_id, &response);
+}
+
+void Http2Session::setDeferred(uint32_t stream_id, std::shared_ptr<HttpDeferredState> state) {
+    auto it = streams_.find(stream_id);
+    if (it == streams_.end()) {
+        state->cancel();
+        return;
+    }
+    it->second->deferred = std::move(state);
+}
+
+// 每次从队首取一个流发送一帧，没发完的排到队尾，各流轮流占用连接窗口
+void Http2Session::pumpData() {
+    while (!closed_ && !send_queue_.empty() && send_window_ > 0) {
+        // 连接输出积压过多时等待排空(onWriteComplete)，不把整个主体复制进输出缓冲区
+        if (conn_->outputBytes() + output_.readableBytes() >= kOutputHighWater) {
+            break;
+        }
+        uint32_t stream_id = send_queue_.front();
+        send_queue_.pop_front();
+        auto it = streams_.find(stream_id);
+        if (it == streams_.end()) {
+            continue;
+        }
+        Stream* stream = it->second.get();
+        if (stream->send_window <= 0) {
+            stream->blocked = true;
+            continue;
+        }
+
+        size_t n = static_cast<size_t>(std::min<int64_t>(
+            {static_cast<int64_t>(stream->remaining), send_window_, stream->send_window,
+             static_cast<int64_t>(peer_max_frame_size_)}));
+        bool last = n == stream->remaining;
+        writeFrameHeader(n, kFrameData, last ? kFlagEndStream : 0, stream_id);
+        if (stream->response->hasFileBody()) {
+            // 帧头先发出，文件内容仍由连接零拷贝发送
+            const HttpResponse::FileBody& file = stream->response->fileBody();
+            flush();
+            conn_->sendFile(file.fd, file.offset + stream->sent, n, file.holder);
+        } else {
+            output_.append(stream->response->bodyData().data() + stream->sent, n);
+        }
+        stream->sent += n;
+        stream->remaining -= n;
+        stream->send_window -= n;
+        send_window_ -= n;
+
+        if (last) {
+            finishStream(stream);
+        } else {
+            send_queue_.push_back(stream_id);
+        }
+    }
+}
+
+void Http2Session::finishStream(Stream* stream) {
+    if (!stream->remote_closed) {
+        // 请求还没收完就已经响应(如413)，告知对端不必继续发送
+        resetStream(stream->id, kNoError);
+    } else {
+        closeStream(stream->id);
+    }
+}
+
+void Http2Session::resetStream(uint32_t stream_id, uint32_t error_code) {
+    writeFrameHeader(4, kFrameRstStream, 0, stream_id);
+    appendUint32(&output_, error_code);
+    closeStream(stream_id);
+}
+
+void Http2Session::closeStream(uint32_t stream_id) {
+    auto it = streams_.find(stream_id);
+    if (it == streams_.end()) {
+        return;
+    }
+    if (it->second->deferred) {
+        it->second->deferred->cancel();
+    }
+    // send_queue_中残留的ID在pumpData中跳过
+    streams_.erase(it);
+
+    if (goaway_received_ && streams_.empty() && !closed_) {
+        closed_ = true;
+        flush();
+        conn_->shutdown();
+    }
+}
+
+void Http2Session::connectionError(uint32_t error_code, const char* reason) {
+    if (closed_) {
+        return;
+    }
+    LOG_WARN("Http2Session::connectionError [{}] {}, error code = {}", conn_->name(), reason, error_code);
+    writeGoaway(error_code);
+    closed_ = true;
+    flush();
+    conn_->shutdown();
+
+    for (auto& entry : streams_) {
+        if (entry.second->deferred) {
+            entry.second->deferred->cancel();
+        }
+    }
+    streams_.clear();
+    send_queue_.clear();
+}
+
+void Http2Session::writeFrameHeader(size_t length, uint8_t type, uint8_t flags, uint32_t stream_id) {
+    char header[kFrameHeaderSize] = {
+        static_cast<char>(length >> 16), static_cast<char>(length >> 8), static_cast<char>(length),
+        static_cast<char>(type), static_cast<char>(flags),
+        static_cast<char>((stream_id >> 24) & 0x7f), static_cast<char>(stream_id >> 16),
+        static_cast<char>(stream_id >> 8), static_cast<char>(stream_id),
+    };
+    output_.append(header, sizeof header);
+}
+
+void Http2Session::writeHeaders(uint32_t stream_id, const std::string& block, bool end_stream) {
+    // 超过对端最大帧的头部块拆成HEADERS + CONTINUATION，中间不能插入其他帧
+    size_t n = std::min<size_t>(block.size(), peer_max_frame_size_);
+    uint8_t flags = end_stream ? kFlagEndStream : 0;
+    if (n == block.size()) {
+        flags |= kFlagEndHeaders;
+    }
+    writeFrameHeader(n, kFrameHeaders, flags, stream_id);
+    output_.append(block.data(), n);
+
+    for (size_t pos = n; pos < block.size(); pos += n) {
+        n = std::min<size_t>(block.size() - pos, peer_max_frame_size_);
+        writeFrameHeader(n, kFrameContinuation, pos + n == block.size() ? kFlagEndHeaders : 0, stream_id);
+        output_.append(block.data() + pos, n);
+    }
+}
+
+void Http2Session::writeWindowUpdate(uint32_t stream_id, uint32_t increment) {
+    writeFrameHeader(4, kFrameWindowUpdate, 0, stream_id);
+    appendUint32(&output_, increment);
+}
+
+void Http2Session::writeGoaway(uint32_t error_code) {
+    writeFrameHeader(8, kFrameGoaway, 0, 0);
+    appendUint32(&output_, last_stream_id_);
+    appendUint32(&output_, error_code);
+}
+
+void Http2Session::flush() {
+    if (output_.readableBytes() > 0) {
+        conn_->send(&output_);
+    }
+}
+
+} // namespace core
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "core/http/hpack.h"
+#include "core/net/buffer.h"
+
+namespace core {
+
+class HttpDeferredState;
+class HttpRequest;
+class HttpResponse;
+class TcpConnection;
+
+// 一个明文HTTP/2(h2c)连接：帧的收发、HPACK、流控和流的多路复用。
+// 由HttpServer在检测到连接前言(prior knowledge)或完成Upgrade: h2c后创建，保存在连接的上下文中。
+// 每个流的请求完整到达后通过RequestCallback交给与HTTP/1.1相同的处理流程，
+// 响应由submitResponse按流提交，多个流的DATA帧按流控窗口轮流发送
+class Http2Session {
+public:
+    struct Options {
+        uint32_t max_concurrent_streams = 128;          // 同时打开的流数，超过的流回复REFUSED_STREAM
+        uint32_t initial_window_size = 1024 * 1024;     // 每个流的接收窗口
+        uint32_t connection_window_size = 16 * 1024 * 1024;  // 连接的接收窗口
+        uint32_t max_frame_size = 16384;                // 可接收的最大帧负载
+        size_t max_header_list_size = 64 * 1024;        // 解码后请求头部的总大小，超过回复431
+        size_t max_body_size = 8 * 1024 * 1024;         // 内存中累积的请求体上限，超过回复413
+    };
+    
+    // 流的请求完整到达，请求只在回调期间有效
+    using RequestCallback = std::function<void(uint32_t stream_id, const HttpRequest&)>;
+    
+    // 客户端连接前言
+    static constexpr std::string_view kPreface = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+    
+    Http2Session(TcpConnection* conn, const Options& options, RequestCallback cb);
+    ~Http2Session();
+    
+    Http2Session(const Http2Session&) = delete;
+    Http2Session& operator=(const Http2Session&) = delete;
+    
+    // 发送服务端的SETTINGS，收到连接前言(prior knowledge)后调用
+    void start();
+    // Upgrade: h2c：settings为HTTP2-Settings头部的值。校验通过后回复101和SETTINGS，升级前的请求作为流1处理；
+    // 格式错误返回false，连接继续使用HTTP/1.1
+    bool upgrade(std::string_view settings, const HttpRequest& req);
+    
+    // 处理收到的数据，消费掉所有完整的帧
+    void onMessage(Buffer* buf);
+    // 连接输出缓冲区排空，继续发送因积压暂停的DATA帧
+    void onWriteComplete();
+    
+    // 提交流的响应，可在RequestCallback中或之后(延迟响应、压缩线程)调用；流已重置时忽略
+    void submitResponse(uint32_t stream_id, HttpResponse* response);
+    // 处理函数的响应在HTTP/2流上实际回复的状态码：chunked响应无法转成DATA帧、1xx不能作为最终响应，
+    // 都改为500；WebSocket升级回复400。指标按这个状态码统计，与客户端收到的一致
+    static int responseStatus(const HttpResponse& response);
+    // 登记流上等待中的延迟响应，流被重置或连接断开时取消
+    void setDeferred(uint32_t stream_id, std::shared_ptr<HttpDeferredState> state);
+    
+    // 打开的流数，为0时连接处于空闲状态
+    size_t activeStreams() const { return streams_.size(); }
+    // 已发送GOAWAY并关闭写端
+    bool closed() const { return closed_; }
+    
+private:
+    struct Stream;
+    
+    // 帧处理
+    void handleFrame(uint8_t type, uint8_t flags, uint32_t stream_id, const char* payload, size_t len);
+    void handleHeaders(uint8_t flags, uint32_t stream_id, const char* payload, size_t len);
+    void handleContinuation(uint8_t flags, uint32_t stream_id, const char* payload, size_t len);
+    void handleData(uint8_t flags, uint32_t stream_id, const char* payload, size_t len);
+    void handleSettings(uint8_t flags, uint32_t stream_id, const char* payload, size_t len);
+    void handleWindowUpdate(uint32_t stream_id, const char* payload, size_t len);
+    void handleRstStream(uint32_t stream_id, const char* payload, size_t len);
+    // 头部块接收完整后解码，END_STREAM时分派请求
+    void finishHeaderBlock();
+    void dispatch(Stream* stream);
+    // 不经过处理函数，直接以状态码回复流(400/413/431)
+    void respondError(uint32_t stream_id, int status_code);
+    
+    // 应用一组SETTINGS参数(每项6字节)，错误时返回对应的错误码
+    uint32_t applySettings(const char* payload, size_t len);
+    // 按流控窗口轮流发送各流待发的DATA帧
+    void pumpData();
+    // 流的响应发送完毕
+    void finishStream(Stream* stream);
+    // 以下两种错误分别重置一个流和关闭整个连接
+    void resetStream(uint32_t stream_id, uint32_t error_code);
+    void connectionError(uint32_t error_code, const char* reason);
+    void closeStream(uint32_t stream_id);
+    
+    // 帧编码
+    void writeFrameHeader(size_t length, uint8_t type, uint8_t flags, uint32_t stream_id);
+    void writeHeaders(uint32_t stream_id, const std::string& block, bool end_stream);
+    void writeWindowUpdate(uint32_t stream_id, uint32_t increment);
+    void writeGoaway(uint32_t error_code);
+    void flush();
+    
+    TcpConnection* conn_;
+    Options options_;
+    RequestCallback request_callback_;
+    HpackDecoder decoder_;
+    Buffer output_;                 // 本轮积累的帧，统一发送
+    
+    std::map<uint32_t, std::unique_ptr<Stream>> streams_;
+    std::deque<uint32_t> send_queue_;  // 有DATA待发送且窗口未耗尽的流，轮流发送
+    uint32_t last_stream_id_;       // 已接受的最大客户端流ID
+    
+    // 正在接收的头部块(HEADERS + CONTINUATION)
+    uint32_t header_stream_id_;     // 0表示没有
+    uint8_t header_flags_;          // HEADERS帧的标志
+    std::string header_block_;
+    
+    // 流控
+    int64_t send_window_;           // 连接的发送窗口
+    int64_t recv_window_;           // 连接的剩余接收窗口
+    uint32_t peer_initial_window_;  // 对端SETTINGS_INITIAL_WINDOW_SIZE
+    uint32_t peer_max_frame_size_;  // 对端SETTINGS_MAX_FRAME_SIZE
+    
+    bool preface_received_;
+    bool settings_received_;
+    bool goaway_received_;
+    bool closed_;
+};
+
+} // namespace core
@@ -0,0 +1,36 @@
+#include "core/http/http_chunk_writer.h"
+
+#include <stdio.h>
+#include "core/net/buffer.h"
+
+namespace core {
+
+void HttpChunkWriter::write(std::string_view data) {
+    if (data.empty()) {
+        return;
+    }
+    if (close_delimited_) {
+        conn_->send(data.data(), data.size());
+        return;
+    }
+    
+    // 长度行、数据和结尾CRLF拼在一起发送
+    char size_line[32];
+    int n = snprintf(size_line, sizeof size_line, "%zx\r\n", data.size());
+    Buffer chunk;
+    chunk.ensureWritableBytes(n + data.size() + 2);
+    chunk.append(size_line, n);
+    chunk.append(data.data(), data.size());
+    chunk.append("\r\n", 2);
+    conn_->send(&chunk);
+}
+
+void HttpChunkWriter::end() {
+    if (close_delimited_) {
+        // 主体的结尾由关闭连接表示
+        return;
+    }
+    conn_->send("0\r\n\r\n", 5);
+}
+
+} // namespace core
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string_view>
+#include "core/net/tcp_connection.h"
+
+namespace core {
+
+// chunked响应主体的写入器，由HttpServer在调用ChunkProducer时传入
+// 每次write()发送一个chunk：<16进制长度>\r\n<数据>\r\n
+// 发给HTTP/1.0客户端时不分chunk，数据原样发送，主体以关闭连接结束
+class HttpChunkWriter {
+public:
+    explicit HttpChunkWriter(const TcpConnection::TcpConnectionPtr& conn, bool close_delimited = false)
+        : conn_(conn),
+          close_delimited_(close_delimited) {
+    }
+    
+    // 发送一个chunk，空数据会被忽略（空chunk表示结束）
+    void write(std::string_view data);
+    
+    // 发送结束chunk
+    void end();
+    
+    // 连接输出缓冲区中尚未发出的字节数，生产者可据此决定本次写多少
+    size_t pendingBytes() const { return conn_->outputBytes(); }
+    
+    // 连接是否仍然可用
+    bool connected() const { return conn_->connected(); }
+    
+private:
+    TcpConnection::TcpConnectionPtr conn_;
+    bool close_delimited_;  // 不分chunk，原样发送
+};
+
+} // namespace core
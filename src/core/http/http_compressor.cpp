@@ -0,0 +1,337 @@
+#include "core/http/http_compressor.h"
+
+#include <limits.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <zlib.h>
+#include "core/http/http_request.h"
+#include "core/http/http_response.h"
+#include "core/reactor/event_loop.h"
+#include "core/thread/eventloop_thread.h"
+#include "core/utils/logger.h"
+
+namespace core {
+
+namespace {
+
+// deflateInit2会分配几百KB的内部状态，每个线程按编码各保留一个z_stream，用deflateReset复用
+struct Deflater {
+    z_stream stream;
+    bool initialized = false;
+    int level = 0;
+
+    ~Deflater() {
+        if (initialized) {
+            ::deflateEnd(&stream);
+        }
+    }
+};
+
+thread_local Deflater t_deflaters[2];  // 0: gzip, 1: deflate
+
+std::string_view trimWhitespace(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+        s.remove_prefix(1);
+    }
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+
+bool iequals(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && strncasecmp(a.data(), b.data(), a.size()) == 0;
+}
+
+// 解析"q=0.5"形式的权重，格式不对时按1处理
+double parseQuality(std::string_view params) {
+    size_t pos = params.find("q=");
+    if (pos == std::string_view::npos) {
+        return 1.0;
+    }
+    std::string_view value = trimWhitespace(params.substr(pos + 2));
+    double q = 0.0;
+    double scale = 1.0;
+    bool fraction = false;
+    for (char c : value) {
+        if (c == '.' && !fraction) {
+            fraction = true;
+        } else if (c >= '0' && c <= '9') {
+            if (fraction) {
+                scale /= 10;
+                q += (c - '0') * scale;
+            } else {
+                q = q * 10 + (c - '0');
+            }
+        } else {
+            break;
+        }
+    }
+    return q;
+}
+
+const char* const kCompressibleTypes[] = {
+    "text/",
+    "application/json",
+    "application/javascript",
+    "application/xml",
+    "application/wasm",
+    "image/svg+xml",
+};
+
+} // namespace
+
+HttpCompressor::HttpCompressor(Options options)
+    : options_(std::move(options)),
+      cache_hits_(0),
+      cache_misses_(0),
+      next_worker_(0) {
+}
+
+// 压缩线程的析构函数会退出并等待各自的事件循环
+HttpCompressor::~HttpCompressor() = default;
+
+HttpCompressor::Encoding HttpCompressor::negotiate(std::string_view accept_encoding) {
+    double gzip_q = -1;
+    double deflate_q = -1;
+    double any_q = -1;
+    while (!accept_encoding.empty()) {
+        size_t comma = accept_encoding.find(',');
+        std::string_view item = accept_encoding.substr(0, comma);
+        accept_encoding = comma == std::string_view::npos ? std::string_view() : accept_encoding.substr(comma + 1);
+
+        size_t semi = item.find(';');
+        std::string_view name = trimWhitespace(item.substr(0, semi));
+        double q = semi == std::string_view::npos ? 1.0 : parseQuality(item.substr(semi + 1));
+        if (iequals(name, "gzip") || iequals(name, "x-gzip")) {
+            gzip_q = q;
+        } else if (iequals(name, "deflate")) {
+            deflate_q = q;
+        } else if (name == "*") {
+            any_q = q;
+        }
+    }
+
+    // 没有单独列出的编码使用"*"的权重，q=0表示不可接受
+    if (gzip_q < 0) {
+        gzip_q = any_q;
+    }
+    if (deflate_q < 0) {
+        deflate_q = any_q;
+    }
+    if (gzip_q <= 0 && deflate_q <= 0) {
+        return kIdentity;
+    }
+    return gzip_q >= deflate_q ? kGzip : kDeflate;
+}
+
+const char* HttpCompressor::encodingName(Encoding encoding) {
+    switch (encoding) {
+        case kGzip: return "gzip";
+        case kDeflate: return "deflate";
+        default: return "identity";
+    }
+}
+
+bool HttpCompressor::compressibleType(std::string_view content_type) {
+    for (const char* prefix : kCompressibleTypes) {
+        size_t len = strlen(prefix);
+        if (content_type.size() >= len && strncasecmp(content_type.data(), prefix, len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool HttpCompressor::compress(Encoding encoding, std::string_view input, int level, std::string* output) {
+    if (encoding == kIdentity || input.size() > UINT_MAX) {
+        return false;
+    }
+
+    Deflater& deflater = t_deflaters[encoding == kGzip ? 0 : 1];
+    if (deflater.initialized && deflater.level != level) {
+        ::deflateEnd(&deflater.stream);
+        deflater.initialized = false;
+    }
+    if (!deflater.initialized) {
+        memset(&deflater.stream, 0, sizeof deflater.stream);
+        // windowBits加16输出gzip格式，否则为HTTP deflate要求的zlib格式
+        int window_bits = encoding == kGzip ? 15 + 16 : 15;
+        if (::deflateInit2(&deflater.stream, level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            LOG_ERROR("HttpCompressor::compress - deflateInit2 failed, level = {}", level);
+            return false;
+        }
+        deflater.initialized = true;
+        deflater.level = level;
+    } else {
+        ::deflateReset(&deflater.stream);
+    }
+
+    // 按上界一次分配，单次deflate(Z_FINISH)完成
+    z_stream& stream = deflater.stream;
+    output->resize(::deflateBound(&stream, static_cast<uLong>(input.size())));
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+    stream.avail_in = static_cast<uInt>(input.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&(*output)[0]);
+    stream.avail_out = static_cast<uInt>(output->size());
+
+    int ret = ::deflate(&stream, Z_FINISH);
+    output->resize(stream.total_out);
+    return ret == Z_STREAM_END;
+}
+
+std::string HttpCompressor::variantKey(Encoding encoding, std::string_view path, std::string_view etag) {
+    const char* name = encodingName(encoding);
+    std::string key;
+    key.reserve(strlen(name) + path.size() + etag.size() + 2);
+    key.append(name);
+    key.push_back('\0');
+    key.append(path.data(), path.size());
+    key.push_back('\0');
+    key.append(etag.data(), etag.size());
+    return key;
+}
+
+HttpCompressor::Result HttpCompressor::apply(const HttpRequest& req, HttpResponse* resp, Plan* plan) {
+    plan->encoding = kIdentity;
+    plan->cache_key.clear();
+    if (req.method() == HttpRequest::HEAD
+        || resp->statusCode() != HttpResponse::k200Ok
+        || resp->chunked()
+        || !resp->getHeader("Content-Encoding").empty()
+        || !compressibleType(resp->getHeader("Content-Type"))) {
+        return kSkipped;
+    }
+
+    size_t size = resp->hasFileBody() ? resp->fileBody().length : resp->bodyData().size();
+    if (size < options_.min_size) {
+        return kSkipped;
+    }
+
+    // 响应内容随Accept-Encoding变化，告知中间缓存
+    resp->addHeader("Vary", "Accept-Encoding");
+    Encoding negotiated = negotiate(req.getHeader("Accept-Encoding"));
+    if (negotiated == kIdentity) {
+        return kSkipped;
+    }
+    // 大文件保持sendfile零拷贝发送
+    if (resp->hasFileBody() && size > options_.max_cached_size) {
+        return kSkipped;
+    }
+
+    std::string_view etag = resp->getHeader("ETag");
+    if (options_.cache_entries > 0 && !etag.empty() && size <= options_.max_cached_size) {
+        plan->cache_key = variantKey(negotiated, req.path(), etag);
+        if (Variant variant = findVariant(plan->cache_key)) {
+            cache_hits_.fetch_add(1, std::memory_order_relaxed);
+            resp->setBodyView(*variant, variant);
+            resp->addHeader("Content-Encoding", encodingName(negotiated));
+            if (etag.front() == '"') {
+                resp->addHeader("ETag", "W/" + std::string(etag));
+            }
+            return kCompressed;
+        }
+        cache_misses_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    plan->encoding = negotiated;
+    if (options_.offload_size > 0 && size >= options_.offload_size) {
+        return kOffload;
+    }
+    return compressResponse(resp, *plan) ? kCompressed : kSkipped;
+}
+
+void HttpCompressor::compressAsync(EventLoop* loop, std::shared_ptr<HttpResponse> resp, Plan plan,
+                                   std::function<void()> done) {
+    nextWorker()->runInLoop([this, loop, resp, plan, done]() {
+        compressResponse(resp.get(), plan);
+        loop->runInLoop(done);
+    });
+}
+
+bool HttpCompressor::compressResponse(HttpResponse* resp, const Plan& plan) {
+    const Encoding encoding = plan.encoding;
+    std::string file_data;
+    std::string_view input = resp->bodyData();
+    if (resp->hasFileBody()) {
+        // 文件主体读入内存压缩，压缩结果进入缓存后不再读盘
+        const HttpResponse::FileBody& file = resp->fileBody();
+        file_data.resize(file.length);
+        size_t done = 0;
+        while (done < file.length) {
+            ssize_t n = ::pread(file.fd, &file_data[done], file.length - done, file.offset + done);
+            if (n <= 0) {
+                LOG_ERROR("HttpCompressor::compressResponse - pread fd={} failed: {}",
+                          file.fd, n == 0 ? "unexpected end of file" : strerror(errno));
+                return false;
+            }
+            done += n;
+        }
+        input = file_data;
+    }
+
+    auto output = std::make_shared<std::string>();
+    if (!compress(encoding, input, options_.level, output.get())) {
+        LOG_ERROR("HttpCompressor::compressResponse - {} failed, size = {}", encodingName(encoding), input.size());
+        return false;
+    }
+    if (output->size() >= input.size()) {
+        // 已经压缩过的内容，原样发送
+        return false;
+    }
+
+    if (!plan.cache_key.empty()) {
+        insertVariant(plan.cache_key, output);
+    }
+    std::string_view etag = resp->getHeader("ETag");
+
+    resp->setBodyView(*output, output);
+    resp->addHeader("Content-Encoding", encodingName(encoding));
+    // 压缩后的字节与原ETag不再逐字节一致，按惯例改为弱ETag，条件请求仍按弱比较命中
+    if (!etag.empty() && etag.front() == '"') {
+        resp->addHeader("ETag", "W/" + std::string(etag));
+    }
+    return true;
+}
+
+HttpCompressor::Variant HttpCompressor::findVariant(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = variants_.find(key);
+    if (it == variants_.end()) {
+        return nullptr;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->second;
+}
+
+void HttpCompressor::insertVariant(const std::string& key, Variant variant) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = variants_.find(key);
+    if (it != variants_.end()) {
+        it->second->second = std::move(variant);
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return;
+    }
+    lru_.emplace_front(key, std::move(variant));
+    variants_.emplace(key, lru_.begin());
+    while (variants_.size() > options_.cache_entries) {
+        variants_.erase(lru_.back().first);
+        lru_.pop_back();
+    }
+}
+
+EventLoop* HttpCompressor::nextWorker() {
+    // 第一次需要时才启动压缩线程
+    std::call_once(workers_once_, [this]() {
+        int threads = options_.offload_threads > 0 ? options_.offload_threads : 1;
+        for (int i = 0; i < threads; ++i) {
+            worker_threads_.emplace_back(new EventLoopThread(EventLoopThread::ThreadInitCallback(),
+                                                             "compress" + std::to_string(i)));
+            workers_.push_back(worker_threads_.back()->startLoop());
+        }
+    });
+    return workers_[next_worker_.fetch_add(1, std::memory_order_relaxed) % workers_.size()];
+}
+
+} // namespace core
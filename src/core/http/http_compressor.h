@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace core {
+
+class EventLoop;
+class EventLoopThread;
+class HttpRequest;
+class HttpResponse;
+
+// 响应压缩：按Accept-Encoding协商gzip/deflate，用zlib压缩响应主体。
+// 带ETag的响应(静态文件、可缓存的接口)把压缩结果缓存在预压缩变体缓存中，热点内容只压缩一次；
+// 无法命中缓存的大主体交给压缩线程，不阻塞IO线程
+class HttpCompressor {
+public:
+    enum Encoding {
+        kIdentity,
+        kGzip,
+        kDeflate,
+    };
+
+    struct Options {
+        size_t min_size = 1024;                     // 小于该大小的主体不压缩
+        int level = 6;                              // zlib压缩级别1~9
+        size_t cache_entries = 256;                 // 预压缩变体缓存的条目数，0表示不缓存
+        size_t max_cached_size = 4 * 1024 * 1024;   // 超过该大小的主体不缓存，文件主体也不读入内存压缩
+        size_t offload_size = 256 * 1024;           // 不小于该大小的主体在压缩线程中压缩，0表示总在IO线程压缩
+        int offload_threads = 1;                    // 压缩线程数
+    };
+
+    enum Result {
+        kSkipped,     // 不需要压缩
+        kCompressed,  // 已经压缩(或命中缓存)
+        kOffload,     // 需要调用compressAsync在压缩线程中完成
+    };
+
+    // apply的协商结果，返回kOffload时原样交给compressAsync
+    struct Plan {
+        Encoding encoding = kIdentity;
+        std::string cache_key;  // 预压缩变体缓存的键，为空表示结果不进入缓存
+    };
+
+    explicit HttpCompressor(Options options);
+    ~HttpCompressor();
+
+    HttpCompressor(const HttpCompressor&) = delete;
+    HttpCompressor& operator=(const HttpCompressor&) = delete;
+
+    // 根据Accept-Encoding选择编码，同等权重下优先gzip
+    static Encoding negotiate(std::string_view accept_encoding);
+    static const char* encodingName(Encoding encoding);
+    // 是否值得压缩的内容类型(文本、JSON、JavaScript、XML、SVG等)
+    static bool compressibleType(std::string_view content_type);
+    // 一次性压缩input，输出gzip或zlib(deflate)格式
+    static bool compress(Encoding encoding, std::string_view input, int level, std::string* output);
+
+    // 按请求协商并尝试压缩响应，可在任意IO线程中调用。
+    // 返回kOffload时*plan为协商结果，响应保持原样
+    Result apply(const HttpRequest& req, HttpResponse* resp, Plan* plan);
+
+    // 在压缩线程中按plan压缩resp，完成后在loop中调用done
+    void compressAsync(EventLoop* loop, std::shared_ptr<HttpResponse> resp, Plan plan,
+                       std::function<void()> done);
+
+    // 统计
+    uint64_t cacheHits() const { return cache_hits_.load(std::memory_order_relaxed); }
+    uint64_t cacheMisses() const { return cache_misses_.load(std::memory_order_relaxed); }
+
+private:
+    using Variant = std::shared_ptr<const std::string>;
+
+    // 压缩resp的主体并替换，plan带缓存键时放入缓存
+    bool compressResponse(HttpResponse* resp, const Plan& plan);
+    // 变体缓存的键：编码、请求路径和ETag。ETag只在一个资源内唯一(文件的ETag只由大小和修改时间构成)，
+    // 不同路径上相同的ETag不能共用压缩结果
+    static std::string variantKey(Encoding encoding, std::string_view path, std::string_view etag);
+    Variant findVariant(const std::string& key);
+    void insertVariant(const std::string& key, Variant variant);
+    EventLoop* nextWorker();
+
+    Options options_;
+
+    // 预压缩变体缓存，LRU淘汰；键见variantKey
+    std::mutex mutex_;
+    std::list<std::pair<std::string, Variant>> lru_;
+    std::unordered_map<std::string, std::list<std::pair<std::string, Variant>>::iterator> variants_;
+    std::atomic<uint64_t> cache_hits_;
+    std::atomic<uint64_t> cache_misses_;
+
+    // 压缩线程
+    std::once_flag workers_once_;
+    std::vector<std::unique_ptr<EventLoopThread>> worker_threads_;
+    std::vector<EventLoop*> workers_;
+    std::atomic<uint32_t> next_worker_;
+};
+
+} // namespace core
@@ -0,0 +1,55 @@
+#include "core/http/http_date.h"
+
+#include <time.h>
+#include <string.h>
+#include <chrono>
+#include "core/reactor/event_loop.h"
+
+namespace core {
+
+namespace {
+
+const char kServerHeader[] = "Server: GameForge\r\n";
+
+struct DateBlock {
+    char data[96];        // "Date: Sun, 18 Oct 2026 08:00:00 GMT\r\nServer: GameForge\r\n"
+    size_t len = 0;
+    time_t second = 0;    // 缓存对应的秒
+    bool timer = false;   // 是否由定时器负责刷新
+};
+
+thread_local DateBlock t_date;
+
+} // namespace
+
+void HttpDateCache::refresh() {
+    time_t now = ::time(nullptr);
+    struct tm tm_buf;
+    ::gmtime_r(&now, &tm_buf);
+    
+    size_t n = ::strftime(t_date.data, sizeof t_date.data, "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &tm_buf);
+    memcpy(t_date.data + n, kServerHeader, sizeof kServerHeader - 1);
+    t_date.len = n + sizeof kServerHeader - 1;
+    t_date.second = now;
+}
+
+std::string_view HttpDateCache::headerBlock() {
+    if (t_date.len == 0 || (!t_date.timer && ::time(nullptr) != t_date.second)) {
+        refresh();
+    }
+    return std::string_view(t_date.data, t_date.len);
+}
+
+void HttpDateCache::installTimer(EventLoop* loop) {
+    loop->assertInLoopThread();
+    if (t_date.timer) {
+        return;
+    }
+    t_date.timer = true;
+    refresh();
+    loop->getTimerManager()->addTimer(&HttpDateCache::refresh,
+                                      std::chrono::steady_clock::now() + std::chrono::seconds(1),
+                                      std::chrono::seconds(1));
+}
+
+} // namespace core
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string_view>
+
+namespace core {
+
+class EventLoop;
+
+// 每个IO线程缓存一份"Date: <RFC 7231时间>\r\nServer: ...\r\n"头部块，
+// 由loop上每秒触发一次的定时器刷新，序列化响应时直接拷贝，不再每次格式化时间
+class HttpDateCache {
+public:
+    // 获取当前线程的头部块；当前线程未安装定时器时，按秒懒刷新
+    static std::string_view headerBlock();
+    
+    // 立即刷新当前线程的缓存
+    static void refresh();
+    
+    // 在loop上安装每秒刷新的定时器，须在loop所属线程中调用
+    static void installTimer(EventLoop* loop);
+};
+
+} // namespace core
@@ -0,0 +1,137 @@
+#include "core/http/http_deferred_response.h"
+
+#include "core/http/http_response.h"
+#include "core/reactor/event_loop.h"
+
+namespace core {
+
+HttpDeferredState::HttpDeferredState()
+    : completed_(false),
+      cancelled_(false),
+      loop_(nullptr) {
+}
+
+HttpDeferredState::~HttpDeferredState() = default;
+
+bool HttpDeferredState::complete(HttpResponse&& response) {
+    auto pending = std::make_shared<HttpResponse>(std::move(response));
+    EventLoop* loop = nullptr;
+    Completion completion;
+    Observer observer;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (completed_ || cancelled_) {
+            return false;
+        }
+        completed_ = true;
+        if (!loop_) {
+            // 处理函数还没返回，由attach负责发送和回调观察者
+            early_response_.reset(new HttpResponse(std::move(*pending)));
+        } else {
+            loop = loop_;
+            // 完成后不再需要，同时断开completion对连接的引用
+            completion.swap(completion_);
+            observer.swap(observer_);
+        }
+    }
+    if (!loop) {
+        return true;
+    }
+
+    // 观察者随响应一起转到IO线程，统计只在IO线程中记录
+    loop->runInLoop([completion, observer, pending]() {
+        if (observer) {
+            observer(*pending);
+        }
+        completion(pending.get());
+    });
+    return true;
+}
+
+bool HttpDeferredState::cancelled() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cancelled_;
+}
+
+void HttpDeferredState::setCancelCallback(std::function<void()> cb) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!cancelled_) {
+            cancel_callback_ = std::move(cb);
+            return;
+        }
+    }
+    cb();
+}
+
+void HttpDeferredState::observe(Observer observer) {
+    const HttpResponse* early;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (cancelled_) {
+            return;
+        }
+        if (!early_response_) {
+            observer_ = std::move(observer);
+            return;
+        }
+        // early_response_只由attach和cancel释放，二者与这里同在IO线程中执行
+        early = early_response_.get();
+    }
+    observer(*early);
+}
+
+void HttpDeferredState::attach(EventLoop* loop, Completion completion) {
+    loop->assertInLoopThread();
+    std::shared_ptr<HttpResponse> pending;
+    Observer observer;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (cancelled_) {
+            return;
+        }
+        if (!early_response_) {
+            loop_ = loop;
+            completion_ = std::move(completion);
+            return;
+        }
+        pending.reset(early_response_.release());
+        observer.swap(observer_);
+    }
+
+    // 调用方正在处理请求，排到本轮循环之后再发送，避免重入
+    loop->queueInLoop([completion, observer, pending]() {
+        if (observer) {
+            observer(*pending);
+        }
+        completion(pending.get());
+    });
+}
+
+void HttpDeferredState::cancel() {
+    std::function<void()> cb;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (cancelled_) {
+            return;
+        }
+        cancelled_ = true;
+        completion_ = nullptr;
+        observer_ = nullptr;
+        early_response_.reset();
+        if (completed_) {
+            // 响应已经交给IO线程，不需要取消后端
+            return;
+        }
+        cb.swap(cancel_callback_);
+    }
+    if (cb) {
+        cb();
+    }
+}
+
+bool HttpDeferredResponse::complete(HttpResponse response) {
+    return state_ && state_->complete(std::move(response));
+}
+
+} // namespace core
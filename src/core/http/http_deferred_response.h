@@ -0,0 +1,89 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace core {
+
+class EventLoop;
+class HttpResponse;
+
+// 延迟响应的共享状态，由处理函数持有的HttpDeferredResponse和连接的上下文共同引用
+class HttpDeferredState {
+public:
+    // 在连接所属的IO线程中发送完成的响应
+    using Completion = std::function<void(HttpResponse*)>;
+
+    HttpDeferredState();
+    ~HttpDeferredState();
+
+    // 任意线程：只有第一次调用生效，已取消时返回false
+    bool complete(HttpResponse&& response);
+    bool cancelled() const;
+    void setCancelCallback(std::function<void()> cb);
+    // 登记响应完成时的观察者，参数为完成的响应，用于统计；随响应一起转到IO线程，在发送之前回调，
+    // 不在后端线程中执行。须在IO线程中、处理函数返回后attach之前登记，此前已完成的响应立即回调；
+    // 连接断开时不回调
+    using Observer = std::function<void(const HttpResponse&)>;
+    void observe(Observer observer);
+
+    // IO线程：处理函数返回后由HttpServer登记发送方式；此前已完成的响应排到本轮循环之后发送
+    void attach(EventLoop* loop, Completion completion);
+    // IO线程：连接断开，丢弃尚未完成的响应并回调取消函数
+    void cancel();
+
+private:
+    mutable std::mutex mutex_;
+    bool completed_;
+    bool cancelled_;
+    std::unique_ptr<HttpResponse> early_response_;  // attach之前就完成的响应
+    EventLoop* loop_;
+    Completion completion_;
+    std::function<void()> cancel_callback_;
+    Observer observer_;
+};
+
+// 延迟响应句柄：处理函数调用HttpResponse::defer()得到它，之后可以在任意线程中完成响应。
+//   server.setHttpCallback([](const HttpRequest& req, HttpResponse* resp) {
+//       auto deferred = resp->defer();
+//       std::string key(req.path());   // 请求只在处理函数执行期间有效，需要的数据先拷贝出来
+//       backend.query(key, [deferred](std::string value) mutable {
+//           HttpResponse r;
+//           r.setStatusCode(HttpResponse::k200Ok);
+//           r.setBody(std::move(value));
+//           deferred.complete(std::move(r));
+//       });
+//   });
+// 完成之前，同一连接上pipelined的后续请求不会被处理，响应顺序保持不变；
+// 客户端先断开时句柄被取消，complete()返回false
+class HttpDeferredResponse {
+public:
+    HttpDeferredResponse() = default;
+
+    bool valid() const { return static_cast<bool>(state_); }
+
+    // 完成响应，可在任意线程中调用；只有第一次调用生效，连接已断开时返回false
+    bool complete(HttpResponse response);
+
+    // 客户端是否已断开
+    bool cancelled() const { return state_ && state_->cancelled(); }
+
+    // 客户端断开时在连接所属的IO线程中回调，用于取消后端的工作；已经断开时立即回调
+    void setCancelCallback(std::function<void()> cb) {
+        if (state_) {
+            state_->setCancelCallback(std::move(cb));
+        }
+    }
+
+private:
+    friend class HttpResponse;
+
+    explicit HttpDeferredResponse(std::shared_ptr<HttpDeferredState> state)
+        : state_(std::move(state)) {
+    }
+
+    std::shared_ptr<HttpDeferredState> state_;
+};
+
+} // namespace core
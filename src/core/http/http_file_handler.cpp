@@ -0,0 +1,598 @@
+#include "core/http/http_file_handler.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include "core/http/http_response.h"
+#include "core/net/channel.h"
+#include "core/reactor/event_loop.h"
+#include "core/utils/logger.h"
+
+namespace core {
+
+// 缓存的文件：fd与元数据，最后一个引用(缓存或正在发送的响应)释放时关闭fd
+struct HttpFileHandler::FileEntry {
+    int fd = -1;
+    int wd = -1;                   // inotify监视，不缓存时为-1
+    size_t size = 0;
+    time_t mtime = 0;
+    std::string etag;              // "inode-大小-修改时间(ns)"，均为十六进制
+    std::string last_modified;     // RFC 7231格式的修改时间
+    std::string_view content_type;
+    uint32_t hits = 0;             // 命中次数，在mutex_保护下修改
+    bool loading = false;          // 正在读入内存，在mutex_保护下修改
+    std::string data;              // 读入内存的副本，在mutex_保护下设置一次，之后不再修改
+
+    ~FileEntry() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+};
+
+namespace {
+
+const struct {
+    const char* ext;
+    const char* type;
+} kMimeTypes[] = {
+    {"html", "text/html; charset=utf-8"},
+    {"htm", "text/html; charset=utf-8"},
+    {"css", "text/css; charset=utf-8"},
+    {"js", "application/javascript; charset=utf-8"},
+    {"mjs", "application/javascript; charset=utf-8"},
+    {"json", "application/json"},
+    {"map", "application/json"},
+    {"txt", "text/plain; charset=utf-8"},
+    {"xml", "application/xml"},
+    {"svg", "image/svg+xml"},
+    {"png", "image/png"},
+    {"jpg", "image/jpeg"},
+    {"jpeg", "image/jpeg"},
+    {"gif", "image/gif"},
+    {"webp", "image/webp"},
+    {"ico", "image/x-icon"},
+    {"wasm", "application/wasm"},
+    {"woff", "font/woff"},
+    {"woff2", "font/woff2"},
+    {"ttf", "font/ttf"},
+    {"mp3", "audio/mpeg"},
+    {"ogg", "audio/ogg"},
+    {"mp4", "video/mp4"},
+    {"pdf", "application/pdf"},
+};
+
+std::string_view mimeType(std::string_view path) {
+    size_t dot = path.rfind('.');
+    if (dot == std::string_view::npos || path.find('/', dot) != std::string_view::npos) {
+        return "application/octet-stream";
+    }
+    std::string_view ext = path.substr(dot + 1);
+    for (const auto& mime : kMimeTypes) {
+        if (ext.size() == strlen(mime.ext) && strncasecmp(ext.data(), mime.ext, ext.size()) == 0) {
+            return mime.type;
+        }
+    }
+    return "application/octet-stream";
+}
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// 解码%XX并规范化为相对根目录的路径，拒绝".."和NUL，防止越出根目录
+bool normalizePath(std::string_view raw, std::string* out) {
+    size_t query = raw.find('?');
+    if (query != std::string_view::npos) {
+        raw = raw.substr(0, query);
+    }
+
+    std::string decoded;
+    decoded.reserve(raw.size());
+    for (size_t i = 0; i < raw.size(); ++i) {
+        char c = raw[i];
+        if (c == '%') {
+            if (i + 2 >= raw.size() || hexValue(raw[i + 1]) < 0 || hexValue(raw[i + 2]) < 0) {
+                return false;
+            }
+            c = static_cast<char>(hexValue(raw[i + 1]) * 16 + hexValue(raw[i + 2]));
+            i += 2;
+        }
+        if (c == '\0') {
+            return false;
+        }
+        decoded.push_back(c);
+    }
+
+    out->clear();
+    size_t pos = 0;
+    while (pos <= decoded.size()) {
+        size_t slash = decoded.find('/', pos);
+        if (slash == std::string::npos) {
+            slash = decoded.size();
+        }
+        std::string_view segment(decoded.data() + pos, slash - pos);
+        if (segment == "..") {
+            return false;
+        }
+        if (!segment.empty() && segment != ".") {
+            if (!out->empty()) {
+                out->push_back('/');
+            }
+            out->append(segment.data(), segment.size());
+        }
+        pos = slash + 1;
+    }
+    return true;
+}
+
+std::string formatHttpDate(time_t t) {
+    struct tm tm_buf;
+    ::gmtime_r(&t, &tm_buf);
+    char buf[64];
+    size_t n = ::strftime(buf, sizeof buf, "%a, %d %b %Y %H:%M:%S GMT", &tm_buf);
+    return std::string(buf, n);
+}
+
+bool parseHttpDate(std::string_view str, time_t* t) {
+    char buf[64];
+    if (str.size() >= sizeof buf) {
+        return false;
+    }
+    memcpy(buf, str.data(), str.size());
+    buf[str.size()] = '\0';
+
+    struct tm tm_buf;
+    memset(&tm_buf, 0, sizeof tm_buf);
+    const char* end = ::strptime(buf, "%a, %d %b %Y %H:%M:%S GMT", &tm_buf);
+    if (end == nullptr || *end != '\0') {
+        return false;
+    }
+    *t = ::timegm(&tm_buf);
+    return true;
+}
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+        s.remove_prefix(1);
+    }
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+
+// If-None-Match是逗号分隔的ETag列表，按弱比较匹配
+bool etagMatches(std::string_view list, std::string_view etag) {
+    list = trim(list);
+    if (list == "*") {
+        return true;
+    }
+    while (!list.empty()) {
+        size_t comma = list.find(',');
+        std::string_view tag = trim(list.substr(0, comma));
+        if (tag.size() > 2 && tag[0] == 'W' && tag[1] == '/') {
+            tag.remove_prefix(2);
+        }
+        if (tag == etag) {
+            return true;
+        }
+        if (comma == std::string_view::npos) {
+            break;
+        }
+        list.remove_prefix(comma + 1);
+    }
+    return false;
+}
+
+bool parseSize(std::string_view s, size_t* value) {
+    if (s.empty() || s.size() > 19) {
+        return false;
+    }
+    size_t v = 0;
+    for (char c : s) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        v = v * 10 + (c - '0');
+    }
+    *value = v;
+    return true;
+}
+
+enum RangeResult {
+    kRangeIgnored,         // 没有可用的Range，回复完整文件
+    kRangeOk,              // 回复[begin, begin + length)
+    kRangeUnsatisfiable,   // 回复416
+};
+
+// 解析单个区间"bytes=a-b"、"bytes=a-"或"bytes=-n"；多区间和无法识别的格式按忽略处理
+RangeResult parseRange(std::string_view header, size_t size, size_t* begin, size_t* length) {
+    header = trim(header);
+    if (header.size() < 6 || strncasecmp(header.data(), "bytes=", 6) != 0) {
+        return kRangeIgnored;
+    }
+    std::string_view spec = trim(header.substr(6));
+    size_t dash = spec.find('-');
+    if (dash == std::string_view::npos || spec.find(',') != std::string_view::npos) {
+        return kRangeIgnored;
+    }
+    std::string_view first = trim(spec.substr(0, dash));
+    std::string_view last = trim(spec.substr(dash + 1));
+
+    if (first.empty()) {
+        // 最后n个字节
+        size_t n = 0;
+        if (!parseSize(last, &n)) {
+            return kRangeIgnored;
+        }
+        if (n == 0 || size == 0) {
+            return kRangeUnsatisfiable;
+        }
+        *begin = size - std::min(n, size);
+        *length = size - *begin;
+        return kRangeOk;
+    }
+
+    size_t b = 0;
+    size_t e = 0;
+    if (!parseSize(first, &b)) {
+        return kRangeIgnored;
+    }
+    if (last.empty()) {
+        e = size - 1;
+    } else if (!parseSize(last, &e) || e < b) {
+        return kRangeIgnored;
+    }
+    if (b >= size) {
+        return kRangeUnsatisfiable;
+    }
+    e = std::min(e, size - 1);
+    *begin = b;
+    *length = e - b + 1;
+    return kRangeOk;
+}
+
+const uint32_t kWatchMask = IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF;
+
+// 把文件完整读入out；读到的长度不符(文件被截断或追加)时返回false
+bool readWhole(int fd, size_t size, std::string* out) {
+    out->resize(size);
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = ::pread(fd, &(*out)[done], size - done, static_cast<off_t>(done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+    char extra;
+    return ::pread(fd, &extra, 1, static_cast<off_t>(size)) == 0;
+}
+
+} // namespace
+
+HttpFileHandler::HttpFileHandler(EventLoop* loop, Options options)
+    : loop_(loop),
+      options_(std::move(options)),
+      inotify_fd_(::inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {
+    if (options_.root.empty()) {
+        options_.root = ".";
+    }
+    if (inotify_fd_ < 0) {
+        // 无法感知文件变化时不缓存，每个请求重新打开文件
+        LOG_ERROR("HttpFileHandler::HttpFileHandler - inotify_init1 failed: {}, file cache disabled", strerror(errno));
+        return;
+    }
+    inotify_channel_.reset(new Channel(loop_, inotify_fd_));
+    inotify_channel_->setReadCallback(std::bind(&HttpFileHandler::handleInotify, this));
+    inotify_channel_->enableReading();
+}
+
+HttpFileHandler::~HttpFileHandler() {
+    if (inotify_channel_) {
+        inotify_channel_->disableAll();
+        inotify_channel_->remove();
+    }
+    if (inotify_fd_ >= 0) {
+        ::close(inotify_fd_);
+    }
+}
+
+HttpRouter::Handler HttpFileHandler::handler() {
+    return [this](const HttpRequest& req, const RouteParams& params, HttpResponse* resp) {
+        handle(req, params, resp);
+    };
+}
+
+size_t HttpFileHandler::cachedFiles() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return files_.size();
+}
+
+void HttpFileHandler::handle(const HttpRequest& req, const RouteParams& params, HttpResponse* resp) {
+    std::string_view raw = params.size() > 0 ? params[params.size() - 1].second : req.path();
+    std::string path;
+    const char* data = nullptr;
+    FileEntryPtr entry;
+    if (normalizePath(raw, &path)) {
+        entry = lookup(path, &data);
+    }
+    if (!entry) {
+        resp->setStatusCode(HttpResponse::k404NotFound);
+        resp->setStatusMessage("Not Found");
+        return;
+    }
+
+    resp->addHeader("ETag", entry->etag);
+    resp->addHeader("Last-Modified", entry->last_modified);
+    resp->addHeader("Accept-Ranges", "bytes");
+    if (options_.max_age > 0) {
+        resp->addHeader("Cache-Control", "max-age=" + std::to_string(options_.max_age));
+    }
+
+    // 条件请求：If-None-Match优先，存在时忽略If-Modified-Since
+    bool not_modified = false;
+    std::string_view if_none_match = req.getHeader("If-None-Match");
+    std::string_view if_modified_since = req.getHeader("If-Modified-Since");
+    if (!if_none_match.empty()) {
+        not_modified = etagMatches(if_none_match, entry->etag);
+    } else if (!if_modified_since.empty()) {
+        time_t since = 0;
+        not_modified = if_modified_since == entry->last_modified
+                    || (parseHttpDate(if_modified_since, &since) && entry->mtime <= since);
+    }
+    if (not_modified) {
+        resp->setStatusCode(HttpResponse::k304NotModified);
+        return;
+    }
+
+    size_t begin = 0;
+    size_t length = entry->size;
+    HttpResponse::StatusCode code = HttpResponse::k200Ok;
+    std::string_view range = req.getHeader("Range");
+    std::string_view if_range = trim(req.getHeader("If-Range"));
+    // If-Range不匹配说明客户端手里的片段已过期，回复完整文件
+    if (!range.empty() && (if_range.empty() || if_range == entry->etag || if_range == entry->last_modified)) {
+        switch (parseRange(range, entry->size, &begin, &length)) {
+            case kRangeOk:
+                code = HttpResponse::k206PartialContent;
+                resp->addHeader("Content-Range", "bytes " + std::to_string(begin) + "-"
+                                + std::to_string(begin + length - 1) + "/" + std::to_string(entry->size));
+                break;
+            case kRangeUnsatisfiable:
+                resp->setStatusCode(HttpResponse::k416RangeNotSatisfiable);
+                resp->addHeader("Content-Range", "bytes */" + std::to_string(entry->size));
+                return;
+            case kRangeIgnored:
+                break;
+        }
+    }
+
+    resp->setStatusCode(code);
+    resp->setContentType(std::string(entry->content_type));
+    if (data) {
+        resp->setBodyView(std::string_view(data + begin, length), entry);
+    } else {
+        resp->setFileBody(entry->fd, static_cast<off_t>(begin), length, entry);
+    }
+}
+
+HttpFileHandler::FileEntryPtr HttpFileHandler::lookup(const std::string& path, const char** data) {
+    *data = nullptr;
+    if (inotify_fd_ < 0) {
+        return openFile(path);
+    }
+
+    FileEntryPtr entry;
+    uint64_t unmatched = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = files_.find(path);
+        if (it != files_.end()) {
+            entry = it->second;
+        }
+        unmatched = unmatched_events_;
+    }
+
+    if (!entry) {
+        // stat/inotify_add_watch/open都在锁外进行，只在发布条目时加锁
+        FileEntryPtr opened = openFile(path);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!opened) {
+            return nullptr;
+        }
+        auto it = files_.find(path);
+        if (it != files_.end()) {
+            // 其他线程已经发布了同一路径，用它的条目；wd相同，监视由那个条目持有
+            entry = it->second;
+            if (opened->wd != entry->wd && watches_.find(opened->wd) == watches_.end()) {
+                ::inotify_rm_watch(inotify_fd_, opened->wd);
+            }
+        } else if (unmatched != unmatched_events_) {
+            // 建立监视到发布之间有事件没找到条目，可能正是这个文件的修改，
+            // 本次照常回复但不缓存，下次请求重新打开
+            if (watches_.find(opened->wd) == watches_.end()) {
+                ::inotify_rm_watch(inotify_fd_, opened->wd);
+            }
+            opened->wd = -1;
+            return opened;
+        } else {
+            if (files_.size() >= options_.max_cached_files) {
+                // 淘汰任意一个条目，正在发送中的响应仍持有它的fd
+                std::string victim = files_.begin()->first;
+                removeLocked(victim);
+            }
+            entry = opened;
+            files_.emplace(path, entry);
+            watches_[entry->wd].push_back(path);
+        }
+    }
+
+    // 小的热点文件读入内存，之后随响应头一次写出，省去sendfile调用。
+    // 读的是私有副本而不是mmap：文件被截断时mmap的页访问会触发SIGBUS，副本不受影响
+    bool load = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++entry->hits;
+        if (!entry->data.empty()) {
+            *data = entry->data.data();
+            return entry;
+        }
+        load = !entry->loading && options_.memory_max_size > 0 && entry->size > 0
+            && entry->size <= options_.memory_max_size && entry->hits >= options_.memory_min_hits;
+        if (!load) {
+            return entry;
+        }
+        entry->loading = true;
+    }
+
+    std::string content;
+    bool ok = readWhole(entry->fd, entry->size, &content);
+    if (!ok) {
+        // 文件在缓存之后被改动，inotify很快会让条目失效，这之前仍用sendfile发送
+        LOG_DEBUG("HttpFileHandler::lookup - {} changed while reading, size = {}", path, entry->size);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    entry->loading = false;
+    if (ok) {
+        entry->data.swap(content);
+        *data = entry->data.data();
+    }
+    return entry;
+}
+
+HttpFileHandler::FileEntryPtr HttpFileHandler::openFile(const std::string& path) {
+    std::string full = options_.root;
+    if (!path.empty()) {
+        full += '/';
+        full += path;
+    }
+    struct stat st;
+    if (::stat(full.c_str(), &st) < 0) {
+        return nullptr;
+    }
+    if (S_ISDIR(st.st_mode)) {
+        full += '/';
+        full += options_.index;
+    }
+
+    // 先建立监视再打开和读取元数据，之后的任何变化都会触发失效
+    int wd = -1;
+    if (inotify_fd_ >= 0) {
+        wd = ::inotify_add_watch(inotify_fd_, full.c_str(), kWatchMask);
+        if (wd < 0) {
+            if (errno != ENOENT) {
+                LOG_WARN("HttpFileHandler::openFile - inotify_add_watch {} failed: {}", full, strerror(errno));
+            }
+            return nullptr;
+        }
+    }
+
+    auto entry = std::make_shared<FileEntry>();
+    entry->wd = wd;
+    entry->fd = ::open(full.c_str(), O_RDONLY | O_CLOEXEC);
+    if (entry->fd < 0 || ::fstat(entry->fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        if (wd >= 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (watches_.find(wd) == watches_.end()) {
+                ::inotify_rm_watch(inotify_fd_, wd);
+            }
+        }
+        return nullptr;
+    }
+
+    entry->size = static_cast<size_t>(st.st_size);
+    entry->mtime = st.st_mtim.tv_sec;
+    // 带上inode：文件被替换成大小和修改时间都相同的新文件时ETag也会变
+    char etag[80];
+    unsigned long long mtime_ns = static_cast<unsigned long long>(st.st_mtim.tv_sec) * 1000000000ULL
+                                + static_cast<unsigned long long>(st.st_mtim.tv_nsec);
+    int n = snprintf(etag, sizeof etag, "\"%llx-%zx-%llx\"",
+                     static_cast<unsigned long long>(st.st_ino), entry->size, mtime_ns);
+    entry->etag.assign(etag, n);
+    entry->last_modified = formatHttpDate(entry->mtime);
+    entry->content_type = mimeType(full);
+    return entry;
+}
+
+void HttpFileHandler::removeLocked(const std::string& path) {
+    auto it = files_.find(path);
+    if (it == files_.end()) {
+        return;
+    }
+    int wd = it->second->wd;
+    files_.erase(it);
+
+    auto watch = watches_.find(wd);
+    if (watch != watches_.end()) {
+        auto& paths = watch->second;
+        paths.erase(std::remove(paths.begin(), paths.end(), path), paths.end());
+        if (paths.empty()) {
+            watches_.erase(watch);
+            ::inotify_rm_watch(inotify_fd_, wd);
+        }
+    }
+}
+
+void HttpFileHandler::handleInotify() {
+    loop_->assertInLoopThread();
+
+    alignas(struct inotify_event) char buf[4096];
+    for (;;) {
+        ssize_t n = ::read(inotify_fd_, buf, sizeof buf);
+        if (n <= 0) {
+            if (n < 0 && errno != EAGAIN && errno != EINTR) {
+                LOG_ERROR("HttpFileHandler::handleInotify - read failed: {}", strerror(errno));
+            }
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (char* p = buf; p < buf + n; ) {
+            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(p);
+            p += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                // 事件丢失，无法确定哪些文件变了，全部失效
+                for (const auto& watch : watches_) {
+                    ::inotify_rm_watch(inotify_fd_, watch.first);
+                }
+                watches_.clear();
+                files_.clear();
+                continue;
+            }
+
+            auto watch = watches_.find(event->wd);
+            if (watch == watches_.end()) {
+                // 已经移除的监视(例如inotify_rm_watch之后的IN_IGNORED)，
+                // 或者条目还在锁外打开、尚未发布，计数让它放弃缓存
+                ++unmatched_events_;
+                continue;
+            }
+            std::vector<std::string> paths = watch->second;
+            for (const auto& path : paths) {
+                LOG_DEBUG("HttpFileHandler::handleInotify - invalidate {}, mask = 0x{:x}", path, event->mask);
+                removeLocked(path);
+            }
+            if (event->mask & IN_IGNORED) {
+                // 内核已经移除了监视
+                watches_.erase(event->wd);
+            }
+        }
+    }
+}
+
+} // namespace core
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "core/http/http_router.h"
+
+namespace core {
+
+class Channel;
+class EventLoop;
+class HttpResponse;
+
+// 静态文件处理器，作为路由的通配处理函数使用：
+//   HttpFileHandler files(&loop, options);
+//   server.router().get("/assets/*path", files.handler());
+// 打开的fd和stat/ETag元数据缓存在内存中，由inotify在文件变化时失效，
+// 条件请求(If-None-Match/If-Modified-Since)直接用缓存的元数据回复304，不访问磁盘；
+// 主体用sendfile零拷贝发送，小的热点文件读入内存后随响应头一起写出。
+// 支持单个区间的Range请求，多区间请求按完整文件回复
+class HttpFileHandler {
+public:
+    struct Options {
+        std::string root;                   // 文件根目录
+        std::string index = "index.html";   // 请求目录时返回的文件
+        size_t max_cached_files = 1024;     // 最多缓存的文件数(每个占用一个fd)
+        size_t memory_max_size = 64 * 1024; // 不超过该大小的热点文件读入内存，0表示关闭
+        uint32_t memory_min_hits = 4;       // 命中多少次后才读入
+        int max_age = 0;                    // Cache-Control: max-age，0表示不发送
+    };
+
+    // 须在loop所属线程中构造和析构，inotify事件在loop上处理
+    HttpFileHandler(EventLoop* loop, Options options);
+    ~HttpFileHandler();
+
+    HttpFileHandler(const HttpFileHandler&) = delete;
+    HttpFileHandler& operator=(const HttpFileHandler&) = delete;
+
+    // 处理请求，文件路径取路由的最后一个参数，没有参数时取整个请求路径
+    void handle(const HttpRequest& req, const RouteParams& params, HttpResponse* resp);
+
+    // 用于注册路由的处理函数，HttpFileHandler须比HttpServer存活得更久
+    HttpRouter::Handler handler();
+
+    // 当前缓存的文件数
+    size_t cachedFiles() const;
+
+private:
+    struct FileEntry;
+    using FileEntryPtr = std::shared_ptr<FileEntry>;
+
+    // 查找或打开文件，data在文件已读入内存时非空
+    FileEntryPtr lookup(const std::string& path, const char** data);
+    FileEntryPtr openFile(const std::string& path);
+    void removeLocked(const std::string& path);
+    void handleInotify();
+
+    EventLoop* loop_;
+    Options options_;
+    int inotify_fd_;                            // 打开失败时为-1，此时不缓存
+    std::unique_ptr<Channel> inotify_channel_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, FileEntryPtr> files_;        // 相对路径 -> 文件
+    std::unordered_map<int, std::vector<std::string>> watches_;  // inotify wd -> 相对路径(硬链接会共用wd)
+    uint64_t unmatched_events_ = 0;             // 没有对应条目的inotify事件数
+};
+
+} // namespace core
@@ -0,0 +1,551 @@
+#include "core/http/http_load_generator.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <sstream>
+#include <thread>
+#include "core/net/channel.h"
+#include "core/net/inet_address_format.h"
+#include "core/net/tcp_connection.h"
+#include "core/reactor/event_loop.h"
+#include "core/thread/eventloop_thread_pool.h"
+#include "core/utils/byte_scan.h"
+#include "core/utils/logger.h"
+
+namespace core {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const std::chrono::milliseconds kStartDelay(20);    // 连接全部建立后，各线程统一在这之后开始发送
+const std::chrono::milliseconds kDrainTimeout(1000); // 结束时等在途响应收完的最长时间
+
+int64_t nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+Clock::time_point toTimePoint(int64_t ns) {
+    return Clock::time_point(std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(ns)));
+}
+
+// 在loop中执行fn并等待它完成
+void runAndWait(EventLoop* loop, const std::function<void()>& fn) {
+    std::promise<void> done;
+    loop->runInLoop([&fn, &done]() {
+        fn();
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+
+// 阻塞连接到服务器，成功后切换为非阻塞，返回fd，失败返回-1
+int connectTo(const InetAddress& server) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+    if (fd < 0) {
+        return -1;
+    }
+    if (::connect(fd, server.getSockAddr(), static_cast<socklen_t>(sizeof(struct sockaddr_in))) < 0) {
+        LOG_ERROR("HttpLoadGenerator - connect {} failed: {}", server, strerror(errno));
+        ::close(fd);
+        return -1;
+    }
+    int flags = ::fcntl(fd, F_GETFL, 0);
+    ::fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    return fd;
+}
+
+} // namespace
+
+struct HttpLoadGenerator::Client {
+    enum ParseState {
+        kHeaders,
+        kBody,
+        kChunkSize,
+        kChunkData,
+        kTrailers,
+    };
+
+    TcpConnection::TcpConnectionPtr conn;
+    size_t next = 0;                            // mix_中下一个请求的位置
+    std::deque<std::pair<int64_t, bool>> inflight;  // 在途请求的计划时刻(纳秒)和是否为HEAD
+    std::deque<int64_t> queued;                 // 定速模式：已到计划时刻、等待在途名额的请求
+    int64_t first_due = 0;                      // 定速模式：第一个请求的计划时刻
+    uint64_t scheduled = 0;                     // 定速模式：已安排的请求数
+    bool closed = false;
+
+    // 响应解析状态
+    ParseState state = kHeaders;
+    size_t remaining = 0;
+    int status = 0;
+};
+
+// 一个IO线程上的连接和统计，只在该线程中访问，结束后由run()汇总
+struct HttpLoadGenerator::Worker {
+    const HttpLoadGenerator* owner;
+    EventLoop* loop;
+    std::vector<std::unique_ptr<Client>> clients;
+    int64_t record_from = 0;    // 之前完成的请求属于预热
+    int64_t interval = 0;       // 定速模式下每个连接两个请求的间隔(纳秒)，0表示闭环
+    bool running = false;
+    Result result;
+    Buffer output;
+    // 定速模式的定时器：TimerManager随poll的10ms超时检查，精度不够，
+    // 改用timerfd，每次设到最早的下一个计划时刻
+    int timer_fd = -1;
+    std::unique_ptr<Channel> timer_channel;
+
+    void start(int64_t start_ns, int64_t record_from_ns, int64_t interval_ns, size_t first_index, size_t total) {
+        record_from = record_from_ns;
+        interval = interval_ns;
+        running = true;
+        for (size_t i = 0; i < clients.size(); ++i) {
+            // 各连接的发送时刻错开，总体上均匀分布
+            clients[i]->first_due = start_ns + (interval * static_cast<int64_t>(first_index + i)) / static_cast<int64_t>(total);
+        }
+        if (interval > 0) {
+            timer_fd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+            timer_channel.reset(new Channel(loop, timer_fd));
+            timer_channel->setReadCallback([this]() {
+                uint64_t expirations;
+                ssize_t n = ::read(timer_fd, &expirations, sizeof(expirations));
+                (void)n;
+                schedule();
+            });
+            timer_channel->enableReading();
+            armTimer(start_ns);
+        } else {
+            loop->getTimerManager()->addTimer([this]() {
+                for (auto& client : clients) {
+                    send(client.get());
+                }
+            }, toTimePoint(start_ns));
+        }
+    }
+
+    // 定时器在绝对时刻ns(steady_clock即CLOCK_MONOTONIC)到期
+    void armTimer(int64_t ns) {
+        struct itimerspec spec;
+        memset(&spec, 0, sizeof(spec));
+        spec.it_value.tv_sec = static_cast<time_t>(ns / 1000000000);
+        spec.it_value.tv_nsec = static_cast<long>(ns % 1000000000);
+        ::timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr);
+    }
+
+    // 定速模式：把到达计划时刻的请求排入队列，再把定时器设到下一个计划时刻
+    void schedule() {
+        if (!running) {
+            return;
+        }
+        int64_t now = nowNanos();
+        int64_t next = INT64_MAX;
+        for (auto& client : clients) {
+            Client* c = client.get();
+            if (c->closed) {
+                continue;
+            }
+            if (now >= c->first_due) {
+                uint64_t due = static_cast<uint64_t>((now - c->first_due) / interval) + 1;
+                while (c->scheduled < due) {
+                    c->queued.push_back(c->first_due + static_cast<int64_t>(c->scheduled) * interval);
+                    ++c->scheduled;
+                }
+                send(c);
+            }
+            next = std::min(next, c->first_due + static_cast<int64_t>(c->scheduled) * interval);
+        }
+        if (next != INT64_MAX) {
+            armTimer(next);
+        }
+    }
+
+    // 填满在途名额，多个请求合并成一次写
+    void send(Client* c) {
+        if (!running || c->closed) {
+            return;
+        }
+        const size_t pipeline = static_cast<size_t>(std::max(owner->options_.pipeline, 1));
+        int64_t now = 0;
+        while (c->inflight.size() < pipeline) {
+            int64_t due;
+            if (interval > 0) {
+                if (c->queued.empty()) {
+                    break;
+                }
+                due = c->queued.front();
+                c->queued.pop_front();
+            } else {
+                if (now == 0) {
+                    now = nowNanos();
+                }
+                due = now;
+            }
+            const Request& request = owner->requests_[owner->mix_[c->next]];
+            c->next = (c->next + 1) % owner->mix_.size();
+            c->inflight.emplace_back(due, request.head);
+            output.append(request.bytes);
+        }
+        if (output.readableBytes() > 0) {
+            c->conn->send(&output);
+        }
+    }
+
+    // 一个响应接收完毕
+    void complete(Client* c) {
+        int64_t due = c->inflight.front().first;
+        c->inflight.pop_front();
+        c->state = Client::kHeaders;
+        int64_t now = nowNanos();
+        if (now >= record_from && running) {
+            ++result.requests;
+            result.latency.record(static_cast<uint64_t>(std::max<int64_t>(now - due, 0) / 1000));
+            int klass = c->status / 100;
+            if (klass >= 1 && klass <= 5) {
+                ++result.status[klass];
+            }
+        }
+    }
+
+    void fail(Client* c, const char* reason) {
+        LOG_ERROR("HttpLoadGenerator - [{}] {}", c->conn->name(), reason);
+        ++result.errors;
+        c->conn->forceClose();
+    }
+
+    void onMessage(Client* c, Buffer* buf) {
+        result.bytes_read += buf->readableBytes();
+        while (buf->readableBytes() > 0) {
+            const char* begin = buf->peek();
+            const char* end = begin + buf->readableBytes();
+            if (c->state == Client::kHeaders) {
+                const char* headers_end = scanCRLFCRLF(begin, end);
+                if (!headers_end) {
+                    break;
+                }
+                if (c->inflight.empty() || headers_end - begin < 12 || strncmp(begin, "HTTP/1.", 7) != 0) {
+                    fail(c, "unexpected response");
+                    buf->retrieveAll();
+                    return;
+                }
+                c->status = (begin[9] - '0') * 100 + (begin[10] - '0') * 10 + (begin[11] - '0');
+                // 只关心决定主体长度的两个头部
+                size_t length = 0;
+                bool chunked = false;
+                const char* line = scanCRLF(begin, headers_end + 2) + 2;
+                while (line < headers_end) {
+                    const char* eol = scanCRLF(line, headers_end + 2);
+                    if (eol - line > 15 && strncasecmp(line, "Content-Length:", 15) == 0) {
+                        length = strtoull(line + 15, nullptr, 10);
+                    } else if (eol - line > 18 && strncasecmp(line, "Transfer-Encoding:", 18) == 0) {
+                        chunked = memmem(line + 18, eol - line - 18, "chunked", 7) != nullptr;
+                    }
+                    line = eol + 2;
+                }
+                buf->retrieve(headers_end + 4 - begin);
+                bool no_body = c->inflight.front().second || c->status < 200 || c->status == 204 || c->status == 304;
+                if (no_body || (!chunked && length == 0)) {
+                    complete(c);
+                } else if (chunked) {
+                    c->state = Client::kChunkSize;
+                } else {
+                    c->state = Client::kBody;
+                    c->remaining = length;
+                }
+            } else if (c->state == Client::kBody || c->state == Client::kChunkData) {
+                size_t n = std::min(c->remaining, buf->readableBytes());
+                buf->retrieve(n);
+                c->remaining -= n;
+                if (c->remaining == 0) {
+                    if (c->state == Client::kBody) {
+                        complete(c);
+                    } else {
+                        c->state = Client::kChunkSize;
+                    }
+                }
+            } else {
+                const char* eol = scanCRLF(begin, end);
+                if (!eol) {
+                    break;
+                }
+                if (c->state == Client::kChunkSize) {
+                    size_t size = strtoull(begin, nullptr, 16);
+                    c->state = size == 0 ? Client::kTrailers : Client::kChunkData;
+                    c->remaining = size + 2;  // 数据后的CRLF
+                } else if (eol == begin) {
+                    complete(c);
+                }
+                buf->retrieve(eol + 2 - begin);
+            }
+        }
+        if (!running) {
+            closeIfDrained(c);
+            return;
+        }
+        send(c);
+    }
+
+    // 停止后在途的响应全部收到再关闭：带着未读的响应关闭会发出RST，服务器端报连接重置
+    void closeIfDrained(Client* c) {
+        if (!c->closed && c->inflight.empty()) {
+            c->conn->forceClose();
+        }
+    }
+
+    void onClose(Client* c) {
+        c->closed = true;
+        if (running) {
+            // 服务器提前关闭了连接
+            result.errors += c->inflight.size();
+        }
+        c->inflight.clear();
+        c->queued.clear();
+        loop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, c->conn));
+    }
+
+    // 停止发送新请求，没有在途请求的连接立即关闭，其余的收完响应后关闭
+    void stop() {
+        running = false;
+        if (timer_channel) {
+            timer_channel->disableAll();
+            timer_channel->remove();
+            timer_channel.reset();
+            ::close(timer_fd);
+        }
+        for (auto& client : clients) {
+            closeIfDrained(client.get());
+        }
+    }
+
+    // 尚未关闭的连接数
+    size_t openClients() const {
+        size_t n = 0;
+        for (auto& client : clients) {
+            n += client->closed ? 0 : 1;
+        }
+        return n;
+    }
+
+    // 超时仍未收完的连接直接关闭
+    void abort() {
+        for (auto& client : clients) {
+            if (!client->closed) {
+                client->conn->forceClose();
+            }
+        }
+    }
+};
+
+HttpLoadGenerator::HttpLoadGenerator(const Options& options)
+    : options_(options) {
+}
+
+HttpLoadGenerator::~HttpLoadGenerator() = default;
+
+void HttpLoadGenerator::addRequest(std::string_view method, std::string_view path, std::string_view body,
+                                   int weight) {
+    Request request;
+    request.head = method == "HEAD";
+    std::string& bytes = request.bytes;
+    bytes.append(method.data(), method.size());
+    bytes.push_back(' ');
+    bytes.append(path.data(), path.size());
+    bytes.append(" HTTP/1.1\r\nHost: ");
+    bytes.append(options_.host);
+    bytes.append("\r\n");
+    if (!body.empty() || method == "POST" || method == "PUT") {
+        bytes.append("Content-Length: ");
+        bytes.append(std::to_string(body.size()));
+        bytes.append("\r\n");
+    }
+    bytes.append("\r\n");
+    bytes.append(body.data(), body.size());
+
+    requests_.push_back(std::move(request));
+    for (int i = 0; i < std::max(weight, 1); ++i) {
+        mix_.push_back(requests_.size() - 1);
+    }
+}
+
+bool HttpLoadGenerator::loadRequests(const std::string& file) {
+    std::ifstream in(file);
+    if (!in) {
+        LOG_ERROR("HttpLoadGenerator::loadRequests - cannot open {}", file);
+        return false;
+    }
+    std::string line;
+    int line_no = 0;
+    while (std::getline(in, line)) {
+        ++line_no;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        std::istringstream fields(line);
+        std::string first;
+        if (!(fields >> first) || first[0] == '#') {
+            continue;
+        }
+        int weight = 1;
+        std::string method = first;
+        if (first.find_first_not_of("0123456789") == std::string::npos) {
+            weight = std::stoi(first);
+            fields >> method;
+        }
+        std::string path;
+        if (!(fields >> path)) {
+            LOG_ERROR("HttpLoadGenerator::loadRequests - {}:{}: missing path", file, line_no);
+            return false;
+        }
+        // 路径之后的剩余部分作为主体
+        std::string body;
+        std::getline(fields >> std::ws, body);
+        addRequest(method, path, body, weight);
+    }
+    return !requests_.empty();
+}
+
+HttpLoadGenerator::Result HttpLoadGenerator::run() {
+    if (requests_.empty()) {
+        addRequest("GET", "/");
+    }
+
+    // 析构顺序：线程池先停止并回收IO线程，之后才能释放Worker
+    EventLoop base_loop;
+    std::vector<std::unique_ptr<Worker>> workers;
+    EventLoopThreadPool pool(&base_loop, "loadgen");
+    pool.setThreadNum(std::max(options_.threads, 1));
+    pool.start();
+    for (EventLoop* loop : pool.getAllLoops()) {
+        workers.emplace_back(new Worker());
+        workers.back()->owner = this;
+        workers.back()->loop = loop;
+    }
+
+    Result result;
+    InetAddress server(options_.host, options_.port);
+    for (int i = 0; i < options_.connections; ++i) {
+        int fd = connectTo(server);
+        if (fd < 0) {
+            ++result.connect_errors;
+            continue;
+        }
+        struct sockaddr_in local;
+        socklen_t len = static_cast<socklen_t>(sizeof(local));
+        memset(&local, 0, sizeof(local));
+        ::getsockname(fd, reinterpret_cast<struct sockaddr*>(&local), &len);
+
+        Worker* worker = workers[i % workers.size()].get();
+        auto client = std::make_unique<Client>();
+        Client* c = client.get();
+        c->next = static_cast<size_t>(i) % mix_.size();
+        c->conn = std::make_shared<TcpConnection>(worker->loop, "loadgen#" + std::to_string(i), fd,
+                                                  InetAddress(local), server);
+        c->conn->setTcpNoDelay(true);
+        c->conn->setMessageCallback([worker, c](const TcpConnection::TcpConnectionPtr&, Buffer* buf, size_t) {
+            worker->onMessage(c, buf);
+        });
+        c->conn->setCloseCallback([worker, c](const TcpConnection::TcpConnectionPtr&) {
+            worker->onClose(c);
+        });
+        worker->clients.push_back(std::move(client));
+    }
+
+    // 所有连接建立后统一开始
+    int64_t interval = options_.rate > 0 ? static_cast<int64_t>(options_.connections * 1e9 / options_.rate) : 0;
+    int64_t start = nowNanos() + std::chrono::duration_cast<std::chrono::nanoseconds>(kStartDelay).count();
+    int64_t record_from = start + std::chrono::duration_cast<std::chrono::nanoseconds>(options_.warmup).count();
+    size_t first_index = 0;
+    for (auto& worker : workers) {
+        Worker* w = worker.get();
+        runAndWait(w->loop, [w, start, record_from, interval, first_index, this]() {
+            for (auto& client : w->clients) {
+                client->conn->connectEstablished();
+            }
+            w->start(start, record_from, interval, first_index, static_cast<size_t>(options_.connections));
+        });
+        first_index += w->clients.size();
+    }
+
+    base_loop.getTimerManager()->addTimer([&base_loop]() { base_loop.quit(); },
+                                          toTimePoint(record_from) + options_.duration);
+    base_loop.loop();
+
+    // 停止发送，等在途的响应收完后关闭连接，最多等kDrainTimeout
+    for (auto& worker : workers) {
+        Worker* w = worker.get();
+        runAndWait(w->loop, [w]() { w->stop(); });
+    }
+    Clock::time_point drain_deadline = Clock::now() + kDrainTimeout;
+    for (;;) {
+        size_t open = 0;
+        for (auto& worker : workers) {
+            Worker* w = worker.get();
+            runAndWait(w->loop, [w, &open]() { open += w->openClients(); });
+        }
+        if (open == 0) {
+            break;
+        }
+        if (Clock::now() >= drain_deadline) {
+            for (auto& worker : workers) {
+                Worker* w = worker.get();
+                runAndWait(w->loop, [w]() { w->abort(); });
+            }
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    // forceClose和connectDestroyed各自排到下一轮循环，等两轮
+    for (int round = 0; round < 2; ++round) {
+        for (auto& worker : workers) {
+            runAndWait(worker->loop, []() {});
+        }
+    }
+
+    result.seconds = std::chrono::duration<double>(options_.duration).count();
+    for (auto& worker : workers) {
+        const Result& part = worker->result;
+        result.requests += part.requests;
+        result.errors += part.errors;
+        result.bytes_read += part.bytes_read;
+        for (size_t i = 0; i < 6; ++i) {
+            result.status[i] += part.status[i];
+        }
+        result.latency.merge(part.latency);
+    }
+    return result;
+}
+
+std::string HttpLoadGenerator::report(const Result& result) {
+    char buf[256];
+    std::string out;
+    snprintf(buf, sizeof(buf), "%llu requests in %.2fs, %.2f MB read\n",
+             static_cast<unsigned long long>(result.requests), result.seconds, result.bytes_read / 1048576.0);
+    out += buf;
+    snprintf(buf, sizeof(buf), "Requests/sec: %.2f\n", result.throughput());
+    out += buf;
+    snprintf(buf, sizeof(buf), "Status: 2xx=%llu 3xx=%llu 4xx=%llu 5xx=%llu, errors=%llu, connect errors=%llu\n",
+             static_cast<unsigned long long>(result.status[2]), static_cast<unsigned long long>(result.status[3]),
+             static_cast<unsigned long long>(result.status[4]), static_cast<unsigned long long>(result.status[5]),
+             static_cast<unsigned long long>(result.errors), static_cast<unsigned long long>(result.connect_errors));
+    out += buf;
+    const LogLinearHistogram& h = result.latency;
+    snprintf(buf, sizeof(buf), "Latency (us): mean=%.1f min=%llu max=%llu\n", h.mean(),
+             static_cast<unsigned long long>(h.min()), static_cast<unsigned long long>(h.max()));
+    out += buf;
+    const double kPercentiles[] = {50, 90, 99, 99.9, 99.99};
+    for (double p : kPercentiles) {
+        snprintf(buf, sizeof(buf), "  p%-6g %llu\n", p, static_cast<unsigned long long>(h.percentile(p)));
+        out += buf;
+    }
+    return out;
+}
+
+} // namespace core
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "core/utils/histogram.h"
+
+namespace core {
+
+// HTTP/1.1压测工具，基于与服务器相同的EventLoop/EventLoopThreadPool。
+// 两种模式：
+//   闭环(rate为0)：每个连接保持pipeline个请求在途，收到响应立即发出下一个，测最大吞吐；
+//   定速(rate>0)：按总目标速率均匀安排每个请求的发送时刻，延迟从计划时刻而不是实际发出时刻算起，
+//   服务器变慢导致请求排队时，排队时间也计入延迟，避免协调遗漏(coordinated omission)低估尾延迟
+class HttpLoadGenerator {
+public:
+    struct Options {
+        std::string host = "127.0.0.1";
+        uint16_t port = 8080;
+        int connections = 64;
+        int threads = 2;                            // IO线程数，连接平均分配，至少为1
+        int pipeline = 1;                           // 每个连接同时在途的请求数
+        std::chrono::milliseconds duration = std::chrono::seconds(10);
+        std::chrono::milliseconds warmup = std::chrono::milliseconds(0);  // 开始后这段时间的结果不计入
+        double rate = 0;                            // 总目标速率(请求/秒)，0表示闭环
+    };
+
+    struct Result {
+        uint64_t requests = 0;          // 完成的请求数
+        uint64_t errors = 0;            // 连接断开时未完成的请求和无法解析的响应
+        uint64_t connect_errors = 0;
+        uint64_t bytes_read = 0;
+        uint64_t status[6] = {0};       // 按状态码首位统计，status[2]为2xx
+        double seconds = 0;             // 计入结果的时长
+        LogLinearHistogram latency;     // 单位微秒
+
+        double throughput() const { return seconds > 0 ? requests / seconds : 0; }
+    };
+
+    explicit HttpLoadGenerator(const Options& options);
+    ~HttpLoadGenerator();
+
+    HttpLoadGenerator(const HttpLoadGenerator&) = delete;
+    HttpLoadGenerator& operator=(const HttpLoadGenerator&) = delete;
+
+    // 添加请求混合中的一项，weight为相对权重；没有添加时默认GET /
+    void addRequest(std::string_view method, std::string_view path, std::string_view body = std::string_view(),
+                    int weight = 1);
+    // 从文件加载请求混合，每行"[权重] 方法 路径 [主体]"，空行和#开头的行忽略
+    bool loadRequests(const std::string& file);
+
+    // 建立连接并压测，阻塞到结束；结束时先收完在途的响应再关闭连接(最多等1秒)，不让服务器看到连接重置
+    Result run();
+
+    // 文本报告：吞吐、状态码分布和延迟百分位
+    static std::string report(const Result& result);
+
+private:
+    struct Client;
+    struct Worker;
+
+    struct Request {
+        std::string bytes;      // 序列化好的请求
+        bool head;              // HEAD请求的响应没有主体
+    };
+
+    Options options_;
+    std::vector<Request> requests_;
+    std::vector<size_t> mix_;   // 按权重展开的请求下标，各连接从不同位置开始轮流发送
+};
+
+} // namespace core
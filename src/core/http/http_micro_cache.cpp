@@ -0,0 +1,194 @@
+#include "core/http/http_micro_cache.h"
+
+#include <strings.h>
+#include "core/http/http_request.h"
+
+namespace core {
+
+namespace {
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && strncasecmp(a.data(), b.data(), a.size()) == 0;
+}
+
+} // namespace
+
+HttpMicroCache::EntryPtr HttpMicroCache::Shard::find(const std::string& key) {
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    if (it->second->expires <= std::chrono::steady_clock::now()) {
+        entries_.erase(it);
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return it->second;
+}
+
+bool HttpMicroCache::Shard::filling(const std::string& key) {
+    auto it = fills_.find(key);
+    if (it == fills_.end()) {
+        return false;
+    }
+    if (std::chrono::steady_clock::now() - it->second.started < owner_->options_.fill_timeout) {
+        collapsed_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    // 处理函数丢掉了延迟响应的句柄或迟迟不完成，等待者各自调用处理函数，下一个请求重新生成
+    std::vector<Waiter> waiters;
+    waiters.swap(it->second.waiters);
+    fills_.erase(it);
+    for (const auto& waiter : waiters) {
+        waiter(nullptr);
+    }
+    return false;
+}
+
+void HttpMicroCache::Shard::begin(const std::string& key) {
+    fills_[key].started = std::chrono::steady_clock::now();
+}
+
+void HttpMicroCache::Shard::wait(const std::string& key, Waiter waiter) {
+    fills_[key].waiters.push_back(std::move(waiter));
+}
+
+HttpMicroCache::EntryPtr HttpMicroCache::Shard::complete(const std::string& key, const HttpResponse& response,
+                                                         std::chrono::milliseconds ttl) {
+    std::vector<Waiter> waiters;
+    auto it = fills_.find(key);
+    if (it != fills_.end()) {
+        waiters.swap(it->second.waiters);
+        fills_.erase(it);
+    }
+
+    // 只有可缓存的响应才交给等待者：带Set-Cookie、private或no-store的响应属于生成它的那个请求，
+    // 等待者拿到的是空条目，各自调用处理函数
+    std::shared_ptr<Entry> entry;
+    if (shareable(response) && owner_->cacheable(response)) {
+        entry = std::make_shared<Entry>();
+        // 主体之外的部分单独序列化一次，得到响应头的长度
+        entry->response = response;
+        entry->response.setBody(std::string());
+        std::string_view body = response.bodyData();
+        HttpResponse head(response);
+        head.setOmitBody(true);
+        Buffer output;
+        head.appendToBuffer(&output);
+        entry->header_length = output.readableBytes();
+        entry->bytes.reserve(entry->header_length + body.size());
+        entry->bytes.assign(output.peek(), output.readableBytes());
+        entry->bytes.append(body.data(), body.size());
+        entry->expires = std::chrono::steady_clock::now() + ttl;
+
+        if (entries_.size() >= owner_->options_.max_entries && entries_.find(key) == entries_.end()) {
+            makeRoom();
+        }
+        entries_[key] = entry;
+    }
+
+    for (const auto& waiter : waiters) {
+        waiter(entry);
+    }
+    return entry;
+}
+
+void HttpMicroCache::Shard::makeRoom() {
+    auto now = std::chrono::steady_clock::now();
+    auto oldest = entries_.end();
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (it->second->expires <= now) {
+            it = entries_.erase(it);
+            continue;
+        }
+        if (oldest == entries_.end() || it->second->expires < oldest->second->expires) {
+            oldest = it;
+        }
+        ++it;
+    }
+    if (entries_.size() >= owner_->options_.max_entries && oldest != entries_.end()) {
+        entries_.erase(oldest);
+    }
+}
+
+HttpMicroCache::HttpMicroCache(Options options)
+    : options_(std::move(options)) {
+}
+
+HttpMicroCache::~HttpMicroCache() = default;
+
+void HttpMicroCache::addRoute(std::string_view pattern, std::chrono::milliseconds ttl) {
+    ttls_[std::string(pattern)] = ttl;
+}
+
+std::chrono::milliseconds HttpMicroCache::ttl(std::string_view pattern) const {
+    // 路由模式来自路由表，查找前需要构造一次string
+    auto it = ttls_.find(std::string(pattern));
+    return it == ttls_.end() ? std::chrono::milliseconds(0) : it->second;
+}
+
+void HttpMicroCache::makeKey(const HttpRequest& req, std::string_view encoding, std::string* key) const {
+    std::string_view path = req.path();
+    key->clear();
+    key->reserve(path.size() + encoding.size() + 1 + options_.vary_headers.size() * 16);
+    key->append(path.data(), path.size());
+    key->push_back('\0');
+    key->append(encoding.data(), encoding.size());
+    for (const auto& name : options_.vary_headers) {
+        std::string_view value = req.getHeader(name);
+        key->push_back('\0');
+        key->append(value.data(), value.size());
+    }
+}
+
+HttpMicroCache::Shard* HttpMicroCache::shard(EventLoop* loop) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& shard = shards_[loop];
+    if (!shard) {
+        shard.reset(new Shard(this));
+    }
+    return shard.get();
+}
+
+uint64_t HttpMicroCache::sum(std::atomic<uint64_t> Shard::*counter) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t total = 0;
+    for (const auto& entry : shards_) {
+        total += (entry.second.get()->*counter).load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint64_t HttpMicroCache::hits() const { return sum(&Shard::hits_); }
+uint64_t HttpMicroCache::misses() const { return sum(&Shard::misses_); }
+uint64_t HttpMicroCache::collapsed() const { return sum(&Shard::collapsed_); }
+
+bool HttpMicroCache::shareable(const HttpResponse& response) {
+    return !response.chunked() && !response.hasFileBody() && !response.deferred() && !response.webSocket()
+        && !response.closeConnection() && response.statusCode() >= 200;
+}
+
+bool HttpMicroCache::cacheable(const HttpResponse& response) const {
+    // 只缓存成功和确定的响应；带Set-Cookie或Cache-Control: private/no-store的响应属于单个用户
+    int code = response.statusCode();
+    if (code != HttpResponse::k200Ok && code != HttpResponse::k204NoContent
+        && code != HttpResponse::k301MovedPermanently && code != HttpResponse::k404NotFound) {
+        return false;
+    }
+    if (response.bodyData().size() > options_.max_body_size) {
+        return false;
+    }
+    for (const auto& header : response.headers()) {
+        if (equalsIgnoreCase(header.first, "Set-Cookie")
+            || (equalsIgnoreCase(header.first, "Cache-Control")
+                && (header.second.find("no-store") != std::string::npos
+                    || header.second.find("private") != std::string::npos))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace core
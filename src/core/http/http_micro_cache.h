@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "core/http/http_response.h"
+
+namespace core {
+
+class EventLoop;
+class HttpRequest;
+
+// 热点GET响应的微缓存：对排行榜、列表这类短时间内被大量客户端重复请求的接口，
+// 按路由配置一个很短的TTL，期间同一个键只调用一次处理函数。
+// 每个IO线程一个分片，查找和插入都在所属线程中进行，不加锁；命中时直接输出序列化好的响应字节。
+// 同一个键的响应正在生成时(延迟响应或压缩线程)，后续请求挂在它上面等待，而不是各自再调用处理函数
+class HttpMicroCache {
+public:
+    struct Options {
+        std::vector<std::string> vary_headers;      // 参与缓存键的请求头，名字不区分大小写
+        size_t max_entries = 1024;                  // 每个分片的条目上限，满时淘汰最早到期的条目
+        size_t max_body_size = 1024 * 1024;         // 超过该大小的响应不缓存
+        std::chrono::milliseconds fill_timeout = std::chrono::seconds(30);  // 生成响应的最长时间，超过后视为放弃
+    };
+    
+    // 缓存的响应，创建后只读
+    struct Entry {
+        std::string bytes;              // 序列化好的HTTP/1.1响应
+        size_t header_length;           // 响应头的长度，HEAD请求只发送这部分
+        HttpResponse response;          // 不含主体的同一响应，供HTTP/2使用
+        std::chrono::steady_clock::time_point expires;
+    
+        std::string_view body() const { return std::string_view(bytes).substr(header_length); }
+    };
+    using EntryPtr = std::shared_ptr<const Entry>;
+    // 等待正在生成的响应。entry为空表示该响应不能给其他请求(属于单个用户、不可缓存或不能序列化)，
+    // 或生成超时被放弃，此时等待者自己调用处理函数
+    using Waiter = std::function<void(const EntryPtr& entry)>;
+    
+    // 一个IO线程的缓存，只在所属线程中访问
+    class Shard {
+    public:
+        explicit Shard(HttpMicroCache* owner) : owner_(owner) {}
+    
+        // 查找未过期的条目
+        EntryPtr find(const std::string& key);
+        // 是否有请求正在生成这个键的响应，是则调用方应当wait；超过fill_timeout的视为放弃，唤醒等待者后返回false
+        bool filling(const std::string& key);
+        // 标记开始生成，调用方负责之后调用complete
+        void begin(const std::string& key);
+        // 等待其他请求正在生成的响应
+        void wait(const std::string& key, Waiter waiter);
+        // 响应生成完毕：可缓存时序列化为条目存入分片，依次唤醒等待者。
+        // 返回的条目为空表示响应不能共享，生成者按常规流程发送自己的响应
+        EntryPtr complete(const std::string& key, const HttpResponse& response, std::chrono::milliseconds ttl);
+    
+    private:
+        friend class HttpMicroCache;
+    
+        struct Fill {
+            std::chrono::steady_clock::time_point started;
+            std::vector<Waiter> waiters;
+        };
+    
+        // 腾出一个位置：先清理过期条目，仍然满时淘汰最早到期的
+        void makeRoom();
+    
+        HttpMicroCache* owner_;
+        std::unordered_map<std::string, EntryPtr> entries_;
+        std::unordered_map<std::string, Fill> fills_;
+    
+        // 统计，其他线程汇总时读取
+        std::atomic<uint64_t> hits_{0};
+        std::atomic<uint64_t> misses_{0};
+        std::atomic<uint64_t> collapsed_{0};
+    };
+    
+    explicit HttpMicroCache(Options options);
+    ~HttpMicroCache();
+    
+    HttpMicroCache(const HttpMicroCache&) = delete;
+    HttpMicroCache& operator=(const HttpMicroCache&) = delete;
+    
+    // 为路由模式(与注册路由时的写法相同，如"/boards/:id")设置TTL，须在启动之前调用
+    void addRoute(std::string_view pattern, std::chrono::milliseconds ttl);
+    // 路由的TTL，未配置返回0
+    std::chrono::milliseconds ttl(std::string_view pattern) const;
+    bool hasRoutes() const { return !ttls_.empty(); }
+    
+    // 缓存键：路径加上vary_headers的值；encoding为协商出的压缩编码，不同编码的响应分开缓存
+    void makeKey(const HttpRequest& req, std::string_view encoding, std::string* key) const;
+    
+    // 取得loop的分片，第一次访问时创建
+    Shard* shard(EventLoop* loop);
+    
+    // 统计，汇总所有分片
+    uint64_t hits() const;
+    uint64_t misses() const;
+    uint64_t collapsed() const;  // 等待其他请求生成响应的次数(响应不能共享时等待者之后仍会调用处理函数)
+    
+private:
+    // 响应是否能序列化
+    static bool shareable(const HttpResponse& response);
+    // 能序列化的响应是否可以缓存到TTL结束、发给其他请求
+    bool cacheable(const HttpResponse& response) const;
+    
+    uint64_t sum(std::atomic<uint64_t> Shard::*counter) const;
+    
+    Options options_;
+    std::unordered_map<std::string, std::chrono::milliseconds> ttls_;
+    
+    mutable std::mutex mutex_;
+    std::unordered_map<EventLoop*, std::unique_ptr<Shard>> shards_;
+};
+
+} // namespace core
@@ -3,98 +3,303 @@
 #include <algorithm>
 #include <cstring>
 #include "core/net/buffer.h"
+#include "core/utils/byte_scan.h"
 #include "core/utils/logger.h"
 
 namespace core {
 
 HttpParser::HttpParser()
-    : state_(kExpectRequestLine),
-      content_length_(0) {
+    : state_(kExpectHeaders),
+      header_length_(0),
+      content_length_(0),
+      has_content_length_(false),
+      max_body_size_(kDefaultMaxBodySize),
+      error_status_(HttpResponse::k400BadRequest),
+      body_remaining_(0),
+      chunked_(false),
+      has_transfer_encoding_(false),
+      streaming_(false),
+      scan_offset_(0),
+      base_(nullptr) {
 }
 
 void HttpParser::reset() {
-    state_ = kExpectRequestLine;
+    state_ = kExpectHeaders;
     request_.reset();
+    header_length_ = 0;
     content_length_ = 0;
+    has_content_length_ = false;
+    error_status_ = HttpResponse::k400BadRequest;
+    body_remaining_ = 0;
+    chunked_ = false;
+    has_transfer_encoding_ = false;
+    streaming_ = false;
+    scan_offset_ = 0;
+    base_ = nullptr;
+    body_storage_.clear();
 }
 
 bool HttpParser::parseRequest(Buffer* buf, std::chrono::steady_clock::time_point receiveTime) {
-    bool ok = true;
-    bool hasMore = true;
+    if (state_ == kExpectHeaders) {
+        // 查找头部结束的空行，从上次扫描结束处继续
+        const char* end = buf->findCRLFCRLF(&scan_offset_);
+        if (end == nullptr) {
+            // 头部过大，视为错误
+            return buf->readableBytes() <= kMaxHeaderBytes || fail(HttpResponse::k431RequestHeaderFieldsTooLarge);
+        }
+        
+        if (!parseHeaders(buf->peek(), end + 2)) {
+            return false;
+        }
+        // 不流式接收时主体在内存中累积，先按Content-Length拒绝超长的请求
+        if (!chunked_ && !body_callback_ && content_length_ > max_body_size_) {
+            return fail(HttpResponse::k413PayloadTooLarge);
+        }
+        base_ = buf->peek();
+        header_length_ = end + 4 - buf->peek();
+        scan_offset_ = 0;
+        
+        streaming_ = chunked_ || body_callback_;
+        if (streaming_) {
+            // 主体要边到达边取出，头部先拷贝到请求内部，再释放头部占用的字节
+            request_.detach();
+            buf->retrieve(header_length_);
+            header_length_ = 0;
+            body_remaining_ = content_length_;
+            state_ = chunked_ ? kExpectChunkSize : kExpectBody;
+        } else {
+            state_ = kExpectBody;
+        }
+    }
     
-    while (hasMore) {
-        if (state_ == kExpectRequestLine) {
-            // 查找请求行结束符
-            const char* crlf = buf->findCRLF();
-            if (crlf) {
-                // 解析请求行
-                ok = parseRequestLine(buf->peek(), crlf);
-                if (ok) {
-                    // 跳过请求行
-                    buf->retrieveUntil(crlf + 2);
-                    // 转入解析头部阶段
-                    state_ = kExpectHeaders;
-                } else {
-                    hasMore = false;
-                }
-            } else {
-                hasMore = false;
+    if (chunked_) {
+        if (state_ != kGotAll && !parseChunked(buf)) {
+            return false;
+        }
+    } else if (state_ == kExpectBody && streaming_) {
+        // Content-Length主体的流式接收
+        size_t n = std::min(buf->readableBytes(), body_remaining_);
+        if (n > 0) {
+            appendBody(buf->peek(), n);  // 有BodyCallback，不会超限
+            buf->retrieve(n);
+            body_remaining_ -= n;
+        }
+        if (body_remaining_ == 0) {
+            state_ = kGotAll;
+        }
+    } else if (state_ == kExpectBody) {
+        // 等待主体期间Buffer可能扩容或前移，视图需要随之平移
+        if (buf->peek() != base_) {
+            request_.rebase(base_, header_length_, buf->peek());
+            base_ = buf->peek();
+        }
+        
+        // 检查是否有足够的数据
+        if (buf->readableBytes() - header_length_ >= content_length_) {
+            request_.setBody(std::string_view(buf->peek() + header_length_, content_length_));
+            // 解析完成
+            state_ = kGotAll;
+        }
+    }
+    
+    return true;
+}
+
+// chunked格式：
+// 1a;ext=1\r\n
+// <0x1a字节数据>\r\n
+// 0\r\n
+// Trailer: x\r\n
+// \r\n
+bool HttpParser::parseChunked(Buffer* buf) {
+    while (state_ != kGotAll) {
+        if (state_ == kExpectChunkSize) {
+            const char* crlf = buf->findCRLF(&scan_offset_);
+            if (crlf == nullptr) {
+                // 大小行不会很长，过长视为错误
+                return buf->readableBytes() <= 1024;
             }
-        } else if (state_ == kExpectHeaders) {
-            // 查找头部行结束符
-            const char* crlf = buf->findCRLF();
-            if (crlf) {
-                const char* colon = std::find(buf->peek(), crlf, ':');
-                if (colon != crlf) {
-                    // 解析头部
-                    std::string field(buf->peek(), colon);
-                    ++colon;
-                    // 去除中间空格
-                    while (colon < crlf && isspace(*colon)) {
-                        ++colon;
-                    }
-                    std::string value(colon, crlf);
-                    // 去除尾部空格
-                    while (!value.empty() && isspace(value[value.size() - 1])) {
-                        value.resize(value.size() - 1);
-                    }
-                    request_.addHeader(field, value);
-                    
-                    // 检查Content-Length
-                    if (field == "Content-Length") {
-                        content_length_ = std::stoul(value);
-                    }
-                } else {
-                    // 空行，头部结束
-                    if (content_length_ > 0) {
-                        // 转入解析主体阶段
-                        state_ = kExpectBody;
-                    } else {
-                        // 没有主体，解析完成
-                        state_ = kGotAll;
-                        hasMore = false;
-                    }
+            
+            // 解析16进制大小，忽略";"之后的扩展
+            size_t size = 0;
+            int digits = 0;
+            for (const char* p = buf->peek(); p < crlf && *p != ';'; ++p) {
+                int v;
+                if (*p >= '0' && *p <= '9') v = *p - '0';
+                else if (*p >= 'a' && *p <= 'f') v = *p - 'a' + 10;
+                else if (*p >= 'A' && *p <= 'F') v = *p - 'A' + 10;
+                else if (*p == ' ' || *p == '\t') continue;
+                else return false;
+                if (++digits > 15) {
+                    return false;
                 }
-                // 跳过当前行
-                buf->retrieveUntil(crlf + 2);
-            } else {
-                hasMore = false;
+                size = size * 16 + v;
             }
-        } else if (state_ == kExpectBody) {
-            // 检查是否有足够的数据
-            if (buf->readableBytes() >= content_length_) {
-                // 解析主体
-                request_.setBody(buf->retrieveAsString(content_length_));
-                // 解析完成
+            if (digits == 0) {
+                return false;
+            }
+            
+            buf->retrieveUntil(crlf + 2);
+            scan_offset_ = 0;
+            body_remaining_ = size;
+            state_ = size == 0 ? kExpectTrailers : kExpectChunkData;
+        } else if (state_ == kExpectChunkData) {
+            size_t n = std::min(buf->readableBytes(), body_remaining_);
+            if (n == 0) {
+                return true;
+            }
+            if (!appendBody(buf->peek(), n)) {
+                return fail(HttpResponse::k413PayloadTooLarge);
+            }
+            buf->retrieve(n);
+            body_remaining_ -= n;
+            if (body_remaining_ == 0) {
+                state_ = kExpectChunkEnd;
+            }
+        } else if (state_ == kExpectChunkEnd) {
+            if (buf->readableBytes() < 2) {
+                return true;
+            }
+            if (buf->peek()[0] != '\r' || buf->peek()[1] != '\n') {
+                return false;
+            }
+            buf->retrieve(2);
+            state_ = kExpectChunkSize;
+        } else if (state_ == kExpectTrailers) {
+            // trailer头部直接忽略，遇到空行结束
+            const char* crlf = buf->findCRLF(&scan_offset_);
+            if (crlf == nullptr) {
+                return buf->readableBytes() <= kMaxHeaderBytes;
+            }
+            bool empty_line = crlf == buf->peek();
+            buf->retrieveUntil(crlf + 2);
+            scan_offset_ = 0;
+            if (empty_line) {
+                if (!body_callback_) {
+                    request_.setBody(body_storage_);
+                }
                 state_ = kGotAll;
-                hasMore = false;
-            } else {
-                hasMore = false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool HttpParser::appendBody(const char* data, size_t len) {
+    if (body_callback_) {
+        body_callback_(std::string_view(data, len));
+    } else {
+        if (len > max_body_size_ - body_storage_.size()) {
+            return false;
+        }
+        body_storage_.append(data, len);
+    }
+    return true;
+}
+
+void HttpParser::finishRequest(Buffer* buf) {
+    assert(state_ == kGotAll);
+    // 流式模式下数据已经取出，这里只剩普通请求占用的字节
+    if (!streaming_) {
+        buf->retrieve(header_length_ + content_length_);
+    }
+    reset();
+}
+
+bool HttpParser::parseHeaders(const char* begin, const char* end) {
+    // 请求行
+    const char* crlf = scanCRLF(begin, end);
+    if (crlf == nullptr || !parseRequestLine(begin, crlf)) {
+        return false;
+    }
+    
+    // 逐行解析头部
+    for (const char* line = crlf + 2; line < end; line = crlf + 2) {
+        crlf = scanCRLF(line, end);
+        if (crlf == nullptr) {
+            return false;
+        }
+        
+        const char* colon = scanByte(line, crlf, ':');
+        if (colon == nullptr) {
+            return false;
+        }
+        std::string_view field(line, colon - line);
+        ++colon;
+        // 去除中间空格
+        while (colon < crlf && isspace(*colon)) {
+            ++colon;
+        }
+        // 去除尾部空格
+        const char* value_end = crlf;
+        while (value_end > colon && isspace(*(value_end - 1))) {
+            --value_end;
+        }
+        std::string_view value(colon, value_end - colon);
+        request_.addHeader(field, value);
+        
+        // 检查Content-Length：只接受一个，最多19位数字，不会溢出；重复出现视为请求走私的迹象，直接拒绝
+        if (field.size() == 14 && strncasecmp(field.data(), "Content-Length", 14) == 0) {
+            if (has_content_length_ || value.empty()) {
+                return false;
+            }
+            has_content_length_ = true;
+            content_length_ = 0;
+            for (char c : value) {
+                if (c < '0' || c > '9') {
+                    return false;
+                }
+            }
+            if (value.size() > 19) {
+                return fail(HttpResponse::k413PayloadTooLarge);
+            }
+            for (char c : value) {
+                content_length_ = content_length_ * 10 + (c - '0');
+            }
+        }
+        
+        // 检查Transfer-Encoding，chunked优先于Content-Length
+        if (field.size() == 17 && strncasecmp(field.data(), "Transfer-Encoding", 17) == 0) {
+            has_transfer_encoding_ = true;
+            if (!parseTransferEncoding(value)) {
+                return false;
             }
         }
     }
     
-    return ok;
+    // RFC 9112 6.3：请求带Transfer-Encoding而最后一个编码不是chunked时无法确定主体长度，回复400
+    if (has_transfer_encoding_ && !chunked_) {
+        return false;
+    }
+    return true;
+}
+
+bool HttpParser::parseTransferEncoding(std::string_view value) {
+    // 逗号分隔的编码列表，可能分散在多个头部中；允许空元素
+    while (!value.empty()) {
+        size_t comma = value.find(',');
+        std::string_view coding = value.substr(0, comma);
+        value.remove_prefix(comma == std::string_view::npos ? value.size() : comma + 1);
+        while (!coding.empty() && (coding.front() == ' ' || coding.front() == '\t')) {
+            coding.remove_prefix(1);
+        }
+        while (!coding.empty() && (coding.back() == ' ' || coding.back() == '\t')) {
+            coding.remove_suffix(1);
+        }
+        if (coding.empty()) {
+            continue;
+        }
+        if (chunked_) {
+            // chunked之后还有编码，或者chunked出现了两次
+            return false;
+        }
+        if (coding.size() == 7 && strncasecmp(coding.data(), "chunked", 7) == 0) {
+            chunked_ = true;
+        }
+    }
+    return true;
 }
 
 bool HttpParser::parseRequestLine(const char* begin, const char* end) {
@@ -105,8 +310,7 @@ bool HttpParser::parseRequestLine(const char* begin, const char* end) {
     }
     
     // 解析请求方法
-    std::string method_str(begin, space);
-    HttpRequest::Method method = HttpRequest::stringToMethod(method_str);
+    HttpRequest::Method method = HttpRequest::stringToMethod(std::string_view(begin, space - begin));
     if (method == HttpRequest::INVALID) {
         return false;
     }
@@ -122,7 +326,7 @@ bool HttpParser::parseRequestLine(const char* begin, const char* end) {
     }
     
     // 解析请求路径
-    request_.setPath(std::string(begin, space));
+    request_.setPath(std::string_view(begin, space - begin));
     
     // 跳过空格
     begin = space + 1;
@@ -1,33 +1,64 @@
 #pragma once
 
+#include <functional>
 #include <string>
+#include <string_view>
 #include "core/http/http_request.h"
+#include "core/http/http_response.h"
 
 namespace core {
 
 class Buffer;
 
 // HTTP请求解析器
+// 普通Content-Length请求解析时不从Buffer中取出数据，HttpRequest中的视图直接指向Buffer；
+// 处理完请求后调用finishRequest()才真正释放这部分字节。
+// chunked请求或设置了BodyCallback时，头部先detach()到请求内部，主体边到达边解码、边从Buffer中取出
 class HttpParser {
 public:
     enum ParseState {
-        kExpectRequestLine,    // 期望请求行
-        kExpectHeaders,        // 期望头部
-        kExpectBody,           // 期望主体
+        kExpectHeaders,        // 期望请求行和头部
+        kExpectBody,           // 期望Content-Length主体
+        kExpectChunkSize,      // 期望chunk大小行
+        kExpectChunkData,      // 期望chunk数据
+        kExpectChunkEnd,       // 期望chunk数据后的CRLF
+        kExpectTrailers,       // 期望trailer头部及结尾空行
         kGotAll,               // 获取全部
     };
     
+    // 流式接收请求体，每收到一段数据回调一次，数据仅在回调期间有效
+    using BodyCallback = std::function<void(std::string_view data)>;
+    
+    static const size_t kMaxHeaderBytes = 64 * 1024;  // 请求行+头部的最大长度
+    static const size_t kDefaultMaxBodySize = 8 * 1024 * 1024;  // 默认的内存中请求体上限
+    
     HttpParser();
     
     // 重置解析器
     void reset();
     
-    // 解析请求
+    // 设置后请求体不在内存中累积，而是分段交给cb，HttpRequest::body()为空
+    void setBodyCallback(BodyCallback cb) { body_callback_ = std::move(cb); }
+    
+    // 在内存中累积的请求体(Content-Length主体或解码后的chunked主体)上限，超过时解析失败并回复413；
+    // 设置了BodyCallback时主体不累积，不受此限制
+    void setMaxBodySize(size_t size) { max_body_size_ = size; }
+    
+    // 解析请求，返回false表示请求格式错误，errorStatus()为应回复的状态码
     bool parseRequest(Buffer* buf, std::chrono::steady_clock::time_point receiveTime);
     
+    // 解析失败的原因：400(格式错误)、413(主体过大)或431(头部过大)
+    HttpResponse::StatusCode errorStatus() const { return error_status_; }
+    
     // 是否获取到完整的请求
     bool gotAll() const { return state_ == kGotAll; }
     
+    // 是否已解析完头部，正在接收主体
+    bool expectingBody() const { return state_ != kExpectHeaders && state_ != kGotAll; }
+    
+    // 请求处理完毕，从Buffer中取出该请求尚未释放的字节并重置解析器
+    void finishRequest(Buffer* buf);
+    
     // 获取解析后的请求
     const HttpRequest& request() const { return request_; }
     HttpRequest& request() { return request_; }
@@ -35,10 +66,35 @@ public:
 private:
     // 解析请求行
     bool parseRequestLine(const char* begin, const char* end);
+    // 解析请求行和全部头部，end指向头部结尾的空行
+    bool parseHeaders(const char* begin, const char* end);
+    // 解析Transfer-Encoding的编码列表，chunked之后还有编码时返回false
+    bool parseTransferEncoding(std::string_view value);
+    // 解析chunked主体，返回false表示格式错误
+    bool parseChunked(Buffer* buf);
+    // 把一段主体数据交给BodyCallback或累积到body_storage_，超过上限时返回false
+    bool appendBody(const char* data, size_t len);
+    // 记录失败原因并返回false
+    bool fail(HttpResponse::StatusCode status) {
+        error_status_ = status;
+        return false;
+    }
     
     ParseState state_;         // 解析状态
     HttpRequest request_;      // 解析到的请求
+    BodyCallback body_callback_; // 流式请求体回调
+    size_t header_length_;     // 请求行+头部(含结尾空行)的长度
     size_t content_length_;    // 内容长度
+    bool has_content_length_;  // 是否已出现Content-Length头部
+    size_t max_body_size_;     // 内存中请求体上限
+    HttpResponse::StatusCode error_status_;  // 解析失败时应回复的状态码
+    size_t body_remaining_;    // 流式/chunked模式下当前主体或chunk剩余的字节数
+    bool chunked_;             // Transfer-Encoding的最后一个编码是chunked
+    bool has_transfer_encoding_; // 是否出现了Transfer-Encoding头部
+    bool streaming_;           // 主体是否边到达边取出（chunked或设置了BodyCallback）
+    size_t scan_offset_;       // 当前行已扫描的偏移(相对peek())，避免数据分批到达时重复扫描
+    const char* base_;         // 解析头部时Buffer的peek()，Buffer移动后用于平移视图
+    std::string body_storage_; // chunked且未设置BodyCallback时，解码后的主体
 };
 
 } // namespace core
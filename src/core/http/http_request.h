@@ -1,13 +1,17 @@
 #pragma once
 
-#include <map>
 #include <string>
 #include <string_view>
+#include <vector>
 #include <chrono>
+#include <stdint.h>
+#include <strings.h>
 
 namespace core {
 
 // HTTP请求:METHOD PATH HTTP/VERSION (GET /index.html HTTP/1.1)
+// 路径、头部和正文均为string_view，默认指向连接输入缓冲区中的原始字节，不做拷贝，
+// 仅在HttpCallback执行期间有效；需要在回调之外保留请求时调用detach()或直接拷贝一份
 class HttpRequest {
 public:
     enum Method {
@@ -22,12 +26,38 @@ public:
     enum Version {
         UNKNOWN,
         HTTP10,
-        HTTP11
+        HTTP11,
+        HTTP20
     };
     
+    struct Header {
+        std::string_view name;
+        std::string_view value;
+    };
+    
+    // 大多数请求的头部数量都在这个范围内，预留后复用时不再分配
+    static const size_t kInlineHeaders = 16;
+    
     HttpRequest()
         : method_(INVALID),
           version_(UNKNOWN) {
+        headers_.reserve(kInlineHeaders);
+    }
+    
+    // 拷贝/移动时若持有数据，需要把视图重新指向新的存储
+    HttpRequest(const HttpRequest& other) { copyFrom(other); }
+    HttpRequest& operator=(const HttpRequest& other) {
+        if (this != &other) {
+            copyFrom(other);
+        }
+        return *this;
+    }
+    HttpRequest(HttpRequest&& other) noexcept { moveFrom(std::move(other)); }
+    HttpRequest& operator=(HttpRequest&& other) noexcept {
+        if (this != &other) {
+            moveFrom(std::move(other));
+        }
+        return *this;
     }
     
     // 设置/获取方法
@@ -35,35 +65,90 @@ public:
     Method method() const { return method_; }
     
     // 设置/获取路径
-    void setPath(const std::string& path) { path_ = path; }
-    const std::string& path() const { return path_; }
+    void setPath(std::string_view path) { path_ = path; }
+    std::string_view path() const { return path_; }
     
     // 设置/获取版本
     void setVersion(Version version) { version_ = version; }
     Version version() const { return version_; }
     
-    // 设置/获取HTTP头部
-    void addHeader(const std::string& key, const std::string& value) { headers_[key] = value; }
-    std::string getHeader(const std::string& key) const {
-        auto it = headers_.find(key);
-        return it == headers_.end() ? "" : it->second;
+    // 设置/获取HTTP头部，头部名不区分大小写，未找到返回空
+    void addHeader(std::string_view key, std::string_view value) { headers_.push_back(Header{key, value}); }
+    std::string_view getHeader(std::string_view key) const {
+        for (const Header& header : headers_) {
+            if (header.name.size() == key.size()
+                && strncasecmp(header.name.data(), key.data(), key.size()) == 0) {
+                return header.value;
+            }
+        }
+        return std::string_view();
     }
+    const std::vector<Header>& headers() const { return headers_; }
     
     // 设置/获取正文
-    void setBody(const std::string& body) { body_ = body; }
-    const std::string& body() const { return body_; }
+    void setBody(std::string_view body) { body_ = body; }
+    std::string_view body() const { return body_; }
+    
+    // 将视图指向的数据拷贝到请求内部，此后请求不再依赖输入缓冲区
+    void detach() {
+        std::string storage;
+        storage.reserve(path_.size() + body_.size() + headers_.size() * 32);
+        // 先记录各视图在新存储中的偏移，拼接完成后再统一指向，避免扩容导致失效
+        std::vector<std::pair<size_t, size_t>> offsets;
+        offsets.reserve(headers_.size() * 2 + 2);
+        auto push = [&](std::string_view v) {
+            offsets.emplace_back(storage.size(), v.size());
+            storage.append(v.data(), v.size());
+        };
+        push(path_);
+        push(body_);
+        for (const Header& header : headers_) {
+            push(header.name);
+            push(header.value);
+        }
+        storage_.swap(storage);
+        
+        size_t i = 0;
+        auto view = [&]() {
+            const std::pair<size_t, size_t>& o = offsets[i++];
+            return std::string_view(storage_.data() + o.first, o.second);
+        };
+        path_ = view();
+        body_ = view();
+        for (Header& header : headers_) {
+            header.name = view();
+            header.value = view();
+        }
+    }
     
-    // 重置请求
+    // 数据整体移动后(Buffer扩容/前移、存储拷贝)，将落在[old_base, old_base + size)内的视图平移到new_base
+    void rebase(const char* old_base, size_t size, const char* new_base) {
+        auto move = [old_base, size, new_base](std::string_view& v) {
+            uintptr_t offset = reinterpret_cast<uintptr_t>(v.data()) - reinterpret_cast<uintptr_t>(old_base);
+            if (v.data() != nullptr && offset < size) {
+                v = std::string_view(new_base + offset, v.size());
+            }
+        };
+        move(path_);
+        move(body_);
+        for (Header& header : headers_) {
+            move(header.name);
+            move(header.value);
+        }
+    }
+    
+    // 重置请求，保留headers_的容量
     void reset() {
         method_ = INVALID;
         version_ = UNKNOWN;
-        path_.clear();
+        path_ = std::string_view();
         headers_.clear();
-        body_.clear();
+        body_ = std::string_view();
+        storage_.clear();
     }
     
     // 将字符串转为方法
-    static Method stringToMethod(const std::string& str) {
+    static Method stringToMethod(std::string_view str) {
         if (str == "GET") return GET;
         else if (str == "POST") return POST;
         else if (str == "HEAD") return HEAD;
@@ -72,12 +157,51 @@ public:
         else return INVALID;
     }
     
+    static const char* methodToString(Method method) {
+        switch (method) {
+            case GET:    return "GET";
+            case POST:   return "POST";
+            case HEAD:   return "HEAD";
+            case PUT:    return "PUT";
+            case DELETE: return "DELETE";
+            default:     return "INVALID";
+        }
+    }
+    
 private:
+    void copyFrom(const HttpRequest& other) {
+        method_ = other.method_;
+        version_ = other.version_;
+        path_ = other.path_;
+        headers_ = other.headers_;
+        body_ = other.body_;
+        storage_ = other.storage_;
+        if (!storage_.empty()) {
+            rebase(other.storage_.data(), other.storage_.size(), storage_.data());
+        }
+    }
+    
+    void moveFrom(HttpRequest&& other) {
+        const char* old_base = other.storage_.data();
+        method_ = other.method_;
+        version_ = other.version_;
+        path_ = other.path_;
+        headers_ = std::move(other.headers_);
+        body_ = other.body_;
+        storage_ = std::move(other.storage_);
+        // 短字符串优化(SSO)下移动后地址会变化
+        if (!storage_.empty() && storage_.data() != old_base) {
+            rebase(old_base, storage_.size(), storage_.data());
+        }
+        other.reset();
+    }
+    
     Method method_;                    // 请求方法
-    std::string path_;                 // 请求路径
+    std::string_view path_;            // 请求路径
     Version version_;                  // HTTP版本
-    std::map<std::string, std::string> headers_; // 请求头
-    std::string body_;                 // 请求体
+    std::vector<Header> headers_;      // 请求头，按到达顺序保存
+    std::string_view body_;            // 请求体
+    std::string storage_;              // detach()后持有的数据，平时为空
 };
 
 } // namespace core
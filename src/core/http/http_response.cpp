@@ -1,48 +1,127 @@
 #include "core/http/http_response.h"
 
-#include <stdio.h>
+#include "core/http/http_date.h"
+#include "core/http/http_deferred_response.h"
+#include "core/http/websocket.h"
+#include "core/utils/int_format.h"
 
 namespace core {
 
+namespace {
+
+// 1xx、204、304响应不能携带主体
+bool bodyAllowed(int code) {
+    return code >= 200 && code != 204 && code != 304;
+}
+
+const std::string_view kCRLF("\r\n");
+
+} // namespace
+
+HttpDeferredResponse HttpResponse::defer() {
+    if (!deferred_) {
+        deferred_ = std::make_shared<HttpDeferredState>();
+    }
+    return HttpDeferredResponse(deferred_);
+}
+
+void HttpResponse::upgradeWebSocket(WebSocketCallbacks callbacks) {
+    websocket_ = std::make_shared<const WebSocketCallbacks>(std::move(callbacks));
+}
+
 // 将HttpResponse转化为实际回复的http包，并添加到output Buffer
 void HttpResponse::appendToBuffer(Buffer* output) const {
     // 一个标准Response示例如下：
     // HTTP/1.1 200 OK
     // Content-Type: application/json
     // Content-Length: 190
+    // Date: Sun, 18 Oct 2026 08:00:00 GMT
+    // Server: GameForge
 
     // {
     // "code": 200,
     // "msg": "{\"partialKey\":\"...\",\"finalPublicKey\":\"...\"}"
     // }
+    
+    // 状态行：优先使用预渲染的状态行，自定义描述时才拼接
+    std::string_view status_line = statusLine(status_code_);
+    char code_buf[kMaxUIntDigits];
+    size_t code_len = 0;
+    if (status_line.empty() || (!status_message_.empty()
+        && status_line.substr(13, status_line.size() - 15) != status_message_)) {
+        status_line = std::string_view();
+        code_len = formatUInt(static_cast<uint64_t>(status_code_), code_buf);
+    }
+    
+    const bool has_body = bodyAllowed(status_code_) && !chunked();
+    std::string_view connection = close_connection_ ? "Connection: close\r\n" : "Connection: Keep-Alive\r\n";
+    if (status_code_ == k101SwitchingProtocols) {
+        connection = "Connection: Upgrade\r\n";
+    }
+    std::string_view date_block = HttpDateCache::headerBlock();
+    
+    // 主体来源：文件 > 外部内存 > body_
+    std::string_view body = bodyData();
+    size_t body_length = hasFileBody() ? file_body_.length : body.size();
+    if (!has_body || hasFileBody() || omit_body_) {
+        body = std::string_view();
+    }
+    
+    char length_buf[kMaxUIntDigits];
+    size_t length_len = has_body ? formatUInt(body_length, length_buf) : 0;
+    
+    // 预先计算总长度，只扩容一次
+    size_t total = status_line.empty() ? 9 + code_len + 1 + status_message_.size() + 2 : status_line.size();
+    total += connection.size() + date_block.size() + kCRLF.size();
+    if (chunked()) {
+        if (!close_delimited_) {
+            total += sizeof("Transfer-Encoding: chunked\r\n") - 1;
+        }
+    } else if (has_body) {
+        total += sizeof("Content-Length: \r\n") - 1 + length_len + body.size();
+    }
+    for (const auto& header : headers_) {
+        total += header.first.size() + 2 + header.second.size() + 2;
+    }
+    output->ensureWritableBytes(total);
+    
     // 状态行
-    char buf[32];
-    snprintf(buf, sizeof buf, "HTTP/1.1 %d ", status_code_);
-    output->append(buf);
-    output->append(status_message_);
-    output->append("\r\n");
+    if (status_line.empty()) {
+        output->append("HTTP/1.1 ", 9);
+        output->append(code_buf, code_len);
+        output->append(" ", 1);
+        output->append(status_message_);
+        output->append(kCRLF.data(), kCRLF.size());
+    } else {
+        output->append(status_line.data(), status_line.size());
+    }
     
     // 响应头
-    if (close_connection_) {
-        output->append("Connection: close\r\n");
-    } else {
-        snprintf(buf, sizeof buf, "Content-Length: %zd\r\n", body_.size());
-        output->append(buf);
-        output->append("Connection: Keep-Alive\r\n");
+    if (chunked()) {
+        // 主体长度未知，由后续chunk给出；不分chunk时由关闭连接给出
+        if (!close_delimited_) {
+            output->append("Transfer-Encoding: chunked\r\n", 28);
+        }
+    } else if (has_body) {
+        output->append("Content-Length: ", 16);
+        output->append(length_buf, length_len);
+        output->append(kCRLF.data(), kCRLF.size());
     }
+    output->append(connection.data(), connection.size());
+    output->append(date_block.data(), date_block.size());
     
     for (const auto& header : headers_) {
         output->append(header.first);
-        output->append(": ");
+        output->append(": ", 2);
         output->append(header.second);
-        output->append("\r\n");
+        output->append(kCRLF.data(), kCRLF.size());
     }
     
     // 空行
-    output->append("\r\n");
+    output->append(kCRLF.data(), kCRLF.size());
     
-    // 响应体
-    output->append(body_);
+    // 响应体，chunked响应的主体由HttpChunkWriter后续发送，文件主体由连接用sendfile发送
+    output->append(body.data(), body.size());
 }
 
 } // namespace core
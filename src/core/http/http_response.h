@@ -1,33 +1,94 @@
 #pragma once
 
-#include <map>
+#include <functional>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <sys/types.h>
 #include "core/net/buffer.h"
 
 namespace core {
 
+class HttpChunkWriter;
+class HttpDeferredResponse;
+class HttpDeferredState;
+struct WebSocketCallbacks;
+
 // HTTP响应
 class HttpResponse {
 public:
+    // 流式主体的生产者：每次被调用时通过writer写入若干chunk，返回true表示主体结束
+    using ChunkProducer = std::function<bool(HttpChunkWriter*)>;
+    
+    // 文件主体：由连接用sendfile发送fd中[offset, offset + length)的内容
+    struct FileBody {
+        int fd = -1;
+        off_t offset = 0;
+        size_t length = 0;
+        std::shared_ptr<void> holder;  // 发送完成前保持fd有效
+    };
+    
     enum StatusCode {
         kUnknown,
+        k101SwitchingProtocols = 101,
         k200Ok = 200,
+        k204NoContent = 204,
+        k206PartialContent = 206,
         k301MovedPermanently = 301,
+        k302Found = 302,
+        k304NotModified = 304,
         k400BadRequest = 400,
         k403Forbidden = 403,
         k404NotFound = 404,
+        k405MethodNotAllowed = 405,
+        k408RequestTimeout = 408,
+        k413PayloadTooLarge = 413,
+        k416RangeNotSatisfiable = 416,
+        k426UpgradeRequired = 426,
+        k431RequestHeaderFieldsTooLarge = 431,
         k500InternalServerError = 500,
+        k503ServiceUnavailable = 503,
     };
     
+    // 预先渲染好的状态行"HTTP/1.1 200 OK\r\n"，未知状态码返回空
+    static constexpr std::string_view statusLine(int code) {
+        switch (code) {
+            case 101: return "HTTP/1.1 101 Switching Protocols\r\n";
+            case 200: return "HTTP/1.1 200 OK\r\n";
+            case 204: return "HTTP/1.1 204 No Content\r\n";
+            case 206: return "HTTP/1.1 206 Partial Content\r\n";
+            case 301: return "HTTP/1.1 301 Moved Permanently\r\n";
+            case 302: return "HTTP/1.1 302 Found\r\n";
+            case 304: return "HTTP/1.1 304 Not Modified\r\n";
+            case 400: return "HTTP/1.1 400 Bad Request\r\n";
+            case 403: return "HTTP/1.1 403 Forbidden\r\n";
+            case 404: return "HTTP/1.1 404 Not Found\r\n";
+            case 405: return "HTTP/1.1 405 Method Not Allowed\r\n";
+            case 408: return "HTTP/1.1 408 Request Timeout\r\n";
+            case 413: return "HTTP/1.1 413 Payload Too Large\r\n";
+            case 416: return "HTTP/1.1 416 Range Not Satisfiable\r\n";
+            case 426: return "HTTP/1.1 426 Upgrade Required\r\n";
+            case 431: return "HTTP/1.1 431 Request Header Fields Too Large\r\n";
+            case 500: return "HTTP/1.1 500 Internal Server Error\r\n";
+            case 503: return "HTTP/1.1 503 Service Unavailable\r\n";
+            default:  return std::string_view();
+        }
+    }
+    
     HttpResponse()
         : status_code_(kUnknown),
-          close_connection_(false) {
+          close_connection_(false),
+          omit_body_(false),
+          close_delimited_(false) {
     }
     
     // 设置状态码
     void setStatusCode(StatusCode code) { status_code_ = code; }
+    StatusCode statusCode() const { return status_code_; }
     
-    // 设置状态消息
+    // 设置状态消息，不设置时使用状态码的标准描述
     void setStatusMessage(const std::string& message) { status_message_ = message; }
     
     // 设置关闭连接
@@ -39,11 +100,89 @@ public:
     // 设置内容类型
     void setContentType(const std::string& type) { addHeader("Content-Type", type); }
     
-    // 添加头部
-    void addHeader(const std::string& key, const std::string& value) { headers_[key] = value; }
+    // 添加头部，同名头部会被覆盖，输出时保持首次添加的顺序
+    void addHeader(const std::string& key, const std::string& value) {
+        for (auto& header : headers_) {
+            if (header.first == key) {
+                header.second = value;
+                return;
+            }
+        }
+        headers_.emplace_back(key, value);
+    }
+    
+    // 获取头部，未找到返回空
+    std::string_view getHeader(std::string_view key) const {
+        for (const auto& header : headers_) {
+            if (header.first == key) {
+                return header.second;
+            }
+        }
+        return std::string_view();
+    }
+    
+    // 全部头部，按首次添加的顺序
+    const std::vector<std::pair<std::string, std::string>>& headers() const { return headers_; }
+    
+    // 设置主体，传入右值时不拷贝；以下三种主体以最后一次设置的为准
+    void setBody(std::string body) {
+        body_ = std::move(body);
+        body_view_ = std::string_view();
+        body_holder_.reset();
+        file_body_ = FileBody();
+    }
+    const std::string& body() const { return body_; }
+    
+    // 主体引用外部内存(如读入内存的文件缓存)，不拷贝；holder保证数据在输出前有效
+    void setBodyView(std::string_view data, std::shared_ptr<const void> holder) {
+        body_.clear();
+        body_view_ = data;
+        body_holder_ = std::move(holder);
+        file_body_ = FileBody();
+    }
+    
+    // 内存中的主体(setBody或setBodyView)，文件主体返回空
+    std::string_view bodyData() const { return body_view_.empty() ? std::string_view(body_) : body_view_; }
+    
+    // 主体为文件的一段，响应头发出后由连接零拷贝发送
+    void setFileBody(int fd, off_t offset, size_t length, std::shared_ptr<void> holder) {
+        body_.clear();
+        body_view_ = std::string_view();
+        body_holder_.reset();
+        file_body_.fd = fd;
+        file_body_.offset = offset;
+        file_body_.length = length;
+        file_body_.holder = std::move(holder);
+    }
+    bool hasFileBody() const { return file_body_.fd >= 0; }
+    const FileBody& fileBody() const { return file_body_; }
+    
+    // 只输出响应头(HEAD请求)：Content-Length照常按主体计算，但不输出主体
+    void setOmitBody(bool on) { omit_body_ = on; }
+    bool omitBody() const { return omit_body_; }
+    
+    // 以chunked编码流式发送主体，代替setBody；HTTP/1.0请求改为不分chunk、以关闭连接结束(见setCloseDelimited)。
+    // producer首次在响应头发出后调用，之后每当连接输出缓冲区排空再调用一次，以此实现背压
+    void setChunkedBody(ChunkProducer producer) { chunk_producer_ = std::move(producer); }
+    bool chunked() const { return static_cast<bool>(chunk_producer_); }
+    // HTTP/1.0客户端不认识chunked编码：流式主体不分chunk原样发送、以关闭连接结束，
+    // 响应头不带Transfer-Encoding并带Connection: close。由HttpServer按请求的版本设置
+    void setCloseDelimited() {
+        close_delimited_ = true;
+        close_connection_ = true;
+    }
+    bool closeDelimited() const { return close_delimited_; }
+    const ChunkProducer& chunkProducer() const { return chunk_producer_; }
+    
+    // 延迟响应：处理函数返回后由返回的句柄在任意线程中完成，本对象的内容被忽略
+    HttpDeferredResponse defer();
+    bool deferred() const { return static_cast<bool>(deferred_); }
+    const std::shared_ptr<HttpDeferredState>& deferredState() const { return deferred_; }
     
-    // 设置主体
-    void setBody(const std::string& body) { body_ = body; }
+    // 升级为WebSocket：HttpServer校验握手并回复101，之后连接按帧收发，由callbacks处理消息；
+    // 握手不合法时改为回复400/426。仅适用于HTTP/1.1，本对象的其他内容被忽略
+    void upgradeWebSocket(WebSocketCallbacks callbacks);
+    const std::shared_ptr<const WebSocketCallbacks>& webSocket() const { return websocket_; }
     
     // 将HttpResponse转化为实际回复的http包，并添加到output Buffer
     void appendToBuffer(Buffer* output) const;
@@ -51,9 +190,17 @@ public:
 private:
     StatusCode status_code_;           // 状态码
     std::string status_message_;       // 状态消息
-    std::map<std::string, std::string> headers_; // 响应头
+    std::vector<std::pair<std::string, std::string>> headers_; // 响应头，按插入顺序保存
     std::string body_;                 // 响应体
+    std::string_view body_view_;       // 引用外部内存的响应体，非空时代替body_
+    std::shared_ptr<const void> body_holder_; // body_view_的所有者
+    FileBody file_body_;               // 文件响应体
     bool close_connection_;            // 是否关闭连接
+    bool omit_body_;                   // 是否只输出响应头
+    bool close_delimited_;             // 流式主体是否以关闭连接结束(不用chunked编码)
+    ChunkProducer chunk_producer_;     // 流式主体生产者，为空表示普通响应
+    std::shared_ptr<HttpDeferredState> deferred_;  // 延迟响应的状态，为空表示同步响应
+    std::shared_ptr<const WebSocketCallbacks> websocket_;  // 升级为WebSocket后的回调，为空表示普通响应
 };
 
 } // namespace core
@@ -0,0 +1,300 @@
+#include "core/http/http_router.h"
+
+#include <assert.h>
+#include "core/http/http_response.h"
+#include "core/utils/logger.h"
+
+namespace core {
+
+// 注册阶段使用的树节点
+struct HttpRouter::BuildNode {
+    std::string prefix;                               // 静态前缀
+    std::vector<std::unique_ptr<BuildNode>> children; // 静态子节点，首字符互不相同
+    std::unique_ptr<BuildNode> param_child;           // ":name"子节点
+    std::unique_ptr<BuildNode> wildcard_child;        // "*name"子节点
+    std::string name;                                 // 参数/通配节点的参数名
+    int32_t handlers[HttpRequest::DELETE + 1];
+    
+    BuildNode() {
+        for (int32_t& h : handlers) {
+            h = -1;
+        }
+    }
+};
+
+HttpRouter::HttpRouter()
+    : root_(new BuildNode),
+      frozen_(false) {
+}
+
+HttpRouter::~HttpRouter() = default;
+
+HttpRouter::BuildNode* HttpRouter::insertStatic(BuildNode* node, std::string_view s) {
+    while (!s.empty()) {
+        BuildNode* next = nullptr;
+        for (auto& child : node->children) {
+            if (child->prefix[0] != s[0]) {
+                continue;
+            }
+            
+            // 计算公共前缀
+            size_t lcp = 0;
+            while (lcp < child->prefix.size() && lcp < s.size() && child->prefix[lcp] == s[lcp]) {
+                ++lcp;
+            }
+            
+            if (lcp < child->prefix.size()) {
+                // 分裂：公共前缀成为新的中间节点，原节点保留剩余部分
+                std::unique_ptr<BuildNode> mid(new BuildNode);
+                mid->prefix = child->prefix.substr(0, lcp);
+                child->prefix.erase(0, lcp);
+                mid->children.push_back(std::move(child));
+                child = std::move(mid);
+            }
+            next = child.get();
+            s.remove_prefix(lcp);
+            break;
+        }
+        
+        if (next == nullptr) {
+            node->children.emplace_back(new BuildNode);
+            node->children.back()->prefix = std::string(s);
+            return node->children.back().get();
+        }
+        node = next;
+    }
+    return node;
+}
+
+void HttpRouter::addRoute(HttpRequest::Method method, std::string_view pattern, Handler handler) {
+    assert(!frozen_);
+    assert(method != HttpRequest::INVALID);
+    
+    BuildNode* node = root_.get();
+    size_t pos = 0;
+    while (pos < pattern.size()) {
+        if (pattern[pos] == ':') {
+            // 参数片段到下一个'/'为止
+            size_t end = pattern.find('/', pos);
+            if (end == std::string_view::npos) {
+                end = pattern.size();
+            }
+            std::string_view name = pattern.substr(pos + 1, end - pos - 1);
+            if (!node->param_child) {
+                node->param_child.reset(new BuildNode);
+                node->param_child->name = std::string(name);
+            } else if (node->param_child->name != name) {
+                LOG_ERROR("HttpRouter::addRoute - conflicting parameter :{} in {}", name, pattern);
+                return;
+            }
+            node = node->param_child.get();
+            pos = end;
+        } else if (pattern[pos] == '*') {
+            // 通配只能出现在结尾
+            std::string_view name = pattern.substr(pos + 1);
+            if (name.find('/') != std::string_view::npos) {
+                LOG_ERROR("HttpRouter::addRoute - wildcard must be the last segment: {}", pattern);
+                return;
+            }
+            if (!node->wildcard_child) {
+                node->wildcard_child.reset(new BuildNode);
+                node->wildcard_child->name = std::string(name);
+            }
+            node = node->wildcard_child.get();
+            pos = pattern.size();
+        } else {
+            size_t end = pattern.find_first_of(":*", pos);
+            if (end == std::string_view::npos) {
+                end = pattern.size();
+            }
+            node = insertStatic(node, pattern.substr(pos, end - pos));
+            pos = end;
+        }
+    }
+    
+    if (node->handlers[method] >= 0) {
+        LOG_WARN("HttpRouter::addRoute - {} {} registered twice, overriding",
+                 HttpRequest::methodToString(method), pattern);
+        handlers_[node->handlers[method]] = std::move(handler);
+        return;
+    }
+    node->handlers[method] = static_cast<int32_t>(handlers_.size());
+    handlers_.push_back(std::move(handler));
+    uint32_t off = addString(pattern);
+    patterns_.emplace_back(off, static_cast<uint32_t>(pattern.size()));
+}
+
+uint32_t HttpRouter::addString(std::string_view s) {
+    uint32_t off = static_cast<uint32_t>(strings_.size());
+    strings_.append(s.data(), s.size());
+    return off;
+}
+
+void HttpRouter::freeze() {
+    if (frozen_) {
+        return;
+    }
+    nodes_.clear();
+    nodes_.emplace_back();
+    flatten(root_.get(), 0);
+    root_.reset();
+    frozen_ = true;
+}
+
+// 将b写入nodes_[slot]，静态子节点预留连续的位置后再逐个递归填充
+void HttpRouter::flatten(const BuildNode* b, uint32_t slot) {
+    {
+        Node& n = nodes_[slot];
+        n.prefix_off = addString(b->prefix);
+        n.prefix_len = static_cast<uint32_t>(b->prefix.size());
+        n.name_off = addString(b->name);
+        n.name_len = static_cast<uint32_t>(b->name.size());
+        for (size_t i = 0; i <= HttpRequest::DELETE; ++i) {
+            n.handlers[i] = b->handlers[i];
+        }
+    }
+    
+    uint32_t first = static_cast<uint32_t>(nodes_.size());
+    nodes_.resize(first + b->children.size());
+    nodes_[slot].first_child = first;
+    nodes_[slot].child_count = static_cast<uint32_t>(b->children.size());
+    for (size_t i = 0; i < b->children.size(); ++i) {
+        flatten(b->children[i].get(), first + static_cast<uint32_t>(i));
+    }
+    
+    nodes_[slot].param_child = kNone;
+    if (b->param_child) {
+        uint32_t index = static_cast<uint32_t>(nodes_.size());
+        nodes_.emplace_back();
+        nodes_[slot].param_child = index;
+        flatten(b->param_child.get(), index);
+    }
+    
+    nodes_[slot].wildcard_child = kNone;
+    if (b->wildcard_child) {
+        uint32_t index = static_cast<uint32_t>(nodes_.size());
+        nodes_.emplace_back();
+        nodes_[slot].wildcard_child = index;
+        flatten(b->wildcard_child.get(), index);
+    }
+}
+
+namespace {
+
+bool hasAnyHandler(const int32_t* handlers) {
+    for (size_t i = 0; i <= HttpRequest::DELETE; ++i) {
+        if (handlers[i] >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// HEAD请求没有单独注册时使用GET的处理函数
+int32_t handlerFor(const int32_t* handlers, HttpRequest::Method method) {
+    int32_t h = handlers[method];
+    if (h < 0 && method == HttpRequest::HEAD) {
+        h = handlers[HttpRequest::GET];
+    }
+    return h;
+}
+
+} // namespace
+
+bool HttpRouter::matchNode(uint32_t index, std::string_view path, HttpRequest::Method method,
+                           int32_t* handler, bool* path_found, RouteParams* params) const {
+    const Node& node = nodes_[index];
+    
+    if (path.empty()) {
+        if (hasAnyHandler(node.handlers)) {
+            *path_found = true;
+            int32_t h = handlerFor(node.handlers, method);
+            if (h >= 0) {
+                *handler = h;
+                return true;
+            }
+        }
+    } else {
+        // 静态子节点
+        for (uint32_t i = 0; i < node.child_count; ++i) {
+            const Node& child = nodes_[node.first_child + i];
+            std::string_view prefix = str(child.prefix_off, child.prefix_len);
+            if (prefix[0] == path[0] && path.compare(0, prefix.size(), prefix) == 0) {
+                if (matchNode(node.first_child + i, path.substr(prefix.size()), method, handler, path_found, params)) {
+                    return true;
+                }
+                break;  // 首字符互不相同，不会再有其它静态子节点匹配
+            }
+        }
+        
+        // 参数子节点，匹配到下一个'/'为止，失败时回溯
+        if (node.param_child != kNone) {
+            size_t end = path.find('/');
+            if (end == std::string_view::npos) {
+                end = path.size();
+            }
+            const Node& param = nodes_[node.param_child];
+            if (end > 0 && params->push(str(param.name_off, param.name_len), path.substr(0, end))) {
+                if (matchNode(node.param_child, path.substr(end), method, handler, path_found, params)) {
+                    return true;
+                }
+                params->pop();
+            }
+        }
+    }
+    
+    // 通配子节点，匹配剩余的全部路径(可以为空)
+    if (node.wildcard_child != kNone) {
+        const Node& wildcard = nodes_[node.wildcard_child];
+        if (hasAnyHandler(wildcard.handlers)) {
+            *path_found = true;
+            int32_t h = handlerFor(wildcard.handlers, method);
+            if (h >= 0 && params->push(str(wildcard.name_off, wildcard.name_len), path)) {
+                *handler = h;
+                return true;
+            }
+        }
+    }
+    
+    return false;
+}
+
+HttpRouter::MatchResult HttpRouter::match(HttpRequest::Method method, std::string_view path,
+                                          const Handler** handler, RouteParams* params) const {
+    assert(frozen_);
+    if (method == HttpRequest::INVALID || nodes_.empty()) {
+        return kNotFound;
+    }
+    
+    // 查询字符串不参与匹配
+    size_t query = path.find('?');
+    if (query != std::string_view::npos) {
+        path = path.substr(0, query);
+    }
+    
+    int32_t h = -1;
+    bool path_found = false;
+    if (matchNode(0, path, method, &h, &path_found, params)) {
+        *handler = &handlers_[h];
+        params->route_ = str(patterns_[h].first, patterns_[h].second);
+        return kMatched;
+    }
+    return path_found ? kMethodNotAllowed : kNotFound;
+}
+
+HttpRouter::MatchResult HttpRouter::route(const HttpRequest& req, HttpResponse* resp) const {
+    const Handler* handler = nullptr;
+    RouteParams params;
+    MatchResult result = match(req.method(), req.path(), &handler, &params);
+    
+    if (result == kMatched) {
+        (*handler)(req, params, resp);
+    } else if (result == kMethodNotAllowed) {
+        resp->setStatusCode(HttpResponse::k405MethodNotAllowed);
+    } else {
+        resp->setStatusCode(HttpResponse::k404NotFound);
+    }
+    return result;
+}
+
+} // namespace core
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "core/http/http_request.h"
+
+namespace core {
+
+class HttpResponse;
+
+// 路由匹配得到的路径参数，固定容量，匹配过程不分配内存
+// 参数名指向路由表，参数值指向请求路径，仅在处理请求期间有效
+class RouteParams {
+public:
+    static const size_t kMaxParams = 8;
+    
+    RouteParams() : size_(0) {}
+    
+    // 按名字获取参数，未找到返回空
+    std::string_view get(std::string_view name) const {
+        for (size_t i = 0; i < size_; ++i) {
+            if (params_[i].first == name) {
+                return params_[i].second;
+            }
+        }
+        return std::string_view();
+    }
+    
+    size_t size() const { return size_; }
+    const std::pair<std::string_view, std::string_view>& operator[](size_t i) const { return params_[i]; }
+    
+    // 匹配到的路由模式，如"/boards/:id"
+    std::string_view route() const { return route_; }
+    
+private:
+    friend class HttpRouter;
+    
+    bool push(std::string_view name, std::string_view value) {
+        if (size_ == kMaxParams) {
+            return false;
+        }
+        params_[size_++] = {name, value};
+        return true;
+    }
+    void pop() { --size_; }
+    
+    std::pair<std::string_view, std::string_view> params_[kMaxParams];
+    size_t size_;
+    std::string_view route_;
+};
+
+// 基于压缩前缀树(radix tree)的HTTP路由
+// 路由模式支持静态片段、":name"参数(匹配到下一个'/'为止)和结尾的"*name"通配(匹配剩余路径)，
+// 匹配优先级：静态 > 参数 > 通配。注册阶段使用指针树，freeze()后压平为连续数组，查找时不分配内存
+class HttpRouter {
+public:
+    using Handler = std::function<void(const HttpRequest&, const RouteParams&, HttpResponse*)>;
+    
+    enum MatchResult {
+        kMatched,           // 匹配成功
+        kNotFound,          // 路径不存在
+        kMethodNotAllowed,  // 路径存在但方法不匹配
+    };
+    
+    HttpRouter();
+    ~HttpRouter();
+    
+    HttpRouter(const HttpRouter&) = delete;
+    HttpRouter& operator=(const HttpRouter&) = delete;
+    
+    // 注册路由，须在freeze()之前调用
+    void addRoute(HttpRequest::Method method, std::string_view pattern, Handler handler);
+    void get(std::string_view pattern, Handler handler) { addRoute(HttpRequest::GET, pattern, std::move(handler)); }
+    void post(std::string_view pattern, Handler handler) { addRoute(HttpRequest::POST, pattern, std::move(handler)); }
+    void put(std::string_view pattern, Handler handler) { addRoute(HttpRequest::PUT, pattern, std::move(handler)); }
+    void del(std::string_view pattern, Handler handler) { addRoute(HttpRequest::DELETE, pattern, std::move(handler)); }
+    
+    // 构建紧凑数组布局，此后路由表只读，可被多个IO线程并发查找
+    void freeze();
+    bool frozen() const { return frozen_; }
+    bool empty() const { return handlers_.empty(); }
+    
+    // 查找路由，成功时返回处理函数并填充params
+    MatchResult match(HttpRequest::Method method, std::string_view path,
+                      const Handler** handler, RouteParams* params) const;
+    
+    // 查找并调用处理函数；未找到时填充404/405响应
+    MatchResult route(const HttpRequest& req, HttpResponse* resp) const;
+    
+    // 处理函数按注册顺序编号，match返回的handler的编号为indexOf(handler)，用于按路由统计
+    size_t size() const { return handlers_.size(); }
+    size_t indexOf(const Handler* handler) const { return static_cast<size_t>(handler - handlers_.data()); }
+    std::string_view pattern(size_t index) const { return str(patterns_[index].first, patterns_[index].second); }
+    
+private:
+    struct BuildNode;
+    
+    // 压平后的节点，字符串均以(偏移, 长度)指向strings_
+    struct Node {
+        uint32_t prefix_off;
+        uint32_t prefix_len;
+        uint32_t first_child;     // 静态子节点在nodes_中连续存放
+        uint32_t child_count;
+        uint32_t param_child;     // kNone表示没有
+        uint32_t wildcard_child;  // kNone表示没有
+        uint32_t name_off;        // 参数/通配节点的参数名
+        uint32_t name_len;
+        int32_t handlers[HttpRequest::DELETE + 1];  // 按Method索引handlers_，-1表示没有
+    };
+    
+    static const uint32_t kNone = 0xffffffffu;
+    
+    // 在node的静态子树中插入s，必要时分裂已有节点，返回s结尾所在的节点
+    static BuildNode* insertStatic(BuildNode* node, std::string_view s);
+    void flatten(const BuildNode* node, uint32_t slot);
+    uint32_t addString(std::string_view str);
+    std::string_view str(uint32_t off, uint32_t len) const { return std::string_view(strings_.data() + off, len); }
+    
+    // 在node上继续匹配path，返回true表示找到
+    bool matchNode(uint32_t index, std::string_view path, HttpRequest::Method method,
+                   int32_t* handler, bool* path_found, RouteParams* params) const;
+    
+    std::unique_ptr<BuildNode> root_;  // 注册阶段的树，freeze()后释放
+    std::vector<Node> nodes_;          // 压平后的节点，nodes_[0]为根
+    std::string strings_;              // 前缀、参数名和路由模式
+    std::vector<Handler> handlers_;    // 处理函数
+    std::vector<std::pair<uint32_t, uint32_t>> patterns_;  // 每个处理函数对应的路由模式
+    bool frozen_;
+};
+
+} // namespace core
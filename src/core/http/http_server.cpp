@@ -1,9 +1,16 @@
 #include "core/http/http_server.h"
 
+#include <string.h>
+#include <algorithm>
+#include "core/http/http_chunk_writer.h"
+#include "core/http/http_date.h"
+#include "core/http/http_deferred_response.h"
 #include "core/http/http_parser.h"
 #include "core/http/http_request.h"
 #include "core/http/http_response.h"
+#include "core/http/websocket.h"
 #include "core/net/tcp_connection.h"
+#include "core/reactor/event_loop.h"
 #include "core/utils/logger.h"
 
 namespace core {
@@ -11,95 +18,1109 @@ namespace core {
 // 存储在TcpConnection中的上下文
 class HttpContext {
 public:
+    // 连接当前所处的超时阶段
+    enum TimeoutPhase {
+        kNoTimeout,   // 正在生成/发送响应，不计时
+        kIdle,        // 等待下一个请求
+        kHeaders,     // 接收请求行和头部
+        kBody,        // 接收请求体
+        kClosing,     // 已决定关闭，等待输出写完后强制关闭
+    };
+    
     HttpParser parser;
     
+    // 正在发送的chunked响应，发送完之前不处理后续的pipelined请求
+    HttpResponse::ChunkProducer producer;
+    bool close_after_stream = false;  // 流式响应结束后是否关闭连接
+    bool stream_close_delimited = false;  // 流式响应不分chunk，以关闭连接结束(HTTP/1.0)
+    bool close_requested = false;     // 当前请求要求响应后关闭连接(Connection: close或HTTP/1.0)
+    bool http10_request = false;      // 当前请求是HTTP/1.0，流式响应不能用chunked编码
+    bool waiting_drain = false;       // 是否在等待输出缓冲区排空
+    // 正在其他线程中生成的响应(延迟响应或压缩线程)，完成前不处理后续的pipelined请求
+    bool pending_response = false;
+    std::shared_ptr<HttpDeferredState> deferred;  // 等待完成的延迟响应
+    
+    // 切换到HTTP/2后由会话处理全部输入，上面的HTTP/1.1状态不再使用
+    std::unique_ptr<Http2Session> h2;
+    // 升级为WebSocket后由它按帧处理全部输入
+    std::shared_ptr<WebSocketConnection> ws;
+    
+    // 所属IO线程的微缓存分片，为空表示没有开启
+    HttpMicroCache::Shard* cache_shard = nullptr;
+    
+    // 超时
+    HttpTimeoutWheel* wheel = nullptr;  // 所属IO线程的时间轮，为空表示不检查超时
+    TimeoutPhase phase = kNoTimeout;
+    uint64_t deadline = 0;              // 到期的时间轮刻度，0表示不限制
+    uint64_t wheel_tick = 0;            // 在时间轮中登记的刻度，0表示没有登记
+    
     // 重置解析器
     void reset() {
         parser.reset();
+        producer = nullptr;
+        close_after_stream = false;
+        stream_close_delimited = false;
+        close_requested = false;
+        http10_request = false;
+        waiting_drain = false;
+        pending_response = false;
+        if (deferred) {
+            // 连接断开，取消尚未完成的延迟响应
+            deferred->cancel();
+            deferred.reset();
+        }
+        // 会话析构时取消各流尚未完成的延迟响应
+        h2.reset();
+        if (ws) {
+            ws->onDisconnected();
+            ws.reset();
+        }
+        phase = kNoTimeout;
+        deadline = 0;
     }
 };
 
+// 每个IO线程一个的时间轮，每秒推进一格。连接只记录到期刻度，顺延超时只改字段，
+// 不移动时间轮中的条目；条目所在的格子到期时，再按最新的刻度决定超时还是重新登记
+class HttpTimeoutWheel {
+public:
+    using ExpireCallback = std::function<void(const TcpConnection::TcpConnectionPtr&, HttpContext*)>;
+    
+    static const size_t kSlots = 64;
+    
+    explicit HttpTimeoutWheel(ExpireCallback cb)
+        : buckets_(kSlots),
+          now_(1),
+          expire_callback_(std::move(cb)) {
+    }
+    
+    uint64_t now() const { return now_; }
+    
+    // 按context->deadline登记；已登记在更早的格子里时什么也不做，到期时再顺延
+    void schedule(const TcpConnection::TcpConnectionPtr& conn, HttpContext* context) {
+        if (context->wheel_tick != 0 && context->wheel_tick <= context->deadline) {
+            return;
+        }
+        context->wheel_tick = context->deadline;
+        buckets_[context->deadline % kSlots].push_back(conn);
+    }
+    
+    // 推进一格，处理这一格中的连接
+    void tick() {
+        ++now_;
+        std::vector<std::weak_ptr<TcpConnection>> entries;
+        entries.swap(buckets_[now_ % kSlots]);
+        std::vector<std::weak_ptr<TcpConnection>> next_round;
+        
+        for (const auto& weak_conn : entries) {
+            auto conn = weak_conn.lock();
+            if (!conn || conn->disconnected() || conn->getContext().empty()) {
+                continue;
+            }
+            auto context = boost::any_cast<std::shared_ptr<HttpContext>>(conn->getContext());
+            if (context->wheel_tick != now_) {
+                // 刻度在下一圈的条目留在本格，已被更早的登记取代的条目直接丢弃
+                if (context->wheel_tick > now_ && context->wheel_tick % kSlots == now_ % kSlots) {
+                    next_round.push_back(weak_conn);
+                }
+                continue;
+            }
+            
+            context->wheel_tick = 0;
+            if (context->deadline == 0) {
+                continue;
+            }
+            if (context->deadline <= now_) {
+                expire_callback_(conn, context.get());
+            } else {
+                schedule(conn, context.get());
+            }
+        }
+        
+        auto& bucket = buckets_[now_ % kSlots];
+        bucket.insert(bucket.end(), next_round.begin(), next_round.end());
+    }
+    
+private:
+    std::vector<std::vector<std::weak_ptr<TcpConnection>>> buckets_;
+    uint64_t now_;                     // 当前刻度
+    ExpireCallback expire_callback_;
+};
+
+namespace {
+
+const int kCloseLingerSeconds = 2;  // 决定关闭后，输出写完还要等对端关闭的时间
+
+// 本IO线程的时间轮，在线程初始化回调中设置；接受连接时取时间轮不需要加锁查表
+struct LocalTimeoutWheel {
+    const HttpServer* server;
+    HttpTimeoutWheel* wheel;
+};
+thread_local LocalTimeoutWheel t_timeout_wheel = {nullptr, nullptr};
+
+// 逗号分隔的头部值中是否有token，不区分大小写
+bool headerHasToken(std::string_view value, std::string_view expected) {
+    while (!value.empty()) {
+        size_t comma = value.find(',');
+        std::string_view token = value.substr(0, comma);
+        value = comma == std::string_view::npos ? std::string_view() : value.substr(comma + 1);
+        while (!token.empty() && token.front() == ' ') {
+            token.remove_prefix(1);
+        }
+        while (!token.empty() && token.back() == ' ') {
+            token.remove_suffix(1);
+        }
+        if (token.size() == expected.size() && strncasecmp(token.data(), expected.data(), expected.size()) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Upgrade头部中是否有h2c，并且带有HTTP2-Settings
+bool h2cUpgradeRequested(const HttpRequest& req) {
+    return req.getHeader("HTTP2-Settings").data() != nullptr && headerHasToken(req.getHeader("Upgrade"), "h2c");
+}
+
+// 请求是否要求响应后关闭连接：HTTP/1.1带Connection: close，HTTP/1.0没有Connection: keep-alive
+bool requestWantsClose(const HttpRequest& req) {
+    std::string_view connection = req.getHeader("Connection");
+    if (req.version() == HttpRequest::HTTP10) {
+        return !headerHasToken(connection, "keep-alive");
+    }
+    return headerHasToken(connection, "close");
+}
+
+// 缓存条目转成响应对象(HTTP/2或需要走常规发送流程时)，主体引用条目中的字节
+HttpResponse cachedResponse(const HttpMicroCache::EntryPtr& entry) {
+    HttpResponse response(entry->response);
+    response.setBodyView(entry->body(), entry);
+    return response;
+}
+
+} // namespace
+
 HttpServer::HttpServer(EventLoop* loop, const InetAddress& listenAddr,
                      const std::string& name, TcpServer::Option option)
     : server_(loop, listenAddr, name, option),
-      http_callback_([this](const HttpRequest& req, HttpResponse* resp) {
-          onRequest(req, resp);
-      }) {
+      max_body_size_(HttpParser::kDefaultMaxBodySize),
+      http2_enabled_(false),
+      idle_timeouts_(0),
+      header_timeouts_(0),
+      body_timeouts_(0) {
     
     // 设置回调函数
     server_.setConnectionChangeCallback(
         std::bind(&HttpServer::onConnection, this, std::placeholders::_1));
     server_.setMessageCallback(
         std::bind(&HttpServer::onMessage, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+    server_.setWriteCompleteCallback(
+        std::bind(&HttpServer::onWriteComplete, this, std::placeholders::_1));
 }
 
+HttpServer::~HttpServer() = default;
+
 void HttpServer::start() {
-    LOG_INFO("HttpServer[%s] starts listening on %s", server_.name(), server_.ipPort());
+    LOG_INFO("HttpServer[{}] starts listening on {}", server_.name(), server_.ipPort());
+    
+    // 每个IO线程安装刷新Date头部的定时器，再执行用户的线程初始化回调
+    // 路由表在启动前冻结，之后各IO线程只读共享
+    router_.freeze();
+    if (metrics_) {
+        installMetrics();
+    }
+    
+    server_.setThreadInitCallback([this](EventLoop* loop) {
+        HttpDateCache::installTimer(loop);
+        t_timeout_wheel = {this, nullptr};
+        if (timeouts_.idle > 0 || timeouts_.header > 0 || timeouts_.body > 0) {
+            installTimeoutWheel(loop);
+        }
+        if (thread_init_callback_) {
+            thread_init_callback_(loop);
+        }
+    });
     server_.start();
 }
 
 void HttpServer::onConnection(const TcpConnection::TcpConnectionPtr& conn) {
     if (conn->connected()) {
         // 创建上下文
-        conn->setContext(std::make_shared<HttpContext>());
+        auto context = std::make_shared<HttpContext>();
+        context->parser.setMaxBodySize(max_body_size_);
+        if (body_callback_) {
+            // 请求体分段交给用户，不在内存中累积
+            HttpContext* ctx = context.get();
+            context->parser.setBodyCallback([this, ctx](std::string_view data) {
+                body_callback_(ctx->parser.request(), data);
+            });
+        }
+        context->wheel = localTimeoutWheel(conn->getLoop());
+        if (micro_cache_ && micro_cache_->hasRoutes()) {
+            context->cache_shard = micro_cache_->shard(conn->getLoop());
+        }
+        conn->setContext(context);
+        updateTimeout(conn, context.get());
+    } else if (!conn->getContext().empty()) {
+        // 连接断开，释放未完成的流式响应和延迟响应
+        auto context = boost::any_cast<std::shared_ptr<HttpContext>>(conn->getContext());
+        context->reset();
     }
 }
 
 void HttpServer::onMessage(const TcpConnection::TcpConnectionPtr& conn, Buffer* buf, size_t len) {
     auto context = boost::any_cast<std::shared_ptr<HttpContext>>(conn->getContext());
+    if (context->phase == HttpContext::kClosing) {
+        // 已经决定关闭，丢弃后续输入
+        buf->retrieveAll();
+        return;
+    }
+    if (context->h2) {
+        onHttp2Message(conn, context.get(), buf);
+        return;
+    }
+    if (context->ws) {
+        context->ws->onMessage(buf);
+        updateTimeout(conn, context.get());
+        return;
+    }
     
-    // 解析请求
-    if (!context->parser.parseRequest(buf, std::chrono::steady_clock::now())) {
-        // 解析失败
-        LOG_ERROR("HttpServer::onMessage - Bad Request");
+    // prior knowledge：请求开始处是HTTP/2连接前言(HTTP/1.1不存在PRI方法)
+    if (http2_enabled_ && !context->parser.expectingBody()) {
+        std::string_view preface = Http2Session::kPreface;
+        size_t n = std::min(buf->readableBytes(), preface.size());
+        if (memcmp(buf->peek(), preface.data(), n) == 0) {
+            if (n == preface.size()) {
+                startHttp2(conn, context.get());
+                context->h2->start();
+                onHttp2Message(conn, context.get(), buf);
+            } else {
+                // 前言还没收全
+                updateTimeout(conn, context.get());
+            }
+            return;
+        }
+    }
+    processRequests(conn, context.get(), buf);
+}
+
+void HttpServer::processRequests(const TcpConnection::TcpConnectionPtr& conn, HttpContext* context, Buffer* buf) {
+    // 客户端可能把多个请求(pipelining)放在一次发送中，依次处理缓冲区中所有完整的请求，
+    // 响应按顺序写入同一个Buffer，最后一次性发送
+    Buffer output;
+    bool close = false;
+    
+    // 流式响应发送期间，后续请求留在缓冲区中，等它结束后再处理
+    while (!close && !context->producer && !context->pending_response && buf->readableBytes() > 0) {
+        // 解析请求
+        if (!context->parser.parseRequest(buf, std::chrono::steady_clock::now())) {
+            // 解析失败，按原因返回400/413/431
+            HttpResponse::StatusCode status = context->parser.errorStatus();
+            LOG_ERROR("HttpServer::onMessage - bad request, responding {}", static_cast<int>(status));
+            
+            HttpResponse response;
+            response.setStatusCode(status);
+            response.setCloseConnection(true);
+            response.appendToBuffer(&output);
+            
+            buf->retrieveAll();
+            close = true;
+            break;
+        }
+        
+        if (!context->parser.gotAll()) {
+            // 剩余数据不足一个完整请求，等待更多数据
+            break;
+        }
+        context->close_requested = requestWantsClose(context->parser.request());
+        context->http10_request = context->parser.request().version() == HttpRequest::HTTP10;
+        
+        if (http2_enabled_ && h2cUpgradeRequested(context->parser.request())) {
+            // 之前的响应先发出，101之后连接切换到HTTP/2，这个请求作为流1处理
+            if (output.readableBytes() > 0) {
+                conn->send(&output);
+            }
+            const HttpRequest& request = context->parser.request();
+            startHttp2(conn, context);
+            if (context->h2->upgrade(request.getHeader("HTTP2-Settings"), request)) {
+                context->parser.finishRequest(buf);
+                // 剩余的输入是客户端的连接前言和帧
+                onHttp2Message(conn, context, buf);
+                return;
+            }
+            // HTTP2-Settings无效，忽略升级按HTTP/1.1处理
+            context->h2.reset();
+        }
         
-        // 返回400
+        // 处理请求
         HttpResponse response;
-        response.setStatusCode(HttpResponse::k400BadRequest);
-        response.setStatusMessage("Bad Request");
-        response.setCloseConnection(true);
+        CacheStep step = kCacheBypass;
+        if (context->cache_shard) {
+            // 微缓存：命中时直接发送序列化好的字节，同一个键的响应正在生成时等待它
+            const HttpRequest& request = context->parser.request();
+            bool head = request.method() == HttpRequest::HEAD;
+            std::weak_ptr<TcpConnection> weak_conn(conn);
+            HttpMicroCache::EntryPtr entry;
+            step = lookupMicroCache(conn->getLoop(), context->cache_shard, request, &response, &entry,
+                [this, weak_conn, head](const HttpMicroCache::EntryPtr& e, HttpResponse* r, const HttpRequest* req) {
+                    auto c = weak_conn.lock();
+                    if (!c || !c->connected()) {
+                        return;
+                    }
+                    auto ctx = boost::any_cast<std::shared_ptr<HttpContext>>(c->getContext());
+                    if (e) {
+                        sendCachedResponse(c, ctx.get(), e, head);
+                    } else if (r) {
+                        r->setOmitBody(head);
+                        sendPendingResponse(c, ctx.get(), r);
+                    } else {
+                        redispatch(c, ctx.get(), *req);
+                    }
+                });
+            if (step == kCacheHit && context->close_requested) {
+                // 缓存的字节带Connection: Keep-Alive，要求关闭的请求重新序列化一次
+                HttpResponse cached = cachedResponse(entry);
+                cached.setOmitBody(head);
+                cached.setCloseConnection(true);
+                cached.appendToBuffer(&output);
+                context->parser.finishRequest(buf);
+                close = true;
+                break;
+            }
+            if (step == kCacheHit) {
+                context->parser.finishRequest(buf);
+                context->phase = HttpContext::kNoTimeout;
+                size_t len = head ? entry->header_length : entry->bytes.size();
+                if (output.readableBytes() == 0) {
+                    // 没有积累的响应时直接写连接，不经过output拷贝
+                    conn->send(entry->bytes.data(), len);
+                } else {
+                    output.append(entry->bytes.data(), len);
+                }
+                continue;
+            }
+            if (step == kCacheWait) {
+                context->parser.finishRequest(buf);
+                if (output.readableBytes() > 0) {
+                    conn->send(&output);
+                }
+                context->pending_response = true;
+                updateTimeout(conn, context);
+                return;
+            }
+        }
+        if (step != kCacheRespond) {
+            onRequest(context->parser.request(), &response);
+        }
+        if (response.webSocket()) {
+            if (acceptWebSocket(conn, context, buf, &response, &output)) {
+                return;
+            }
+            // 握手不合法，response已改为400/426
+        } else if (response.deferred()) {
+            // 先发出之前的响应，延迟响应完成后再发送它并继续处理
+            bool head = context->parser.request().method() == HttpRequest::HEAD;
+            context->parser.finishRequest(buf);
+            if (output.readableBytes() > 0) {
+                conn->send(&output);
+            }
+            waitDeferred(conn, context, response.deferredState(), head);
+            updateTimeout(conn, context);
+            return;
+        }
+        if (compressor_) {
+            HttpCompressor::Plan plan;
+            if (compressor_->apply(context->parser.request(), &response, &plan) == HttpCompressor::kOffload) {
+                // 先发出之前的响应，压缩完成后再发送这个响应并继续处理
+                context->parser.finishRequest(buf);
+                if (output.readableBytes() > 0) {
+                    conn->send(&output);
+                }
+                offloadCompression(conn, context, &response, plan);
+                updateTimeout(conn, context);
+                return;
+            }
+        }
+        if (context->close_requested) {
+            response.setCloseConnection(true);
+        }
+        if (context->http10_request && response.chunked()) {
+            response.setCloseDelimited();
+        }
+        if (context->parser.request().method() == HttpRequest::HEAD) {
+            response.setOmitBody(true);
+        }
+        response.appendToBuffer(&output);
+        
+        if (response.hasFileBody() && !response.omitBody()) {
+            // 先发出累积的响应，再零拷贝发送文件内容，保持pipelined响应的顺序
+            const HttpResponse::FileBody& file = response.fileBody();
+            conn->send(&output);
+            conn->sendFile(file.fd, file.offset, file.length, file.holder);
+        }
         
-        Buffer buf;
-        response.appendToBuffer(&buf);
-        conn->send(&buf);
+        if (response.chunked()) {
+            // 响应头随output发出，主体交给pumpStream
+            context->producer = response.chunkProducer();
+            context->close_after_stream = response.closeConnection();
+            context->stream_close_delimited = response.closeDelimited();
+        } else {
+            // 如果是HTTP/1.0或者需要关闭连接，则不再处理后续请求
+            close = response.closeConnection();
+        }
+        
+        // 请求中的视图指向buf，处理完毕后才释放这部分数据，并重置解析器准备解析下一个请求
+        context->parser.finishRequest(buf);
+        // 下一个请求重新开始计时
+        context->phase = HttpContext::kNoTimeout;
+    }
+    
+    if (output.readableBytes() > 0) {
+        conn->send(&output);
+    }
+    if (close) {
         conn->shutdown();
+        beginClosing(conn, context);
+    } else {
+        updateTimeout(conn, context);
+        if (context->producer) {
+            pumpStream(conn, context);
+        }
+    }
+}
+
+// 握手合法时回复101，连接切换为WebSocket，剩余的输入按帧处理
+bool HttpServer::acceptWebSocket(const TcpConnection::TcpConnectionPtr& conn, HttpContext* context, Buffer* buf,
+                                 HttpResponse* response, Buffer* output) {
+    std::shared_ptr<const WebSocketCallbacks> callbacks = response->webSocket();
+    *response = HttpResponse();
+    if (!WebSocketConnection::handshake(context->parser.request(), response)) {
+        return false;
+    }
+    response->appendToBuffer(output);
+    conn->send(output);
+    context->parser.finishRequest(buf);
+    context->ws = std::make_shared<WebSocketConnection>(conn, std::move(callbacks));
+    context->ws->start();
+    if (buf->readableBytes() > 0 && context->ws) {
+        context->ws->onMessage(buf);
+    }
+    updateTimeout(conn, context);
+    return true;
+}
+
+HttpServer::CacheStep HttpServer::lookupMicroCache(EventLoop* loop, HttpMicroCache::Shard* shard,
+                                                   const HttpRequest& req, HttpResponse* response,
+                                                   HttpMicroCache::EntryPtr* entry, CacheDelivery deliver) {
+    bool head = req.method() == HttpRequest::HEAD;
+    if (req.method() != HttpRequest::GET && !head) {
+        return kCacheBypass;
+    }
+    const HttpRouter::Handler* handler = nullptr;
+    RouteParams params;
+    if (router_.match(HttpRequest::GET, req.path(), &handler, &params) != HttpRouter::kMatched) {
+        return kCacheBypass;
+    }
+    std::chrono::milliseconds ttl = micro_cache_->ttl(params.route());
+    if (ttl.count() <= 0) {
+        return kCacheBypass;
     }
     
-    if (context->parser.gotAll()) {
-        // 处理请求
-        HttpResponse response;
-        onRequest(context->parser.request(), &response);
-        
-        // 发送响应
-        Buffer buf;
-        response.appendToBuffer(&buf);
-        conn->send(&buf);
+    // 压缩后的响应按协商出的编码分开缓存
+    HttpCompressor::Encoding encoding = HttpCompressor::kIdentity;
+    if (compressor_) {
+        encoding = HttpCompressor::negotiate(req.getHeader("Accept-Encoding"));
+    }
+    std::string key;
+    micro_cache_->makeKey(req, HttpCompressor::encodingName(encoding), &key);
+    if ((*entry = shard->find(key))) {
+        return kCacheHit;
+    }
+    if (head) {
+        // HEAD未命中时按常规流程处理，不生成缓存
+        return kCacheBypass;
+    }
+    if (shard->filling(key)) {
+        // 响应不能共享时要为这个请求重新调用处理函数，请求中的视图指向输入缓冲区，先拷贝一份
+        auto copy = std::make_shared<HttpRequest>(req);
+        copy->detach();
+        shard->wait(key, [deliver, copy](const HttpMicroCache::EntryPtr& e) {
+            deliver(e, nullptr, e ? nullptr : copy.get());
+        });
+        return kCacheWait;
+    }
+    
+    // 由本请求生成
+    shard->begin(key);
+    onRequest(req, response);
+    if (response->deferred()) {
+        std::string path(req.path());
+        response->deferredState()->attach(loop, [this, loop, shard, key, path, ttl, encoding, deliver](HttpResponse* r) {
+            finishMicroCacheFill(loop, shard, key, path, ttl, encoding, r, deliver);
+        });
+        return kCacheWait;
+    }
+    if (compressor_) {
+        HttpCompressor::Plan plan;
+        if (compressor_->apply(req, response, &plan) == HttpCompressor::kOffload) {
+            auto pending = std::make_shared<HttpResponse>(std::move(*response));
+            compressor_->compressAsync(loop, pending, std::move(plan), [shard, key, ttl, pending, deliver]() {
+                HttpMicroCache::EntryPtr e = shard->complete(key, *pending, ttl);
+                deliver(e, e ? nullptr : pending.get(), nullptr);
+            });
+            return kCacheWait;
+        }
+    }
+    *entry = shard->complete(key, *response, ttl);
+    return *entry ? kCacheHit : kCacheRespond;
+}
+
+void HttpServer::finishMicroCacheFill(EventLoop* loop, HttpMicroCache::Shard* shard, const std::string& key,
+                                      const std::string& path, std::chrono::milliseconds ttl,
+                                      HttpCompressor::Encoding encoding, HttpResponse* response,
+                                      const CacheDelivery& deliver) {
+    if (compressor_ && encoding != HttpCompressor::kIdentity) {
+        // 原始请求已经不在了，按路径和协商出的编码构造一个只含Accept-Encoding的请求
+        HttpRequest req;
+        req.setMethod(HttpRequest::GET);
+        req.setPath(path);
+        req.addHeader("Accept-Encoding", HttpCompressor::encodingName(encoding));
+        HttpCompressor::Plan plan;
+        if (compressor_->apply(req, response, &plan) == HttpCompressor::kOffload) {
+            auto pending = std::make_shared<HttpResponse>(std::move(*response));
+            compressor_->compressAsync(loop, pending, std::move(plan), [shard, key, ttl, pending, deliver]() {
+                HttpMicroCache::EntryPtr e = shard->complete(key, *pending, ttl);
+                deliver(e, e ? nullptr : pending.get(), nullptr);
+            });
+            return;
+        }
+    }
+    HttpMicroCache::EntryPtr e = shard->complete(key, *response, ttl);
+    deliver(e, e ? nullptr : response, nullptr);
+}
+
+void HttpServer::sendCachedResponse(const TcpConnection::TcpConnectionPtr& conn, HttpContext* context,
+                                    const HttpMicroCache::EntryPtr& entry, bool head) {
+    if (context->close_requested) {
+        // 要求关闭的请求需要Connection: close，不能直接发送缓存的字节
+        HttpResponse cached = cachedResponse(entry);
+        cached.setOmitBody(head);
+        sendPendingResponse(conn, context, &cached);
+        return;
+    }
+    context->pending_response = false;
+    conn->send(entry->bytes.data(), head ? entry->header_length : entry->bytes.size());
+    processRequests(conn, context, conn->inputBuffer());
+}
+
+void HttpServer::redispatch(const TcpConnection::TcpConnectionPtr& conn, HttpContext* context, const HttpRequest& req) {
+    bool head = req.method() == HttpRequest::HEAD;
+    HttpResponse response;
+    onRequest(req, &response);
+    if (response.webSocket()) {
+        // 请求已经离开输入缓冲区，不能再升级
+        response = HttpResponse();
+        response.setStatusCode(HttpResponse::k400BadRequest);
+    } else if (response.deferred()) {
+        waitDeferred(conn, context, response.deferredState(), head);
+        return;
+    }
+    if (compressor_) {
+        HttpCompressor::Plan plan;
+        if (compressor_->apply(req, &response, &plan) == HttpCompressor::kOffload) {
+            offloadCompression(conn, context, &response, plan);
+            return;
+        }
+    }
+    if (head) {
+        response.setOmitBody(true);
+    }
+    sendPendingResponse(conn, context, &response);
+}
+
+void HttpServer::offloadCompression(const TcpConnection::TcpConnectionPtr& conn, HttpContext* context,
+                                    HttpResponse* response, const HttpCompressor::Plan& plan) {
+    context->pending_response = true;
+    auto pending = std::make_shared<HttpResponse>(std::move(*response));
+    std::weak_ptr<TcpConnection> weak_conn(conn);
+    compressor_->compressAsync(conn->getLoop(), pending, plan, [this, weak_conn, pending]() {
+        auto c = weak_conn.lock();
+        if (!c || !c->connected()) {
+            return;
+        }
+        auto ctx = boost::any_cast<std::shared_ptr<HttpContext>>(c->getContext());
+        // 压缩失败时仍是原来的主体
+        sendPendingResponse(c, ctx.get(), pending.get());
+    });
+}
+
+void HttpServer::waitDeferred(const TcpConnection::TcpConnectionPtr& conn, HttpContext* context,
+                              const std::shared_ptr<HttpDeferredState>& state, bool head) {
+    context->pending_response = true;
+    context->deferred = state;
+    
+    // completion保存在state中，只持有连接的弱引用，避免循环引用
+    std::weak_ptr<TcpConnection> weak_conn(conn);
+    HttpDeferredState* raw = state.get();
+    state->attach(conn->getLoop(), [this, weak_conn, raw, head](HttpResponse* response) {
+        auto c = weak_conn.lock();
+        if (!c || !c->connected()) {
+            return;
+        }
+        auto ctx = boost::any_cast<std::shared_ptr<HttpContext>>(c->getContext());
+        if (ctx->deferred.get() != raw) {
+            return;
+        }
+        ctx->deferred.reset();
+        if (head) {
+            response->setOmitBody(true);
+        }
+        sendPendingResponse(c, ctx.get(), response);
+    });
+}
+
+// 发送在其他线程中完成的响应，然后继续处理等待期间积压的请求
+void HttpServer::sendPendingResponse(const TcpConnection::TcpConnectionPtr& conn, HttpContext* context,
+                                     HttpResponse* response) {
+    context->pending_response = false;
+    if (context->close_requested) {
+        response->setCloseConnection(true);
+    }
+    if (context->http10_request && response->chunked()) {
+        response->setCloseDelimited();
+    }
+    
+    Buffer output;
+    response->appendToBuffer(&output);
+    conn->send(&output);
+    if (response->hasFileBody() && !response->omitBody()) {
+        const HttpResponse::FileBody& file = response->fileBody();
+        conn->sendFile(file.fd, file.offset, file.length, file.holder);
+    }
+    
+    if (response->chunked()) {
+        context->producer = response->chunkProducer();
+        context->close_after_stream = response->closeConnection();
+        context->stream_close_delimited = response->closeDelimited();
+        updateTimeout(conn, context);
+        pumpStream(conn, context);
+    } else if (response->closeConnection()) {
+        conn->shutdown();
+        beginClosing(conn, context);
+    } else {
+        processRequests(conn, context, conn->inputBuffer());
+    }
+}
+
+// 调用一次生产者；输出全部直接写入socket时立即安排下一次，否则等输出缓冲区排空(onWriteComplete)再继续
+void HttpServer::pumpStream(const TcpConnection::TcpConnectionPtr& conn, HttpContext* context) {
+    if (!context->producer || !conn->connected()) {
+        return;
+    }
+    
+    HttpChunkWriter writer(conn, context->stream_close_delimited);
+    if (context->producer(&writer)) {
+        writer.end();
+        bool close = context->close_after_stream;
+        context->producer = nullptr;
+        context->close_after_stream = false;
+        context->stream_close_delimited = false;
+        context->waiting_drain = false;
         
-        // 如果是HTTP/1.0或者需要关闭连接，则关闭连接
-        if (response.closeConnection()) {
+        if (close) {
             conn->shutdown();
+            beginClosing(conn, context);
+        } else {
+            // 继续处理流式响应期间积压的请求
+            processRequests(conn, context, conn->inputBuffer());
         }
-        
-        // 重置解析器，准备解析下一个请求
-        context->reset();
+    } else if (conn->outputBytes() > 0) {
+        context->waiting_drain = true;
+    } else {
+        // 通过queueInLoop让出本轮循环，避免长时间占用IO线程
+        std::weak_ptr<TcpConnection> weak_conn(conn);
+        conn->getLoop()->queueInLoop([this, weak_conn]() {
+            if (auto c = weak_conn.lock()) {
+                if (c->connected()) {
+                    auto ctx = boost::any_cast<std::shared_ptr<HttpContext>>(c->getContext());
+                    pumpStream(c, ctx.get());
+                }
+            }
+        });
+    }
+}
+
+void HttpServer::onWriteComplete(const TcpConnection::TcpConnectionPtr& conn) {
+    if (conn->getContext().empty()) {
+        return;
+    }
+    auto context = boost::any_cast<std::shared_ptr<HttpContext>>(conn->getContext());
+    if (context->h2) {
+        context->h2->onWriteComplete();
+        updateTimeout(conn, context.get());
+        return;
+    }
+    if (context->ws) {
+        return;
+    }
+    // 直接写完的send也会触发写完成回调，只有真正排空了积压的输出才继续生产
+    if (context->waiting_drain && conn->outputBytes() == 0) {
+        context->waiting_drain = false;
+        pumpStream(conn, context.get());
+    }
+}
+
+void HttpServer::startHttp2(const TcpConnection::TcpConnectionPtr& conn, HttpContext* context) {
+    std::weak_ptr<TcpConnection> weak_conn(conn);
+    context->h2.reset(new Http2Session(conn.get(), http2_options_,
+        [this, weak_conn](uint32_t stream_id, const HttpRequest& req) {
+            if (auto c = weak_conn.lock()) {
+                onHttp2Request(c, stream_id, req);
+            }
+        }));
+}
+
+void HttpServer::onHttp2Message(const TcpConnection::TcpConnectionPtr& conn, HttpContext* context, Buffer* buf) {
+    context->h2->onMessage(buf);
+    updateTimeout(conn, context);
+}
+
+// 与processRequests中的单个请求相同：路由、延迟响应、压缩，区别是响应提交到流上，各流互不等待
+void HttpServer::onHttp2Request(const TcpConnection::TcpConnectionPtr& conn, uint32_t stream_id,
+                                const HttpRequest& req, bool use_cache) {
+    auto context = boost::any_cast<std::shared_ptr<HttpContext>>(conn->getContext());
+    Http2Session* session = context->h2.get();
+    std::weak_ptr<TcpConnection> weak_conn(conn);
+    bool head = req.method() == HttpRequest::HEAD;
+    
+    HttpResponse response;
+    CacheStep step = kCacheBypass;
+    if (use_cache && context->cache_shard) {
+        HttpMicroCache::EntryPtr entry;
+        step = lookupMicroCache(conn->getLoop(), context->cache_shard, req, &response, &entry,
+            [this, weak_conn, session, stream_id, head](const HttpMicroCache::EntryPtr& e, HttpResponse* r,
+                                                        const HttpRequest* request) {
+                auto c = weak_conn.lock();
+                if (!c || !c->connected()) {
+                    return;
+                }
+                if (request) {
+                    auto ctx = boost::any_cast<std::shared_ptr<HttpContext>>(c->getContext());
+                    if (ctx->h2.get() == session) {
+                        onHttp2Request(c, stream_id, *request, false);
+                    }
+                    return;
+                }
+                HttpResponse cached;
+                if (e) {
+                    cached = cachedResponse(e);
+                    r = &cached;
+                }
+                r->setOmitBody(head);
+                submitHttp2Response(c, session, stream_id, r);
+            });
+        if (step == kCacheHit) {
+            HttpResponse cached = cachedResponse(entry);
+            cached.setOmitBody(head);
+            session->submitResponse(stream_id, &cached);
+            return;
+        }
+        if (step == kCacheWait) {
+            return;
+        }
+    }
+    if (step != kCacheRespond) {
+        onRequest(req, &response);
+    }
+    if (response.webSocket()) {
+        // 不支持在HTTP/2流上承载WebSocket(RFC 8441)
+        response = HttpResponse();
+        response.setStatusCode(HttpResponse::k400BadRequest);
+    } else if (response.deferred()) {
+        const std::shared_ptr<HttpDeferredState>& state = response.deferredState();
+        session->setDeferred(stream_id, state);
+        state->attach(conn->getLoop(), [this, weak_conn, session, stream_id, head](HttpResponse* r) {
+            if (auto c = weak_conn.lock()) {
+                if (head) {
+                    r->setOmitBody(true);
+                }
+                submitHttp2Response(c, session, stream_id, r);
+            }
+        });
+        return;
+    }
+    if (compressor_) {
+        HttpCompressor::Plan plan;
+        if (compressor_->apply(req, &response, &plan) == HttpCompressor::kOffload) {
+            auto pending = std::make_shared<HttpResponse>(std::move(response));
+            compressor_->compressAsync(conn->getLoop(), pending, std::move(plan),
+                [this, weak_conn, session, stream_id, pending]() {
+                    if (auto c = weak_conn.lock()) {
+                        submitHttp2Response(c, session, stream_id, pending.get());
+                    }
+                });
+            return;
+        }
+    }
+    if (head) {
+        response.setOmitBody(true);
+    }
+    session->submitResponse(stream_id, &response);
+}
+
+void HttpServer::submitHttp2Response(const TcpConnection::TcpConnectionPtr& conn, Http2Session* session,
+                                     uint32_t stream_id, HttpResponse* response) {
+    if (!conn->connected()) {
+        return;
+    }
+    auto context = boost::any_cast<std::shared_ptr<HttpContext>>(conn->getContext());
+    if (context->h2.get() != session) {
+        return;
+    }
+    session->submitResponse(stream_id, response);
+    updateTimeout(conn, context.get());
+}
+
+void HttpServer::installTimeoutWheel(EventLoop* loop) {
+    auto wheel = std::make_unique<HttpTimeoutWheel>(
+        std::bind(&HttpServer::onTimeout, this, std::placeholders::_1, std::placeholders::_2));
+    HttpTimeoutWheel* raw = wheel.get();
+    {
+        std::lock_guard<std::mutex> lock(wheels_mutex_);
+        wheels_[loop] = std::move(wheel);
+    }
+    t_timeout_wheel = {this, raw};
+    loop->getTimerManager()->addTimer([raw]() { raw->tick(); },
+                                      std::chrono::steady_clock::now() + std::chrono::seconds(1),
+                                      std::chrono::seconds(1));
+}
+
+HttpTimeoutWheel* HttpServer::localTimeoutWheel(EventLoop* loop) {
+    if (__builtin_expect(t_timeout_wheel.server == this, 1)) {
+        return t_timeout_wheel.wheel;
+    }
+    // 多个服务器共用一个IO线程(都没有线程池、共用base loop)时才会走到这里
+    std::lock_guard<std::mutex> lock(wheels_mutex_);
+    auto it = wheels_.find(loop);
+    return it == wheels_.end() ? nullptr : it->second.get();
+}
+
+// 每处理完一批输入后调用，根据连接所处的阶段设置到期刻度
+void HttpServer::updateTimeout(const TcpConnection::TcpConnectionPtr& conn, HttpContext* context) {
+    HttpTimeoutWheel* wheel = context->wheel;
+    if (!wheel || context->phase == HttpContext::kClosing) {
+        return;
+    }
+    
+    HttpContext::TimeoutPhase phase;
+    int timeout = 0;
+    if (context->h2) {
+        if (context->h2->closed()) {
+            // 会话已发送GOAWAY并关闭写端
+            beginClosing(conn, context);
+            return;
+        }
+        // 多路复用的连接上没有单个请求的头部/主体阶段，没有打开的流时按空闲计时
+        phase = context->h2->activeStreams() > 0 ? HttpContext::kNoTimeout : HttpContext::kIdle;
+        timeout = phase == HttpContext::kIdle ? timeouts_.idle : 0;
+    } else if (context->ws) {
+        if (context->ws->closed()) {
+            // 关闭握手完成或协议错误，已关闭写端
+            beginClosing(conn, context);
+            return;
+        }
+        // 长连接上的消息间隔由应用决定，需要时用ping探测
+        phase = HttpContext::kNoTimeout;
+    } else if (context->producer || context->pending_response) {
+        phase = HttpContext::kNoTimeout;
+    } else if (context->parser.expectingBody()) {
+        // 每次收到主体数据都顺延
+        phase = HttpContext::kBody;
+        timeout = timeouts_.body;
+    } else if (conn->inputBuffer()->readableBytes() > 0) {
+        // 从收到请求的第一个字节开始计时，头部陆续到达也不顺延，防止slowloris
+        if (context->phase == HttpContext::kHeaders) {
+            return;
+        }
+        phase = HttpContext::kHeaders;
+        timeout = timeouts_.header;
+    } else {
+        phase = HttpContext::kIdle;
+        timeout = timeouts_.idle;
+    }
+    
+    context->phase = phase;
+    // 当前刻度已经过去了一部分，多等一格，保证不会在配置的时长之前到期
+    context->deadline = timeout > 0 ? wheel->now() + timeout + 1 : 0;
+    if (context->deadline != 0) {
+        wheel->schedule(conn, context);
+    }
+}
+
+// 已调用shutdown()的连接：等输出写完后再给对端一点时间关闭，之后强制关闭回收fd
+void HttpServer::beginClosing(const TcpConnection::TcpConnectionPtr& conn, HttpContext* context) {
+    if (!context->wheel) {
+        return;
+    }
+    context->phase = HttpContext::kClosing;
+    context->deadline = context->wheel->now() + kCloseLingerSeconds;
+    context->wheel->schedule(conn, context);
+}
+
+void HttpServer::onTimeout(const TcpConnection::TcpConnectionPtr& conn, HttpContext* context) {
+    switch (context->phase) {
+        case HttpContext::kIdle:
+            idle_timeouts_.fetch_add(1, std::memory_order_relaxed);
+            LOG_DEBUG("HttpServer::onTimeout [{}] keep-alive idle timeout", conn->name());
+            context->deadline = 0;
+            conn->forceClose();
+            break;
+            
+        case HttpContext::kHeaders:
+        case HttpContext::kBody:
+            if (context->phase == HttpContext::kHeaders) {
+                header_timeouts_.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                body_timeouts_.fetch_add(1, std::memory_order_relaxed);
+            }
+            LOG_DEBUG("HttpServer::onTimeout [{}] request {} timeout", conn->name(),
+                      context->phase == HttpContext::kHeaders ? "header" : "body");
+            if (timeouts_.send_408) {
+                HttpResponse response;
+                response.setStatusCode(HttpResponse::k408RequestTimeout);
+                response.setCloseConnection(true);
+                Buffer output;
+                response.appendToBuffer(&output);
+                conn->send(&output);
+            }
+            conn->shutdown();
+            beginClosing(conn, context);
+            break;
+            
+        case HttpContext::kClosing:
+            if (conn->outputBytes() > 0) {
+                // 响应还没写完，继续等待
+                beginClosing(conn, context);
+            } else {
+                context->deadline = 0;
+                conn->forceClose();
+            }
+            break;
+            
+        default:
+            break;
     }
 }
 
 void HttpServer::onRequest(const HttpRequest& req, HttpResponse* resp) {
-    LOG_INFO("HttpServer::onRequest - %s %s", 
-            req.method() == HttpRequest::GET ? "GET" : 
-            req.method() == HttpRequest::POST ? "POST" : "OTHER",
-            req.path());
+    LOG_INFO("HttpServer::onRequest - {} {}", HttpRequest::methodToString(req.method()), req.path());
+    
+    std::chrono::steady_clock::time_point start;
+    if (metrics_) {
+        start = std::chrono::steady_clock::now();
+    }
+    
+    // 优先匹配路由表，未匹配的请求交给用户设置的回调函数
+    HttpRouter::MatchResult result = HttpRouter::kNotFound;
+    if (!router_.empty()) {
+        const HttpRouter::Handler* handler = nullptr;
+        RouteParams params;
+        result = router_.match(req.method(), req.path(), &handler, &params);
+        if (result == HttpRouter::kMatched) {
+            (*handler)(req, params, resp);
+            if (metrics_) {
+                recordRequest(route_metrics_[handler_metrics_[router_.indexOf(handler)]], start, resp,
+                              req.version() == HttpRequest::HTTP20);
+            }
+            return;
+        }
+    }
     
-    // 调用用户设置的回调函数
     if (http_callback_) {
         http_callback_(req, resp);
+    } else if (result == HttpRouter::kMethodNotAllowed) {
+        resp->setStatusCode(HttpResponse::k405MethodNotAllowed);
     } else {
         // 默认响应
         resp->setStatusCode(HttpResponse::k404NotFound);
         resp->setStatusMessage("Not Found");
         resp->setCloseConnection(true);
     }
+    if (metrics_) {
+        recordRequest(route_metrics_.back(), start, resp, req.version() == HttpRequest::HTTP20);
+    }
+}
+
+void HttpServer::enableMetrics(std::string_view path) {
+    metrics_.reset(new MetricsRegistry());
+    MetricsRegistry* registry = metrics_.get();
+    router_.get(path, [registry](const HttpRequest&, const RouteParams&, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setContentType("text/plain; version=0.0.4; charset=utf-8");
+        resp->addHeader("Cache-Control", "no-store");
+        resp->setBody(registry->render());
+    });
+}
+
+void HttpServer::installMetrics() {
+    // 同一路由模式的不同方法共用一组指标
+    auto addRoute = [this](std::string_view route) {
+        MetricsRegistry::Labels labels = {{"route", std::string(route)}};
+        RouteMetrics m;
+        m.requests = metrics_->counterArray("http_requests_total", "HTTP requests by route and status code",
+                                            labels, "code", 600);
+        m.latency = metrics_->histogram("http_request_duration_seconds", "HTTP request handling latency by route",
+                                        labels, 1e-6, MetricsRegistry::defaultLatencyBounds());
+        route_metrics_.push_back(m);
+    };
+    std::unordered_map<std::string_view, size_t> routes;
+    handler_metrics_.resize(router_.size());
+    for (size_t i = 0; i < router_.size(); ++i) {
+        std::string_view pattern = router_.pattern(i);
+        auto it = routes.find(pattern);
+        if (it == routes.end()) {
+            it = routes.emplace(pattern, route_metrics_.size()).first;
+            addRoute(pattern);
+        }
+        handler_metrics_[i] = it->second;
+    }
+    addRoute("unmatched");
+    
+    const MetricsRegistry::Labels idle = {{"phase", "idle"}};
+    const MetricsRegistry::Labels header = {{"phase", "header"}};
+    const MetricsRegistry::Labels body = {{"phase", "body"}};
+    const char* help = "Connections closed by timeout";
+    metrics_->counterFunction("http_timeouts_total", help, idle, [this]() { return static_cast<double>(idleTimeouts()); });
+    metrics_->counterFunction("http_timeouts_total", help, header, [this]() { return static_cast<double>(headerTimeouts()); });
+    metrics_->counterFunction("http_timeouts_total", help, body, [this]() { return static_cast<double>(bodyTimeouts()); });
+    if (micro_cache_) {
+        HttpMicroCache* cache = micro_cache_.get();
+        metrics_->counterFunction("http_micro_cache_hits_total", "Requests served from the micro-cache",
+                                  MetricsRegistry::Labels(), [cache]() { return static_cast<double>(cache->hits()); });
+        metrics_->counterFunction("http_micro_cache_misses_total", "Micro-cache lookups that called the handler",
+                                  MetricsRegistry::Labels(), [cache]() { return static_cast<double>(cache->misses()); });
+        metrics_->counterFunction("http_micro_cache_collapsed_total", "Requests that waited for another request's fill",
+                                  MetricsRegistry::Labels(), [cache]() { return static_cast<double>(cache->collapsed()); });
+    }
+}
+
+void HttpServer::recordRequest(const RouteMetrics& metrics, std::chrono::steady_clock::time_point start,
+                               HttpResponse* resp, bool http2) {
+    if (resp->deferred()) {
+        // 响应回到IO线程时记录，延迟包含后端处理的时间；不在后端线程中记录，
+        // 否则每个完成响应的线程都会在注册表中分到一组槽位
+        MetricsRegistry::CounterArray requests = metrics.requests;
+        MetricsRegistry::Histogram latency = metrics.latency;
+        resp->deferredState()->observe([requests, latency, start, http2](const HttpResponse& response) {
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            latency.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+            requests.inc(static_cast<size_t>(http2 ? Http2Session::responseStatus(response) : response.statusCode()));
+        });
+        return;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    metrics.latency.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+    metrics.requests.inc(static_cast<size_t>(http2 ? Http2Session::responseStatus(*resp) : resp->statusCode()));
 }
 
-} // namespace core
+} // namespace core
\ No newline at end of file
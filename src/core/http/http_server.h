@@ -1,25 +1,99 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <string>
+#include <string_view>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "core/http/http2_session.h"
+#include "core/http/http_compressor.h"
+#include "core/http/http_micro_cache.h"
+#include "core/http/http_router.h"
 #include "core/net/tcp_server.h"
+#include "core/utils/metrics.h"
 
 namespace core {
 
+class HttpContext;
+class HttpDeferredState;
+class HttpTimeoutWheel;
 class HttpRequest;
 class HttpResponse;
 
 // HTTP服务器
 class HttpServer {
 public:
+    // 同步填充响应；需要等待后端时调用resp->defer()取得句柄，稍后在任意线程中完成
     using HttpCallback = std::function<void(const HttpRequest&, HttpResponse*)>;
+    // 流式请求体回调：请求体(Content-Length或chunked)每到达一段就回调一次，数据仅在回调期间有效；
+    // 主体结束后仍会调用HttpCallback，此时req.body()为空
+    using BodyCallback = std::function<void(const HttpRequest&, std::string_view data)>;
+    
+    // 连接超时，单位秒，0表示不限制；由每个IO线程的时间轮检查，精度为1秒，实际在配置的时长之后1秒内到期
+    struct Timeouts {
+        int idle = 75;          // keep-alive连接等待下一个请求的最长时间，到期直接关闭
+        int header = 60;        // 从收到请求的第一个字节起，接收完请求行和头部的最长时间
+        int body = 60;          // 接收请求体时，两次收到数据之间的最长间隔
+        bool send_408 = true;   // 头部/主体超时时是否先回复408再关闭
+    };
     
     HttpServer(EventLoop* loop, const InetAddress& listenAddr,
               const std::string& name, TcpServer::Option option = TcpServer::kNoReusePort);
+    ~HttpServer();
     
     void setThreadNum(int numThreads) { server_.setThreadNum(numThreads); }
     void setHttpCallback(const HttpCallback& cb) { http_callback_ = cb; }
+    void setBodyCallback(const BodyCallback& cb) { body_callback_ = cb; }
+    void setThreadInitCallback(const TcpServer::ThreadInitCallback& cb) { thread_init_callback_ = cb; }
+    // 内存中累积的请求体上限(默认8MB)，Content-Length超过或chunked主体累积超过时回复413并关闭连接；
+    // 设置了BodyCallback时不受限制。须在start()之前调用
+    void setMaxBodySize(size_t size) { max_body_size_ = size; }
+    
+    // 路由表，须在start()之前注册路由；未匹配的请求交给HttpCallback
+    HttpRouter& router() { return router_; }
+    
+    // 开启响应压缩，须在start()之前调用
+    void enableCompression(const HttpCompressor::Options& options) { compressor_.reset(new HttpCompressor(options)); }
+    HttpCompressor* compressor() const { return compressor_.get(); }
+    
+    // 开启微缓存，须在start()之前调用；只有用cacheRoute设置了TTL的GET路由会被缓存
+    void enableMicroCache(const HttpMicroCache::Options& options = HttpMicroCache::Options()) {
+        micro_cache_.reset(new HttpMicroCache(options));
+    }
+    // 为路由模式(与注册时的写法相同)设置缓存TTL，未开启微缓存时按默认选项开启
+    void cacheRoute(std::string_view pattern, std::chrono::milliseconds ttl) {
+        if (!micro_cache_) {
+            enableMicroCache();
+        }
+        micro_cache_->addRoute(pattern, ttl);
+    }
+    HttpMicroCache* microCache() const { return micro_cache_.get(); }
+    
+    // 开启明文HTTP/2(h2c)，须在start()之前调用；客户端以连接前言(prior knowledge)或Upgrade: h2c协商，
+    // 每个流的请求与HTTP/1.1走同样的路由、压缩和延迟响应流程
+    void enableHttp2(const Http2Session::Options& options = Http2Session::Options()) {
+        http2_enabled_ = true;
+        http2_options_ = options;
+    }
+    
+    // 设置连接超时，须在start()之前调用
+    void setTimeouts(const Timeouts& timeouts) { timeouts_ = timeouts; }
+    const Timeouts& timeouts() const { return timeouts_; }
+    
+    // 开启指标统计，须在start()之前调用：按路由模式统计请求数(按状态码)和处理延迟(延迟响应算到完成为止)，
+    // 并在path注册GET路由，以Prometheus文本格式导出，超时和微缓存的统计一并导出。
+    // 微缓存命中的请求不调用处理函数，只计入缓存命中数；metrics()可以注册自定义指标
+    void enableMetrics(std::string_view path = "/metrics");
+    MetricsRegistry* metrics() const { return metrics_.get(); }
+    
+    // 超时统计
+    uint64_t idleTimeouts() const { return idle_timeouts_.load(std::memory_order_relaxed); }
+    uint64_t headerTimeouts() const { return header_timeouts_.load(std::memory_order_relaxed); }
+    uint64_t bodyTimeouts() const { return body_timeouts_.load(std::memory_order_relaxed); }
     
     // 启动服务器
     void start();
@@ -27,10 +101,103 @@ public:
 private:
     void onConnection(const TcpConnection::TcpConnectionPtr& conn);
     void onMessage(const TcpConnection::TcpConnectionPtr& conn, Buffer* buf, size_t len);
+    void onWriteComplete(const TcpConnection::TcpConnectionPtr& conn);
     void onRequest(const HttpRequest& req, HttpResponse* resp);
     
+    // 一个路由模式的指标
+    struct RouteMetrics {
+        MetricsRegistry::CounterArray requests;  // 按状态码计数
+        MetricsRegistry::Histogram latency;      // 微秒
+    };
+    // 启动时按路由表创建各路由的指标
+    void installMetrics();
+    // 处理函数返回后记录请求；延迟响应在完成时记录。http2时按流上实际回复的状态码统计
+    void recordRequest(const RouteMetrics& metrics, std::chrono::steady_clock::time_point start, HttpResponse* resp,
+                       bool http2);
+    
+    // 处理缓冲区中所有完整的请求
+    void processRequests(const TcpConnection::TcpConnectionPtr& conn, HttpContext* context, Buffer* buf);
+    // 处理函数要求升级为WebSocket：握手成功返回true，之后连接按帧处理
+    bool acceptWebSocket(const TcpConnection::TcpConnectionPtr& conn, HttpContext* context, Buffer* buf,
+                         HttpResponse* response, Buffer* output);
+    // 驱动chunked响应的生产者
+    void pumpStream(const TcpConnection::TcpConnectionPtr& conn, HttpContext* context);
+    // 在压缩线程中压缩响应，完成后发送并继续处理后续请求
+    void offloadCompression(const TcpConnection::TcpConnectionPtr& conn, HttpContext* context,
+                            HttpResponse* response, const HttpCompressor::Plan& plan);
+    
+    // 微缓存查找的结果
+    enum CacheStep {
+        kCacheBypass,   // 请求不走缓存，按常规流程处理
+        kCacheHit,      // 得到条目(命中或本请求同步生成)，直接发送
+        kCacheWait,     // 响应正在生成，完成后由CacheDelivery发送
+        kCacheRespond,  // 本请求已调用处理函数，但响应不能共享，response按常规流程发送
+    };
+    // kCacheWait的请求得到结果：entry不为空时发送缓存条目；否则response为本请求异步生成的响应，
+    // 或者request为等待者请求的拷贝(响应不能共享)，需要为它重新调用处理函数
+    using CacheDelivery = std::function<void(const HttpMicroCache::EntryPtr& entry, HttpResponse* response,
+                                             const HttpRequest* request)>;
+    // 处理可缓存的GET请求：命中、等待正在生成的响应，或者由本请求调用处理函数生成
+    CacheStep lookupMicroCache(EventLoop* loop, HttpMicroCache::Shard* shard, const HttpRequest& req,
+                               HttpResponse* response, HttpMicroCache::EntryPtr* entry, CacheDelivery deliver);
+    // 延迟响应完成后压缩(需要时)并存入缓存，唤醒等待者，再把结果交给生成它的请求
+    // path为请求路径，压缩结果按它进入预压缩变体缓存
+    void finishMicroCacheFill(EventLoop* loop, HttpMicroCache::Shard* shard, const std::string& key,
+                              const std::string& path, std::chrono::milliseconds ttl,
+                              HttpCompressor::Encoding encoding, HttpResponse* response,
+                              const CacheDelivery& deliver);
+    // HTTP/1.1：发送缓存条目的字节，并继续处理积压的请求
+    void sendCachedResponse(const TcpConnection::TcpConnectionPtr& conn, HttpContext* context,
+                            const HttpMicroCache::EntryPtr& entry, bool head);
+    // HTTP/1.1：等待者拿不到可共享的响应，不经过缓存重新处理请求
+    void redispatch(const TcpConnection::TcpConnectionPtr& conn, HttpContext* context, const HttpRequest& req);
+    
+    // 等待延迟响应完成
+    void waitDeferred(const TcpConnection::TcpConnectionPtr& conn, HttpContext* context,
+                      const std::shared_ptr<HttpDeferredState>& state, bool head);
+    // 发送在其他线程中完成的响应，并继续处理积压的请求
+    void sendPendingResponse(const TcpConnection::TcpConnectionPtr& conn, HttpContext* context,
+                             HttpResponse* response);
+    
+    // HTTP/2：创建连接的会话，处理收到的帧和各流的请求
+    void startHttp2(const TcpConnection::TcpConnectionPtr& conn, HttpContext* context);
+    void onHttp2Message(const TcpConnection::TcpConnectionPtr& conn, HttpContext* context, Buffer* buf);
+    // use_cache为false时不经过微缓存(等待者拿不到可共享的响应后重新处理)
+    void onHttp2Request(const TcpConnection::TcpConnectionPtr& conn, uint32_t stream_id, const HttpRequest& req,
+                        bool use_cache = true);
+    // 在其他线程中完成的响应回到IO线程后提交到流上
+    void submitHttp2Response(const TcpConnection::TcpConnectionPtr& conn, Http2Session* session,
+                             uint32_t stream_id, HttpResponse* response);
+    
+    // 超时：在IO线程中安装时间轮，按连接当前所处的阶段设置超时，到期时关闭连接
+    void installTimeoutWheel(EventLoop* loop);
+    // 当前IO线程(loop所属)的时间轮，没有安装时返回空
+    HttpTimeoutWheel* localTimeoutWheel(EventLoop* loop);
+    void updateTimeout(const TcpConnection::TcpConnectionPtr& conn, HttpContext* context);
+    void beginClosing(const TcpConnection::TcpConnectionPtr& conn, HttpContext* context);
+    void onTimeout(const TcpConnection::TcpConnectionPtr& conn, HttpContext* context);
+    
     TcpServer server_;         // TCP服务器
+    HttpRouter router_;        // 路由表
+    std::unique_ptr<HttpCompressor> compressor_;  // 响应压缩，为空表示不压缩
+    std::unique_ptr<HttpMicroCache> micro_cache_;  // 微缓存，为空表示不缓存
     HttpCallback http_callback_;  // HTTP回调
+    BodyCallback body_callback_;  // 流式请求体回调
+    size_t max_body_size_;        // 内存中请求体上限
+    bool http2_enabled_;          // 是否接受h2c
+    Http2Session::Options http2_options_;
+    TcpServer::ThreadInitCallback thread_init_callback_;  // 用户的IO线程初始化回调
+    
+    std::unique_ptr<MetricsRegistry> metrics_;  // 指标，为空表示不统计
+    std::vector<RouteMetrics> route_metrics_;   // 按路由模式去重，最后一项为未匹配路由表的请求
+    std::vector<size_t> handler_metrics_;       // 路由表中处理函数的编号 -> route_metrics_下标
+    
+    Timeouts timeouts_;
+    std::mutex wheels_mutex_;
+    std::unordered_map<EventLoop*, std::unique_ptr<HttpTimeoutWheel>> wheels_;  // 每个IO线程的时间轮
+    std::atomic<uint64_t> idle_timeouts_;
+    std::atomic<uint64_t> header_timeouts_;
+    std::atomic<uint64_t> body_timeouts_;
 };
 
 } // namespace core
\ No newline at end of file
@@ -0,0 +1,556 @@
+#include "core/http/websocket.h"
+
+#include <string.h>
+#include <strings.h>
+#include "core/http/http_request.h"
+#include "core/http/http_response.h"
+#include "core/net/tcp_connection.h"
+#include "core/reactor/event_loop.h"
+#include "core/utils/byte_mask.h"
+#include "core/utils/logger.h"
+
+namespace core {
+
+namespace {
+
+const size_t kMaxFrameHeader = 10;            // 服务端帧头最长10字节(不加掩码)
+const size_t kMaxControlPayload = 125;
+const int kCloseHandshakeSeconds = 5;         // 发出close帧后等待对端回复的时间
+
+const char kAcceptGuid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+// 逗号分隔的头部值中是否有token(不区分大小写)
+bool headerHasToken(std::string_view value, std::string_view token) {
+    while (!value.empty()) {
+        size_t comma = value.find(',');
+        std::string_view item = value.substr(0, comma);
+        value = comma == std::string_view::npos ? std::string_view() : value.substr(comma + 1);
+        while (!item.empty() && (item.front() == ' ' || item.front() == '\t')) {
+            item.remove_prefix(1);
+        }
+        while (!item.empty() && (item.back() == ' ' || item.back() == '\t')) {
+            item.remove_suffix(1);
+        }
+        if (item.size() == token.size() && strncasecmp(item.data(), token.data(), token.size()) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// SHA-1，只用于计算Sec-WebSocket-Accept
+void sha1(const std::string& input, unsigned char digest[20]) {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+    std::string msg = input;
+    uint64_t bit_len = static_cast<uint64_t>(input.size()) * 8;
+    msg.push_back(static_cast<char>(0x80));
+    while (msg.size() % 64 != 56) {
+        msg.push_back('\0');
+    }
+    for (int i = 7; i >= 0; --i) {
+        msg.push_back(static_cast<char>(bit_len >> (i * 8)));
+    }
+
+    auto rotl = [](uint32_t x, int n) { return (x << n) | (x >> (32 - n)); };
+    for (size_t chunk = 0; chunk < msg.size(); chunk += 64) {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(msg.data() + chunk);
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = static_cast<uint32_t>(p[i * 4]) << 24 | static_cast<uint32_t>(p[i * 4 + 1]) << 16
+                 | static_cast<uint32_t>(p[i * 4 + 2]) << 8 | p[i * 4 + 3];
+        }
+        for (int i = 16; i < 80; ++i) {
+            w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t t = rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotl(b, 30);
+            b = a;
+            a = t;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+    for (int i = 0; i < 5; ++i) {
+        digest[i * 4] = static_cast<unsigned char>(h[i] >> 24);
+        digest[i * 4 + 1] = static_cast<unsigned char>(h[i] >> 16);
+        digest[i * 4 + 2] = static_cast<unsigned char>(h[i] >> 8);
+        digest[i * 4 + 3] = static_cast<unsigned char>(h[i]);
+    }
+}
+
+std::string encodeBase64(const unsigned char* data, size_t len) {
+    static const char kTable[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((len + 2) / 3 * 4);
+    size_t i = 0;
+    for (; i + 3 <= len; i += 3) {
+        uint32_t v = static_cast<uint32_t>(data[i]) << 16 | static_cast<uint32_t>(data[i + 1]) << 8 | data[i + 2];
+        out.push_back(kTable[v >> 18]);
+        out.push_back(kTable[(v >> 12) & 0x3F]);
+        out.push_back(kTable[(v >> 6) & 0x3F]);
+        out.push_back(kTable[v & 0x3F]);
+    }
+    if (i + 1 == len) {
+        uint32_t v = static_cast<uint32_t>(data[i]) << 16;
+        out.push_back(kTable[v >> 18]);
+        out.push_back(kTable[(v >> 12) & 0x3F]);
+        out.append("==");
+    } else if (i + 2 == len) {
+        uint32_t v = static_cast<uint32_t>(data[i]) << 16 | static_cast<uint32_t>(data[i + 1]) << 8;
+        out.push_back(kTable[v >> 18]);
+        out.push_back(kTable[(v >> 12) & 0x3F]);
+        out.push_back(kTable[(v >> 6) & 0x3F]);
+        out.push_back('=');
+    }
+    return out;
+}
+
+// 文本消息和关闭原因必须是合法的UTF-8(拒绝过长编码、代理区和超出U+10FFFF的码点)
+bool validUtf8(const char* data, size_t len) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    const unsigned char* end = p + len;
+    while (p < end) {
+        // 逐8字节跳过ASCII
+        while (end - p >= 8) {
+            uint64_t v;
+            memcpy(&v, p, 8);
+            if (v & 0x8080808080808080ULL) {
+                break;
+            }
+            p += 8;
+        }
+        if (p == end) {
+            break;
+        }
+        unsigned char c = *p;
+        if (c < 0x80) {
+            ++p;
+            continue;
+        }
+        size_t n;
+        uint32_t cp;
+        if (c >= 0xC2 && c <= 0xDF) {
+            n = 1;
+            cp = c & 0x1F;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            n = 2;
+            cp = c & 0x0F;
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            n = 3;
+            cp = c & 0x07;
+        } else {
+            return false;
+        }
+        if (static_cast<size_t>(end - p) <= n) {
+            return false;
+        }
+        for (size_t i = 1; i <= n; ++i) {
+            if ((p[i] & 0xC0) != 0x80) {
+                return false;
+            }
+            cp = (cp << 6) | (p[i] & 0x3F);
+        }
+        if ((n == 2 && (cp < 0x800 || (cp >= 0xD800 && cp <= 0xDFFF))) || (n == 3 && (cp < 0x10000 || cp > 0x10FFFF))) {
+            return false;
+        }
+        p += n + 1;
+    }
+    return true;
+}
+
+// close帧中允许出现的关闭码
+bool validCloseCode(uint16_t code) {
+    if (code >= 3000 && code <= 4999) {
+        return true;
+    }
+    return (code >= 1000 && code <= 1003) || (code >= 1007 && code <= 1011);
+}
+
+// 写服务端帧头，返回长度
+size_t encodeFrameHeader(uint8_t opcode, size_t len, char* header) {
+    header[0] = static_cast<char>(0x80 | opcode);  // FIN，服务端不分片发送
+    if (len < 126) {
+        header[1] = static_cast<char>(len);
+        return 2;
+    }
+    if (len <= 0xFFFF) {
+        header[1] = 126;
+        header[2] = static_cast<char>(len >> 8);
+        header[3] = static_cast<char>(len);
+        return 4;
+    }
+    header[1] = 127;
+    for (int i = 0; i < 8; ++i) {
+        header[2 + i] = static_cast<char>(static_cast<uint64_t>(len) >> ((7 - i) * 8));
+    }
+    return 10;
+}
+
+} // namespace
+
+WebSocketConnection::WebSocketConnection(const std::shared_ptr<TcpConnection>& conn,
+                                         std::shared_ptr<const WebSocketCallbacks> callbacks)
+    : conn_(conn),
+      loop_(conn->getLoop()),
+      name_(conn->name()),
+      callbacks_(std::move(callbacks)),
+      state_(kOpen),
+      close_notified_(false),
+      message_opcode_(0) {
+}
+
+WebSocketConnection::~WebSocketConnection() = default;
+
+bool WebSocketConnection::handshake(const HttpRequest& req, HttpResponse* resp) {
+    std::string_view key = req.getHeader("Sec-WebSocket-Key");
+    // 密钥是16字节随机数的base64编码，固定24个字符
+    if (req.method() != HttpRequest::GET || req.version() != HttpRequest::HTTP11
+        || !headerHasToken(req.getHeader("Upgrade"), "websocket")
+        || !headerHasToken(req.getHeader("Connection"), "upgrade")
+        || key.size() != 24 || key.substr(22) != "==") {
+        resp->setStatusCode(HttpResponse::k400BadRequest);
+        resp->setCloseConnection(true);
+        return false;
+    }
+    if (req.getHeader("Sec-WebSocket-Version") != "13") {
+        resp->setStatusCode(HttpResponse::k426UpgradeRequired);
+        resp->addHeader("Sec-WebSocket-Version", "13");
+        resp->setCloseConnection(true);
+        return false;
+    }
+
+    std::string input(key);
+    input.append(kAcceptGuid, sizeof(kAcceptGuid) - 1);
+    unsigned char digest[20];
+    sha1(input, digest);
+
+    resp->setStatusCode(HttpResponse::k101SwitchingProtocols);
+    resp->addHeader("Upgrade", "websocket");
+    resp->addHeader("Sec-WebSocket-Accept", encodeBase64(digest, sizeof(digest)));
+    return true;
+}
+
+WebSocketConnection::PreparedMessage WebSocketConnection::prepare(std::string_view payload, Opcode opcode) {
+    char header[kMaxFrameHeader];
+    size_t header_len = encodeFrameHeader(static_cast<uint8_t>(opcode), payload.size(), header);
+    auto frame = std::make_shared<std::string>();
+    frame->reserve(header_len + payload.size());
+    frame->append(header, header_len);
+    frame->append(payload.data(), payload.size());
+    return frame;
+}
+
+void WebSocketConnection::send(std::string_view payload, Opcode opcode) {
+    if (loop_->isInLoopThread()) {
+        sendFrameInLoop(static_cast<uint8_t>(opcode), payload.data(), payload.size());
+    } else {
+        // 跨线程时只能拷贝一次负载，顺便在调用线程中完成编码
+        send(prepare(payload, opcode));
+    }
+}
+
+void WebSocketConnection::send(const PreparedMessage& message) {
+    auto self = shared_from_this();
+    loop_->runInLoop([self, message]() {
+        auto conn = self->conn_.lock();
+        if (self->state_ == kOpen && conn) {
+            // 帧不拷贝进输出缓冲区：直接写socket，写不完时排队的也只是对共享帧的引用
+            conn->sendShared(message->data(), message->size(), message);
+        }
+    });
+}
+
+void WebSocketConnection::ping(std::string_view payload) {
+    if (payload.size() > kMaxControlPayload) {
+        payload = payload.substr(0, kMaxControlPayload);
+    }
+    send(payload, kPing);
+}
+
+void WebSocketConnection::close(uint16_t code, std::string_view reason) {
+    if (loop_->isInLoopThread()) {
+        closeInLoop(code, reason);
+    } else {
+        auto self = shared_from_this();
+        loop_->runInLoop([self, code, r = std::string(reason)]() {
+            self->closeInLoop(code, r);
+        });
+    }
+}
+
+void WebSocketConnection::start() {
+    if (callbacks_->on_open) {
+        callbacks_->on_open(shared_from_this());
+    }
+}
+
+void WebSocketConnection::onMessage(Buffer* buf) {
+    // 回调中用户可能丢掉最后一个引用
+    auto self = shared_from_this();
+
+    while (state_ != kClosed && buf->readableBytes() >= 2) {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(buf->peek());
+        size_t readable = buf->readableBytes();
+        bool fin = p[0] & 0x80;
+        uint8_t opcode = p[0] & 0x0F;
+        bool control = opcode & 0x08;
+
+        if (p[0] & 0x70) {
+            fail(kProtocolError, "reserved bits set");
+            break;
+        }
+        if ((opcode > kBinary && opcode < kClose) || opcode > kPong) {
+            fail(kProtocolError, "unknown opcode");
+            break;
+        }
+        if (!(p[1] & 0x80)) {
+            // 客户端发出的帧必须加掩码
+            fail(kProtocolError, "unmasked frame");
+            break;
+        }
+
+        uint64_t len = p[1] & 0x7F;
+        size_t header_len = 2;
+        if (len == 126) {
+            if (readable < 4) {
+                break;
+            }
+            len = static_cast<uint64_t>(p[2]) << 8 | p[3];
+            header_len = 4;
+        } else if (len == 127) {
+            if (readable < 10) {
+                break;
+            }
+            if (p[2] & 0x80) {
+                // 64位长度的最高位必须为0(RFC 6455 5.2)
+                fail(kProtocolError, "invalid payload length");
+                break;
+            }
+            len = 0;
+            for (int i = 0; i < 8; ++i) {
+                len = len << 8 | p[2 + i];
+            }
+            header_len = 10;
+        }
+
+        if (control && (!fin || len > kMaxControlPayload)) {
+            fail(kProtocolError, "invalid control frame");
+            break;
+        }
+        // 先检查长度再等待负载到达，超长的消息不会在缓冲区中累积；用减法比较，len来自对端，相加可能溢出
+        if (!control && (message_.size() > callbacks_->max_message_size ||
+                         len > callbacks_->max_message_size - message_.size())) {
+            fail(kMessageTooBig, "message too big");
+            break;
+        }
+
+        header_len += 4;
+        if (readable < header_len || readable - header_len < len) {
+            break;
+        }
+
+        // 在输入缓冲区中原地去除掩码
+        char* payload = const_cast<char*>(buf->peek()) + header_len;
+        xorMask(payload, static_cast<size_t>(len), p + header_len - 4);
+        bool ok = control ? handleControl(opcode, payload, static_cast<size_t>(len))
+                          : handleFrame(fin, opcode, payload, static_cast<size_t>(len));
+        if (!ok) {
+            break;
+        }
+        buf->retrieve(header_len + static_cast<size_t>(len));
+    }
+
+    if (state_ == kClosed) {
+        // 关闭之后的输入直接丢弃
+        buf->retrieveAll();
+    }
+}
+
+bool WebSocketConnection::handleFrame(bool fin, uint8_t opcode, char* payload, size_t len) {
+    if (state_ == kClosing) {
+        // 已发出close帧，等待对端回复期间忽略数据帧
+        return true;
+    }
+
+    if (opcode == kContinuation) {
+        if (message_opcode_ == 0) {
+            fail(kProtocolError, "unexpected continuation frame");
+            return false;
+        }
+        message_.append(payload, len);
+        if (!fin) {
+            return true;
+        }
+        uint8_t message_opcode = message_opcode_;
+        std::string message;
+        message.swap(message_);
+        message_opcode_ = 0;
+        if (message_opcode == kText && !validUtf8(message.data(), message.size())) {
+            fail(kInvalidPayload, "invalid utf-8");
+            return false;
+        }
+        if (callbacks_->on_message) {
+            callbacks_->on_message(shared_from_this(), message_opcode, message);
+        }
+        // 归还缓冲区，下一个分片消息复用
+        if (message_.capacity() < message.capacity()) {
+            message.clear();
+            message_.swap(message);
+        }
+        return state_ != kClosed;
+    }
+
+    if (message_opcode_ != 0) {
+        fail(kProtocolError, "expected continuation frame");
+        return false;
+    }
+    if (!fin) {
+        message_opcode_ = opcode;
+        message_.assign(payload, len);
+        return true;
+    }
+    if (opcode == kText && !validUtf8(payload, len)) {
+        fail(kInvalidPayload, "invalid utf-8");
+        return false;
+    }
+    // 未分片的消息直接引用输入缓冲区
+    if (callbacks_->on_message) {
+        callbacks_->on_message(shared_from_this(), opcode, std::string_view(payload, len));
+    }
+    return state_ != kClosed;
+}
+
+bool WebSocketConnection::handleControl(uint8_t opcode, const char* payload, size_t len) {
+    if (opcode == kPing) {
+        if (state_ == kOpen) {
+            sendFrameInLoop(kPong, payload, len);
+        }
+        return true;
+    }
+    if (opcode == kPong) {
+        return true;
+    }
+
+    // close帧：负载为空，或2字节关闭码加UTF-8的原因
+    uint16_t code = kNoStatus;
+    std::string_view reason;
+    if (len == 1) {
+        fail(kProtocolError, "invalid close frame");
+        return false;
+    }
+    if (len >= 2) {
+        code = static_cast<uint16_t>(static_cast<unsigned char>(payload[0]) << 8 | static_cast<unsigned char>(payload[1]));
+        reason = std::string_view(payload + 2, len - 2);
+        if (!validCloseCode(code)) {
+            fail(kProtocolError, "invalid close code");
+            return false;
+        }
+        if (!validUtf8(reason.data(), reason.size())) {
+            fail(kInvalidPayload, "invalid close reason");
+            return false;
+        }
+    }
+
+    if (state_ == kOpen) {
+        // 对端发起关闭，回复相同的关闭码
+        sendFrameInLoop(kClose, payload, len >= 2 ? 2 : 0);
+    }
+    state_ = kClosed;
+    if (auto conn = conn_.lock()) {
+        conn->shutdown();
+    }
+    notifyClose(code, reason);
+    return false;
+}
+
+void WebSocketConnection::fail(uint16_t code, const char* reason) {
+    LOG_WARN("WebSocketConnection::fail [{}] {}, closing with {}", name_, reason, static_cast<unsigned>(code));
+    if (state_ == kOpen) {
+        char payload[2] = {static_cast<char>(code >> 8), static_cast<char>(code)};
+        sendFrameInLoop(kClose, payload, sizeof(payload));
+    }
+    state_ = kClosed;
+    if (auto conn = conn_.lock()) {
+        conn->shutdown();
+    }
+    notifyClose(code, reason);
+}
+
+void WebSocketConnection::onDisconnected() {
+    state_ = kClosed;
+    notifyClose(kAbnormalClosure, std::string_view());
+}
+
+void WebSocketConnection::sendFrameInLoop(uint8_t opcode, const char* payload, size_t len) {
+    auto conn = conn_.lock();
+    if (!conn || state_ == kClosed || (state_ == kClosing && opcode != kClose)) {
+        return;
+    }
+    // 帧头和负载拼在一起发出，避免两次写
+    Buffer frame;
+    char header[kMaxFrameHeader];
+    size_t header_len = encodeFrameHeader(opcode, len, header);
+    frame.ensureWritableBytes(header_len + len);
+    frame.append(header, header_len);
+    frame.append(payload, len);
+    conn->send(&frame);
+}
+
+void WebSocketConnection::closeInLoop(uint16_t code, std::string_view reason) {
+    if (state_ != kOpen) {
+        return;
+    }
+    if (reason.size() > kMaxControlPayload - 2) {
+        reason = reason.substr(0, kMaxControlPayload - 2);
+    }
+    char payload[kMaxControlPayload];
+    payload[0] = static_cast<char>(code >> 8);
+    payload[1] = static_cast<char>(code);
+    memcpy(payload + 2, reason.data(), reason.size());
+    sendFrameInLoop(kClose, payload, 2 + reason.size());
+    state_ = kClosing;
+
+    // 对端不回复close帧时强制关闭
+    std::weak_ptr<TcpConnection> weak_conn(conn_);
+    loop_->getTimerManager()->addTimer([weak_conn]() {
+        if (auto conn = weak_conn.lock()) {
+            conn->forceClose();
+        }
+    }, std::chrono::steady_clock::now() + std::chrono::seconds(kCloseHandshakeSeconds));
+}
+
+void WebSocketConnection::notifyClose(uint16_t code, std::string_view reason) {
+    if (close_notified_) {
+        return;
+    }
+    close_notified_ = true;
+    message_.clear();
+    message_opcode_ = 0;
+    if (callbacks_->on_close) {
+        callbacks_->on_close(shared_from_this(), code, reason);
+    }
+}
+
+} // namespace core
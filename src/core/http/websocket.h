@@ -0,0 +1,140 @@
+#pragma once
+
+#include <functional>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <boost/any.hpp>
+#include "core/net/buffer.h"
+
+namespace core {
+
+class EventLoop;
+class HttpRequest;
+class HttpResponse;
+class TcpConnection;
+class WebSocketConnection;
+
+// 路由处理函数调用HttpResponse::upgradeWebSocket()时提供，回调都在连接所属的IO线程中执行
+struct WebSocketCallbacks {
+    using Ptr = std::shared_ptr<WebSocketConnection>;
+    using OpenCallback = std::function<void(const Ptr&)>;
+    // 收到完整的文本或二进制消息，data只在回调期间有效；opcode为kText或kBinary
+    using MessageCallback = std::function<void(const Ptr&, int opcode, std::string_view data)>;
+    // 连接关闭，每个连接只回调一次；对端直接断开时code为1006
+    using CloseCallback = std::function<void(const Ptr&, uint16_t code, std::string_view reason)>;
+    
+    OpenCallback on_open;
+    MessageCallback on_message;
+    CloseCallback on_close;
+    size_t max_message_size = 16 * 1024 * 1024;  // 单个消息(拼接所有分片后)的上限，超过以1009关闭
+};
+
+// 升级为WebSocket(RFC 6455)后的连接，由HttpServer在完成握手后创建，保存在连接的上下文中。
+// 帧直接在输入缓冲区中解析，客户端的掩码原地去除，未分片的消息不经拷贝交给回调；
+// 分片的消息拼接完整后再回调。收到ping自动回复pong，收到close回复close后关闭连接
+class WebSocketConnection : public std::enable_shared_from_this<WebSocketConnection> {
+public:
+    enum Opcode {
+        kContinuation = 0x0,
+        kText = 0x1,
+        kBinary = 0x2,
+        kClose = 0x8,
+        kPing = 0x9,
+        kPong = 0xA,
+    };
+    
+    // 关闭码
+    enum CloseCode : uint16_t {
+        kNormalClosure = 1000,
+        kGoingAway = 1001,
+        kProtocolError = 1002,
+        kUnsupportedData = 1003,
+        kNoStatus = 1005,           // 对端的close帧没有携带关闭码，不能出现在发送的帧中
+        kAbnormalClosure = 1006,    // 连接直接断开，没有收到close帧，不能出现在发送的帧中
+        kInvalidPayload = 1007,     // 文本消息不是合法的UTF-8
+        kMessageTooBig = 1009,
+        kInternalError = 1011,
+    };
+    
+    using Ptr = std::shared_ptr<WebSocketConnection>;
+    // 预先编码好的服务端帧，可以发送给任意多个连接，只编码一次、不按连接拷贝
+    using PreparedMessage = std::shared_ptr<const std::string>;
+    
+    using OpenCallback = WebSocketCallbacks::OpenCallback;
+    using MessageCallback = WebSocketCallbacks::MessageCallback;
+    using CloseCallback = WebSocketCallbacks::CloseCallback;
+    
+    WebSocketConnection(const std::shared_ptr<TcpConnection>& conn, std::shared_ptr<const WebSocketCallbacks> callbacks);
+    ~WebSocketConnection();
+    
+    WebSocketConnection(const WebSocketConnection&) = delete;
+    WebSocketConnection& operator=(const WebSocketConnection&) = delete;
+    
+    // 校验升级请求：合法时把resp填成101响应(含Sec-WebSocket-Accept)并返回true，
+    // 否则填成400，或在版本不支持时填成带Sec-WebSocket-Version的426
+    static bool handshake(const HttpRequest& req, HttpResponse* resp);
+    
+    // 编码一个服务端帧(不加掩码)，用于广播
+    static PreparedMessage prepare(std::string_view payload, Opcode opcode = kText);
+    
+    // 发送消息，可在任意线程中调用；在IO线程中调用时直接写出，否则拷贝负载后转到IO线程
+    void send(std::string_view payload, Opcode opcode = kText);
+    // 发送预先编码好的帧，可在任意线程中调用，只增加引用计数；
+    // 帧不拷贝进各连接的输出缓冲区，socket写不完时排队的也只是对它的引用
+    void send(const PreparedMessage& message);
+    void ping(std::string_view payload = std::string_view());
+    // 发送close帧，收到对端的close帧或等待超时后关闭连接，可在任意线程中调用
+    void close(uint16_t code = kNormalClosure, std::string_view reason = std::string_view());
+    
+    // 是否仍可发送消息：连接未断开且没有发送过close帧，仅在IO线程中准确
+    bool open() const { return state_ == kOpen; }
+    EventLoop* getLoop() const { return loop_; }
+    const std::string& name() const { return name_; }
+    
+    // 用户数据，仅在IO线程中访问
+    void setContext(const boost::any& context) { context_ = context; }
+    const boost::any& getContext() const { return context_; }
+    boost::any* getMutableContext() { return &context_; }
+    
+    // 以下由HttpServer在IO线程中调用
+    // 握手响应发出后调用，回调on_open
+    void start();
+    // 消费输入缓冲区中所有完整的帧
+    void onMessage(Buffer* buf);
+    // TCP连接断开
+    void onDisconnected();
+    // 关闭握手已完成或连接出错，等待输出写完后断开
+    bool closed() const { return state_ == kClosed; }
+    
+private:
+    enum State { kOpen, kClosing, kClosed };
+    
+    // 处理一个完整的帧，负载已去除掩码；返回false表示连接已关闭，停止解析
+    bool handleFrame(bool fin, uint8_t opcode, char* payload, size_t len);
+    bool handleControl(uint8_t opcode, const char* payload, size_t len);
+    // 协议错误：发送close帧并关闭连接
+    void fail(uint16_t code, const char* reason);
+    
+    void sendFrameInLoop(uint8_t opcode, const char* payload, size_t len);
+    void closeInLoop(uint16_t code, std::string_view reason);
+    // 回调on_close(只回调一次)
+    void notifyClose(uint16_t code, std::string_view reason);
+    
+    std::weak_ptr<TcpConnection> conn_;  // 上下文持有本对象，这里只保存弱引用避免循环引用
+    EventLoop* loop_;
+    std::string name_;
+    std::shared_ptr<const WebSocketCallbacks> callbacks_;
+    
+    State state_;
+    bool close_notified_;
+    
+    // 正在拼接的分片消息
+    uint8_t message_opcode_;   // kText/kBinary，0表示没有
+    std::string message_;
+    
+    boost::any context_;
+};
+
+} // namespace core
@@ -64,7 +64,7 @@ void Acceptor::handleRead() {
         }
     } else {
         // 出错
-        LOG_ERROR("Acceptor::handleRead - accept error: %s", strerror(errno));
+        LOG_ERROR("Acceptor::handleRead - accept error: {}", strerror(errno));
         
         // 文件描述符耗尽，先关闭空闲的文件描述符，再接受连接，然后立即关闭
         // 这样做的目的是优雅应对 EMFILE 错误
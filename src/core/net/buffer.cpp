@@ -2,6 +2,7 @@
 #include <string.h>
 #include <sys/uio.h>
 #include <cassert>
+#include "core/utils/byte_scan.h"
 
 namespace core{
     
@@ -9,16 +10,49 @@ const char Buffer::kCRLF[] = "\r\n";
 // 查找CRLF（\r\n)
 const char* Buffer::findCRLF() const {
     // 笔记：查找子序列第一次出现：auto it = std::search(data.begin(), data.end(), sub.begin(), sub.end());
-    const char* crlf = std::search(peek(), beginWrite(), kCRLF, kCRLF + 2);
-    return crlf == beginWrite() ? nullptr : crlf;
+    // std::search逐字节比较，这里改用向量化的scanCRLF
+    return scanCRLF(peek(), beginWrite());
 }
 
 // 从指定位置开始查找CRLF
 const char* Buffer::findCRLF(const char* start) const {
     assert(peek() <= start);
     assert(start <= beginWrite());
-    const char* crlf = std::search(start, beginWrite(), kCRLF, kCRLF + 2);
-    return crlf == beginWrite() ? nullptr : crlf;
+    return scanCRLF(start, beginWrite());
+}
+
+// 从上次扫描结束的位置继续查找CRLF
+const char* Buffer::findCRLF(size_t* scan_offset) const {
+    assert(*scan_offset <= readableBytes());
+    const char* crlf = scanCRLF(peek() + *scan_offset, beginWrite());
+    if (crlf == nullptr && readableBytes() > 0) {
+        // 最后一个字节可能是'\r'，下次需要从它开始
+        *scan_offset = readableBytes() - 1;
+    }
+    return crlf;
+}
+
+// 查找CRLFCRLF（\r\n\r\n)，即HTTP头部的结束位置
+const char* Buffer::findCRLFCRLF() const {
+    return scanCRLFCRLF(peek(), beginWrite());
+}
+
+// 从指定位置开始查找CRLFCRLF
+const char* Buffer::findCRLFCRLF(const char* start) const {
+    assert(peek() <= start);
+    assert(start <= beginWrite());
+    return scanCRLFCRLF(start, beginWrite());
+}
+
+// 从上次扫描结束的位置继续查找CRLFCRLF
+const char* Buffer::findCRLFCRLF(size_t* scan_offset) const {
+    assert(*scan_offset <= readableBytes());
+    const char* pos = scanCRLFCRLF(peek() + *scan_offset, beginWrite());
+    if (pos == nullptr && readableBytes() >= 3) {
+        // 末尾3个字节可能是分隔符的前缀
+        *scan_offset = readableBytes() - 3;
+    }
+    return pos;
 }
 
 // 查找换行符
@@ -35,6 +69,20 @@ const char* Buffer::findEOL(const char* start) const {
     return static_cast<const char*>(eol);
 }
 
+// 从指定位置开始查找单个字节
+const char* Buffer::findByte(char c, const char* start) const {
+    assert(peek() <= start);
+    assert(start <= beginWrite());
+    return scanByte(start, beginWrite(), c);
+}
+
+// 从指定位置开始查找set中任意一个字节
+const char* Buffer::findAnyOf(const char* set, size_t set_len, const char* start) const {
+    assert(peek() <= start);
+    assert(start <= beginWrite());
+    return scanAnyOf(start, beginWrite(), set, set_len);
+}
+
 // 取出数据，并后移reader_index_
 void Buffer::retrieve(size_t len) {
     if (len < readableBytes()) {
@@ -58,19 +106,19 @@ void Buffer::retrieveAll() {
 }
 
 // 取出所有数据并转为字符串
-inline std::string Buffer::retrieveAllAsString() {
+std::string Buffer::retrieveAllAsString() {
     return retrieveAsString(readableBytes());
 }
 
 // 取出指定长度的数据并转为字符串
-inline std::string Buffer::retrieveAsString(size_t len) {
+std::string Buffer::retrieveAsString(size_t len) {
     std::string result(peek(), len);
     retrieve(len);
     return result;
 }
 
 // 确保有足够的写空间
-inline void Buffer::ensureWritableBytes(size_t len) {
+void Buffer::ensureWritableBytes(size_t len) {
     if (writableBytes() < len) {
         makeSpace(len);
     }
@@ -95,24 +143,24 @@ void Buffer::makeSpace(size_t len){
 }
 
 // 在数组末尾追加数据，空间不足则扩容
-inline void Buffer::append(const char* data, size_t len) {
+void Buffer::append(const char* data, size_t len) {
     ensureWritableBytes(len);
     std::copy(data, data + len, beginWrite());
     hasWritten(len);
 }
 
 // 追加字符串
-inline void Buffer::append(const std::string& str) {
+void Buffer::append(const std::string& str) {
     append(str.data(), str.size());
 }
 
 // 追加其他Buffer
-inline void Buffer::append(const Buffer& buf) {
+void Buffer::append(const Buffer& buf) {
     append(buf.peek(), buf.readableBytes());
 }
 
 // 写入数据完成
-inline void Buffer::hasWritten(size_t len) {
+void Buffer::hasWritten(size_t len) {
     assert(len <= writableBytes());
     writer_index_ += len;
 }
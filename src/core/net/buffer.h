@@ -47,8 +47,17 @@ public:
 
     const char* findCRLF() const;
     const char* findCRLF(const char* start) const;
+    const char* findCRLFCRLF() const;
+    const char* findCRLFCRLF(const char* start) const;
     const char* findEOL() const;
     const char* findEOL(const char* start) const;
+    const char* findByte(char c, const char* start) const;
+    const char* findAnyOf(const char* set, size_t set_len, const char* start) const;
+
+    // 可恢复的查找：scan_offset为相对peek()的已扫描偏移，未找到时更新为下次应开始的位置，
+    // 数据分多次到达时不必从头重新扫描。使用偏移而非指针，Buffer扩容后依然有效
+    const char* findCRLF(size_t* scan_offset) const;
+    const char* findCRLFCRLF(size_t* scan_offset) const;
 
     void retrieve(size_t len);
     void retrieveUntil(const char* end);
@@ -34,11 +34,11 @@ void Channel::handleEvent(){
     if (!tied_ || guard) {
         event_handling_ = true;
     
-        LOG_TRACE("fd = %d, revents = %d", fd_, revents_);
+        LOG_TRACE("fd = {}, revents = {}", fd_, revents_);
         
         // 对端关闭连接（半关闭或全关闭），但本地可能仍有数据可读。
         if ((revents_ & POLLHUP) && !(revents_ & POLLIN)) {
-            LOG_WARN("fd = %d POLLHUP", fd_);
+            LOG_WARN("fd = {} POLLHUP", fd_);
             if (close_callback_) close_callback_();
         }
         
@@ -0,0 +1,307 @@
+#include "core/net/connection_pool.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <cassert>
+#include "core/net/inet_address_format.h"
+#include "core/reactor/event_loop.h"
+#include "core/utils/logger.h"
+
+namespace core {
+
+namespace {
+
+// 空闲连接上不应收到数据(对端关闭前的通知、上一个请求多出的响应)，无法判断如何处理，直接关闭
+void onIdleMessage(const TcpConnection::TcpConnectionPtr& conn, Buffer* buf, size_t) {
+    LOG_WARN("ConnectionPool - unexpected {} bytes on idle connection [{}], closing",
+             buf->readableBytes(), conn->name());
+    buf->retrieveAll();
+    conn->forceClose();
+}
+
+// 以空连接回调失败的请求；放到下一轮循环，不在acquire/析构函数中重入调用方
+void failWaiters(EventLoop* loop, std::vector<ConnectionPool::AcquireCallback> waiters) {
+    if (!waiters.empty()) {
+        loop->queueInLoop([waiters]() {
+            for (const auto& cb : waiters) {
+                cb(TcpConnection::TcpConnectionPtr());
+            }
+        });
+    }
+}
+
+} // namespace
+
+ConnectionPool::ConnectionPool(EventLoop* loop, const std::string& name, const Options& options)
+    : loop_(loop),
+      name_(name),
+      options_(options),
+      next_conn_id_(1),
+      idle_check_pending_(false),
+      alive_(std::make_shared<bool>(true)) {
+}
+
+ConnectionPool::~ConnectionPool() {
+    loop_->assertInLoopThread();
+    LOG_DEBUG("ConnectionPool::~ConnectionPool [{}] closing {} connections", name_, connections_.size());
+    alive_.reset();
+
+    std::vector<AcquireCallback> waiters;
+    for (auto& item : hosts_) {
+        Host& host = item.second;
+        for (const auto& connector : host.connectors) {
+            connector->stop();
+        }
+        for (auto& cb : host.waiters) {
+            waiters.push_back(std::move(cb));
+        }
+    }
+    // 连接的关闭晚于连接池的析构，关闭回调不能再访问this
+    EventLoop* loop = loop_;
+    for (const auto& item : connections_) {
+        const TcpConnection::TcpConnectionPtr& conn = item.first;
+        conn->setCloseCallback([loop](const TcpConnection::TcpConnectionPtr& c) {
+            loop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, c));
+        });
+        conn->forceClose();
+    }
+    failWaiters(loop_, std::move(waiters));
+}
+
+uint64_t ConnectionPool::keyOf(const InetAddress& addr) {
+    const struct sockaddr_in* sin = reinterpret_cast<const struct sockaddr_in*>(addr.getSockAddr());
+    return (static_cast<uint64_t>(ntohl(sin->sin_addr.s_addr)) << 16) | ntohs(sin->sin_port);
+}
+
+void ConnectionPool::acquire(const InetAddress& addr, AcquireCallback cb) {
+    loop_->assertInLoopThread();
+    uint64_t key = keyOf(addr);
+    auto it = hosts_.find(key);
+    if (it == hosts_.end()) {
+        it = hosts_.emplace(key, Host(addr)).first;
+    }
+    Host* host = &it->second;
+
+    // 最近归还的连接最热(拥塞窗口、对端缓存)，先借出
+    while (!host->idle.empty()) {
+        TcpConnection::TcpConnectionPtr conn = std::move(host->idle.back().conn);
+        host->idle.pop_back();
+        if (conn->connected()) {
+            ++host->busy;
+            connections_[conn].busy = true;
+            cb(conn);
+            return;
+        }
+    }
+
+    host->waiters.push_back(std::move(cb));
+    if (host->total() < options_.max_connections_per_host) {
+        startConnect(host);
+    } else {
+        LOG_DEBUG("ConnectionPool::acquire [{}] - {} connections to {} in use, {} waiting",
+                  name_, host->total(), host->addr, host->waiters.size());
+    }
+}
+
+void ConnectionPool::release(const TcpConnection::TcpConnectionPtr& conn) {
+    // 可能在conn的MessageCallback中调用，换回调留到本轮事件处理完之后
+    std::weak_ptr<bool> alive(alive_);
+    loop_->queueInLoop([this, alive, conn]() {
+        if (alive.lock()) {
+            releaseInLoop(conn);
+        }
+    });
+}
+
+size_t ConnectionPool::idleConnections() const {
+    size_t n = 0;
+    for (const auto& item : hosts_) {
+        n += item.second.idle.size();
+    }
+    return n;
+}
+
+size_t ConnectionPool::busyConnections() const {
+    size_t n = 0;
+    for (const auto& item : hosts_) {
+        n += item.second.busy;
+    }
+    return n;
+}
+
+void ConnectionPool::startConnect(Host* host) {
+    uint64_t key = keyOf(host->addr);
+    auto connector = std::make_shared<Connector>(loop_, host->addr, options_.connector);
+    // 回调只持有weak_ptr，避免Connector和自己的回调互相引用
+    std::weak_ptr<Connector> weak_connector(connector);
+    connector->setNewConnectionCallback([this, key, weak_connector](int sockfd) {
+        newConnection(key, weak_connector.lock(), sockfd);
+    });
+    connector->setConnectFailedCallback([this, key, weak_connector]() {
+        connectFailed(key, weak_connector.lock());
+    });
+    host->connectors.insert(connector);
+    connector->start();
+}
+
+void ConnectionPool::newConnection(uint64_t key, const std::shared_ptr<Connector>& connector, int sockfd) {
+    loop_->assertInLoopThread();
+    Host* host = &hosts_.find(key)->second;
+    host->connectors.erase(connector);
+
+    InetAddress peer_addr = Connector::peerAddress(sockfd);
+    InetAddress local_addr = Connector::localAddress(sockfd);
+    // 创建连接名
+    char buf[64];
+    snprintf(buf, sizeof buf, "-%s#%d", peer_addr.IP_Port().c_str(), next_conn_id_);
+    ++next_conn_id_;
+    std::string conn_name = name_ + buf;
+
+    TcpConnection::TcpConnectionPtr conn = std::make_shared<TcpConnection>(
+        loop_, conn_name, sockfd, local_addr, peer_addr);
+    conn->setTcpNoDelay(options_.tcp_no_delay);
+    conn->setMessageCallback(onIdleMessage);
+    conn->setCloseCallback(
+        std::bind(&ConnectionPool::removeConnection, this, std::placeholders::_1));
+    connections_[conn] = ConnectionState{key, false};
+    conn->connectEstablished();
+
+    LOG_DEBUG("ConnectionPool::newConnection [{}] - new connection [{}]", name_, conn_name);
+    putIdle(host, conn);
+}
+
+void ConnectionPool::connectFailed(uint64_t key, const std::shared_ptr<Connector>& connector) {
+    loop_->assertInLoopThread();
+    Host* host = &hosts_.find(key)->second;
+    host->connectors.erase(connector);
+    LOG_WARN("ConnectionPool::connectFailed [{}] - cannot connect to {}", name_, host->addr);
+
+    // 每次建立连接都是为一个排队的请求发起的(acquire或removeConnection)，只让这一个请求失败；
+    // 排队的请求不比正在建立的连接多时，它已经由归还的连接满足了。
+    // 连接数达到上限后排队的请求没有对应的连接，还有借出的连接时继续等它们归还，
+    // 否则不会再有连接可用，一并失败
+    std::vector<AcquireCallback> failed;
+    size_t fail_count = host->waiters.size() > host->connectors.size()
+                      ? host->waiters.size() - host->connectors.size() : 0;
+    if (host->busy > 0) {
+        fail_count = std::min<size_t>(fail_count, 1);
+    }
+    while (failed.size() < fail_count) {
+        failed.push_back(std::move(host->waiters.front()));
+        host->waiters.pop_front();
+    }
+    failWaiters(loop_, std::move(failed));
+}
+
+void ConnectionPool::releaseInLoop(const TcpConnection::TcpConnectionPtr& conn) {
+    loop_->assertInLoopThread();
+    auto it = connections_.find(conn);
+    if (it == connections_.end() || !it->second.busy) {
+        LOG_WARN("ConnectionPool::release [{}] - connection [{}] is not borrowed from this pool",
+                 name_, conn->name());
+        return;
+    }
+    it->second.busy = false;
+    Host* host = &hosts_.find(it->second.key)->second;
+    --host->busy;
+
+    // 清掉借用方的回调和上下文
+    conn->setMessageCallback(onIdleMessage);
+    conn->setConnectionChangeCallback(TcpConnection::ConnectionCallback());
+    conn->setWriteCompleteCallback(TcpConnection::WriteCompleteCallback());
+    conn->setContext(boost::any());
+    if (!conn->connected()) {
+        // 正在关闭，关闭回调中移除
+        return;
+    }
+    if (conn->inputBuffer()->readableBytes() > 0) {
+        // 还有未读完的响应，复用会错位
+        LOG_WARN("ConnectionPool::release [{}] - connection [{}] returned with {} unread bytes, closing",
+                 name_, conn->name(), conn->inputBuffer()->readableBytes());
+        conn->forceClose();
+        return;
+    }
+    putIdle(host, conn);
+}
+
+void ConnectionPool::putIdle(Host* host, const TcpConnection::TcpConnectionPtr& conn) {
+    if (!host->waiters.empty()) {
+        AcquireCallback cb = std::move(host->waiters.front());
+        host->waiters.pop_front();
+        ++host->busy;
+        connections_[conn].busy = true;
+        cb(conn);
+        return;
+    }
+    if (host->idle.size() >= options_.max_idle_per_host) {
+        conn->forceClose();
+        return;
+    }
+    host->idle.push_back(IdleConnection{conn, std::chrono::steady_clock::now()});
+    scheduleIdleCheck();
+}
+
+void ConnectionPool::removeConnection(const TcpConnection::TcpConnectionPtr& conn) {
+    loop_->assertInLoopThread();
+    auto it = connections_.find(conn);
+    assert(it != connections_.end());
+    bool busy = it->second.busy;
+    Host* host = &hosts_.find(it->second.key)->second;
+    connections_.erase(it);
+
+    if (busy) {
+        --host->busy;
+    } else {
+        host->idle.erase(std::remove_if(host->idle.begin(), host->idle.end(),
+                                        [&conn](const IdleConnection& idle) { return idle.conn == conn; }),
+                         host->idle.end());
+    }
+    LOG_DEBUG("ConnectionPool::removeConnection [{}] - connection [{}]", name_, conn->name());
+
+    // 在本轮事件处理完之后销毁连接
+    loop_->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+
+    // 空出的名额给排队的请求建立新连接
+    if (host->waiters.size() > host->connectors.size() &&
+        host->total() < options_.max_connections_per_host) {
+        startConnect(host);
+    }
+}
+
+void ConnectionPool::scheduleIdleCheck() {
+    if (idle_check_pending_ || options_.idle_timeout.count() <= 0) {
+        return;
+    }
+    idle_check_pending_ = true;
+    std::weak_ptr<bool> alive(alive_);
+    auto interval = std::max(options_.idle_timeout / 2, std::chrono::milliseconds(100));
+    loop_->getTimerManager()->addTimer([this, alive]() {
+        if (alive.lock()) {
+            closeIdleConnections();
+        }
+    }, std::chrono::steady_clock::now() + interval);
+}
+
+void ConnectionPool::closeIdleConnections() {
+    idle_check_pending_ = false;
+    auto deadline = std::chrono::steady_clock::now() - options_.idle_timeout;
+    bool remaining = false;
+    for (auto& item : hosts_) {
+        std::vector<IdleConnection>& idle = item.second.idle;
+        // 空闲列表按归还时间排列，超时的都在前面
+        auto end = std::find_if(idle.begin(), idle.end(),
+                                [deadline](const IdleConnection& c) { return c.since > deadline; });
+        std::vector<IdleConnection> expired(std::make_move_iterator(idle.begin()), std::make_move_iterator(end));
+        idle.erase(idle.begin(), end);
+        for (const IdleConnection& c : expired) {
+            LOG_DEBUG("ConnectionPool [{}] - closing idle connection [{}]", name_, c.conn->name());
+            c.conn->forceClose();
+        }
+        remaining = remaining || !idle.empty();
+    }
+    if (remaining) {
+        scheduleIdleCheck();
+    }
+}
+
+} // namespace core
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "core/net/connector.h"
+#include "core/net/tcp_connection.h"
+
+namespace core {
+
+class EventLoop;
+
+// 按服务器地址复用上游连接的连接池，每个EventLoop一个(如在TcpServer的ThreadInitCallback中创建)，
+// 只在所属loop线程中使用，不加锁。
+// 借用：acquire(addr, cb)优先取该地址最近归还的空闲连接(连接仍是热的)，没有时新建连接，
+// 连接数达到上限时排队等待归还；cb在loop线程中调用，失败(连接不上、连接池析构)时参数为空。
+// 借到的连接由借用方设置MessageCallback收发数据，处理完一次请求后用release(conn)归还；
+// 不能再复用的连接(协议出错、对端要求关闭)直接shutdown/forceClose，连接池在它关闭时计数。
+// 空闲连接上收到数据或空闲超时时关闭
+class ConnectionPool {
+public:
+    using AcquireCallback = std::function<void(const TcpConnection::TcpConnectionPtr&)>;
+
+    struct Options {
+        size_t max_connections_per_host = 64;   // 同一地址的连接上限(空闲、借出和正在建立的)，达到后acquire排队
+        size_t max_idle_per_host = 16;          // 同一地址保留的空闲连接上限，多出的归还时关闭
+        std::chrono::milliseconds idle_timeout = std::chrono::seconds(60);  // 空闲超过这个时间关闭
+        Connector::Options connector;           // 建立连接的超时和重试，默认只尝试一次
+        bool tcp_no_delay = true;
+
+        Options() { connector.max_retries = 0; }
+    };
+
+    ConnectionPool(EventLoop* loop, const std::string& name, const Options& options);
+    // 关闭所有连接，排队中的acquire以空连接回调；须在loop线程中析构
+    ~ConnectionPool();
+
+    // 禁止拷贝
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    // 借用一个到addr的连接
+    void acquire(const InetAddress& addr, AcquireCallback cb);
+    // 归还借用的连接；可以在它的MessageCallback中调用
+    void release(const TcpConnection::TcpConnectionPtr& conn);
+
+    EventLoop* getLoop() const { return loop_; }
+    // 连接池中的空闲连接数和借出的连接数，只在loop线程中读取
+    size_t idleConnections() const;
+    size_t busyConnections() const;
+
+private:
+    struct IdleConnection {
+        TcpConnection::TcpConnectionPtr conn;
+        std::chrono::steady_clock::time_point since;   // 开始空闲的时间
+    };
+
+    // 一个服务器地址的连接
+    struct Host {
+        explicit Host(const InetAddress& addr) : addr(addr), busy(0) {}
+
+        size_t total() const { return idle.size() + busy + connectors.size(); }
+
+        InetAddress addr;
+        std::vector<IdleConnection> idle;   // 按归还顺序，后归还的在末尾，先借出
+        size_t busy;                        // 借出的连接数
+        std::deque<AcquireCallback> waiters;
+        std::set<std::shared_ptr<Connector>> connectors;  // 正在建立的连接
+    };
+
+    // 已建立的连接：所属地址的键和是否借出
+    struct ConnectionState {
+        uint64_t key = 0;
+        bool busy = false;
+    };
+
+    // 地址和端口组成的键
+    static uint64_t keyOf(const InetAddress& addr);
+
+    void startConnect(Host* host);
+    void newConnection(uint64_t key, const std::shared_ptr<Connector>& connector, int sockfd);
+    void connectFailed(uint64_t key, const std::shared_ptr<Connector>& connector);
+    void releaseInLoop(const TcpConnection::TcpConnectionPtr& conn);
+    // 把可用的连接交给排队的请求或放入空闲列表
+    void putIdle(Host* host, const TcpConnection::TcpConnectionPtr& conn);
+    void removeConnection(const TcpConnection::TcpConnectionPtr& conn);
+    void scheduleIdleCheck();
+    void closeIdleConnections();
+
+    EventLoop* loop_;
+    const std::string name_;
+    const Options options_;
+    std::unordered_map<uint64_t, Host> hosts_;
+    // 全部已建立的连接，析构时关闭
+    std::unordered_map<TcpConnection::TcpConnectionPtr, ConnectionState> connections_;
+    int next_conn_id_;
+    bool idle_check_pending_;       // 是否已安排空闲检查
+    std::shared_ptr<bool> alive_;   // 定时器只持有weak_ptr，连接池析构后的回调直接返回
+};
+
+} // namespace core
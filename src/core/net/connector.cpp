@@ -0,0 +1,266 @@
+#include "core/net/connector.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cassert>
+#include "core/net/channel.h"
+#include "core/net/inet_address_format.h"
+#include "core/reactor/event_loop.h"
+#include "core/utils/logger.h"
+
+namespace core {
+
+namespace {
+
+int socketError(int sockfd) {
+    int optval = 0;
+    socklen_t optlen = static_cast<socklen_t>(sizeof optval);
+    if (::getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &optval, &optlen) < 0) {
+        return errno;
+    }
+    return optval;
+}
+
+// 连接本机上没有监听的临时端口时，内核可能让socket连上自己(TCP同时打开)
+bool isSelfConnect(int sockfd) {
+    InetAddress local = Connector::localAddress(sockfd);
+    InetAddress peer = Connector::peerAddress(sockfd);
+    const struct sockaddr_in* l = reinterpret_cast<const struct sockaddr_in*>(local.getSockAddr());
+    const struct sockaddr_in* p = reinterpret_cast<const struct sockaddr_in*>(peer.getSockAddr());
+    return l->sin_port == p->sin_port && l->sin_addr.s_addr == p->sin_addr.s_addr;
+}
+
+} // namespace
+
+Connector::Connector(EventLoop* loop, const InetAddress& server_addr, const Options& options)
+    : loop_(loop),
+      server_addr_(server_addr),
+      options_(options),
+      connect_(false),
+      state_(kDisconnected),
+      retry_delay_(options.initial_retry_delay),
+      retries_(0),
+      attempt_(0) {
+    LOG_DEBUG("Connector::Connector [{}]", server_addr_);
+}
+
+Connector::~Connector() {
+    LOG_DEBUG("Connector::~Connector [{}]", server_addr_);
+    assert(!channel_);
+}
+
+InetAddress Connector::localAddress(int sockfd) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    socklen_t addrlen = static_cast<socklen_t>(sizeof addr);
+    if (::getsockname(sockfd, reinterpret_cast<struct sockaddr*>(&addr), &addrlen) < 0) {
+        LOG_ERROR("Connector::localAddress - getsockname failed: {}", strerror(errno));
+    }
+    return InetAddress(addr);
+}
+
+InetAddress Connector::peerAddress(int sockfd) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    socklen_t addrlen = static_cast<socklen_t>(sizeof addr);
+    if (::getpeername(sockfd, reinterpret_cast<struct sockaddr*>(&addr), &addrlen) < 0) {
+        LOG_ERROR("Connector::peerAddress - getpeername failed: {}", strerror(errno));
+    }
+    return InetAddress(addr);
+}
+
+void Connector::start() {
+    loop_->runInLoop([self = shared_from_this()]() {
+        self->connect_ = true;
+        self->startInLoop();
+    });
+}
+
+void Connector::restart() {
+    loop_->assertInLoopThread();
+    setState(kDisconnected);
+    retry_delay_ = options_.initial_retry_delay;
+    retries_ = 0;
+    connect_ = true;
+    startInLoop();
+}
+
+void Connector::stop() {
+    loop_->runInLoop([self = shared_from_this()]() {
+        self->connect_ = false;
+        self->stopInLoop();
+    });
+}
+
+void Connector::startInLoop() {
+    loop_->assertInLoopThread();
+    if (connect_ && state_ == kDisconnected) {
+        connect();
+    } else {
+        LOG_DEBUG("Connector::startInLoop [{}] do not connect", server_addr_);
+    }
+}
+
+void Connector::stopInLoop() {
+    loop_->assertInLoopThread();
+    // 正在等待的超时和重试定时器随之失效
+    ++attempt_;
+    if (state_ == kConnecting) {
+        setState(kDisconnected);
+        int sockfd = removeAndResetChannel();
+        ::close(sockfd);
+    }
+}
+
+void Connector::connect() {
+    int sockfd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+    if (sockfd < 0) {
+        LOG_ERROR("Connector::connect [{}] - socket failed: {}", server_addr_, strerror(errno));
+        retry(-1);
+        return;
+    }
+    int ret = ::connect(sockfd, server_addr_.getSockAddr(), static_cast<socklen_t>(sizeof(struct sockaddr_in)));
+    int saved_errno = ret == 0 ? 0 : errno;
+    switch (saved_errno) {
+        case 0:
+        case EINPROGRESS:
+        case EINTR:
+        case EISCONN:
+            // 非阻塞connect一般返回EINPROGRESS，等可写事件
+            connecting(sockfd);
+            break;
+
+        case EAGAIN:
+        case EADDRINUSE:
+        case EADDRNOTAVAIL:
+        case ECONNREFUSED:
+        case ENETUNREACH:
+        case EHOSTUNREACH:
+        case ETIMEDOUT:
+            LOG_WARN("Connector::connect [{}] failed: {}", server_addr_, strerror(saved_errno));
+            retry(sockfd);
+            break;
+
+        default:
+            // EACCES、EPERM、EAFNOSUPPORT等，重试也不会成功
+            LOG_ERROR("Connector::connect [{}] error: {}", server_addr_, strerror(saved_errno));
+            ::close(sockfd);
+            connect_ = false;
+            if (connect_failed_callback_) {
+                connect_failed_callback_();
+            }
+            break;
+    }
+}
+
+void Connector::connecting(int sockfd) {
+    setState(kConnecting);
+    assert(!channel_);
+    channel_.reset(new Channel(loop_, sockfd));
+    channel_->setWriteCallback(std::bind(&Connector::handleWrite, this));
+    channel_->setErrorCallback(std::bind(&Connector::handleError, this));
+    // Channel的回调期间保证Connector存活
+    channel_->tie(shared_from_this());
+    channel_->enableWriting();
+
+    uint64_t attempt = ++attempt_;
+    std::weak_ptr<Connector> weak_self(shared_from_this());
+    loop_->getTimerManager()->addTimer([weak_self, attempt]() {
+        if (auto self = weak_self.lock()) {
+            self->handleTimeout(attempt);
+        }
+    }, std::chrono::steady_clock::now() + options_.connect_timeout);
+}
+
+int Connector::removeAndResetChannel() {
+    channel_->disableAll();
+    channel_->remove();
+    int sockfd = channel_->fd();
+    // 可能正处在这个Channel的handleEvent中，留到本轮事件处理完之后再析构
+    std::shared_ptr<Channel> channel(channel_.release());
+    loop_->queueInLoop([channel]() {});
+    return sockfd;
+}
+
+void Connector::handleWrite() {
+    LOG_TRACE("Connector::handleWrite [{}] state = {}", server_addr_, state_);
+    if (state_ != kConnecting) {
+        return;
+    }
+    int sockfd = removeAndResetChannel();
+    int err = socketError(sockfd);
+    if (err) {
+        LOG_WARN("Connector::handleWrite [{}] - SO_ERROR = {} {}", server_addr_, err, strerror(err));
+        retry(sockfd);
+    } else if (isSelfConnect(sockfd)) {
+        LOG_WARN("Connector::handleWrite [{}] - self connect", server_addr_);
+        retry(sockfd);
+    } else {
+        setState(kConnected);
+        ++attempt_;
+        retries_ = 0;
+        retry_delay_ = options_.initial_retry_delay;
+        if (connect_ && new_connection_callback_) {
+            new_connection_callback_(sockfd);
+        } else {
+            ::close(sockfd);
+        }
+    }
+}
+
+void Connector::handleError() {
+    LOG_TRACE("Connector::handleError [{}] state = {}", server_addr_, state_);
+    if (state_ == kConnecting) {
+        int sockfd = removeAndResetChannel();
+        int err = socketError(sockfd);
+        LOG_WARN("Connector::handleError [{}] - SO_ERROR = {} {}", server_addr_, err, strerror(err));
+        retry(sockfd);
+    }
+}
+
+void Connector::handleTimeout(uint64_t attempt) {
+    if (attempt != attempt_ || state_ != kConnecting) {
+        return;
+    }
+    LOG_WARN("Connector::handleTimeout [{}] - connect timed out after {} ms", server_addr_,
+             static_cast<int64_t>(options_.connect_timeout.count()));
+    int sockfd = removeAndResetChannel();
+    retry(sockfd);
+}
+
+void Connector::retry(int sockfd) {
+    if (sockfd >= 0) {
+        ::close(sockfd);
+    }
+    setState(kDisconnected);
+    if (!connect_) {
+        LOG_DEBUG("Connector::retry [{}] do not connect", server_addr_);
+        return;
+    }
+    if (options_.max_retries >= 0 && retries_ >= options_.max_retries) {
+        LOG_WARN("Connector::retry [{}] - giving up after {} retries", server_addr_, retries_);
+        connect_ = false;
+        if (connect_failed_callback_) {
+            connect_failed_callback_();
+        }
+        return;
+    }
+    ++retries_;
+    LOG_INFO("Connector::retry - retry connecting to {} in {} ms", server_addr_,
+             static_cast<int64_t>(retry_delay_.count()));
+
+    uint64_t attempt = ++attempt_;
+    std::weak_ptr<Connector> weak_self(shared_from_this());
+    loop_->getTimerManager()->addTimer([weak_self, attempt]() {
+        auto self = weak_self.lock();
+        if (self && attempt == self->attempt_) {
+            self->startInLoop();
+        }
+    }, std::chrono::steady_clock::now() + retry_delay_);
+    retry_delay_ = std::min(retry_delay_ * 2, options_.max_retry_delay);
+}
+
+} // namespace core
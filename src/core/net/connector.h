@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include "core/net/inet_address.h"
+
+namespace core {
+
+class Channel;
+class EventLoop;
+
+// 主动发起连接的类，TcpClient和ConnectionPool的底层：
+// 非阻塞connect，等待可写事件判断结果；每次尝试有超时，失败后按指数退避重试(初始间隔每次翻倍，直到上限)。
+// 连接成功后把sockfd交给NewConnectionCallback，由调用方创建TcpConnection，Connector不再管理它。
+// 由shared_ptr管理，定时器只持有weak_ptr，Connector先于定时器销毁时不会被回调。
+// 笔记：超时和重试定时器不取消，回调中比较尝试的序号，过期的直接返回
+class Connector : public std::enable_shared_from_this<Connector> {
+public:
+    using NewConnectionCallback = std::function<void(int sockfd)>;
+    using ConnectFailedCallback = std::function<void()>;
+
+    struct Options {
+        std::chrono::milliseconds connect_timeout = std::chrono::seconds(3);         // 单次连接的超时
+        std::chrono::milliseconds initial_retry_delay = std::chrono::milliseconds(500);
+        std::chrono::milliseconds max_retry_delay = std::chrono::seconds(30);
+        int max_retries = -1;   // 连续失败后最多重试的次数，用完后调用ConnectFailedCallback，-1表示一直重试
+    };
+
+    Connector(EventLoop* loop, const InetAddress& server_addr, const Options& options);
+    ~Connector();
+
+    // 禁止拷贝
+    Connector(const Connector&) = delete;
+    Connector& operator=(const Connector&) = delete;
+
+    void setNewConnectionCallback(const NewConnectionCallback& cb) { new_connection_callback_ = cb; }
+    void setConnectFailedCallback(const ConnectFailedCallback& cb) { connect_failed_callback_ = cb; }
+
+    const InetAddress& serverAddress() const { return server_addr_; }
+
+    // 开始连接，可在任意线程调用
+    void start();
+    // 连接断开后重新连接，重置退避间隔；只能在loop线程调用
+    void restart();
+    // 停止连接和重试，可在任意线程调用
+    void stop();
+
+    // 已连接socket的本地/对端地址
+    static InetAddress localAddress(int sockfd);
+    static InetAddress peerAddress(int sockfd);
+
+private:
+    enum StateE { kDisconnected, kConnecting, kConnected };
+
+    void setState(StateE s) { state_ = s; }
+    void startInLoop();
+    void stopInLoop();
+    void connect();
+    void connecting(int sockfd);
+    void handleWrite();
+    void handleError();
+    void handleTimeout(uint64_t attempt);
+    void retry(int sockfd);
+    // 移除正在等待的Channel，返回它的fd
+    int removeAndResetChannel();
+
+    EventLoop* loop_;               // 所属的事件循环
+    const InetAddress server_addr_; // 服务器地址
+    const Options options_;
+    bool connect_;                  // 是否需要连接，stop后为false
+    StateE state_;
+    std::unique_ptr<Channel> channel_;   // 连接过程中等待可写事件的Channel
+    std::chrono::milliseconds retry_delay_;  // 下次重试前的等待时间
+    int retries_;                   // 连续失败的次数
+    uint64_t attempt_;              // 当前尝试的序号，每次连接、停止时递增，使之前的定时器失效
+
+    NewConnectionCallback new_connection_callback_;
+    ConnectFailedCallback connect_failed_callback_;
+};
+
+} // namespace core
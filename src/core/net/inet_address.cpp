@@ -2,6 +2,7 @@
 
 #include <arpa/inet.h>
 #include <string.h>
+#include "core/utils/int_format.h"
 #include "core/utils/logger.h"
 
 namespace core {
@@ -19,7 +20,7 @@ InetAddress::InetAddress(const std::string& ip, uint16_t port) {
     addr_.sin_port = htons(port);
     
     if (::inet_pton(AF_INET, ip.c_str(), &addr_.sin_addr) <= 0) {
-        LOG_ERROR("inet_pton failed for %s", ip);
+        LOG_ERROR("inet_pton failed for {}", ip);
     }
 }
 
@@ -34,11 +35,20 @@ std::string InetAddress::IP() const {
 }
 
 std::string InetAddress::IP_Port() const {
-    char buf[64] = "";
-    ::inet_ntop(AF_INET, &addr_.sin_addr, buf, static_cast<socklen_t>(sizeof buf));
-    size_t end = strlen(buf);
-    snprintf(buf + end, sizeof buf - end, ":%u", ntohs(addr_.sin_port));
-    return buf;
+    char buf[kMaxIpPortLength];
+    return std::string(buf, formatIpPort(buf));
+}
+
+size_t InetAddress::formatIpPort(char* buf) const {
+    // 逐字节输出点分十进制，不经过inet_ntop和snprintf
+    const unsigned char* ip = reinterpret_cast<const unsigned char*>(&addr_.sin_addr.s_addr);
+    char* p = buf;
+    for (int i = 0; i < 4; ++i) {
+        p += formatUInt(ip[i], p);
+        *p++ = i < 3 ? '.' : ':';
+    }
+    p += formatUInt(ntohs(addr_.sin_port), p);
+    return p - buf;
 }
 
 uint16_t InetAddress::port() const {
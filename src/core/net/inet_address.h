@@ -21,6 +21,11 @@ public:
     std::string IP_Port() const;  // 获取IP:port
     uint16_t port() const;        // 获取port
 
+    // "255.255.255.255:65535"的长度
+    static const size_t kMaxIpPortLength = 21;
+    // 把IP:port写入buf(至少kMaxIpPortLength字节，不写'\0')，返回长度，不分配内存
+    size_t formatIpPort(char* buf) const;
+
     // 将类内部的地址结构体sockaddr_in转换为通用的 const sockaddr* 类型指针
     const struct sockaddr* getSockAddr() const{
         // 笔记： const 用于函数名后表示该函数不会修改成员变量，该函数也只能调用同样有const修饰的成员函数
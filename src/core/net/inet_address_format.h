@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string.h>
+#include "core/net/inet_address.h"
+#include "core/utils/binary_logging.h"
+#include "core/utils/log_format.h"
+
+namespace core {
+
+// InetAddress的日志格式化，与地址类本身分开，网络头文件不依赖日志后端；
+// 在日志中输出InetAddress的源文件包含本文件
+
+// 日志中直接使用InetAddress，输出IP:port
+template <>
+struct LogFormatter<InetAddress> {
+    static void format(LogFormatBuffer* out, const InetAddress& addr, char) {
+        out->commit(addr.formatIpPort(out->reserve(InetAddress::kMaxIpPortLength)));
+    }
+};
+
+// 二进制日志中保存网络字节序的地址和端口
+template <>
+struct binlog::ArgTraits<InetAddress> {
+    static const ArgType kType = kInet4;
+
+    static size_t size(const InetAddress&) { return 6; }
+    static char* encode(char* p, const InetAddress& addr) {
+        const struct sockaddr_in* sin = reinterpret_cast<const struct sockaddr_in*>(addr.getSockAddr());
+        memcpy(p, &sin->sin_addr.s_addr, 4);
+        memcpy(p + 4, &sin->sin_port, 2);
+        return p + 6;
+    }
+};
+
+} // namespace core
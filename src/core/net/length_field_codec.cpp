@@ -0,0 +1,172 @@
+#include "core/net/length_field_codec.h"
+
+#include <string.h>
+#include <cassert>
+#include "core/utils/logger.h"
+
+namespace core {
+
+LengthFieldCodec::LengthFieldCodec(const Options& options, FramesCallback cb)
+    : options_(options),
+      frames_callback_(std::move(cb)) {
+    const size_t width = options_.length_field_width;
+    if (width != 1 && width != 2 && width != 3 && width != 4 && width != 8) {
+        LOG_FATAL("LengthFieldCodec - invalid length field width {}", width);
+    }
+    if (options_.length_field_offset > kMaxHeaderLength - width) {
+        LOG_FATAL("LengthFieldCodec - length field offset {} too large for width {}",
+                  options_.length_field_offset, width);
+    }
+}
+
+void LengthFieldCodec::onMessage(const TcpConnection::TcpConnectionPtr& conn, Buffer* buf, size_t) {
+    // 每个IO线程复用一个帧列表，避免每次读事件分配内存
+    thread_local std::vector<Frame> frames;
+    frames.clear();
+    
+    const size_t header_len = headerLength();
+    const char* begin = buf->peek();
+    size_t readable = buf->readableBytes();
+    size_t consumed = 0;
+    
+    while (readable - consumed >= header_len) {
+        const char* frame = begin + consumed;
+        uint64_t field = decodeLength(frame + options_.length_field_offset);
+        
+        // 统一换算为payload长度
+        uint64_t payload_len = field;
+        if (options_.length_includes_header) {
+            if (field < header_len) {
+                payload_len = options_.max_frame_size + 1;  // 非法长度，按超长处理
+            } else {
+                payload_len = field - header_len;
+            }
+        }
+        
+        if (payload_len > options_.max_frame_size) {
+            LOG_ERROR("LengthFieldCodec::onMessage [{}] invalid frame length {}",
+                      conn->name(), field);
+            // 先把已解出的完整帧交给用户，再处理错误
+            if (!frames.empty() && frames_callback_) {
+                frames_callback_(conn, frames);
+            }
+            buf->retrieveAll();
+            if (error_callback_) {
+                error_callback_(conn, static_cast<size_t>(payload_len));
+            } else {
+                conn->shutdown();
+            }
+            return;
+        }
+        
+        if (readable - consumed < header_len + payload_len) {
+            break;  // 半包，等待更多数据
+        }
+        
+        frames.push_back(Frame{
+            std::string_view(frame, options_.length_field_offset),
+            std::string_view(frame + header_len, static_cast<size_t>(payload_len))});
+        consumed += header_len + payload_len;
+    }
+    
+    if (!frames.empty()) {
+        if (frames_callback_) {
+            frames_callback_(conn, frames);
+        }
+        // 回调结束后视图失效，统一取出
+        buf->retrieve(consumed);
+    }
+}
+
+bool LengthFieldCodec::send(const TcpConnection::TcpConnectionPtr& conn, Buffer* payload, const void* prefix) const {
+    const size_t payload_len = payload->readableBytes();
+    if (!fits(payload_len)) {
+        // 对端会把这一帧当作协议错误，长度字段放不下时则会截断成另一个长度，都不能发出去
+        LOG_ERROR("LengthFieldCodec::send [{}] frame of {} bytes too large, dropped", conn->name(), payload_len);
+        payload->retrieveAll();
+        return false;
+    }
+    
+    char header[kMaxHeaderLength];
+    const size_t header_len = headerLength();
+    encodeHeader(payload_len, prefix, header);
+    
+    if (payload->prependableBytes() >= header_len) {
+        // 写入预留前置空间，payload本身不移动
+        payload->prepend(header, header_len);
+        conn->send(payload);
+    } else {
+        Buffer frame;
+        frame.append(header, header_len);
+        frame.append(*payload);
+        payload->retrieveAll();
+        conn->send(&frame);
+    }
+    return true;
+}
+
+bool LengthFieldCodec::send(const TcpConnection::TcpConnectionPtr& conn, std::string_view payload, const void* prefix) const {
+    if (!fits(payload.size())) {
+        LOG_ERROR("LengthFieldCodec::send [{}] frame of {} bytes too large, dropped", conn->name(), payload.size());
+        return false;
+    }
+    Buffer frame;
+    frame.append(payload.data(), payload.size());
+    return send(conn, &frame, prefix);
+}
+
+bool LengthFieldCodec::fits(size_t payload_len) const {
+    if (payload_len > options_.max_frame_size) {
+        return false;
+    }
+    const size_t width = options_.length_field_width;
+    const uint64_t max_field = width >= 8 ? UINT64_MAX : (uint64_t(1) << (8 * width)) - 1;
+    const uint64_t header_len = options_.length_includes_header ? headerLength() : 0;
+    return payload_len <= max_field && payload_len <= max_field - header_len;
+}
+
+void LengthFieldCodec::encodeHeader(size_t payload_len, const void* prefix, char* header) const {
+    const size_t header_len = headerLength();
+    assert(header_len <= kMaxHeaderLength);
+    
+    if (options_.length_field_offset > 0) {
+        if (prefix) {
+            memcpy(header, prefix, options_.length_field_offset);
+        } else {
+            memset(header, 0, options_.length_field_offset);
+        }
+    }
+    
+    uint64_t field = options_.length_includes_header ? payload_len + header_len : payload_len;
+    encodeLength(field, header + options_.length_field_offset);
+}
+
+uint64_t LengthFieldCodec::decodeLength(const char* p) const {
+    const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+    const size_t width = options_.length_field_width;
+    uint64_t value = 0;
+    if (options_.big_endian) {
+        for (size_t i = 0; i < width; ++i) {
+            value = (value << 8) | u[i];
+        }
+    } else {
+        for (size_t i = width; i > 0; --i) {
+            value = (value << 8) | u[i - 1];
+        }
+    }
+    return value;
+}
+
+void LengthFieldCodec::encodeLength(uint64_t len, char* p) const {
+    const size_t width = options_.length_field_width;
+    for (size_t i = 0; i < width; ++i) {
+        unsigned char byte = static_cast<unsigned char>(len >> (8 * i));
+        if (options_.big_endian) {
+            p[width - 1 - i] = static_cast<char>(byte);
+        } else {
+            p[i] = static_cast<char>(byte);
+        }
+    }
+}
+
+} // namespace core
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <functional>
+#include <string_view>
+#include <vector>
+#include "core/net/buffer.h"
+#include "core/net/tcp_connection.h"
+
+namespace core {
+
+// 长度前缀帧编解码器，帧格式为：[prefix(length_field_offset字节)][长度字段][payload]
+// 用法：server.setMessageCallback(std::bind(&LengthFieldCodec::onMessage, &codec, _1, _2, _3))
+// 解码时不拷贝数据，帧以string_view的形式指向输入缓冲区，仅在回调期间有效；
+// 一次读事件中所有完整的帧合并为一次回调，回调返回后统一从缓冲区取出
+class LengthFieldCodec {
+public:
+    struct Options {
+        size_t length_field_offset = 0;      // 长度字段前的字节数（如消息类型）
+        size_t length_field_width = 4;       // 长度字段宽度：1、2、3、4、8，与offset之和不超过16
+        bool big_endian = true;              // 长度字段是否为网络字节序
+        bool length_includes_header = false; // 长度是否包含prefix和长度字段本身
+        size_t max_frame_size = 16 * 1024 * 1024; // payload的最大长度，收到超过的帧视为协议错误，发送时丢弃
+    };
+    
+    struct Frame {
+        std::string_view prefix;   // 长度字段之前的字节
+        std::string_view payload;  // 负载
+    };
+    
+    using FramesCallback = std::function<void(const TcpConnection::TcpConnectionPtr&, const std::vector<Frame>&)>;
+    using ErrorCallback = std::function<void(const TcpConnection::TcpConnectionPtr&, size_t frame_len)>;
+    
+    static const size_t kMaxHeaderLength = 16;  // prefix + 长度字段的最大长度
+    
+    // 选项不合法(长度字段宽度不支持或帧头过长)时LOG_FATAL
+    LengthFieldCodec(const Options& options, FramesCallback cb);
+    
+    // 帧长度超过max_frame_size时回调，默认行为为记录日志并关闭连接
+    void setErrorCallback(const ErrorCallback& cb) { error_callback_ = cb; }
+    
+    // 作为TcpConnection的MessageCallback
+    void onMessage(const TcpConnection::TcpConnectionPtr& conn, Buffer* buf, size_t len);
+    
+    // 发送一帧，帧头写入payload的预留前置空间，不再额外拷贝payload；prefix长度须为length_field_offset。
+    // payload超过max_frame_size或长度字段放不下时记录日志并丢弃，返回false
+    bool send(const TcpConnection::TcpConnectionPtr& conn, Buffer* payload, const void* prefix = nullptr) const;
+    bool send(const TcpConnection::TcpConnectionPtr& conn, std::string_view payload, const void* prefix = nullptr) const;
+    
+    // 帧头（prefix + 长度字段）的长度
+    size_t headerLength() const { return options_.length_field_offset + options_.length_field_width; }
+    
+private:
+    // 读取/写入长度字段
+    uint64_t decodeLength(const char* p) const;
+    void encodeLength(uint64_t len, char* p) const;
+    
+    // payload能否编码为一帧：不超过max_frame_size，且(含帧头的)长度字段放得下
+    bool fits(size_t payload_len) const;
+    
+    // 生成帧头
+    void encodeHeader(size_t payload_len, const void* prefix, char* header) const;
+    
+    const Options options_;
+    FramesCallback frames_callback_;
+    ErrorCallback error_callback_;
+};
+
+} // namespace core
@@ -4,20 +4,20 @@
 #include <string.h>
 #include <netinet/tcp.h>
 
-#include "core/net/inet_address.h"
+#include "core/net/inet_address_format.h"
 #include "core/utils/logger.h"
 namespace core{
 void Socket::bindAddress(const InetAddress& localaddr){
     int ret = ::bind(sockfd_, localaddr.getSockAddr(), static_cast<socklen_t>(sizeof(struct sockaddr_in)));
     if(ret < 0){
-        LOG_FATAL("bind [%s] failed: %s", localaddr.IP_Port(), strerror(errno));
+        LOG_FATAL("bind [{}] failed: {}", localaddr, strerror(errno));
     }
 }
 
 void Socket::listen(){
     int ret = ::listen(sockfd_, SOMAXCONN);
     if (ret < 0) {
-        LOG_FATAL("listen failed: %s", strerror(errno));
+        LOG_FATAL("listen failed: {}", strerror(errno));
     }
 }
 
@@ -31,7 +31,7 @@ int Socket::accept(InetAddress* peeraddr){
     if(connfd > 0){
         peeraddr->setSockAddr(addr);
     }else{
-        LOG_ERROR("Socket::accept failed: %s", strerror(errno));
+        LOG_ERROR("Socket::accept failed: {}", strerror(errno));
     }
 
     return connfd;
@@ -39,7 +39,7 @@ int Socket::accept(InetAddress* peeraddr){
 
 void Socket::shutdownWrite() {
     if (::shutdown(sockfd_, SHUT_WR) < 0) {
-        LOG_ERROR("Socket::shutdownWrite failed: %s", strerror(errno));
+        LOG_ERROR("Socket::shutdownWrite failed: {}", strerror(errno));
     }
 }
 
@@ -48,7 +48,7 @@ void Socket::setTcpNoDelay(bool on) {
     int optval = on ? 1 : 0;
     if (::setsockopt(sockfd_, IPPROTO_TCP, TCP_NODELAY,
                    &optval, static_cast<socklen_t>(sizeof optval)) < 0) {
-        LOG_ERROR("Socket::setTcpNoDelay failed: %s", strerror(errno));
+        LOG_ERROR("Socket::setTcpNoDelay failed: {}", strerror(errno));
     }
 }
 
@@ -57,7 +57,7 @@ void Socket::setReuseAddr(bool on) {
     int optval = on ? 1 : 0;
     if (::setsockopt(sockfd_, SOL_SOCKET, SO_REUSEADDR,
                    &optval, static_cast<socklen_t>(sizeof optval)) < 0) {
-        LOG_ERROR("Socket::setReuseAddr failed: %s", strerror(errno));
+        LOG_ERROR("Socket::setReuseAddr failed: {}", strerror(errno));
     }
 }
 
@@ -67,7 +67,7 @@ void Socket::setReusePort(bool on) {
     int optval = on ? 1 : 0;
     if (::setsockopt(sockfd_, SOL_SOCKET, SO_REUSEPORT,
                    &optval, static_cast<socklen_t>(sizeof optval)) < 0) {
-        LOG_ERROR("Socket::setReusePort failed: %s", strerror(errno));
+        LOG_ERROR("Socket::setReusePort failed: {}", strerror(errno));
     }
 #else
     if (on) {
@@ -81,7 +81,7 @@ void Socket::setKeepAlive(bool on) {
     int optval = on ? 1 : 0;
     if (::setsockopt(sockfd_, SOL_SOCKET, SO_KEEPALIVE,
                    &optval, static_cast<socklen_t>(sizeof optval)) < 0) {
-        LOG_ERROR("Socket::setKeepAlive failed: %s", strerror(errno));
+        LOG_ERROR("Socket::setKeepAlive failed: {}", strerror(errno));
     }
 }
 } // namespace core
\ No newline at end of file
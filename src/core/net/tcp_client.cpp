@@ -0,0 +1,115 @@
+#include "core/net/tcp_client.h"
+
+#include <stdio.h>
+#include <cassert>
+#include "core/net/inet_address_format.h"
+#include "core/reactor/event_loop.h"
+#include "core/utils/logger.h"
+
+namespace core {
+
+TcpClient::TcpClient(EventLoop* loop, const InetAddress& server_addr, const std::string& name,
+                     const Connector::Options& options)
+    : loop_(loop),
+      connector_(std::make_shared<Connector>(loop, server_addr, options)),
+      name_(name),
+      retry_(false),
+      connect_(false),
+      next_conn_id_(1) {
+    connector_->setNewConnectionCallback(
+        std::bind(&TcpClient::newConnection, this, std::placeholders::_1));
+    connector_->setConnectFailedCallback([this]() {
+        if (connect_failed_callback_) {
+            connect_failed_callback_();
+        }
+    });
+    LOG_INFO("TcpClient::TcpClient [{}] - connector {}", name_, server_addr);
+}
+
+TcpClient::~TcpClient() {
+    loop_->assertInLoopThread();
+    LOG_INFO("TcpClient::~TcpClient [{}] destructing", name_);
+
+    // 停止之后Connector不再回调this
+    connector_->stop();
+
+    TcpConnection::TcpConnectionPtr conn = connection();
+    if (conn) {
+        // 连接的关闭晚于TcpClient的析构，关闭回调不能再访问this
+        EventLoop* loop = loop_;
+        conn->setCloseCallback([loop](const TcpConnection::TcpConnectionPtr& c) {
+            loop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, c));
+        });
+        conn->forceClose();
+    }
+}
+
+void TcpClient::connect() {
+    LOG_INFO("TcpClient::connect [{}] - connecting to {}", name_, connector_->serverAddress());
+    connect_ = true;
+    connector_->start();
+}
+
+void TcpClient::disconnect() {
+    connect_ = false;
+    TcpConnection::TcpConnectionPtr conn = connection();
+    if (conn) {
+        conn->shutdown();
+    }
+}
+
+void TcpClient::stop() {
+    connect_ = false;
+    connector_->stop();
+}
+
+TcpConnection::TcpConnectionPtr TcpClient::connection() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return connection_;
+}
+
+void TcpClient::newConnection(int sockfd) {
+    loop_->assertInLoopThread();
+    InetAddress peer_addr = Connector::peerAddress(sockfd);
+    InetAddress local_addr = Connector::localAddress(sockfd);
+
+    // 创建连接名
+    char buf[64];
+    snprintf(buf, sizeof buf, "-%s#%d", peer_addr.IP_Port().c_str(), next_conn_id_);
+    ++next_conn_id_;
+    std::string conn_name = name_ + buf;
+
+    TcpConnection::TcpConnectionPtr conn = std::make_shared<TcpConnection>(
+        loop_, conn_name, sockfd, local_addr, peer_addr);
+
+    // 设置回调函数
+    conn->setConnectionChangeCallback(connection_change_callback_);
+    conn->setMessageCallback(message_callback_);
+    conn->setWriteCompleteCallback(write_complete_callback_);
+    conn->setCloseCallback(
+        std::bind(&TcpClient::removeConnection, this, std::placeholders::_1));
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connection_ = conn;
+    }
+    conn->connectEstablished();
+}
+
+void TcpClient::removeConnection(const TcpConnection::TcpConnectionPtr& conn) {
+    loop_->assertInLoopThread();
+    assert(loop_ == conn->getLoop());
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        assert(connection_ == conn);
+        connection_.reset();
+    }
+
+    // 在本轮事件处理完之后销毁连接
+    loop_->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+    if (retry_ && connect_) {
+        LOG_INFO("TcpClient::removeConnection [{}] - reconnecting to {}", name_, connector_->serverAddress());
+        connector_->restart();
+    }
+}
+
+} // namespace core
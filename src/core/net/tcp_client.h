@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "core/net/connector.h"
+#include "core/net/tcp_connection.h"
+
+namespace core {
+
+class EventLoop;
+
+// TCP客户端类：通过Connector非阻塞地连接到一个服务器，连接成功后创建TcpConnection，
+// 回调和TcpServer一致。enableRetry后连接断开时按Connector的退避策略自动重连。
+// 须在loop线程中析构
+class TcpClient {
+public:
+    TcpClient(EventLoop* loop, const InetAddress& server_addr, const std::string& name,
+              const Connector::Options& options = Connector::Options());
+    ~TcpClient();
+
+    // 禁止拷贝
+    TcpClient(const TcpClient&) = delete;
+    TcpClient& operator=(const TcpClient&) = delete;
+
+    // 开始连接，可在任意线程调用
+    void connect();
+    // 关闭已建立的连接(等待输出写完)，不再重连
+    void disconnect();
+    // 停止正在进行的连接和重试
+    void stop();
+
+    // 当前的连接，未连接时为空；可在任意线程调用
+    TcpConnection::TcpConnectionPtr connection() const;
+
+    EventLoop* getLoop() const { return loop_; }
+    const std::string& name() const { return name_; }
+    bool retry() const { return retry_; }
+    // 连接断开后自动重连
+    void enableRetry() { retry_ = true; }
+
+    void setConnectionChangeCallback(const TcpConnection::ConnectionCallback& cb) { connection_change_callback_ = cb; }
+    void setMessageCallback(const TcpConnection::MessageCallback& cb) { message_callback_ = cb; }
+    void setWriteCompleteCallback(const TcpConnection::WriteCompleteCallback& cb) { write_complete_callback_ = cb; }
+    // 重试次数用完仍未连上时调用(Connector::Options::max_retries不为-1时)
+    void setConnectFailedCallback(const Connector::ConnectFailedCallback& cb) { connect_failed_callback_ = cb; }
+
+private:
+    // Connector连接成功，在loop线程中调用
+    void newConnection(int sockfd);
+    // 连接关闭回调，在loop线程中调用
+    void removeConnection(const TcpConnection::TcpConnectionPtr& conn);
+
+    EventLoop* loop_;
+    std::shared_ptr<Connector> connector_;
+    const std::string name_;
+
+    TcpConnection::ConnectionCallback connection_change_callback_;
+    TcpConnection::MessageCallback message_callback_;
+    TcpConnection::WriteCompleteCallback write_complete_callback_;
+    Connector::ConnectFailedCallback connect_failed_callback_;
+
+    bool retry_;                 // 连接断开后是否重连
+    std::atomic<bool> connect_;  // 是否需要保持连接，disconnect/stop后为false
+    int next_conn_id_;           // 下一个连接ID，用于连接名
+
+    mutable std::mutex mutex_;   // 保护connection_
+    TcpConnection::TcpConnectionPtr connection_;
+};
+
+} // namespace core
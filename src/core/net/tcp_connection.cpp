@@ -2,6 +2,7 @@
 
 #include <errno.h>
 #include <cstring>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
 #include <unistd.h>
 #include "core/net/channel.h"
@@ -20,7 +21,19 @@ TcpConnection::TcpConnection(EventLoop* loop, const std::string& name, int sockf
       channel_(new Channel(loop, sockfd)),
       local_addr_(local_addr),
       peer_addr_(peer_addr),
-      high_water_mark_(64 * 1024 * 1024) {  // 64MB
+      high_water_mark_(64 * 1024 * 1024),  // 64MB
+      auto_cork_(false),
+      cork_pending_(false),
+      close_handled_(false),
+      output_high_mark_(0),
+      output_low_mark_(0),
+      input_high_mark_(0),
+      input_low_mark_(0),
+      read_paused_(false),
+      pause_count_(0),
+      paused_duration_(0),
+      file_preceding_(0),
+      file_bytes_(0) {
     
     // 设置各种回调函数
     channel_->setReadCallback(
@@ -32,12 +45,12 @@ TcpConnection::TcpConnection(EventLoop* loop, const std::string& name, int sockf
     channel_->setErrorCallback(
         std::bind(&TcpConnection::handleError, this));
     
-    LOG_DEBUG("TcpConnection::TcpConnection [%s] fd=%d", name_, sockfd);
+    LOG_DEBUG("TcpConnection::TcpConnection [{}] fd={}", name_, sockfd);
     socket_->setKeepAlive(true);
 }
 
 TcpConnection::~TcpConnection() {
-    LOG_DEBUG("TcpConnection::~TcpConnection [%s] fd=%d state=%d", 
+    LOG_DEBUG("TcpConnection::~TcpConnection [{}] fd={} state={}", 
               name_, channel_->fd(), state_);
     assert(state_ == kDisconnected);
 }
@@ -96,7 +109,7 @@ void TcpConnection::sendInLoop(const void* message, size_t len) {
     loop_->assertInLoopThread();
     
     if (state_ == kDisconnected) {
-        LOG_WARN("TcpConnection::sendInLoop [%s] disconnected, give up writing", name_);
+        LOG_WARN("TcpConnection::sendInLoop [{}] disconnected, give up writing", name_);
         return;
     }
     
@@ -104,8 +117,8 @@ void TcpConnection::sendInLoop(const void* message, size_t len) {
     size_t remaining = len;
     bool faultError = false;
     
-    // 如果没有待写数据，尝试直接发送
-    if (!channel_->isWriting() && output_buffer_.readableBytes() == 0) {
+    // 如果没有待写数据，尝试直接发送；auto-cork模式下留到本轮循环末尾统一发送
+    if (!auto_cork_ && !channel_->isWriting() && outputDrained()) {
         nwrote = ::write(channel_->fd(), message, len);
         if (nwrote >= 0) {
             remaining = len - nwrote;
@@ -117,7 +130,7 @@ void TcpConnection::sendInLoop(const void* message, size_t len) {
         } else {
             nwrote = 0;
             if (errno != EWOULDBLOCK) {
-                LOG_ERROR("TcpConnection::sendInLoop [%s]] error: %s", name_, strerror(errno));
+                LOG_ERROR("TcpConnection::sendInLoop [{}]] error: {}", name_, strerror(errno));
                 if (errno == EPIPE || errno == ECONNRESET) {
                     faultError = true;
                 }
@@ -135,9 +148,261 @@ void TcpConnection::sendInLoop(const void* message, size_t len) {
                 std::bind(high_water_mark_callback_, shared_from_this(), oldLen + remaining));
         }
         output_buffer_.append(static_cast<const char*>(message) + nwrote, remaining);
+        if (channel_->isWriting()) {
+            // 已在等待可写事件，由handleWrite继续发送
+        } else if (auto_cork_) {
+            // 每轮循环只登记一次刷出
+            if (!cork_pending_) {
+                cork_pending_ = true;
+                loop_->queueAfterEvents(
+                    std::bind(&TcpConnection::flushCorkedInLoop, shared_from_this()));
+            }
+        } else {
+            channel_->enableWriting();
+        }
+        updateFlowControl();
+    }
+}
+
+void TcpConnection::sendFile(int fd, off_t offset, size_t len, std::shared_ptr<void> holder) {
+    if (state_ == kConnected) {
+        if (loop_->isInLoopThread()) {
+            sendFileInLoop(fd, offset, len, std::move(holder));
+        } else {
+            loop_->runInLoop([self = shared_from_this(), fd, offset, len, holder]() {
+                self->sendFileInLoop(fd, offset, len, holder);
+            });
+        }
+    }
+}
+
+void TcpConnection::sendShared(const void* data, size_t len, std::shared_ptr<const void> holder) {
+    if (state_ == kConnected) {
+        if (loop_->isInLoopThread()) {
+            sendSharedInLoop(data, len, std::move(holder));
+        } else {
+            loop_->runInLoop([self = shared_from_this(), data, len, holder]() {
+                self->sendSharedInLoop(data, len, holder);
+            });
+        }
+    }
+}
+
+void TcpConnection::sendFileInLoop(int fd, off_t offset, size_t len, std::shared_ptr<void> holder) {
+    loop_->assertInLoopThread();
+    
+    if (state_ == kDisconnected) {
+        LOG_WARN("TcpConnection::sendFileInLoop [{}] disconnected, give up writing", name_);
+        return;
+    }
+    queueSegmentInLoop(FileSegment{fd, nullptr, offset, len, 0, std::move(holder)});
+}
+
+void TcpConnection::sendSharedInLoop(const void* data, size_t len, std::shared_ptr<const void> holder) {
+    loop_->assertInLoopThread();
+    
+    if (state_ == kDisconnected) {
+        LOG_WARN("TcpConnection::sendSharedInLoop [{}] disconnected, give up writing", name_);
+        return;
+    }
+    // 输出为空时writePending直接从data写socket，写不完的部分留在队列中，都不拷贝
+    queueSegmentInLoop(FileSegment{-1, static_cast<const char*>(data), 0, len, 0, std::move(holder)});
+}
+
+void TcpConnection::queueSegmentInLoop(FileSegment segment) {
+    if (segment.remaining == 0) {
+        return;
+    }
+    
+    // 输出缓冲区中已有的数据都要先于这一段发出
+    size_t buffered = output_buffer_.readableBytes();
+    segment.preceding = buffered - file_preceding_;
+    file_preceding_ = buffered;
+    file_bytes_ += segment.remaining;
+    file_queue_.push_back(std::move(segment));
+    
+    if (channel_->isWriting()) {
+        // 已在等待可写事件，由handleWrite继续发送
+    } else if (auto_cork_) {
+        if (!cork_pending_) {
+            cork_pending_ = true;
+            loop_->queueAfterEvents(
+                std::bind(&TcpConnection::flushCorkedInLoop, shared_from_this()));
+        }
+    } else {
+        writeOutputInLoop();
+    }
+}
+
+// 在循环末尾将本轮累积的输出一次性写出，未写完的部分交给handleWrite
+void TcpConnection::flushCorkedInLoop() {
+    loop_->assertInLoopThread();
+    cork_pending_ = false;
+    
+    if (state_ == kDisconnected || channel_->isWriting() || outputDrained()) {
+        return;
+    }
+    writeOutputInLoop();
+}
+
+void TcpConnection::writeOutputInLoop() {
+    bool ok = writePending();
+    updateFlowControl();
+    if (!ok) {
+        return;
+    }
+    
+    if (!outputDrained()) {
         if (!channel_->isWriting()) {
             channel_->enableWriting();
         }
+        return;
+    }
+    
+    // 已经发送完毕，取消关注可写事件
+    if (channel_->isWriting()) {
+        channel_->disableWriting();
+    }
+    if (write_complete_callback_) {
+        loop_->queueInLoop(
+            std::bind(write_complete_callback_, shared_from_this()));
+    }
+    // 如果正在关闭，则关闭写端
+    if (state_ == kDisconnecting) {
+        shutdownInLoop();
+    }
+}
+
+bool TcpConnection::writePending() {
+    for (;;) {
+        // 轮到队首的段时，文件段用sendfile发送，共享内存段直接write
+        if (!file_queue_.empty() && file_queue_.front().preceding == 0) {
+            FileSegment& segment = file_queue_.front();
+            ssize_t n;
+            if (segment.data) {
+                n = ::write(channel_->fd(), segment.data + segment.offset, segment.remaining);
+                if (n > 0) {
+                    segment.offset += n;
+                }
+            } else {
+                n = ::sendfile(channel_->fd(), segment.fd, &segment.offset, segment.remaining);
+            }
+            if (n > 0) {
+                segment.remaining -= n;
+                file_bytes_ -= n;
+                if (segment.remaining == 0) {
+                    file_queue_.pop_front();
+                }
+                continue;
+            }
+            if (n < 0 && (errno == EWOULDBLOCK || errno == EINTR)) {
+                return true;
+            }
+            if (segment.data) {
+                LOG_ERROR("TcpConnection::writePending [{}] error: {}", name_, strerror(errno));
+                return false;
+            }
+            
+            // 文件在发送期间被截断(n == 0)或读取失败，已声明的长度无法兑现，
+            // 丢弃剩余输出并关闭写端，让对端感知到响应不完整
+            LOG_ERROR("TcpConnection::writePending [{}] sendfile fd={} failed: {}",
+                      name_, segment.fd, n == 0 ? "unexpected end of file" : strerror(errno));
+            file_queue_.clear();
+            file_preceding_ = 0;
+            file_bytes_ = 0;
+            output_buffer_.retrieveAll();
+            if (channel_->isWriting()) {
+                channel_->disableWriting();
+            }
+            socket_->shutdownWrite();
+            return false;
+        }
+        
+        // 否则写出输出缓冲区，有文件段在排队时只写到文件段之前
+        size_t bytes = file_queue_.empty() ? output_buffer_.readableBytes() : file_queue_.front().preceding;
+        if (bytes == 0) {
+            return true;
+        }
+        ssize_t n = ::write(channel_->fd(), output_buffer_.peek(), bytes);
+        if (n > 0) {
+            output_buffer_.retrieve(n);
+            if (!file_queue_.empty()) {
+                file_queue_.front().preceding -= n;
+                file_preceding_ -= n;
+            }
+            if (static_cast<size_t>(n) < bytes) {
+                // socket发送缓冲区已满
+                return true;
+            }
+            continue;
+        }
+        if (n < 0 && (errno == EWOULDBLOCK || errno == EINTR)) {
+            return true;
+        }
+        LOG_ERROR("TcpConnection::writePending [{}] error: {}", name_, strerror(errno));
+        return false;
+    }
+}
+
+void TcpConnection::setOutputWatermarks(size_t high, size_t low) {
+    assert(high == 0 || low < high);
+    output_high_mark_ = high;
+    output_low_mark_ = low;
+}
+
+void TcpConnection::setInputWatermarks(size_t high, size_t low) {
+    assert(high == 0 || low < high);
+    input_high_mark_ = high;
+    input_low_mark_ = low;
+}
+
+void TcpConnection::refreshFlowControl() {
+    if (loop_->isInLoopThread()) {
+        updateFlowControl();
+    } else {
+        loop_->queueInLoop(
+            std::bind(&TcpConnection::updateFlowControl, shared_from_this()));
+    }
+}
+
+std::chrono::steady_clock::duration TcpConnection::pausedDuration() const {
+    if (read_paused_) {
+        return paused_duration_ + (std::chrono::steady_clock::now() - pause_start_);
+    }
+    return paused_duration_;
+}
+
+// 任一缓冲区达到高水位则暂停读，所有缓冲区都降到低水位以下才恢复，避免在水位附近来回抖动
+void TcpConnection::updateFlowControl() {
+    loop_->assertInLoopThread();
+    if (state_ != kConnected && state_ != kDisconnecting) {
+        return;
+    }
+    
+    size_t out = output_buffer_.readableBytes();
+    size_t in = input_buffer_.readableBytes();
+    
+    if (!read_paused_) {
+        bool over = (output_high_mark_ > 0 && out >= output_high_mark_)
+                 || (input_high_mark_ > 0 && in >= input_high_mark_);
+        if (over) {
+            read_paused_ = true;
+            ++pause_count_;
+            pause_start_ = std::chrono::steady_clock::now();
+            channel_->disableReading();
+            LOG_DEBUG("TcpConnection::updateFlowControl [{}] pause reading, output = {}, input = {}",
+                      name_, out, in);
+        }
+    } else {
+        bool under = (output_high_mark_ == 0 || out <= output_low_mark_)
+                  && (input_high_mark_ == 0 || in <= input_low_mark_);
+        if (under) {
+            read_paused_ = false;
+            paused_duration_ += std::chrono::steady_clock::now() - pause_start_;
+            channel_->enableReading();
+            LOG_DEBUG("TcpConnection::updateFlowControl [{}] resume reading, output = {}, input = {}",
+                      name_, out, in);
+        }
     }
 }
 
@@ -152,11 +417,28 @@ void TcpConnection::shutdown() {
 
 void TcpConnection::shutdownInLoop() {
     loop_->assertInLoopThread();
-    if (!channel_->isWriting()) {
+    // 还有数据等待写出时不关闭，由handleWrite/flushCorkedInLoop写完后再关闭
+    if (!channel_->isWriting() && !cork_pending_) {
         socket_->shutdownWrite();
     }
 }
 
+void TcpConnection::forceClose() {
+    if (state_ == kConnected || state_ == kDisconnecting) {
+        setState(kDisconnecting);
+        loop_->queueInLoop(
+            std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
+    }
+}
+
+void TcpConnection::forceCloseInLoop() {
+    loop_->assertInLoopThread();
+    // 排队期间对端可能已经关闭
+    if ((state_ == kConnected || state_ == kDisconnecting) && !close_handled_) {
+        handleClose();
+    }
+}
+
 void TcpConnection::setTcpNoDelay(bool on) {
     socket_->setTcpNoDelay(on);
 }
@@ -178,7 +460,8 @@ void TcpConnection::connectEstablished() {
 
 void TcpConnection::connectDestroyed() {
     loop_->assertInLoopThread();
-    if (state_ == kConnected) {
+    // shutdown()之后状态为kDisconnecting，同样需要置为kDisconnected
+    if (state_ == kConnected || state_ == kDisconnecting) {
         setState(kDisconnected);
         channel_->disableAll();
         
@@ -187,6 +470,11 @@ void TcpConnection::connectDestroyed() {
         }
     }
     
+    // 释放未发完的文件段持有的资源
+    file_queue_.clear();
+    file_preceding_ = 0;
+    file_bytes_ = 0;
+    
     channel_->remove();
 }
 
@@ -201,13 +489,15 @@ void TcpConnection::handleRead() {
         if (message_callback_) {
             message_callback_(shared_from_this(), &input_buffer_, n);
         }
+        // 回调未消费完的数据留在输入缓冲区，超过高水位则暂停读
+        updateFlowControl();
     } else if (n == 0) {
         // 对端关闭连接
         handleClose();
     } else {
         // 出错
         errno = savedErrno;
-        LOG_ERROR("TcpConnection::handleRead [%s] error: %s", name_, strerror(errno));
+        LOG_ERROR("TcpConnection::handleRead [{}] error: {}", name_, strerror(errno));
         handleError();
     }
 }
@@ -216,42 +506,19 @@ void TcpConnection::handleWrite() {
     loop_->assertInLoopThread();
     
     if (channel_->isWriting()) {
-        ssize_t n = ::write(channel_->fd(),
-                           output_buffer_.peek(),
-                           output_buffer_.readableBytes());
-        
-        if (n > 0) {
-            output_buffer_.retrieve(n);
-            
-            // 如果已经发送完毕，取消关注可写事件
-            if (output_buffer_.readableBytes() == 0) {
-                channel_->disableWriting();
-                
-                // 回调写完成回调
-                if (write_complete_callback_) {
-                    loop_->queueInLoop(
-                        std::bind(write_complete_callback_, shared_from_this()));
-                }
-                
-                // 如果正在关闭，则关闭写端
-                if (state_ == kDisconnecting) {
-                    shutdownInLoop();
-                }
-            }
-        } else {
-            LOG_ERROR("TcpConnection::handleWrite [%s] error: %s", name_, strerror(errno));
-        }
+        writeOutputInLoop();
     } else {
-        LOG_TRACE("TcpConnection::handleWrite [%s] is down, no more writing", name_);
+        LOG_TRACE("TcpConnection::handleWrite [{}] is down, no more writing", name_);
     }
 }
 
 void TcpConnection::handleClose() {
     loop_->assertInLoopThread();
     
-    LOG_TRACE("TcpConnection::handleClose [%s] state = %d", name_, state_);
+    LOG_TRACE("TcpConnection::handleClose [{}] state = {}", name_, state_);
     
     assert(state_ == kConnected || state_ == kDisconnecting);
+    close_handled_ = true;
     
     // 关闭所有事件
     channel_->disableAll();
@@ -270,7 +537,7 @@ void TcpConnection::handleError() {
     if (::getsockopt(channel_->fd(), SOL_SOCKET, SO_ERROR, &err, &len) < 0) {
         err = errno;
     }
-    LOG_ERROR("TcpConnection::handleError [%s] - SO_ERROR = %s", name_, strerror(err));
+    LOG_ERROR("TcpConnection::handleError [{}] - SO_ERROR = {}", name_, strerror(err));
 }
 
 } // namespace core
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <chrono>
+#include <deque>
 #include <memory>
 #include <string>
 #include <functional>
+#include <sys/types.h>
 #include <boost/any.hpp>
 #include "core/net/buffer.h"
 #include "core/net/inet_address.h"
@@ -44,6 +47,18 @@ public:
     void send(const std::string& message);
     void send(const void* message, size_t len);
     void send(Buffer* message);
+    
+    // 用sendfile零拷贝发送文件fd中[offset, offset + len)的内容，与send()的数据保持调用顺序；
+    // fd由调用方管理，holder在这段内容发送完毕(或连接断开)前保持存活，通常是fd的所有者
+    void sendFile(int fd, off_t offset, size_t len, std::shared_ptr<void> holder = nullptr);
+    // 发送多个连接共享的一段内存(如广播的WebSocket帧)，与send()的数据保持调用顺序；
+    // 内容不拷贝进输出缓冲区，发不完时排队的也只是引用，holder在发送完毕(或连接断开)前保持data存活
+    void sendShared(const void* data, size_t len, std::shared_ptr<const void> holder);
+
+    // 输入/输出缓冲区，仅在loop线程中访问
+    Buffer* inputBuffer() { return &input_buffer_; }
+    // 尚未发出的字节数，包括等待sendfile的文件内容和排队的共享内存
+    size_t outputBytes() const { return output_buffer_.readableBytes() + file_bytes_; }
 
     // contex_相关
     void setContext(const boost::any& context) { context_ = context; }
@@ -52,10 +67,17 @@ public:
 
     // 关闭连接
     void shutdown();
+    // 不等待输出写完，立即关闭连接
+    void forceClose();
     
     // 设置TCP选项
     void setTcpNoDelay(bool on);
     
+    // 自动合并写(auto-cork)：开启后同一轮循环内的多次send只追加到输出缓冲区，
+    // 在循环末尾用一次write统一发出，减少系统调用和小包数量
+    void setAutoCork(bool on) { auto_cork_ = on; }
+    bool autoCork() const { return auto_cork_; }
+    
     // 设置回调函数
     void setConnectionChangeCallback(const ConnectionCallback& cb) { connection_change_callback_ = cb; }
     void setMessageCallback(const MessageCallback& cb) { message_callback_ = cb; }
@@ -66,6 +88,18 @@ public:
         high_water_mark_ = high_water_mark;
     }
     
+    // 流控：输出或输入缓冲区的可读字节数达到高水位时暂停读，全部降到低水位以下后恢复读
+    // high为0表示该缓冲区不参与流控（默认）
+    void setOutputWatermarks(size_t high, size_t low);
+    void setInputWatermarks(size_t high, size_t low);
+    // 在MessageCallback之外消费了输入缓冲区后调用，重新检查是否可以恢复读
+    void refreshFlowControl();
+    
+    // 流控统计，需在loop线程中读取
+    bool readingPaused() const { return read_paused_; }
+    uint64_t pauseCount() const { return pause_count_; }
+    std::chrono::steady_clock::duration pausedDuration() const;  // 累计暂停读的时间（含当前这次）
+    
     // 连接建立
     void connectEstablished();
     
@@ -83,6 +117,17 @@ private:
     void sendInLoop(const std::string& message);
     void sendInLoop(const void* message, size_t len);
     void shutdownInLoop();
+    void forceCloseInLoop();
+    void sendFileInLoop(int fd, off_t offset, size_t len, std::shared_ptr<void> holder);
+    void sendSharedInLoop(const void* data, size_t len, std::shared_ptr<const void> holder);
+    struct FileSegment;
+    // 把文件段或共享内存段排在已有输出之后，并按需写出
+    void queueSegmentInLoop(FileSegment segment);
+    void flushCorkedInLoop();
+    void writeOutputInLoop();  // 写出积压的输出，并根据结果调整可写事件
+    bool writePending();       // 按顺序写出输出缓冲区、文件段和共享内存段直到写满，出错返回false
+    bool outputDrained() const { return output_buffer_.readableBytes() == 0 && file_queue_.empty(); }
+    void updateFlowControl();  // 根据水位暂停/恢复读
     
     EventLoop* loop_;   // 所属的事件循环
     const std::string name_;   // 连接名
@@ -100,9 +145,36 @@ private:
     CloseCallback close_callback_;                   // 对端关闭回调
     HighWaterMarkCallback high_water_mark_callback_; // 高水位回调
     size_t high_water_mark_;                         // 高水位标记
+    bool auto_cork_;                                 // 是否开启自动合并写
+    bool cork_pending_;                              // 是否已登记本轮循环末尾的刷出
+    bool close_handled_;                             // handleClose是否已执行，避免forceClose重复关闭
+    
+    // 流控
+    size_t output_high_mark_;   // 输出缓冲区高水位，0表示不限制
+    size_t output_low_mark_;    // 输出缓冲区低水位
+    size_t input_high_mark_;    // 输入缓冲区高水位，0表示不限制
+    size_t input_low_mark_;     // 输入缓冲区低水位
+    bool read_paused_;          // 是否因流控暂停了读
+    uint64_t pause_count_;      // 暂停次数
+    std::chrono::steady_clock::time_point pause_start_;  // 本次暂停开始时间
+    std::chrono::steady_clock::duration paused_duration_; // 已结束的暂停累计时间
     
     Buffer input_buffer_;   // 输入缓冲区
     Buffer output_buffer_;  // 输出缓冲区
+    
+    // 不经过输出缓冲区的段：等待sendfile的文件段，或data非空时为共享内存段。
+    // 它们与输出缓冲区中的数据交错排列，preceding记录在它之前必须先写出的输出缓冲区字节数（相对上一个段）
+    struct FileSegment {
+        int fd;
+        const char* data;   // 共享内存段的内容，从data + offset开始；文件段为nullptr
+        off_t offset;
+        size_t remaining;
+        size_t preceding;
+        std::shared_ptr<const void> holder;
+    };
+    std::deque<FileSegment> file_queue_;
+    size_t file_preceding_;  // 队列中所有preceding之和
+    size_t file_bytes_;      // 队列中尚未发出的字节数
 
     boost::any context_; // 用于http
 };
@@ -3,7 +3,7 @@
 #include <stdio.h>
 #include <cstring>
 #include "core/net/acceptor.h"
-#include "core/net/inet_address.h"
+#include "core/net/inet_address_format.h"
 #include "core/net/socket.h"
 #include "core/thread/eventloop_thread_pool.h"
 #include "core/reactor/event_loop.h"
@@ -72,8 +72,8 @@ void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr) {
     ++next_conn_id_;
     std::string connName = name_ + buf;
     
-    LOG_INFO("TcpServer::newConnection [%s] - new connection [%s] from {%s}", 
-             name_, connName, peerAddr.IP_Port());
+    LOG_INFO("TcpServer::newConnection [{}] - new connection [{}] from {}", 
+             name_, connName, peerAddr);
     
     // 获取本地地址
     InetAddress localAddr;
@@ -83,7 +83,7 @@ void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr) {
     // getsockname:获取一个已建立连接的套接字的本地地址信息
     // getpeername:获取一个已建立连接的套接字的对端地址信息
     if (::getsockname(sockfd, (struct sockaddr*)&addr, &addrlen) < 0) {
-        LOG_ERROR("TcpServer::newConnection - getsockname failed: {%s}", strerror(errno));
+        LOG_ERROR("TcpServer::newConnection - getsockname failed: {}", strerror(errno));
     }
     localAddr.setSockAddr(addr);
     
@@ -116,7 +116,7 @@ void TcpServer::removeConnection(const TcpConnection::TcpConnectionPtr& conn) {
 void TcpServer::removeConnectionInLoop(const TcpConnection::TcpConnectionPtr& conn) {
     loop_->assertInLoopThread();
     
-    LOG_INFO("TcpServer::removeConnectionInLoop [%s] - connection %s", 
+    LOG_INFO("TcpServer::removeConnectionInLoop [{}] - connection {}", 
              name_, conn->name());
     
     // 从TcpServer的连接映射中移除
@@ -15,7 +15,7 @@ EPollPoller::EPollPoller(EventLoop* loop)
     :Poller(loop), epoll_fd_(epoll_create1(EPOLL_CLOEXEC)),
      ep_events_(kInitEventListSize){
     if(epoll_fd_ < 0){
-        LOG_FATAL("epoll_create error: %s", strerror(errno));
+        LOG_FATAL("epoll_create error: {}", strerror(errno));
     }
 }
 
@@ -25,7 +25,7 @@ EPollPoller::~EPollPoller(){
 
 // 调用epoll_wait获取就绪io，返回就绪io数量
 int EPollPoller::poll(int timeout_ms, std::vector<Channel*>& active_channels){
-    LOG_TRACE("poll fd total count: %d", channels_.size());
+    LOG_TRACE("poll fd total count: {}", channels_.size());
 
     // 笔记：.data()返回指向vector内部数组的裸指针T*。适用于需要传递原始指针的 C 接口或高性能场景（如 memcpy、epoll_wait 等）
     // 笔记：static_cast编译时完成类型转换，不进行检查；dynamic_cast运行时检查。向下转型推荐dynamic_cast
@@ -33,7 +33,7 @@ int EPollPoller::poll(int timeout_ms, std::vector<Channel*>& active_channels){
     int saved_errno = errno;
 
     if(num_events > 0){
-        LOG_TRACE("poll %d events happened", num_events);
+        LOG_TRACE("poll {} events happened", num_events);
         for (int i = 0; i < num_events; ++i) {
             Channel* channel = static_cast<Channel*>(ep_events_[i].data.ptr);
             channel->set_revents(ep_events_[i].events);
@@ -60,7 +60,7 @@ int EPollPoller::poll(int timeout_ms, std::vector<Channel*>& active_channels){
 // 更新channel或添加channel到Poller
 void EPollPoller::updateChannel(Channel* channel){
     const int status = channel->status();
-    LOG_TRACE("update channel{fd = %d, events = %d, status = %d}", channel->fd(), channel->events(), status);
+    LOG_TRACE("update channel fd = {}, events = {}, status = {}", channel->fd(), channel->events(), status);
     
     if(status == NEW_POLLER || status == DELETED_POLLER){
         int fd = channel->fd();
@@ -84,7 +84,7 @@ void EPollPoller::updateChannel(Channel* channel){
 // 停止监听channel，并从Poller中移除该channel
 void EPollPoller::removeChannel(Channel* channel){
     int fd = channel->fd();
-    LOG_TRACE("delete channel{fd = %d", fd);
+    LOG_TRACE("delete channel fd = {}", fd);
 
     int status = channel->status();
     size_t n = channels_.erase(fd);
@@ -106,16 +106,16 @@ void EPollPoller::update(int operation, Channel* channel){
     ep_event.events = channel->events();
     ep_event.data.ptr = channel;
 
-    LOG_TRACE("EPollPoller::update operation = %s, fd = %s, events = %d",
+    LOG_TRACE("EPollPoller::update operation = {}, fd = {}, events = {}",
               operation == EPOLL_CTL_ADD ? "ADD" : 
               operation == EPOLL_CTL_DEL ? "DEL" : "MOD",
               fd, channel->events());
     
     if (epoll_ctl(epoll_fd_, operation, fd, &ep_event) < 0) {
         if (operation == EPOLL_CTL_DEL) {
-            LOG_ERROR("epoll_ctl del error: fd = %d, %s", fd, strerror(errno));
+            LOG_ERROR("epoll_ctl del error: fd = {}, {}", fd, strerror(errno));
         } else {
-            LOG_FATAL("epoll_ctl add/mod error: fd = %d, %s", fd, strerror(errno));
+            LOG_FATAL("epoll_ctl add/mod error: fd = {}, {}", fd, strerror(errno));
         }
     }
 }
@@ -30,13 +30,13 @@ static int createEventfd() {
     return evfd;
 }
 EventLoop::EventLoop()
-    :looping_(false), quit_(false), calling_pending_functors_(false),
+    :looping_(false), quit_(false), calling_pending_functors_(false), calling_after_event_functors_(false),
     thread_id_(std::this_thread::get_id()),
     poller_(Poller::newDefaultPoller(this)),
     wakeup_fd_(createEventfd()),
     wakeup_channel_(new Channel(this, wakeup_fd_)),
     timer_manager_(this){
-    LOG_DEBUG("EventLoop created in thread %d", thread_id_);
+    LOG_DEBUG("EventLoop created in thread {}", thread_id_);
 
     // 事件发生时，通过向evfd write来唤醒EventLoop进行处理
     wakeup_channel_->setReadCallback(std::bind(&EventLoop::handleWakeup, this));
@@ -47,7 +47,7 @@ EventLoop::~EventLoop(){
     wakeup_channel_->disableAll();
     wakeup_channel_->remove();
     ::close(wakeup_fd_);
-    LOG_DEBUG("EventLoop in thread %d destroyed", std::this_thread::get_id());
+    LOG_DEBUG("EventLoop in thread {} destroyed", std::this_thread::get_id());
 }
 
 // 执行循环
@@ -58,7 +58,7 @@ void EventLoop::loop(){
     looping_ = true;
     quit_ = false;
     
-    LOG_INFO("EventLoop in thread %d start looping", std::this_thread::get_id());
+    LOG_INFO("EventLoop in thread {} start looping", std::this_thread::get_id());
 
     while(!quit_){
         active_channels_.clear();
@@ -73,6 +73,8 @@ void EventLoop::loop(){
         timer_manager_.processTimers();
         // 处理来自其它线程的函数
         doPendingFunctors();
+        // 本轮产生的所有写操作在此统一刷出（auto-cork）
+        doAfterEventFunctors();
     }
 
     looping_ = false;
@@ -95,6 +97,23 @@ void EventLoop::doPendingFunctors(){
     calling_pending_functors_ = false;
 }
 
+void EventLoop::doAfterEventFunctors(){
+    // 回调中可能再次调用queueAfterEvents，先交换出来，新加入的留到下一轮
+    std::vector<Functor> functors;
+    functors.swap(after_event_functors_);
+    calling_after_event_functors_ = true;
+
+    for(const Functor& functor: functors){
+        functor();
+    }
+
+    calling_after_event_functors_ = false;
+    // 留到下一轮的函数(如写完成回调中又发送了数据)不能等poll超时，唤醒下一轮的poll立即返回
+    if(!after_event_functors_.empty()){
+        wakeup();
+    }
+}
+
 void EventLoop::quit(){
     quit_ = true;
 
@@ -118,17 +137,23 @@ void EventLoop::queueInLoop(Functor cb){
         pending_functors_.push_back(std::move(cb));
     }
 
-    if(!isInLoopThread() || calling_pending_functors_){
+    // 本轮的doPendingFunctors已经执行过(正在执行或处于本轮末尾)时，需要唤醒，否则要等到poll超时
+    if(!isInLoopThread() || calling_pending_functors_ || calling_after_event_functors_){
         wakeup();
     }
 }
 
+void EventLoop::queueAfterEvents(Functor cb){
+    assertInLoopThread();
+    after_event_functors_.push_back(std::move(cb));
+}
+
 // 向wakeup_fd写入内容，以触发对应的channel事件，达到唤醒线程的目的
 void EventLoop::wakeup(){
-    uint16_t one = 1;
+    uint64_t one = 1; // eventfd要求读写8字节
     ssize_t n = ::write(wakeup_fd_, &one, sizeof(one));
     if(n != sizeof(one)){
-        LOG_ERROR("EventLoop::wakeup() writes %d bytes instead of 8", n);
+        LOG_ERROR("EventLoop::wakeup() writes {} bytes instead of 8", n);
     }
 }
 
@@ -24,6 +24,7 @@ public:
 
     void runInLoop(Functor cb);   // 在当前循环中执行函数cb
     void queueInLoop(Functor cb); // cb放入pending_functors_队列
+    void queueAfterEvents(Functor cb); // cb在本轮循环末尾执行，仅限loop线程调用，用于合并写操作
 
     void wakeup(); 
 
@@ -39,10 +40,12 @@ private:
     void handleWakeup();  // 处理唤醒
 
     void doPendingFunctors(); // 执行待处理函数
+    void doAfterEventFunctors(); // 执行本轮循环末尾的函数
 
     std::atomic<bool> looping_;        // 是否正在循环，仅用于保证loop()函数不会被重复调用
     std::atomic<bool> quit_;           // 是否退出循环，Opt:添加mutex,否则EventLoop析构的时候可能正在loop循环中
     std::atomic<bool> calling_pending_functors_; // 是否正在处理functor
+    bool calling_after_event_functors_; // 是否正在执行本轮末尾的函数，只在loop线程访问
 
     const std::thread::id thread_id_;  // 所属线程id
     std::unique_ptr<Poller> poller_;   
@@ -52,6 +55,7 @@ private:
 
     std::mutex mutex_; // 对pending_functors的互斥锁
     std::vector<Functor> pending_functors_; // 待处理的函数
+    std::vector<Functor> after_event_functors_; // 本轮循环末尾执行的函数，只在loop线程访问，无需加锁
 
     TimerManager timer_manager_; // 定时器管理器，包含一组定时器
 }; // class EventLoop
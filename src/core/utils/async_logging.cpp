@@ -0,0 +1,154 @@
+#include "core/utils/async_logging.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include "core/utils/logger.h"
+
+namespace core {
+
+AsyncLogging::AsyncLogging(OutputCallback output, FlushCallback flush, const Options& options)
+    : output_(std::move(output)),
+      flush_(std::move(flush)),
+      options_(options),
+      current_(new LogBuffer(options.buffer_size)),
+      next_(new LogBuffer(options.buffer_size)),
+      flush_requested_(0),
+      flush_done_(0),
+      running_(false),
+      dropped_(0),
+      dropped_reported_(0) {
+    buffers_.reserve(options_.max_buffers);
+}
+
+AsyncLogging::~AsyncLogging() {
+    stop();
+}
+
+void AsyncLogging::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    thread_ = std::thread(&AsyncLogging::threadFunc, this);
+}
+
+void AsyncLogging::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+        cond_.notify_one();
+    }
+    thread_.join();
+}
+
+void AsyncLogging::append(const char* data, size_t len) {
+    len = std::min(len, options_.buffer_size);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (current_->avail() >= len) {
+        memcpy(current_->data.get() + current_->size, data, len);
+        current_->size += len;
+        return;
+    }
+
+    // 当前缓冲区已满，交给后台线程
+    if (buffers_.size() >= options_.max_buffers) {
+        // 输出跟不上，丢弃而不是无限占用内存或阻塞IO线程
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffers_.push_back(std::move(current_));
+    if (next_) {
+        current_ = std::move(next_);
+    } else {
+        // 备用缓冲区也用完了(写得太快)，临时再分配一块
+        current_.reset(new LogBuffer(options_.buffer_size));
+    }
+    memcpy(current_->data.get(), data, len);
+    current_->size = len;
+    cond_.notify_one();
+}
+
+void AsyncLogging::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!running_) {
+        return;
+    }
+    uint64_t seq = ++flush_requested_;
+    cond_.notify_one();
+    flushed_cond_.wait(lock, [this, seq]() { return flush_done_ >= seq || !running_; });
+}
+
+void AsyncLogging::threadFunc() {
+    // 后台线程的两块空缓冲区，和前端交换
+    BufferPtr spare1(new LogBuffer(options_.buffer_size));
+    BufferPtr spare2(new LogBuffer(options_.buffer_size));
+    std::vector<BufferPtr> to_write;
+    to_write.reserve(options_.max_buffers + 1);
+
+    bool running = true;
+    while (running) {
+        uint64_t flush_seq;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (buffers_.empty() && running_ && flush_requested_ == flush_done_) {
+                cond_.wait_for(lock, options_.flush_interval);
+            }
+            // 当前缓冲区即使没写满也一并取走
+            buffers_.push_back(std::move(current_));
+            current_ = std::move(spare1);
+            to_write.swap(buffers_);
+            if (!next_) {
+                next_ = std::move(spare2);
+            }
+            flush_seq = flush_requested_;
+            running = running_;
+        }
+
+        uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+        if (dropped != dropped_reported_) {
+            char now[kLogTimeLength];
+            formatLogTime(std::chrono::system_clock::now(), now);
+            char line[128];
+            int n = snprintf(line, sizeof(line), "[%.*s] [WARN] AsyncLogging - dropped %llu log records\n",
+                             static_cast<int>(kLogTimeLength), now,
+                             static_cast<unsigned long long>(dropped - dropped_reported_));
+            output_(line, static_cast<size_t>(n));
+            dropped_reported_ = dropped;
+        }
+        for (const BufferPtr& buffer : to_write) {
+            if (buffer->size > 0) {
+                output_(buffer->data.get(), buffer->size);
+            }
+        }
+        flush_();
+
+        // 留下两块缓冲区作为下一轮的备用，多出来的(临时分配的)释放
+        if (to_write.size() > 2) {
+            to_write.resize(2);
+        }
+        if (!spare1) {
+            spare1 = std::move(to_write.back());
+            to_write.pop_back();
+            spare1->size = 0;
+        }
+        if (!spare2 && !to_write.empty()) {
+            spare2 = std::move(to_write.back());
+            to_write.pop_back();
+            spare2->size = 0;
+        }
+        to_write.clear();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            flush_done_ = flush_seq;
+            flushed_cond_.notify_all();
+        }
+    }
+}
+
+} // namespace core
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace core {
+
+// 异步日志后端(双缓冲)：
+// 前端线程把格式化好的日志追加到当前缓冲区，加锁期间只做一次memcpy；当前缓冲区写满时换上备用的一块，
+// 写满的缓冲区交给后台线程。后台线程在有缓冲区写满或到达刷新间隔时醒来，用自己的两块空缓冲区换走
+// 前端的全部数据，在锁外成批写出，一次系统调用写几MB，而不是每行一次。
+// 积压的缓冲区达到上限(输出跟不上)时丢弃新日志并计数，后台线程写出时报告丢弃的条数
+class AsyncLogging {
+public:
+    // 在后台线程中调用：写出一段数据、刷新输出
+    using OutputCallback = std::function<void(const char* data, size_t len)>;
+    using FlushCallback = std::function<void()>;
+
+    struct Options {
+        size_t buffer_size = 4 * 1024 * 1024;   // 每块缓冲区的大小，超过它的单条日志被截断
+        size_t max_buffers = 16;                // 等待写出的缓冲区上限，达到后丢弃新日志
+        std::chrono::milliseconds flush_interval = std::chrono::seconds(1);  // 缓冲区未满时最长多久写出一次
+    };
+
+    AsyncLogging(OutputCallback output, FlushCallback flush, const Options& options);
+    ~AsyncLogging();
+
+    AsyncLogging(const AsyncLogging&) = delete;
+    AsyncLogging& operator=(const AsyncLogging&) = delete;
+
+    void start();
+    // 写出剩余的日志并结束后台线程
+    void stop();
+
+    // 任意线程：追加一条日志
+    void append(const char* data, size_t len);
+    // 任意线程：阻塞到此前追加的日志全部写出并刷新，用于FATAL退出之前
+    void flush();
+
+    // 累计丢弃的日志条数
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    // 固定大小的缓冲区
+    struct LogBuffer {
+        explicit LogBuffer(size_t capacity) : data(new char[capacity]), size(0), capacity(capacity) {}
+
+        size_t avail() const { return capacity - size; }
+
+        std::unique_ptr<char[]> data;
+        size_t size;
+        size_t capacity;
+    };
+    using BufferPtr = std::unique_ptr<LogBuffer>;
+
+    void threadFunc();
+
+    OutputCallback output_;
+    FlushCallback flush_;
+    const Options options_;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;         // 通知后台线程
+    std::condition_variable flushed_cond_; // 通知等待flush的线程
+    BufferPtr current_;                    // 前端正在写的缓冲区
+    BufferPtr next_;                       // 前端的备用缓冲区
+    std::vector<BufferPtr> buffers_;       // 写满待写出的缓冲区
+    uint64_t flush_requested_;             // flush请求的序号
+    uint64_t flush_done_;                  // 已完成的flush序号
+    bool running_;
+    std::atomic<uint64_t> dropped_;
+    uint64_t dropped_reported_;            // 后台线程已报告的丢弃条数
+    std::thread thread_;
+};
+
+} // namespace core
@@ -0,0 +1,322 @@
+#include "core/utils/binary_logging.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace core {
+
+namespace log_detail {
+
+std::atomic<bool> g_binary_enabled(false);
+
+} // namespace log_detail
+
+namespace binlog {
+
+void copyLongString(char* dst, const char* src, size_t len) {
+    memcpy(dst, src, len);
+}
+
+} // namespace binlog
+
+namespace {
+
+// 线程退出之后再写日志(如在其他thread_local的析构函数中)直接丢弃
+thread_local bool t_ring_exited = false;
+
+size_t roundUpToPowerOfTwo(size_t n) {
+    size_t capacity = 4096;
+    while (capacity < n) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+void appendRecord(std::string* out, uint32_t site, int64_t time, const void* payload, size_t len) {
+    binlog::RecordHeader header;
+    header.site = site;
+    header.size = static_cast<uint32_t>(binlog::alignRecord(sizeof(header) + len));
+    header.time = time;
+    out->append(reinterpret_cast<const char*>(&header), sizeof(header));
+    out->append(static_cast<const char*>(payload), len);
+    out->append(header.size - sizeof(header) - len, '\0');
+}
+
+int64_t nowNanosSinceEpoch() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+thread_local BinaryLogRing* BinaryLogging::t_ring_ = nullptr;
+
+// 线程退出时标记环形缓冲区可以释放，由后台线程搬空后释放
+struct BinaryLogging::RingHolder {
+    std::shared_ptr<BinaryLogRing> ring;
+
+    ~RingHolder() {
+        if (ring) {
+            ring->retire();
+        }
+        t_ring_ = nullptr;
+        t_ring_exited = true;
+    }
+};
+
+BinaryLogRing::BinaryLogRing(size_t capacity)
+    : capacity_(roundUpToPowerOfTwo(capacity)),
+      mask_(capacity_ - 1),
+      data_(new char[capacity_]),
+      tail_(0),
+      cached_head_(0),
+      published_(0),
+      head_(0),
+      wakeup_requested_(false),
+      retired_(false) {
+    // 预先触碰每一页，缺页不发生在写日志的路径上
+    memset(data_.get(), 0, capacity_);
+}
+
+size_t BinaryLogRing::drain(std::string* out) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    uint64_t tail = published_.load(std::memory_order_acquire);
+    size_t moved = 0;
+    while (head < tail) {
+        uint64_t offset = head & mask_;
+        const char* p = data_.get() + offset;
+        binlog::RecordHeader header;
+        memcpy(&header.site, p, sizeof(header.site));
+        if (header.site == binlog::kPadding) {
+            head += capacity_ - offset;
+            continue;
+        }
+        // 记录在缓冲区中连续，一直搬到本段末尾或已发布的位置
+        uint64_t end = std::min<uint64_t>(tail, head + (capacity_ - offset));
+        uint64_t pos = head;
+        while (pos < end) {
+            memcpy(&header, data_.get() + (pos & mask_), sizeof(header));
+            if (header.site == binlog::kPadding) {
+                break;
+            }
+            pos += header.size;
+        }
+        out->append(p, pos - head);
+        moved += pos - head;
+        head = pos;
+    }
+    head_.store(head, std::memory_order_release);
+    wakeup_requested_.store(false, std::memory_order_release);
+    return moved;
+}
+
+bool BinaryLogRing::crossedHalf() {
+    // 笔记：写线程只在缓存的读位置落后过半时才读head_，平时不碰后台线程写的缓存行；
+    // 唤醒请求发出后、后台线程搬运前的记录也只多读一次wakeup_requested_
+    if (wakeup_requested_.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    cached_head_ = head_.load(std::memory_order_acquire);
+    if (tail_ - cached_head_ < capacity_ / 2) {
+        return false;
+    }
+    return !wakeup_requested_.exchange(true, std::memory_order_acq_rel);
+}
+
+BinaryLogging& BinaryLogging::instance() {
+    // 不析构：线程退出时仍可能访问
+    static BinaryLogging* instance = new BinaryLogging();
+    return *instance;
+}
+
+BinaryLogging::BinaryLogging()
+    : sites_written_(0),
+      flush_requested_(0),
+      flush_done_(0),
+      running_(false),
+      wakeup_(false),
+      dropped_(0),
+      dropped_reported_(0) {
+}
+
+BinaryLogging::~BinaryLogging() {
+    stop();
+}
+
+bool BinaryLogging::start(const std::string& filename, const Options& options) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) {
+        return true;
+    }
+    file_.open(filename, std::ios::binary | std::ios::app);
+    if (!file_.is_open()) {
+        std::cerr << "Failed to open binary log file: " << filename << std::endl;
+        return false;
+    }
+    options_ = options;
+    // 新的会话重新写出用到的定义；已分配的编号不变
+    sites_written_ = 0;
+    std::string header;
+    appendRecord(&header, binlog::kFileHeader, nowNanosSinceEpoch(), binlog::kMagic, sizeof(binlog::kMagic));
+    file_.write(header.data(), static_cast<std::streamsize>(header.size()));
+
+    running_ = true;
+    thread_ = std::thread(&BinaryLogging::threadFunc, this);
+    log_detail::g_binary_enabled.store(true, std::memory_order_release);
+    return true;
+}
+
+void BinaryLogging::stop() {
+    log_detail::g_binary_enabled.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+        cond_.notify_one();
+    }
+    thread_.join();
+    file_.close();
+}
+
+void BinaryLogging::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!running_) {
+        return;
+    }
+    uint64_t seq = ++flush_requested_;
+    cond_.notify_one();
+    flushed_cond_.wait(lock, [this, seq]() { return flush_done_ >= seq || !running_; });
+}
+
+uint32_t BinaryLogging::registerSite(BinaryLogSite* site, const uint8_t* types, size_t count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // 多个线程同时第一次执行同一语句时只分配一次
+    uint32_t id = site->id.load(std::memory_order_relaxed);
+    if (id == 0) {
+        sites_.push_back(SiteEntry{site, types, count});
+        id = static_cast<uint32_t>(sites_.size());
+        site->id.store(id, std::memory_order_release);
+    }
+    return id;
+}
+
+BinaryLogRing* BinaryLogging::localRing() {
+    if (t_ring_exited) {
+        return nullptr;
+    }
+    static thread_local RingHolder holder;
+    if (!holder.ring) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        holder.ring = std::make_shared<BinaryLogRing>(options_.ring_size);
+        rings_.push_back(holder.ring);
+    }
+    t_ring_ = holder.ring.get();
+    return t_ring_;
+}
+
+void BinaryLogging::wakeWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        wakeup_ = true;
+    }
+    cond_.notify_one();
+}
+
+void BinaryLogging::appendDefinition(std::string* out, const BinaryLogSite* site, const uint8_t* types,
+                                     size_t count) {
+    std::string payload;
+    binlog::SiteDefinition definition;
+    definition.id = site->id.load(std::memory_order_relaxed);
+    definition.line = static_cast<uint32_t>(site->line);
+    definition.level = static_cast<uint32_t>(site->level);
+    definition.arg_count = static_cast<uint32_t>(count);
+    payload.append(reinterpret_cast<const char*>(&definition), sizeof(definition));
+    payload.append(reinterpret_cast<const char*>(types), count);
+    payload.append(site->file);
+    payload.push_back('\0');
+    payload.append(site->func);
+    payload.push_back('\0');
+    payload.append(site->format);
+    payload.push_back('\0');
+    appendRecord(out, binlog::kSiteDefinition, 0, payload.data(), payload.size());
+}
+
+void BinaryLogging::drainOnce(std::string* definitions, std::string* records) {
+    std::vector<std::shared_ptr<BinaryLogRing>> rings;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        rings = rings_;
+    }
+
+    // 先搬记录；写入它们之前已经登记的编号，此后取定义时一定能看到
+    std::vector<BinaryLogRing*> exhausted;
+    for (const auto& ring : rings) {
+        bool retired = ring->retired();
+        ring->drain(records);
+        if (retired) {
+            // 退出前的记录都已搬走
+            exhausted.push_back(ring.get());
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (; sites_written_ < sites_.size(); ++sites_written_) {
+            const SiteEntry& entry = sites_[sites_written_];
+            appendDefinition(definitions, entry.site, entry.types, entry.count);
+        }
+        if (!exhausted.empty()) {
+            rings_.erase(std::remove_if(rings_.begin(), rings_.end(),
+                                        [&exhausted](const std::shared_ptr<BinaryLogRing>& ring) {
+                                            return std::find(exhausted.begin(), exhausted.end(), ring.get()) !=
+                                                   exhausted.end();
+                                        }),
+                         rings_.end());
+        }
+    }
+
+    uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (dropped != dropped_reported_) {
+        uint64_t count = dropped - dropped_reported_;
+        appendRecord(records, binlog::kDropped, nowNanosSinceEpoch(), &count, sizeof(count));
+        dropped_reported_ = dropped;
+    }
+}
+
+void BinaryLogging::threadFunc() {
+    // 两个缓冲区跨轮次复用，搬运时不重新分配内存
+    std::string definitions;
+    std::string records;
+    bool running = true;
+    while (running) {
+        uint64_t flush_seq;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cond_.wait_for(lock, options_.poll_interval, [this]() {
+                return !running_ || wakeup_ || flush_requested_ != flush_done_;
+            });
+            wakeup_ = false;
+            flush_seq = flush_requested_;
+            running = running_;
+        }
+
+        definitions.clear();
+        records.clear();
+        drainOnce(&definitions, &records);
+        if (!definitions.empty() || !records.empty()) {
+            file_.write(definitions.data(), static_cast<std::streamsize>(definitions.size()));
+            file_.write(records.data(), static_cast<std::streamsize>(records.size()));
+            file_.flush();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            flush_done_ = flush_seq;
+            flushed_cond_.notify_all();
+        }
+    }
+}
+
+} // namespace core
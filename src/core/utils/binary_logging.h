@@ -0,0 +1,419 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace core {
+
+// 二进制日志：日志语句不在调用线程中格式化。
+// 每个日志语句有一个静态的BinaryLogSite，记录格式串、文件、行号和参数类型，第一次执行时分配编号；
+// 之后每次只把编号、时间戳和参数的原始字节写入本线程的环形缓冲区(单生产者单消费者，无锁)。
+// 后台线程定期把各线程的环形缓冲区搬到文件中，并在用到某个编号之前写出它的定义；
+// 由离线工具(src/tools/log_decode.cpp)还原成和文本日志相同格式的文本。
+// 同一线程的日志在文件中有序，不同线程之间按搬运的批次交错
+
+// 文件格式：由记录组成，每条记录以RecordHeader开头，长度为8的倍数(按8字节对齐，不足补0)。
+// site为日志语句编号，以下几个保留值表示特殊记录
+namespace binlog {
+
+struct RecordHeader {
+    uint32_t site;
+    uint32_t size;      // 整条记录的长度，含头部和对齐填充
+    int64_t time;       // system_clock自纪元以来的纳秒
+};
+
+const uint32_t kPadding = 0;                // 只出现在环形缓冲区中：跳到缓冲区开头
+const uint32_t kFileHeader = 0xFFFFFFFD;    // 一次会话的开头，之后的编号重新定义
+const uint32_t kDropped = 0xFFFFFFFE;       // 内容为uint64：环形缓冲区满而丢弃的条数
+const uint32_t kSiteDefinition = 0xFFFFFFFF;// 内容见下
+
+// kFileHeader记录的内容
+const char kMagic[8] = {'C', 'O', 'R', 'E', 'B', 'L', 'G', '2'};
+
+// kSiteDefinition记录的内容：SiteDefinition，随后是arg_count个参数类型(各1字节)，
+// 再是以'\0'结尾的文件名、函数名和格式串
+struct SiteDefinition {
+    uint32_t id;
+    uint32_t line;
+    uint32_t level;
+    uint32_t arg_count;
+};
+
+// 参数在记录中的类型和编码：整数按原宽度，字符串为uint32长度加内容(不含'\0')，均不对齐
+enum ArgType : uint8_t {
+    kInt32 = 1,
+    kUInt32,
+    kInt64,
+    kUInt64,
+    kDouble,
+    kString,
+    kPointer,           // 按uint64保存地址
+    kBool,              // 1字节
+    kChar,              // 1字节
+    kInet4,             // IPv4地址和端口，网络字节序，共6字节
+};
+
+// 单个字符串参数最多保存的字节数，超出截断
+const size_t kMaxStringArg = 4096;
+
+inline size_t alignRecord(size_t size) {
+    return (size + 7) & ~static_cast<size_t>(7);
+}
+
+// 由参数的类型得到编码方式
+template <typename T, typename = void>
+struct ArgTraits {
+    static_assert(sizeof(T) == 0, "unsupported binary log argument type");
+};
+
+template <typename T>
+struct ArgTraits<T, std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value &&
+                                     !std::is_same<T, char>::value>> {
+    static const bool kWide = sizeof(T) > 4;
+    static const bool kSigned = std::is_signed<T>::value;
+    static const ArgType kType = kWide ? (kSigned ? kInt64 : kUInt64) : (kSigned ? kInt32 : kUInt32);
+    using Stored = std::conditional_t<kWide, std::conditional_t<kSigned, int64_t, uint64_t>,
+                                      std::conditional_t<kSigned, int32_t, uint32_t>>;
+
+    static size_t size(T) { return sizeof(Stored); }
+    static char* encode(char* p, T v) {
+        Stored stored = static_cast<Stored>(v);
+        memcpy(p, &stored, sizeof(stored));
+        return p + sizeof(stored);
+    }
+};
+
+// bool和char单独记录类型，解码时和文本日志一样输出true/false和字符本身
+template <typename T>
+struct ArgTraits<T, std::enable_if_t<std::is_same<T, bool>::value || std::is_same<T, char>::value>> {
+    static const ArgType kType = std::is_same<T, bool>::value ? kBool : kChar;
+
+    static size_t size(T) { return 1; }
+    static char* encode(char* p, T v) {
+        *p = static_cast<char>(v);
+        return p + 1;
+    }
+};
+
+// 枚举按底层整数保存
+template <typename T>
+struct ArgTraits<T, std::enable_if_t<std::is_enum<T>::value>> {
+    using Integer = ArgTraits<std::underlying_type_t<T>>;
+    static const ArgType kType = Integer::kType;
+
+    static size_t size(T v) { return Integer::size(static_cast<std::underlying_type_t<T>>(v)); }
+    static char* encode(char* p, T v) { return Integer::encode(p, static_cast<std::underlying_type_t<T>>(v)); }
+};
+
+template <typename T>
+struct ArgTraits<T, std::enable_if_t<std::is_floating_point<T>::value>> {
+    static const ArgType kType = kDouble;
+
+    static size_t size(T) { return sizeof(double); }
+    static char* encode(char* p, T v) {
+        double stored = static_cast<double>(v);
+        memcpy(p, &stored, sizeof(stored));
+        return p + sizeof(stored);
+    }
+};
+
+// 字符串：const char*、字符数组、std::string、std::string_view
+inline size_t stringArgSize(std::string_view s) {
+    return sizeof(uint32_t) + (s.size() < kMaxStringArg ? s.size() : kMaxStringArg);
+}
+
+// 长度超过32字节时调用libc的memcpy
+void copyLongString(char* dst, const char* src, size_t len);
+
+// 笔记：长度有上界的变长memcpy会被GCC展开成rep movs，启动开销几十个周期，比拷贝本身还慢；
+// 日志参数大多是几十字节的连接名、路径，用重叠的定长拷贝
+inline void copyString(char* dst, const char* src, size_t len) {
+    if (len >= 16) {
+        if (len > 32) {
+            copyLongString(dst, src, len);
+            return;
+        }
+        memcpy(dst, src, 16);
+        memcpy(dst + len - 16, src + len - 16, 16);
+    } else if (len >= 8) {
+        memcpy(dst, src, 8);
+        memcpy(dst + len - 8, src + len - 8, 8);
+    } else if (len >= 4) {
+        memcpy(dst, src, 4);
+        memcpy(dst + len - 4, src + len - 4, 4);
+    } else if (len > 0) {
+        dst[0] = src[0];
+        dst[len / 2] = src[len / 2];
+        dst[len - 1] = src[len - 1];
+    }
+}
+
+inline char* encodeStringArg(char* p, std::string_view s) {
+    uint32_t len = static_cast<uint32_t>(s.size() < kMaxStringArg ? s.size() : kMaxStringArg);
+    memcpy(p, &len, sizeof(len));
+    copyString(p + sizeof(len), s.data(), len);
+    return p + sizeof(len) + len;
+}
+
+inline std::string_view cStringArg(const char* s) {
+    return s ? std::string_view(s) : std::string_view("(null)");
+}
+
+template <typename T>
+struct ArgTraits<T, std::enable_if_t<std::is_same<T, const char*>::value || std::is_same<T, char*>::value>> {
+    static const ArgType kType = kString;
+
+    static size_t size(const char* s) { return stringArgSize(cStringArg(s)); }
+    static char* encode(char* p, const char* s) { return encodeStringArg(p, cStringArg(s)); }
+};
+
+template <size_t N>
+struct ArgTraits<char[N]> : ArgTraits<const char*> {};
+
+template <size_t N>
+struct ArgTraits<const char[N]> : ArgTraits<const char*> {};
+
+template <typename T>
+struct ArgTraits<T, std::enable_if_t<std::is_same<T, std::string>::value || std::is_same<T, std::string_view>::value>> {
+    static const ArgType kType = kString;
+
+    static size_t size(std::string_view s) { return stringArgSize(s); }
+    static char* encode(char* p, std::string_view s) { return encodeStringArg(p, s); }
+};
+
+// 其他指针按地址保存，用于%p
+template <typename T>
+struct ArgTraits<T*, std::enable_if_t<!std::is_same<std::remove_cv_t<T>, char>::value>> {
+    static const ArgType kType = kPointer;
+
+    static size_t size(const T*) { return sizeof(uint64_t); }
+    static char* encode(char* p, const T* v) {
+        uint64_t stored = reinterpret_cast<uintptr_t>(v);
+        memcpy(p, &stored, sizeof(stored));
+        return p + sizeof(stored);
+    }
+};
+
+// 线程id没有数值形式，保存它的哈希值
+template <>
+struct ArgTraits<std::thread::id> {
+    static const ArgType kType = kUInt64;
+
+    static size_t size(std::thread::id) { return sizeof(uint64_t); }
+    static char* encode(char* p, std::thread::id id) {
+        uint64_t stored = std::hash<std::thread::id>()(id);
+        memcpy(p, &stored, sizeof(stored));
+        return p + sizeof(stored);
+    }
+};
+
+template <typename T>
+using ArgTraitsOf = ArgTraits<std::remove_cv_t<std::remove_reference_t<T>>>;
+
+// 每组参数类型一份静态的类型表
+template <typename... Args>
+struct ArgTypes {
+    static constexpr uint8_t kTypes[sizeof...(Args) + 1] = {ArgTraitsOf<Args>::kType..., 0};
+};
+
+} // namespace binlog
+
+// 一个日志语句，由日志宏定义为静态变量，常量初始化，不需要线程安全的静态初始化检查
+struct BinaryLogSite {
+    constexpr BinaryLogSite(int level, const char* file, int line, const char* func, const char* format)
+        : id(0), level(level), file(file), line(line), func(func), format(format) {}
+
+    std::atomic<uint32_t> id;   // 第一次执行时分配，0表示未分配
+    const int level;
+    const char* const file;
+    const int line;
+    const char* const func;
+    const char* const format;
+};
+
+namespace log_detail {
+
+// 二进制日志是否开启，日志宏据此选择二进制还是文本
+extern std::atomic<bool> g_binary_enabled;
+
+} // namespace log_detail
+
+// 一个线程的环形缓冲区：所属线程写入，后台线程读出。
+// 位置单调递增，取模得到偏移；记录不跨越缓冲区末尾，放不下时在末尾写一条kPadding
+class BinaryLogRing {
+public:
+    explicit BinaryLogRing(size_t capacity);
+
+    BinaryLogRing(const BinaryLogRing&) = delete;
+    BinaryLogRing& operator=(const BinaryLogRing&) = delete;
+
+    // 写线程：预留size字节(8的倍数)，空间不足时返回nullptr
+    char* reserve(size_t size) {
+        uint64_t offset = tail_ & mask_;
+        uint64_t contiguous = capacity_ - offset;
+        uint64_t needed = size <= contiguous ? size : contiguous + size;
+        if (__builtin_expect(tail_ + needed - cached_head_ > capacity_, 0)) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail_ + needed - cached_head_ > capacity_) {
+                return nullptr;
+            }
+        }
+        if (size > contiguous) {
+            uint32_t padding = binlog::kPadding;
+            memcpy(data_.get() + offset, &padding, sizeof(padding));
+            tail_ += contiguous;
+            offset = 0;
+        }
+        return data_.get() + offset;
+    }
+    // 写线程：发布reserve得到的记录；返回true表示缓冲区已用过半，需要唤醒后台线程
+    bool commit(size_t size) {
+        tail_ += size;
+        published_.store(tail_, std::memory_order_release);
+        if (__builtin_expect(tail_ - cached_head_ >= capacity_ / 2, 0)) {
+            return crossedHalf();
+        }
+        return false;
+    }
+
+    // 后台线程：把已发布的记录追加到out，跳过填充，返回搬运的字节数
+    size_t drain(std::string* out);
+
+    // 所属线程已退出，搬空后可以释放
+    void retire() { retired_.store(true, std::memory_order_release); }
+    bool retired() const { return retired_.load(std::memory_order_acquire); }
+
+    size_t capacity() const { return capacity_; }
+
+private:
+    // 用最新的读位置确认是否过半，每次搬运之后只请求一次唤醒
+    bool crossedHalf();
+
+    const size_t capacity_;
+    const uint64_t mask_;
+    std::unique_ptr<char[]> data_;
+    // 写线程独占，和读线程使用的变量分在不同的缓存行
+    alignas(64) uint64_t tail_;
+    uint64_t cached_head_;
+    alignas(64) std::atomic<uint64_t> published_;
+    alignas(64) std::atomic<uint64_t> head_;
+    std::atomic<bool> wakeup_requested_;    // 写线程已请求唤醒，后台线程搬运后清除
+    std::atomic<bool> retired_;
+};
+
+// 二进制日志后端：管理各线程的环形缓冲区和写文件的后台线程
+class BinaryLogging {
+public:
+    struct Options {
+        size_t ring_size = 1024 * 1024;         // 每个线程的环形缓冲区大小，取整为2的幂
+        // 后台线程搬运的间隔；某个线程的缓冲区用过一半时提前唤醒
+        std::chrono::milliseconds poll_interval = std::chrono::milliseconds(10);
+    };
+
+    static BinaryLogging& instance();
+
+    // 开始写入filename(追加)，之后的日志宏写二进制记录；失败时返回false
+    bool start(const std::string& filename, const Options& options);
+    // 搬空所有缓冲区并关闭文件，日志宏恢复写文本；须在其他线程停止写日志之后调用
+    void stop();
+    // 阻塞到此前写入的记录全部写到文件，用于FATAL退出之前
+    void flush();
+
+    // 因缓冲区满而丢弃的累计条数
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    // 日志宏调用：编码一条记录写入本线程的缓冲区
+    template <typename... Args>
+    static void write(BinaryLogSite* site, const Args&... args) {
+        uint32_t id = site->id.load(std::memory_order_acquire);
+        if (__builtin_expect(id == 0, 0)) {
+            id = instance().registerSite(site, binlog::ArgTypes<Args...>::kTypes, sizeof...(Args));
+        }
+        BinaryLogRing* ring = t_ring_;
+        if (__builtin_expect(ring == nullptr, 0)) {
+            ring = instance().localRing();
+            if (!ring) {
+                return;
+            }
+        }
+
+        size_t size = binlog::alignRecord(sizeof(binlog::RecordHeader) +
+                                          (size_t(0) + ... + binlog::ArgTraitsOf<Args>::size(args)));
+        char* p = ring->reserve(size);
+        if (__builtin_expect(p == nullptr, 0)) {
+            instance().dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        binlog::RecordHeader header;
+        header.site = id;
+        header.size = static_cast<uint32_t>(size);
+        header.time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        // 对齐填充在最后8字节内，先整体清零(定长的memset不会展开成rep stos)，再写头部和参数
+        memset(p + size - 8, 0, 8);
+        memcpy(p, &header, sizeof(header));
+        char* end = p + sizeof(header);
+        ((end = binlog::ArgTraitsOf<Args>::encode(end, args)), ...);
+        (void)end;
+        if (__builtin_expect(ring->commit(size), 0)) {
+            instance().wakeWriter();
+        }
+    }
+
+private:
+    BinaryLogging();
+    ~BinaryLogging();
+
+    // 分配编号并登记定义，后台线程在搬运用到它的记录之前写出定义
+    uint32_t registerSite(BinaryLogSite* site, const uint8_t* types, size_t count);
+    // 本线程第一次写入：创建并登记环形缓冲区；线程退出之后返回nullptr
+    BinaryLogRing* localRing();
+
+    // 有缓冲区用过一半，唤醒后台线程立即搬运，不等poll_interval
+    void wakeWriter();
+    void threadFunc();
+    // 搬运一轮：先把各缓冲区的记录追加到records，再把此时已登记的定义追加到definitions，
+    // 文件中先写definitions，保证定义在使用之前
+    void drainOnce(std::string* definitions, std::string* records);
+    void appendDefinition(std::string* out, const BinaryLogSite* site, const uint8_t* types, size_t count);
+
+    struct RingHolder;
+
+    static thread_local BinaryLogRing* t_ring_;
+
+    struct SiteEntry {
+        const BinaryLogSite* site;
+        const uint8_t* types;
+        size_t count;
+    };
+
+    std::mutex mutex_;
+    std::condition_variable cond_;          // 唤醒后台线程
+    std::condition_variable flushed_cond_;  // 通知等待flush的线程
+    Options options_;
+    std::vector<SiteEntry> sites_;          // 下标为编号-1
+    size_t sites_written_;                  // 本次会话已写出定义的个数
+    std::vector<std::shared_ptr<BinaryLogRing>> rings_;
+    std::ofstream file_;
+    uint64_t flush_requested_;
+    uint64_t flush_done_;
+    bool running_;
+    bool wakeup_;                           // 有缓冲区请求立即搬运
+    std::atomic<uint64_t> dropped_;
+    uint64_t dropped_reported_;
+    std::thread thread_;
+};
+
+} // namespace core
@@ -0,0 +1,107 @@
+#include "core/utils/byte_mask.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CORE_MASK_X86 1
+#endif
+
+namespace core {
+
+namespace {
+
+// key已按offset旋转，按内存顺序重复4字节即可，不再关心位置
+using MaskFunc = void (*)(char* data, size_t len, uint32_t key);
+
+void scalarMask(char* data, size_t len, uint32_t key) {
+    uint64_t key64 = static_cast<uint64_t>(key) << 32 | key;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t v;
+        memcpy(&v, data + i, 8);
+        v ^= key64;
+        memcpy(data + i, &v, 8);
+    }
+    const unsigned char* k = reinterpret_cast<const unsigned char*>(&key);
+    for (; i < len; ++i) {
+        data[i] = static_cast<char>(data[i] ^ k[i % 4]);
+    }
+}
+
+#ifdef CORE_MASK_X86
+
+// 每次处理的字节数都是4的倍数，向量中的掩码与剩余部分保持对齐
+__attribute__((target("sse2")))
+void sseMask(char* data, size_t len, uint32_t key) {
+    const __m128i k = _mm_set1_epi32(static_cast<int>(key));
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), _mm_xor_si128(v, k));
+    }
+    scalarMask(data + i, len - i, key);
+}
+
+__attribute__((target("avx2")))
+void avx2Mask(char* data, size_t len, uint32_t key) {
+    const __m256i k = _mm256_set1_epi32(static_cast<int>(key));
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 32));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i), _mm256_xor_si256(a, k));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i + 32), _mm256_xor_si256(b, k));
+    }
+    for (; i + 32 <= len; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i), _mm256_xor_si256(a, k));
+    }
+    scalarMask(data + i, len - i, key);
+}
+
+#endif // CORE_MASK_X86
+
+// 运行时分发，进程启动时根据CPU特性初始化一次
+struct MaskDispatch {
+    MaskFunc mask;
+    const char* name;
+
+    MaskDispatch()
+        : mask(scalarMask), name("scalar") {
+#ifdef CORE_MASK_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            mask = avx2Mask;
+            name = "avx2";
+        } else if (__builtin_cpu_supports("sse2")) {
+            mask = sseMask;
+            name = "sse2";
+        }
+#endif
+    }
+};
+
+const MaskDispatch& maskDispatch() {
+    static const MaskDispatch d;
+    return d;
+}
+
+} // namespace
+
+void xorMask(char* data, size_t len, const unsigned char key[4], size_t offset) {
+    unsigned char rotated[4];
+    for (size_t i = 0; i < 4; ++i) {
+        rotated[i] = key[(offset + i) % 4];
+    }
+    uint32_t key32;
+    memcpy(&key32, rotated, 4);
+    maskDispatch().mask(data, len, key32);
+}
+
+const char* maskImplName() {
+    return maskDispatch().name;
+}
+
+} // namespace core
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stddef.h>
+
+namespace core {
+
+// 循环异或掩码：data[i] ^= key[(offset + i) % 4]，用于WebSocket帧的掩码和去掩码，原地修改
+// x86上运行时检测CPU特性，选择AVX2/SSE2实现，其它平台按8字节一组的标量实现
+// offset为data首字节在整个负载中的位置，负载分段处理时保持掩码对齐
+void xorMask(char* data, size_t len, const unsigned char key[4], size_t offset = 0);
+
+// 当前使用的实现名称："avx2"、"sse2"或"scalar"
+const char* maskImplName();
+
+} // namespace core
@@ -0,0 +1,304 @@
+#include "core/utils/byte_scan.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CORE_SCAN_X86 1
+#endif
+
+namespace core {
+
+namespace {
+
+// ---------------- 标量实现 ----------------
+
+// 不到这个长度的范围直接逐字节比较：向量化循环和memchr都有固定的启动开销，
+// 短范围(小请求、可恢复扫描每次新到的一段、向量循环剩下的尾部)上反而比逐字节慢
+const ptrdiff_t kShortScan = 32;
+
+inline const char* shortCRLF(const char* p, const char* end) {
+    for (; end - p >= 2; ++p) {
+        if (p[0] == '\r' && p[1] == '\n') {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+inline const char* shortCRLFCRLF(const char* p, const char* end) {
+    while (end - p >= 4) {
+        // p[3]不是'\r'或'\n'时，从p到p+3开始的匹配都不可能，跳过4个字节
+        if (p[3] != '\n' && p[3] != '\r') {
+            p += 4;
+        } else if (p[0] == '\r' && p[1] == '\n' && p[2] == '\r' && p[3] == '\n') {
+            return p;
+        } else {
+            ++p;
+        }
+    }
+    return nullptr;
+}
+
+const char* scalarCRLF(const char* begin, const char* end) {
+    if (end - begin < kShortScan) {
+        return shortCRLF(begin, end);
+    }
+    // 先用memchr跳到'\r'，再检查下一个字节
+    while (begin + 1 < end) {
+        const char* cr = static_cast<const char*>(memchr(begin, '\r', end - begin - 1));
+        if (cr == nullptr) {
+            return nullptr;
+        }
+        if (cr[1] == '\n') {
+            return cr;
+        }
+        begin = cr + 1;
+    }
+    return nullptr;
+}
+
+const char* scalarCRLFCRLF(const char* begin, const char* end) {
+    if (end - begin < kShortScan) {
+        return shortCRLFCRLF(begin, end);
+    }
+    while (begin + 3 < end) {
+        const char* cr = static_cast<const char*>(memchr(begin, '\r', end - begin - 3));
+        if (cr == nullptr) {
+            return nullptr;
+        }
+        if (cr[1] == '\n' && cr[2] == '\r' && cr[3] == '\n') {
+            return cr;
+        }
+        begin = cr + 1;
+    }
+    return nullptr;
+}
+
+const char* scalarAnyOf(const char* begin, const char* end, const char* set, size_t set_len) {
+    bool table[256] = {false};
+    for (size_t i = 0; i < set_len; ++i) {
+        table[static_cast<unsigned char>(set[i])] = true;
+    }
+    for (const char* p = begin; p < end; ++p) {
+        if (table[static_cast<unsigned char>(*p)]) {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+#ifdef CORE_SCAN_X86
+
+// ---------------- SSE实现 ----------------
+
+// 笔记：同时加载p和p+1两个错开一字节的向量，分别与'\r'、'\n'比较后按位与，即可一次判断16个位置
+__attribute__((target("sse2")))
+const char* sseCRLF(const char* begin, const char* end) {
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+    const char* p = begin;
+    while (end - p >= 17) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+        int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, cr), _mm_cmpeq_epi8(b, lf)));
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+    return shortCRLF(p, end);
+}
+
+__attribute__((target("sse2")))
+const char* sseCRLFCRLF(const char* begin, const char* end) {
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+    const char* p = begin;
+    while (end - p >= 19) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 2));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 3));
+        __m128i m = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(a, cr), _mm_cmpeq_epi8(b, lf)),
+                                  _mm_and_si128(_mm_cmpeq_epi8(c, cr), _mm_cmpeq_epi8(d, lf)));
+        int mask = _mm_movemask_epi8(m);
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+    return shortCRLFCRLF(p, end);
+}
+
+// SSE4.2的pcmpestri可以一条指令完成“16字节中是否出现set中任意字节”的判断
+__attribute__((target("sse4.2")))
+const char* sse42AnyOf(const char* begin, const char* end, const char* set, size_t set_len) {
+    if (set_len == 0 || set_len > 16) {
+        return scalarAnyOf(begin, end, set, set_len);
+    }
+    char set_buf[16] = {0};
+    memcpy(set_buf, set, set_len);
+    const __m128i needles = _mm_loadu_si128(reinterpret_cast<const __m128i*>(set_buf));
+    const char* p = begin;
+    while (end - p >= 16) {
+        __m128i hay = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int idx = _mm_cmpestri(needles, static_cast<int>(set_len), hay, 16,
+                               _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT);
+        if (idx < 16) {
+            return p + idx;
+        }
+        p += 16;
+    }
+    return scalarAnyOf(p, end, set, set_len);
+}
+
+// ---------------- AVX2实现 ----------------
+
+// 笔记：用过ymm之后不执行vzeroupper就进入非VEX编码的SSE代码，每条SSE指令都要为ymm的高半部分
+// 付出额外的合并开销(较老的CPU上是几十个周期的状态切换)，而且会一直持续到下一次vzeroupper。
+// GCC只在正常返回的路径上插入vzeroupper，尾调用回退实现的路径上没有，所以回退之前显式清除
+
+__attribute__((target("avx2")))
+const char* avx2CRLF(const char* begin, const char* end) {
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i lf = _mm256_set1_epi8('\n');
+    const char* p = begin;
+    while (end - p >= 33) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(a, cr), _mm256_cmpeq_epi8(b, lf))));
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 32;
+    }
+    // 剩下不到一个向量，逐字节比较；转去SSE或标量代码之前先清掉ymm的高半部分
+    _mm256_zeroupper();
+    return shortCRLF(p, end);
+}
+
+__attribute__((target("avx2")))
+const char* avx2CRLFCRLF(const char* begin, const char* end) {
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i lf = _mm256_set1_epi8('\n');
+    const char* p = begin;
+    while (end - p >= 35) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 2));
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 3));
+        __m256i m = _mm256_and_si256(
+            _mm256_and_si256(_mm256_cmpeq_epi8(a, cr), _mm256_cmpeq_epi8(b, lf)),
+            _mm256_and_si256(_mm256_cmpeq_epi8(c, cr), _mm256_cmpeq_epi8(d, lf)));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(m));
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 32;
+    }
+    _mm256_zeroupper();
+    return shortCRLFCRLF(p, end);
+}
+
+// set较小时，逐个字节广播比较再按位或，比pcmpestri吞吐更高
+__attribute__((target("avx2")))
+const char* avx2AnyOf(const char* begin, const char* end, const char* set, size_t set_len) {
+    if (set_len == 0 || set_len > 16) {
+        return scalarAnyOf(begin, end, set, set_len);
+    }
+    __m256i needles[16];
+    for (size_t i = 0; i < set_len; ++i) {
+        needles[i] = _mm256_set1_epi8(set[i]);
+    }
+    const char* p = begin;
+    while (end - p >= 32) {
+        __m256i hay = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i m = _mm256_setzero_si256();
+        for (size_t i = 0; i < set_len; ++i) {
+            m = _mm256_or_si256(m, _mm256_cmpeq_epi8(hay, needles[i]));
+        }
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(m));
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 32;
+    }
+    _mm256_zeroupper();
+    return scalarAnyOf(p, end, set, set_len);
+}
+
+#endif // CORE_SCAN_X86
+
+using ScanFunc = const char* (*)(const char*, const char*);
+using AnyOfFunc = const char* (*)(const char*, const char*, const char*, size_t);
+
+// 运行时分发表，进程启动时根据CPU特性初始化一次
+struct ScanDispatch {
+    ScanFunc crlf;
+    ScanFunc crlfcrlf;
+    AnyOfFunc any_of;
+    const char* name;
+
+    ScanDispatch()
+        : crlf(scalarCRLF), crlfcrlf(scalarCRLFCRLF), any_of(scalarAnyOf), name("scalar") {
+#ifdef CORE_SCAN_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            crlf = avx2CRLF;
+            crlfcrlf = avx2CRLFCRLF;
+            any_of = avx2AnyOf;
+            name = "avx2";
+        } else if (__builtin_cpu_supports("sse4.2")) {
+            crlf = sseCRLF;
+            crlfcrlf = sseCRLFCRLF;
+            any_of = sse42AnyOf;
+            name = "sse4.2";
+        } else if (__builtin_cpu_supports("sse2")) {
+            crlf = sseCRLF;
+            crlfcrlf = sseCRLFCRLF;
+            name = "sse2";
+        }
+#endif
+    }
+};
+
+const ScanDispatch& dispatch() {
+    static const ScanDispatch d;
+    return d;
+}
+
+} // namespace
+
+const char* scanCRLF(const char* begin, const char* end) {
+    if (end - begin < kShortScan) {
+        return shortCRLF(begin, end);
+    }
+    return dispatch().crlf(begin, end);
+}
+
+const char* scanCRLFCRLF(const char* begin, const char* end) {
+    if (end - begin < kShortScan) {
+        return shortCRLFCRLF(begin, end);
+    }
+    return dispatch().crlfcrlf(begin, end);
+}
+
+// glibc的memchr本身已按CPU特性做了向量化，直接使用
+const char* scanByte(const char* begin, const char* end, char c) {
+    if (begin >= end) {
+        return nullptr;
+    }
+    return static_cast<const char*>(memchr(begin, c, end - begin));
+}
+
+const char* scanAnyOf(const char* begin, const char* end, const char* set, size_t set_len) {
+    return dispatch().any_of(begin, end, set, set_len);
+}
+
+const char* scanImplName() {
+    return dispatch().name;
+}
+
+} // namespace core
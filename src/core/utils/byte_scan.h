@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stddef.h>
+
+namespace core {
+
+// 字节扫描原语，用于在缓冲区中查找分隔符
+// x86上运行时检测CPU特性，依次选择AVX2/SSE4.2/SSE2实现，其它平台使用标量实现
+// 所有函数在[begin, end)中查找，找到返回首个匹配位置，否则返回nullptr
+
+// 查找"\r\n"
+const char* scanCRLF(const char* begin, const char* end);
+
+// 查找"\r\n\r\n"
+const char* scanCRLFCRLF(const char* begin, const char* end);
+
+// 查找单个字节
+const char* scanByte(const char* begin, const char* end, char c);
+
+// 查找set中任意一个字节，set_len不超过16时使用向量化实现
+const char* scanAnyOf(const char* begin, const char* end, const char* set, size_t set_len);
+
+// 当前使用的实现名称："avx2"、"sse4.2"、"sse2"或"scalar"
+const char* scanImplName();
+
+} // namespace core
@@ -0,0 +1,50 @@
+#include "core/utils/histogram.h"
+
+#include <algorithm>
+
+namespace core {
+
+LogLinearHistogram::LogLinearHistogram()
+    : counts_(kBuckets, 0),
+      count_(0),
+      sum_(0),
+      max_(0),
+      min_(UINT64_MAX) {
+}
+
+void LogLinearHistogram::merge(const LogLinearHistogram& other) {
+    for (size_t i = 0; i < kBuckets; ++i) {
+        counts_[i] += other.counts_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    max_ = std::max(max_, other.max_);
+    min_ = std::min(min_, other.min_);
+}
+
+void LogLinearHistogram::reset() {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    count_ = 0;
+    sum_ = 0;
+    max_ = 0;
+    min_ = UINT64_MAX;
+}
+
+uint64_t LogLinearHistogram::percentile(double p) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    // 第rank个值(1开始)所在的桶
+    uint64_t rank = static_cast<uint64_t>(p / 100.0 * count_ + 0.5);
+    rank = std::min(std::max<uint64_t>(rank, 1), count_);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        seen += counts_[i];
+        if (seen >= rank) {
+            return std::min(bucketUpperBound(i), max_);
+        }
+    }
+    return max_;
+}
+
+} // namespace core
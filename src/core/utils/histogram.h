@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace core {
+
+// 对数线性直方图(HdrHistogram的简化版)：把数值范围按2的幂分组，每组再线性分成32个桶，
+// 小于64的值精确记录，其余的相对误差不超过1/32。记录只是一次下标计算加计数，不加锁，
+// 每个线程各用一个，汇总时merge
+class LogLinearHistogram {
+public:
+    static const int kSubBucketBits = 5;
+    static const size_t kSubBuckets = size_t(1) << kSubBucketBits;
+    static const size_t kBuckets = (64 - kSubBucketBits) * kSubBuckets;
+
+    // 值所在的桶
+    static size_t bucketIndex(uint64_t value) {
+        if (value < 2 * kSubBuckets) {
+            return static_cast<size_t>(value);
+        }
+        int msb = 63 - __builtin_clzll(value);
+        int shift = msb - kSubBucketBits;
+        return static_cast<size_t>(shift + 1) * kSubBuckets + ((value >> shift) & (kSubBuckets - 1));
+    }
+    // 桶的下界和上界(闭区间)
+    static uint64_t bucketLowerBound(size_t index) {
+        if (index < 2 * kSubBuckets) {
+            return index;
+        }
+        int shift = static_cast<int>(index / kSubBuckets) - 1;
+        return (kSubBuckets + index % kSubBuckets) << shift;
+    }
+    static uint64_t bucketUpperBound(size_t index) {
+        if (index < 2 * kSubBuckets) {
+            return index;
+        }
+        int shift = static_cast<int>(index / kSubBuckets) - 1;
+        return bucketLowerBound(index) + ((uint64_t(1) << shift) - 1);
+    }
+
+    LogLinearHistogram();
+
+    void record(uint64_t value) {
+        ++counts_[bucketIndex(value)];
+        ++count_;
+        sum_ += value;
+        if (value > max_) {
+            max_ = value;
+        }
+        if (value < min_) {
+            min_ = value;
+        }
+    }
+    // 累加另一个直方图
+    void merge(const LogLinearHistogram& other);
+    void reset();
+
+    uint64_t count() const { return count_; }
+    uint64_t sum() const { return sum_; }
+    uint64_t max() const { return max_; }
+    uint64_t min() const { return count_ == 0 ? 0 : min_; }
+    double mean() const { return count_ == 0 ? 0.0 : static_cast<double>(sum_) / count_; }
+    // 百分位数(0~100)，返回所在桶的上界，不超过记录到的最大值
+    uint64_t percentile(double p) const;
+
+    // 各桶的计数，下标含义见bucketIndex
+    const std::vector<uint64_t>& counts() const { return counts_; }
+
+private:
+    std::vector<uint64_t> counts_;
+    uint64_t count_;
+    uint64_t sum_;
+    uint64_t max_;
+    uint64_t min_;
+};
+
+} // namespace core
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace core {
+
+// 快速整数格式化，替代snprintf("%zu")等，不分配内存
+
+namespace detail {
+// "00".."99"的两位数字表，一次处理两位
+inline const char* digitPairs() {
+    static const char kPairs[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+    return kPairs;
+}
+} // namespace detail
+
+// 无符号整数最多20位十进制数字
+static const size_t kMaxUIntDigits = 20;
+
+// 将v写入buf(至少kMaxUIntDigits字节)，返回写入的长度，不写'\0'
+inline size_t formatUInt(uint64_t v, char* buf) {
+    char tmp[kMaxUIntDigits];
+    char* p = tmp + sizeof tmp;
+    const char* pairs = detail::digitPairs();
+    while (v >= 100) {
+        unsigned idx = static_cast<unsigned>(v % 100) * 2;
+        v /= 100;
+        p -= 2;
+        p[0] = pairs[idx];
+        p[1] = pairs[idx + 1];
+    }
+    if (v >= 10) {
+        unsigned idx = static_cast<unsigned>(v) * 2;
+        p -= 2;
+        p[0] = pairs[idx];
+        p[1] = pairs[idx + 1];
+    } else {
+        *--p = static_cast<char>('0' + v);
+    }
+    size_t len = tmp + sizeof tmp - p;
+    memcpy(buf, p, len);
+    return len;
+}
+
+// 有符号版本，buf至少kMaxUIntDigits + 1字节
+inline size_t formatInt(int64_t v, char* buf) {
+    if (v < 0) {
+        *buf = '-';
+        // 先转为无符号再取负，避免INT64_MIN溢出
+        return 1 + formatUInt(0 - static_cast<uint64_t>(v), buf + 1);
+    }
+    return formatUInt(static_cast<uint64_t>(v), buf);
+}
+
+// 十六进制(小写、无前缀)，buf至少16字节
+inline size_t formatHex(uint64_t v, char* buf) {
+    static const char kHexDigits[] = "0123456789abcdef";
+    char tmp[16];
+    char* p = tmp + sizeof tmp;
+    do {
+        *--p = kHexDigits[v & 0xf];
+        v >>= 4;
+    } while (v != 0);
+    size_t len = tmp + sizeof tmp - p;
+    memcpy(buf, p, len);
+    return len;
+}
+
+// 定宽补零格式化(如毫秒"007")，width不超过kMaxUIntDigits，超出部分截断高位
+inline void formatUIntPadded(uint64_t v, char* buf, size_t width) {
+    for (size_t i = width; i > 0; --i) {
+        buf[i - 1] = static_cast<char>('0' + v % 10);
+        v /= 10;
+    }
+}
+
+} // namespace core
@@ -0,0 +1,399 @@
+#include "core/utils/log_file.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+namespace core {
+
+namespace {
+
+const size_t kScanBlock = 64 * 1024;
+
+size_t pageSize() {
+    static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+bool fileExists(const std::string& path) {
+    return ::access(path.c_str(), F_OK) == 0;
+}
+
+// 文件中实际日志的长度：去掉末尾预分配未写的'\0'(上次异常退出时留下的)
+size_t dataLength(int fd, size_t size) {
+    std::vector<char> block(kScanBlock);
+    size_t end = size;
+    while (end > 0) {
+        size_t begin = end > kScanBlock ? end - kScanBlock : 0;
+        ssize_t n = ::pread(fd, block.data(), end - begin, static_cast<off_t>(begin));
+        if (n != static_cast<ssize_t>(end - begin)) {
+            return end;
+        }
+        for (size_t i = end - begin; i > 0; --i) {
+            if (block[i - 1] != '\0') {
+                return begin + i;
+            }
+        }
+        end = begin;
+    }
+    return 0;
+}
+
+// 把fd中前length字节压缩为path，成功时返回true
+bool gzipFile(int fd, size_t length, const std::string& path) {
+    gzFile out = gzopen(path.c_str(), "wb");
+    if (!out) {
+        return false;
+    }
+    std::vector<char> block(kScanBlock);
+    size_t offset = 0;
+    bool ok = true;
+    while (ok && offset < length) {
+        size_t want = std::min(block.size(), length - offset);
+        ssize_t n = ::pread(fd, block.data(), want, static_cast<off_t>(offset));
+        if (n <= 0 || gzwrite(out, block.data(), static_cast<unsigned>(n)) != n) {
+            ok = false;
+            break;
+        }
+        offset += static_cast<size_t>(n);
+    }
+    if (gzclose(out) != Z_OK) {
+        ok = false;
+    }
+    return ok;
+}
+
+} // namespace
+
+LogFile::LogFile(const std::string& filename, const Options& options)
+    : filename_(filename),
+      options_(options),
+      fd_(-1),
+      file_size_(0),
+      written_(0),
+      window_(nullptr),
+      window_offset_(0),
+      window_len_(0),
+      open_time_(0),
+      period_(0),
+      stamp_seq_(0),
+      dropped_bytes_(0),
+      extend_failed_(false),
+      archiver_running_(false) {
+}
+
+LogFile::~LogFile() {
+    if (fd_ >= 0) {
+        int fd;
+        size_t length;
+        closeFile(&fd, &length);
+        ::ftruncate(fd, static_cast<off_t>(length));
+        ::close(fd);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!archiver_running_) {
+            return;
+        }
+        archiver_running_ = false;
+        cond_.notify_one();
+    }
+    // 后台线程处理完已滚动的文件后退出
+    archiver_.join();
+}
+
+bool LogFile::open() {
+    time_t mtime;
+    if (!openFile(&mtime)) {
+        return false;
+    }
+    // 接着写上次留下的文件：它属于更早的周期或已经写满时先滚动
+    if (written_ > 0 && ((options_.roll_interval.count() > 0 && periodOf(mtime) != period_) ||
+                         (options_.roll_size > 0 && written_ >= options_.roll_size))) {
+        open_time_ = mtime;
+        rollFile();
+    }
+    return fd_ >= 0;
+}
+
+bool LogFile::openFile(time_t* mtime) {
+    fd_ = ::open(filename_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        std::cerr << "Failed to open log file: " << filename_ << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (::fstat(fd_, &st) != 0) {
+        std::cerr << "Failed to stat log file: " << filename_ << ": " << strerror(errno) << std::endl;
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    file_size_ = static_cast<size_t>(st.st_size);
+    written_ = dataLength(fd_, file_size_);
+    open_time_ = ::time(nullptr);
+    period_ = periodOf(open_time_);
+    *mtime = st.st_mtime;
+    return true;
+}
+
+int64_t LogFile::periodOf(time_t now) const {
+    int64_t interval = options_.roll_interval.count();
+    return interval > 0 ? static_cast<int64_t>(now) / interval : 0;
+}
+
+void LogFile::append(const char* data, size_t len) {
+    if (fd_ >= 0 && options_.roll_interval.count() > 0 && periodOf(::time(nullptr)) != period_) {
+        rollFile();
+    }
+    // 超过滚动大小时在最后一个放得下的换行处拆开：异步模式一次追加整块缓冲区，也按行滚动
+    while (fd_ >= 0 && options_.roll_size > 0 && written_ + len > options_.roll_size) {
+        size_t room = written_ < options_.roll_size ? options_.roll_size - written_ : 0;
+        const char* newline = room > 0 ? static_cast<const char*>(memrchr(data, '\n', room)) : nullptr;
+        if (newline) {
+            size_t n = newline + 1 - data;
+            write(data, n);
+            data += n;
+            len -= n;
+        } else if (written_ == 0) {
+            // 一行就超过滚动大小，整行写入
+            break;
+        }
+        rollFile();
+        if (written_ > 0) {
+            // 滚动失败，接着写原来的文件
+            break;
+        }
+    }
+    write(data, len);
+}
+
+void LogFile::write(const char* data, size_t len) {
+    if (fd_ < 0) {
+        dropped_bytes_ += len;
+        return;
+    }
+    while (len > 0) {
+        if (!window_ || written_ >= window_offset_ + window_len_) {
+            unmapWindow();
+            if (!mapWindow()) {
+                dropped_bytes_ += len;
+                return;
+            }
+        }
+        size_t n = std::min(len, window_offset_ + window_len_ - written_);
+        memcpy(window_ + (written_ - window_offset_), data, n);
+        written_ += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void LogFile::flush() {
+    if (fd_ >= 0 && options_.roll_interval.count() > 0 && periodOf(::time(nullptr)) != period_) {
+        rollFile();
+    }
+}
+
+void LogFile::rollFile() {
+    if (fd_ < 0) {
+        return;
+    }
+    time_t now = ::time(nullptr);
+    if (written_ == 0) {
+        // 空文件不滚动，只进入新的周期
+        open_time_ = now;
+        period_ = periodOf(now);
+        return;
+    }
+
+    char stamp[32];
+    struct tm tm_buf;
+    localtime_r(&open_time_, &tm_buf);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm_buf);
+    // 同一秒内多次滚动时加序号；序号只增不减，不会重用已被清理的文件名
+    if (last_stamp_ != stamp) {
+        last_stamp_ = stamp;
+        stamp_seq_ = 0;
+    }
+    std::string base = filename_ + "." + stamp;
+    std::string path = stamp_seq_ > 0 ? base + "." + std::to_string(stamp_seq_) : base;
+    while (fileExists(path) || fileExists(path + ".gz")) {
+        path = base + "." + std::to_string(++stamp_seq_);
+    }
+    ++stamp_seq_;
+
+    if (::rename(filename_.c_str(), path.c_str()) != 0) {
+        // 改名失败时接着写原来的文件
+        std::cerr << "Failed to roll log file: " << filename_ << ": " << strerror(errno) << std::endl;
+        return;
+    }
+    // 已打开的fd和映射不受改名影响，交给后台线程处理
+    int fd;
+    size_t length;
+    closeFile(&fd, &length);
+    time_t mtime;
+    openFile(&mtime);
+
+    startArchiver();
+    std::lock_guard<std::mutex> lock(mutex_);
+    archives_.push_back(Archive{fd, length, path});
+    cond_.notify_one();
+}
+
+bool LogFile::mapWindow() {
+    if (written_ >= file_size_) {
+        // 按大小滚动时一次预分配整个文件
+        size_t step = options_.roll_size > 0 ? options_.roll_size : options_.preallocate_size;
+        if (!extendTo(written_ + std::max(step, pageSize()))) {
+            return false;
+        }
+    }
+    size_t page = pageSize();
+    size_t window_size = std::max((options_.window_size + page - 1) / page * page, page);
+    window_offset_ = written_ / page * page;
+    window_len_ = std::min(window_size, file_size_ - window_offset_);
+    // 笔记：MAP_POPULATE在映射时建立页缓存和页表，缺页集中在换窗口时，而不是分散在每次写入中
+    void* p = ::mmap(nullptr, window_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                     static_cast<off_t>(window_offset_));
+    if (p == MAP_FAILED) {
+        std::cerr << "Failed to map log file: " << filename_ << ": " << strerror(errno) << std::endl;
+        window_len_ = 0;
+        return false;
+    }
+    window_ = static_cast<char*>(p);
+    return true;
+}
+
+void LogFile::unmapWindow() {
+    if (window_) {
+        ::munmap(window_, window_len_);
+        window_ = nullptr;
+        window_len_ = 0;
+    }
+}
+
+bool LogFile::extendTo(size_t size) {
+    int ret = ::fallocate(fd_, 0, static_cast<off_t>(file_size_), static_cast<off_t>(size - file_size_));
+    if (ret != 0 && errno == EOPNOTSUPP) {
+        // 文件系统不支持预分配时退化为稀疏文件，磁盘写满时写入会收到SIGBUS
+        ret = ::ftruncate(fd_, static_cast<off_t>(size));
+    }
+    if (ret != 0) {
+        // 多半是磁盘已满，只报告一次，丢弃日志直到空间恢复
+        if (!extend_failed_) {
+            std::cerr << "Failed to preallocate log file: " << filename_ << ": " << strerror(errno) << std::endl;
+            extend_failed_ = true;
+        }
+        return false;
+    }
+    extend_failed_ = false;
+    file_size_ = size;
+    return true;
+}
+
+void LogFile::closeFile(int* fd, size_t* length) {
+    unmapWindow();
+    *fd = fd_;
+    *length = written_;
+    fd_ = -1;
+    file_size_ = 0;
+    written_ = 0;
+    window_offset_ = 0;
+}
+
+void LogFile::startArchiver() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!archiver_running_) {
+        archiver_running_ = true;
+        archiver_ = std::thread(&LogFile::archiverFunc, this);
+    }
+}
+
+void LogFile::archiverFunc() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cond_.wait(lock, [this]() { return !archives_.empty() || !archiver_running_; });
+        if (archives_.empty()) {
+            break;
+        }
+        Archive item = archives_.front();
+        archives_.pop_front();
+        lock.unlock();
+        archive(item);
+        lock.lock();
+    }
+}
+
+void LogFile::archive(const Archive& item) {
+    // 去掉预分配而未写的部分
+    ::ftruncate(item.fd, static_cast<off_t>(item.length));
+    if (options_.compress) {
+        std::string gz_path = item.path + ".gz";
+        if (gzipFile(item.fd, item.length, gz_path)) {
+            ::unlink(item.path.c_str());
+        } else {
+            std::cerr << "Failed to compress log file: " << item.path << std::endl;
+            ::unlink(gz_path.c_str());
+        }
+    }
+    ::close(item.fd);
+    removeOldFiles();
+}
+
+void LogFile::removeOldFiles() {
+    if (options_.max_files == 0) {
+        return;
+    }
+    size_t slash = filename_.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : filename_.substr(0, slash + 1);
+    std::string prefix = (slash == std::string::npos ? filename_ : filename_.substr(slash + 1)) + ".";
+
+    DIR* d = ::opendir(dir.c_str());
+    if (!d) {
+        return;
+    }
+    // 已滚动的文件名为"filename.YYYYmmdd-HHMMSS[.n][.gz]"，按时间和同一秒内的序号排序
+    struct Rolled {
+        std::string stamp;
+        long seq;
+        std::string name;
+    };
+    std::vector<Rolled> files;
+    while (struct dirent* entry = ::readdir(d)) {
+        const char* name = entry->d_name;
+        if (strncmp(name, prefix.c_str(), prefix.size()) != 0 || name[prefix.size()] < '0' ||
+            name[prefix.size()] > '9') {
+            continue;
+        }
+        const char* stamp = name + prefix.size();
+        const char* end = strchr(stamp, '.');
+        Rolled file;
+        file.stamp.assign(stamp, end ? end - stamp : strlen(stamp));
+        file.seq = end && end[1] >= '0' && end[1] <= '9' ? strtol(end + 1, nullptr, 10) : 0;
+        file.name = name;
+        files.push_back(std::move(file));
+    }
+    ::closedir(d);
+    if (files.size() <= options_.max_files) {
+        return;
+    }
+    std::sort(files.begin(), files.end(), [](const Rolled& a, const Rolled& b) {
+        return a.stamp != b.stamp ? a.stamp < b.stamp : a.seq < b.seq;
+    });
+    for (size_t i = 0; i + options_.max_files < files.size(); ++i) {
+        std::string path = slash == std::string::npos ? files[i].name : dir + files[i].name;
+        ::unlink(path.c_str());
+    }
+}
+
+} // namespace core
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <condition_variable>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace core {
+
+// 日志文件：按大小和时间滚动，保留有限个已滚动的文件。
+// 正在写的文件始终叫filename；滚动时改名为"filename.YYYYmmdd-HHMMSS"(文件开始写的本地时间)，
+// 再打开新的filename。文件用fallocate一次预分配一大段，通过mmap窗口写入：写日志只是memcpy，
+// 不经过write系统调用，也不在写的过程中分配磁盘块、更新文件大小。
+// 已滚动文件的截断、gzip压缩和按个数清理都在LogFile自己的后台线程中进行，不占用写日志的线程；
+// 滚动本身(改名、打开新文件、预分配)仍在调用append/flush的线程中进行。Logger同步写入时这就是
+// 写日志的IO线程，滚动的那一次调用(以及等Logger锁的其他线程)要等这些文件系统操作；
+// 要让滚动也不占用IO线程，须开启异步日志(Logger::startAsync)，由AsyncLogging的后台线程写文件。
+// 笔记：文件大小是预分配后的大小，正常关闭和滚动时截断到实际长度；进程异常退出时末尾留下'\0'，
+// 下次打开时去掉后接着写
+// 不是线程安全的，由调用方(Logger)加锁
+class LogFile {
+public:
+    struct Options {
+        size_t roll_size = 0;                       // 文件写到多少字节后滚动，0表示不按大小滚动
+        std::chrono::seconds roll_interval{0};      // 按时间滚动的周期(如24小时)，按UTC对齐，0表示不按时间滚动
+        size_t max_files = 0;                       // 保留的已滚动文件个数，多出的删除最旧的，0表示不限
+        bool compress = true;                       // 已滚动的文件压缩为.gz
+        size_t preallocate_size = 64 * 1024 * 1024; // 不按大小滚动时每次预分配的大小；按大小滚动时一次预分配roll_size
+        size_t window_size = 4 * 1024 * 1024;       // mmap窗口的大小，写满后映射下一段
+    };
+
+    LogFile(const std::string& filename, const Options& options);
+    ~LogFile();
+
+    LogFile(const LogFile&) = delete;
+    LogFile& operator=(const LogFile&) = delete;
+
+    // 打开(或接着写)filename，失败时返回false
+    bool open();
+
+    // 追加一段日志(一行或多行)，按大小滚动时只在行尾拆分
+    void append(const char* data, size_t len);
+    // 数据写入mmap后已在页缓存中，进程退出也不会丢；这里只检查是否到了按时间滚动的时候
+    void flush();
+    // 立即滚动：在调用线程中改名并打开新文件，压缩和清理交给后台线程
+    void rollFile();
+
+    const std::string& filename() const { return filename_; }
+    // 因磁盘空间不足等原因无法写入而丢弃的字节数
+    uint64_t droppedBytes() const { return dropped_bytes_; }
+
+private:
+    // 交给后台线程处理的已滚动文件
+    struct Archive {
+        int fd;
+        size_t length;
+        std::string path;
+    };
+
+    // 打开filename，mtime返回它原来的修改时间
+    bool openFile(time_t* mtime);
+    // 当前时间所在的滚动周期
+    int64_t periodOf(time_t now) const;
+    // 写入当前文件，不检查滚动
+    void write(const char* data, size_t len);
+    // 保证written_处可写：必要时扩展文件并映射新的窗口
+    bool mapWindow();
+    void unmapWindow();
+    // 把文件预分配到size
+    bool extendTo(size_t size);
+    // 结束当前文件：解除映射，fd和实际长度交给调用方
+    void closeFile(int* fd, size_t* length);
+
+    void startArchiver();
+    void archiverFunc();
+    void archive(const Archive& item);
+    void removeOldFiles();
+
+    const std::string filename_;
+    const Options options_;
+
+    int fd_;
+    size_t file_size_;       // 已预分配的文件大小
+    size_t written_;         // 已写入的长度
+    char* window_;           // 当前映射的窗口
+    size_t window_offset_;   // 窗口在文件中的偏移
+    size_t window_len_;
+    time_t open_time_;       // 当前文件开始写的时间，用于滚动后的文件名
+    int64_t period_;         // 当前文件所在的滚动周期
+    std::string last_stamp_; // 上次滚动的文件名中的时间
+    int stamp_seq_;          // 同一秒内下一次滚动的序号
+    uint64_t dropped_bytes_;
+    bool extend_failed_;     // 扩展失败后只报告一次，恢复后清除
+
+    // 后台线程
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::deque<Archive> archives_;
+    bool archiver_running_;
+    std::thread archiver_;
+};
+
+} // namespace core
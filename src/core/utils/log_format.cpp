@@ -0,0 +1,93 @@
+#include "core/utils/log_format.h"
+
+#include <stdio.h>
+
+namespace core {
+
+namespace {
+
+const size_t kInitialFormatBuffer = 4096;
+
+} // namespace
+
+LogFormatBuffer::LogFormatBuffer()
+    : data_(new char[kInitialFormatBuffer]),
+      size_(0),
+      capacity_(kInitialFormatBuffer) {
+}
+
+LogFormatBuffer& LogFormatBuffer::local() {
+    static thread_local LogFormatBuffer buffer;
+    return buffer;
+}
+
+void LogFormatBuffer::grow(size_t n) {
+    size_t capacity = capacity_ * 2;
+    while (capacity - size_ < n) {
+        capacity *= 2;
+    }
+    std::unique_ptr<char[]> data(new char[capacity]);
+    memcpy(data.get(), data_.get(), size_);
+    data_ = std::move(data);
+    capacity_ = capacity;
+}
+
+namespace log_detail {
+
+void appendHex(LogFormatBuffer* out, uint64_t v) {
+    out->commit(formatHex(v, out->reserve(16)));
+}
+
+void appendDouble(LogFormatBuffer* out, double v) {
+    // 浮点数在日志中很少出现，用snprintf，精度同%g
+    const size_t kMaxDouble = 32;
+    int n = snprintf(out->reserve(kMaxDouble), kMaxDouble, "%g", v);
+    if (n > 0) {
+        out->commit(static_cast<size_t>(n) < kMaxDouble ? static_cast<size_t>(n) : kMaxDouble - 1);
+    }
+}
+
+void formatArgs(LogFormatBuffer* out, std::string_view format, const FormatArg* args, size_t count) {
+    // 格式串已在编译期检查过，这里对不合法的部分按原样输出，不会越过参数列表
+    size_t next = 0;
+    const char* p = format.data();
+    const char* end = p + format.size();
+    while (p < end) {
+        // 一次拷贝一段不含花括号的文本
+        const char* brace = p;
+        while (brace < end && *brace != '{' && *brace != '}') {
+            ++brace;
+        }
+        out->append(p, brace - p);
+        if (brace == end) {
+            break;
+        }
+        p = brace;
+
+        if (p + 1 < end && p[1] == *p) {
+            // {{或}}
+            out->push_back(*p);
+            p += 2;
+            continue;
+        }
+        char spec = '\0';
+        size_t len = 0;
+        if (*p == '{' && p + 1 < end && p[1] == '}') {
+            len = 2;
+        } else if (*p == '{' && p + 3 < end && p[1] == ':' && p[2] == 'x' && p[3] == '}') {
+            spec = 'x';
+            len = 4;
+        }
+        if (len == 0 || next >= count) {
+            out->push_back(*p++);
+            continue;
+        }
+        args[next].format(out, args[next].value, spec);
+        ++next;
+        p += len;
+    }
+}
+
+} // namespace log_detail
+
+} // namespace core
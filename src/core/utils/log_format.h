@@ -0,0 +1,226 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include "core/utils/int_format.h"
+
+namespace core {
+
+// 日志消息的格式化：格式串中的{}按顺序替换为参数，{:x}把整数输出为十六进制，{{和}}输出花括号。
+// 参数按类型选择LogFormatter，一遍扫描格式串，直接写入线程本地的缓冲区，不经过printf的可变参数，
+// 也不产生临时字符串；占位符个数和参数个数在编译期检查(见logger.h中的日志宏)
+
+// 格式化缓冲区：每个线程一块，容量只增不减，稳定后格式化不再分配内存
+class LogFormatBuffer {
+public:
+    LogFormatBuffer();
+
+    LogFormatBuffer(const LogFormatBuffer&) = delete;
+    LogFormatBuffer& operator=(const LogFormatBuffer&) = delete;
+
+    // 本线程的缓冲区
+    static LogFormatBuffer& local();
+
+    const char* data() const { return data_.get(); }
+    size_t size() const { return size_; }
+    // 截断到size，只能缩短
+    void resize(size_t size) { size_ = size; }
+
+    // 保证还能写入n字节，返回写入位置；写完后用commit提交实际写入的长度
+    char* reserve(size_t n) {
+        if (capacity_ - size_ < n) {
+            grow(n);
+        }
+        return data_.get() + size_;
+    }
+    void commit(size_t n) { size_ += n; }
+
+    void append(const char* s, size_t n) {
+        memcpy(reserve(n), s, n);
+        size_ += n;
+    }
+    void append(std::string_view s) { append(s.data(), s.size()); }
+    void push_back(char c) {
+        *reserve(1) = c;
+        ++size_;
+    }
+
+private:
+    void grow(size_t n);
+
+    std::unique_ptr<char[]> data_;
+    size_t size_;
+    size_t capacity_;
+};
+
+// 类型T的格式化，特化它即可在日志中直接使用T：
+//   static void format(LogFormatBuffer* out, const T& value, char spec);
+// spec为占位符中冒号后的字符，{}时为'\0'
+template <typename T, typename = void>
+struct LogFormatter {
+    static_assert(sizeof(T) == 0, "type cannot be formatted in log messages, specialize LogFormatter");
+};
+
+namespace log_detail {
+
+void appendHex(LogFormatBuffer* out, uint64_t v);
+void appendDouble(LogFormatBuffer* out, double v);
+
+} // namespace log_detail
+
+template <typename T>
+struct LogFormatter<T, std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value &&
+                                        !std::is_same<T, char>::value>> {
+    static void format(LogFormatBuffer* out, T value, char spec) {
+        if (spec == 'x') {
+            log_detail::appendHex(out, static_cast<std::make_unsigned_t<T>>(value));
+        } else if (std::is_signed<T>::value) {
+            out->commit(formatInt(static_cast<int64_t>(value), out->reserve(kMaxUIntDigits + 1)));
+        } else {
+            out->commit(formatUInt(static_cast<uint64_t>(value), out->reserve(kMaxUIntDigits)));
+        }
+    }
+};
+
+template <>
+struct LogFormatter<bool> {
+    static void format(LogFormatBuffer* out, bool value, char) {
+        out->append(value ? std::string_view("true") : std::string_view("false"));
+    }
+};
+
+template <>
+struct LogFormatter<char> {
+    static void format(LogFormatBuffer* out, char value, char) { out->push_back(value); }
+};
+
+// 枚举按底层整数输出
+template <typename T>
+struct LogFormatter<T, std::enable_if_t<std::is_enum<T>::value>> {
+    static void format(LogFormatBuffer* out, T value, char spec) {
+        LogFormatter<std::underlying_type_t<T>>::format(out, static_cast<std::underlying_type_t<T>>(value), spec);
+    }
+};
+
+template <typename T>
+struct LogFormatter<T, std::enable_if_t<std::is_floating_point<T>::value>> {
+    static void format(LogFormatBuffer* out, T value, char) { log_detail::appendDouble(out, static_cast<double>(value)); }
+};
+
+template <>
+struct LogFormatter<std::string_view> {
+    static void format(LogFormatBuffer* out, std::string_view value, char) { out->append(value); }
+};
+
+template <>
+struct LogFormatter<std::string> {
+    static void format(LogFormatBuffer* out, const std::string& value, char) { out->append(value); }
+};
+
+template <>
+struct LogFormatter<const char*> {
+    static void format(LogFormatBuffer* out, const char* value, char) {
+        out->append(value ? std::string_view(value) : std::string_view("(null)"));
+    }
+};
+
+template <>
+struct LogFormatter<char*> : LogFormatter<const char*> {};
+
+// 字符串字面量按C字符串处理(数组中'\0'之后的部分不输出)
+template <size_t N>
+struct LogFormatter<char[N]> {
+    static void format(LogFormatBuffer* out, const char* value, char) {
+        out->append(value, strnlen(value, N));
+    }
+};
+
+// 其他指针输出地址
+template <typename T>
+struct LogFormatter<T*, std::enable_if_t<!std::is_same<std::remove_cv_t<T>, char>::value>> {
+    static void format(LogFormatBuffer* out, const T* value, char) {
+        out->append("0x", 2);
+        log_detail::appendHex(out, reinterpret_cast<uintptr_t>(value));
+    }
+};
+
+// 线程id没有数值形式，输出它的哈希值，和二进制日志中保存的一致
+template <>
+struct LogFormatter<std::thread::id> {
+    static void format(LogFormatBuffer* out, std::thread::id value, char) {
+        out->commit(formatUInt(std::hash<std::thread::id>()(value), out->reserve(kMaxUIntDigits)));
+    }
+};
+
+namespace log_detail {
+
+// 类型擦除后的参数，格式化函数按参数类型实例化，格式串的解析只有一份
+struct FormatArg {
+    const void* value;
+    void (*format)(LogFormatBuffer* out, const void* value, char spec);
+};
+
+template <typename T>
+void formatErased(LogFormatBuffer* out, const void* value, char spec) {
+    LogFormatter<std::remove_cv_t<T>>::format(out, *static_cast<const T*>(value), spec);
+}
+
+template <typename T>
+FormatArg makeFormatArg(const T& value) {
+    return FormatArg{&value, &formatErased<T>};
+}
+
+void formatArgs(LogFormatBuffer* out, std::string_view format, const FormatArg* args, size_t count);
+
+// 格式串中占位符的个数，格式不合法(单独的花括号、不支持的格式)时返回-1，用于编译期检查
+constexpr int countPlaceholders(const char* format) {
+    int count = 0;
+    for (const char* p = format; *p; ++p) {
+        if (*p == '{') {
+            if (p[1] == '{') {
+                ++p;
+            } else if (p[1] == '}') {
+                ++count;
+                ++p;
+            } else if (p[1] == ':' && p[2] == 'x' && p[3] == '}') {
+                ++count;
+                p += 3;
+            } else {
+                return -1;
+            }
+        } else if (*p == '}') {
+            if (p[1] != '}') {
+                return -1;
+            }
+            ++p;
+        }
+    }
+    return count;
+}
+
+// 只用于sizeof：参数个数加1(没有参数时数组长度也要大于0)
+template <typename... Args>
+char (&countArgs(const Args&...))[sizeof...(Args) + 1];
+
+} // namespace log_detail
+
+// 把格式化结果追加到out
+template <typename... Args>
+void formatTo(LogFormatBuffer* out, std::string_view format, const Args&... args) {
+    const log_detail::FormatArg list[sizeof...(Args) + 1] = {log_detail::makeFormatArg(args)..., {nullptr, nullptr}};
+    log_detail::formatArgs(out, format, list, sizeof...(Args));
+}
+
+// 编译期检查日志格式串和参数个数是否一致，格式串须为字面量
+#define CORE_LOG_CHECK_FORMAT(fmt, ...) \
+    static_assert(core::log_detail::countPlaceholders(fmt) == \
+                      static_cast<int>(sizeof(core::log_detail::countArgs(__VA_ARGS__))) - 1, \
+                  "log format placeholders do not match the arguments")
+
+} // namespace core
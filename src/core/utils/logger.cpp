@@ -1,24 +1,83 @@
 #include "logger.h"
+#include <strings.h>
+#include <string.h>
 #include <iomanip>
 #include <ctime>
+#include "core/utils/int_format.h"
 
 namespace core {
 
-std::string timeToString(const std::chrono::system_clock::time_point& time) {
-    auto time_t = std::chrono::system_clock::to_time_t(time);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()) % 1000;
+namespace log_detail {
+
+std::atomic<int> g_module_levels[kLogModuleCount] = {
+    {static_cast<int>(LogLevel::INFO)}, {static_cast<int>(LogLevel::INFO)}, {static_cast<int>(LogLevel::INFO)},
+    {static_cast<int>(LogLevel::INFO)}, {static_cast<int>(LogLevel::INFO)}, {static_cast<int>(LogLevel::INFO)},
+};
+
+} // namespace log_detail
+
+namespace {
+
+// 本线程最近一次格式化的时间："YYYY-MM-DD HH:MM:SS."部分只在秒变化时重新生成
+struct LogTimeCache {
+    int64_t second = INT64_MIN;
+    char buf[kLogTimeLength];
+};
+
+thread_local LogTimeCache t_log_time;
+
+inline void putTwoDigits(char* p, int v) {
+    const char* pairs = detail::digitPairs();
+    p[0] = pairs[v * 2];
+    p[1] = pairs[v * 2 + 1];
+}
+
+} // namespace
+
+size_t formatLogTime(const std::chrono::system_clock::time_point& time, char* buf) {
+    int64_t ms_since_epoch = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+    int64_t second = ms_since_epoch / 1000;
+    int ms = static_cast<int>(ms_since_epoch % 1000);
     
-    std::stringstream ss;
-    std::tm tm_buf;
-    #ifdef _WIN32
-    localtime_s(&tm_buf, &time_t);
-    #else
-    localtime_r(&time_t, &tm_buf);
-    #endif
+    LogTimeCache& cache = t_log_time;
+    if (second != cache.second) {
+        cache.second = second;
+        std::time_t time_t = static_cast<std::time_t>(second);
+        std::tm tm_buf;
+        #ifdef _WIN32
+        localtime_s(&tm_buf, &time_t);
+        #else
+        localtime_r(&time_t, &tm_buf);
+        #endif
+        
+        char* p = cache.buf;
+        int year = tm_buf.tm_year + 1900;
+        putTwoDigits(p, year / 100);
+        putTwoDigits(p + 2, year % 100);
+        p[4] = '-';
+        putTwoDigits(p + 5, tm_buf.tm_mon + 1);
+        p[7] = '-';
+        putTwoDigits(p + 8, tm_buf.tm_mday);
+        p[10] = ' ';
+        putTwoDigits(p + 11, tm_buf.tm_hour);
+        p[13] = ':';
+        putTwoDigits(p + 14, tm_buf.tm_min);
+        p[16] = ':';
+        putTwoDigits(p + 17, tm_buf.tm_sec);
+        p[19] = '.';
+    }
+    // 每次只改写毫秒的三位
+    char* p = cache.buf + 20;
+    p[0] = static_cast<char>('0' + ms / 100);
+    putTwoDigits(p + 1, ms % 100);
     
-    ss << std::put_time(&tm_buf, "%Y-%m-%d %H:%M:%S") << '.' 
-       << std::setfill('0') << std::setw(3) << ms.count();
-    return ss.str();
+    memcpy(buf, cache.buf, kLogTimeLength);
+    return kLogTimeLength;
+}
+
+std::string timeToString(const std::chrono::system_clock::time_point& time) {
+    char buf[kLogTimeLength];
+    return std::string(buf, formatLogTime(time, buf));
 }
 
 Logger::Logger()
@@ -26,31 +85,149 @@ Logger::Logger()
 }
 
 Logger::~Logger() {
+    stopBinary();
+    stopAsync();
     closeLogFile();
 }
 
+void Logger::setLevel(LogLevel level) {
+    level_ = level;
+    for (int i = 0; i < kLogModuleCount; ++i) {
+        log_detail::g_module_levels[i].store(static_cast<int>(level), std::memory_order_relaxed);
+    }
+}
+
+void Logger::setModuleLevel(LogModule module, LogLevel level) {
+    log_detail::g_module_levels[static_cast<int>(module)].store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+LogLevel Logger::getModuleLevel(LogModule module) const {
+    return static_cast<LogLevel>(log_detail::g_module_levels[static_cast<int>(module)].load(std::memory_order_relaxed));
+}
+
+bool Logger::parseModule(std::string_view name, LogModule* module) {
+    static const char* const kNames[kLogModuleCount] = {"reactor", "net", "thread", "http", "utils", "app"};
+    for (int i = 0; i < kLogModuleCount; ++i) {
+        if (name.size() == strlen(kNames[i]) && strncasecmp(name.data(), kNames[i], name.size()) == 0) {
+            *module = static_cast<LogModule>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
 Logger& Logger::instance() {
     static Logger instance;
     return instance;
 }
 
-void Logger::setLogFile(const std::string& filename) {
+void Logger::setLogFile(const std::string& filename, const LogFile::Options& options) {
     std::lock_guard<std::mutex> lock(mutex_);
     
     // 关闭已经打开的文件
     closeLogFile();
     
-    // 打开新文件
-    output_file_.open(filename, std::ios::app);
-    
-    if (!output_file_.is_open()) {
-        std::cerr << "Failed to open log file: " << filename << std::endl;
+    // 打开新文件，失败时仍输出到stdout
+    std::unique_ptr<LogFile> file(new LogFile(filename, options));
+    if (file->open()) {
+        log_file_ = std::move(file);
+    }
+}
+
+void Logger::startAsync(const AsyncLogging::Options& options) {
+    if (async_) {
+        return;
+    }
+    async_.reset(new AsyncLogging([this](const char* data, size_t len) { writeOutput(data, len); },
+                                  [this]() { flushOutput(); }, options));
+    async_->start();
+}
+
+void Logger::stopAsync() {
+    if (async_) {
+        async_->stop();
+        async_.reset();
+    }
+}
+
+bool Logger::startBinary(const std::string& filename, const BinaryLogging::Options& options) {
+    return BinaryLogging::instance().start(filename, options);
+}
+
+void Logger::stopBinary() {
+    BinaryLogging::instance().stop();
+}
+
+void Logger::writeOutput(const char* data, size_t len) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (log_file_) {
+        log_file_->append(data, len);
+    } else {
+        std::cout.write(data, static_cast<std::streamsize>(len));
+    }
+}
+
+void Logger::flushOutput() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (log_file_) {
+        log_file_->flush();
+    } else {
+        std::cout.flush();
     }
 }
 
 void Logger::closeLogFile() {
-    if (output_file_.is_open()) {
-        output_file_.close();
+    log_file_.reset();
+}
+
+void Logger::appendPrefix(LogFormatBuffer* buf, LogLevel level, const char* file, int line,
+                          const char* func) const {
+    char* p = buf->reserve(kLogTimeLength + 4);
+    p[0] = '[';
+    size_t time_len = formatLogTime(std::chrono::system_clock::now(), p + 1);
+    p[time_len + 1] = ']';
+    p[time_len + 2] = ' ';
+    p[time_len + 3] = '[';
+    buf->commit(time_len + 4);
+    buf->append(levelToString(level));
+    buf->append("] ", 2);
+    buf->append(file);
+    buf->push_back(':');
+    buf->commit(formatInt(line, buf->reserve(kMaxUIntDigits + 1)));
+    buf->append(" (", 2);
+    buf->append(func);
+    buf->append(") ", 2);
+}
+
+void Logger::write(LogLevel level, const char* data, size_t len) {
+    if (level == LogLevel::FATAL && log_detail::g_binary_enabled.load(std::memory_order_relaxed)) {
+        // 先让此前的二进制记录落盘
+        BinaryLogging::instance().flush();
+    }
+    
+    if (async_) {
+        async_->append(data, len);
+        if (level == LogLevel::FATAL) {
+            // 等后台线程写出之后再退出
+            async_->flush();
+            std::abort();
+        }
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    // 输出到日志文件，如没有指定日志文件，输出到stdout。
+    // 日志文件通过mmap写入，写完即在页缓存中，不需要每行刷新
+    if (log_file_) {
+        log_file_->append(data, len);
+    } else {
+        std::cout.write(data, static_cast<std::streamsize>(len));
+    }
+    
+    // 如果是FATAL级别，直接退出程序
+    if (level == LogLevel::FATAL) {
+        std::abort();
     }
 }
 
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <atomic>
 #include <string>
+#include <string_view>
 #include <sstream>
 #include <fstream>
 #include <memory>
@@ -9,6 +11,16 @@
 #include <chrono>
 #include <iostream>
 #include <iomanip>
+#include "core/utils/async_logging.h"
+#include "core/utils/binary_logging.h"
+#include "core/utils/log_file.h"
+#include "core/utils/log_format.h"
+
+// 编译期最低日志级别(0=TRACE ... 5=FATAL)，低于它的日志语句在编译时被整个去掉，参数也不会求值；
+// 例如发布构建用-DCORE_LOG_MIN_LEVEL=2去掉热路径上的TRACE/DEBUG。FATAL总是保留
+#ifndef CORE_LOG_MIN_LEVEL
+#define CORE_LOG_MIN_LEVEL 0
+#endif
 
 namespace core {
 
@@ -21,17 +33,66 @@ enum class LogLevel {
     FATAL
 };
 
-// 简单字符串格式化函数
-template<typename... Args>
-std::string formatString(const std::string& format, Args&&... args) {
-    // 笔记：获取格式化字符串长度的技巧，+ 1是为了给'\0'留空间
-    size_t size = snprintf(nullptr, 0, format.c_str(), std::forward<Args>(args)...) + 1;
-    // 笔记：使用char[]而不是char来特化，确保正确调用delete[]
-    std::unique_ptr<char[]> buf(new char[size]);
-    snprintf(buf.get(), size, format.c_str(), std::forward<Args>(args)...);
-    return std::string(buf.get(), buf.get() + size - 1);
+// 日志模块，按源文件所在的目录(core/reactor、core/net等)划分，其他位置的代码属于APP
+enum class LogModule {
+    REACTOR,
+    NET,
+    THREAD,
+    HTTP,
+    UTILS,
+    APP,
+};
+const int kLogModuleCount = static_cast<int>(LogModule::APP) + 1;
+
+namespace log_detail {
+
+constexpr bool startsWith(const char* s, const char* prefix) {
+    while (*prefix) {
+        if (*s++ != *prefix++) {
+            return false;
+        }
+    }
+    return true;
 }
 
+// 各模块当前的运行时级别
+extern std::atomic<int> g_module_levels[kLogModuleCount];
+
+} // namespace log_detail
+
+// 编译期由源文件路径得到所属模块
+constexpr LogModule logModuleOf(const char* file) {
+    LogModule module = LogModule::APP;
+    for (const char* p = file; *p; ++p) {
+        if (log_detail::startsWith(p, "core/reactor/")) {
+            module = LogModule::REACTOR;
+        } else if (log_detail::startsWith(p, "core/net/")) {
+            module = LogModule::NET;
+        } else if (log_detail::startsWith(p, "core/thread/")) {
+            module = LogModule::THREAD;
+        } else if (log_detail::startsWith(p, "core/http/")) {
+            module = LogModule::HTTP;
+        } else if (log_detail::startsWith(p, "core/utils/")) {
+            module = LogModule::UTILS;
+        }
+    }
+    return module;
+}
+
+// 模块M是否输出level级别的日志：一次relaxed原子读加一次比较，在日志参数求值之前判断
+template <LogModule M>
+inline bool logEnabled(LogLevel level) {
+    return static_cast<int>(level) >=
+           log_detail::g_module_levels[static_cast<int>(M)].load(std::memory_order_relaxed);
+}
+
+// 日志时间"YYYY-MM-DD HH:MM:SS.mmm"的长度
+const size_t kLogTimeLength = 23;
+
+// 把时间格式化到buf(至少kLogTimeLength字节，不写'\0')，返回长度。
+// 每个线程缓存当前这一秒的日期时间部分，秒不变时只改写毫秒，不调用localtime_r，不分配内存
+size_t formatLogTime(const std::chrono::system_clock::time_point& time, char* buf);
+
 // 格式化时间为字符串
 std::string timeToString(const std::chrono::system_clock::time_point& time);
 
@@ -40,65 +101,52 @@ class Logger {
 public:
     static Logger& instance();
     
-    // 设置日志级别
-    void setLevel(LogLevel level) { level_ = level; }
+    // 设置日志级别，同时作用于所有模块
+    void setLevel(LogLevel level);
+    // 单独设置某个模块的级别，如只打开网络层的TRACE
+    void setModuleLevel(LogModule module, LogLevel level);
+    LogLevel getModuleLevel(LogModule module) const;
+    // 按名字(reactor、net、thread、http、utils、app，不区分大小写)查找模块
+    static bool parseModule(std::string_view name, LogModule* module);
     
     // 获取日志级别
     LogLevel getLevel() const { return level_; }
     
-    // 设置日志文件
-    void setLogFile(const std::string& filename);
+    // 设置日志文件，options指定按大小/时间滚动和保留的文件个数，默认不滚动。
+    // 同步写入时滚动在写日志的线程中进行，异步模式下在AsyncLogging的后台线程中进行
+    void setLogFile(const std::string& filename, const LogFile::Options& options = LogFile::Options());
     
     // 关闭日志文件
     void closeLogFile();
     
-    // 写日志
+    // 开启异步日志：之后的日志交给后台线程成批写入当前输出(日志文件或stdout)，不再每行加锁写入并刷新。
+    // 须在其他线程开始写日志之前调用
+    void startAsync(const AsyncLogging::Options& options = AsyncLogging::Options());
+    // 写出积压的日志并停止后台线程，恢复同步写入；须在其他线程停止写日志之后调用
+    void stopAsync();
+    // 异步模式下因积压过多而丢弃的日志条数
+    uint64_t droppedRecords() const { return async_ ? async_->dropped() : 0; }
+    
+    // 开启二进制日志：TRACE到ERROR的日志不再格式化，以二进制记录写入filename，
+    // 由src/tools/log_decode.cpp还原为文本；FATAL仍按文本输出。须在其他线程开始写日志之前调用
+    bool startBinary(const std::string& filename,
+                     const BinaryLogging::Options& options = BinaryLogging::Options());
+    // 写出剩余的二进制记录，恢复文本日志；须在其他线程停止写日志之后调用
+    void stopBinary();
+    
+    // 写日志，级别由日志宏按模块判断，这里不再检查。
+    // 整行在本线程的缓冲区中拼好，格式串中的{}按顺序替换为参数
     template<typename... Args>
     void log(LogLevel level, const char* file, int line, const char* func, 
-             const char* fmt, Args&&... args) {
-        if (level < level_) {
-            return;
-        }
-        
-        try {
-            // 格式化消息
-            // 笔记：根据传入的参数，决定将参数以左值引用还是右值引用的方式进行转发（保留原有的左值右值属性）
-            std::string msg = formatString(fmt, std::forward<Args>(args)...);
-            
-            // 获取时间
-            auto now = std::chrono::system_clock::now();
-            std::string time_str = timeToString(now);
-            
-            // 获取级别字符串
-            const char* level_str = levelToString(level);
-            
-            // 格式化日志
-            std::ostringstream log_stream;
-            log_stream << std::left
-                << "[" << time_str << "] [" << level_str << "] "
-                << file << ":" << line << " ("
-                << func <<  ") "
-                << msg << "\n";
-            std::string log_msg = log_stream.str();
-            
-            // 写日志
-            std::lock_guard<std::mutex> lock(mutex_);
-
-            // 输出到日志文件，如没有指定日志文件，输出到stdout
-            if (output_file_.is_open()) {
-                output_file_ << log_msg;
-                output_file_.flush();
-            }else{
-                std::cout << log_msg;
-            }
-            
-            // 如果是FATAL级别，直接退出程序
-            if (level == LogLevel::FATAL) {
-                std::abort();
-            }
-        } catch (const std::exception& e) {
-            std::cerr << "Logger error: " << e.what() << std::endl;
-        }
+             const char* fmt, const Args&... args) {
+        LogFormatBuffer& buf = LogFormatBuffer::local();
+        // 笔记：从当前末尾开始写，写完截回去；参数的格式化函数里再写日志时，内层的一行接在后面，互不覆盖
+        size_t start = buf.size();
+        appendPrefix(&buf, level, file, line, func);
+        formatTo(&buf, fmt, args...);
+        buf.push_back('\n');
+        write(level, buf.data() + start, buf.size() - start);
+        buf.resize(start);
     }
     
 private:
@@ -108,30 +156,52 @@ private:
     // 获取级别字符串
     const char* levelToString(LogLevel level) const;
     
+    // 行首的"[时间] [级别] 文件:行号 (函数) "
+    void appendPrefix(LogFormatBuffer* buf, LogLevel level, const char* file, int line, const char* func) const;
+    // 输出一行完整的日志，FATAL时输出后退出
+    void write(LogLevel level, const char* data, size_t len);
+    
+    // 异步模式的后台线程写出一批日志、刷新输出
+    void writeOutput(const char* data, size_t len);
+    void flushOutput();
+    
     LogLevel level_;                   // 日志级别
     std::mutex mutex_;                 // 互斥锁
-    std::ofstream output_file_;        // 输出文件
+    std::unique_ptr<LogFile> log_file_;    // 日志文件，为空时输出到stdout
+    std::unique_ptr<AsyncLogging> async_;  // 异步后端，为空表示同步写入
 };
 
 // 日志宏
 // 笔记：当可变参数部分（__VA_ARGS__）为空时，##__VA_ARGS__ 会自动移除其前面的逗号，避免因多余逗号导致编译错误。
 // ##__VA_ARGS__ 是 GNU 扩展语法（如 GCC、Clang 支持），但并非 C/C++ 标准的一部分。
-#define LOG_TRACE(fmt, ...) \
-    core::Logger::instance().log(core::LogLevel::TRACE, __FILE__, __LINE__, __func__, fmt, ##__VA_ARGS__)
-
-#define LOG_DEBUG(fmt, ...) \
-    core::Logger::instance().log(core::LogLevel::DEBUG, __FILE__, __LINE__, __func__, fmt, ##__VA_ARGS__)
-
-#define LOG_INFO(fmt, ...) \
-    core::Logger::instance().log(core::LogLevel::INFO, __FILE__, __LINE__, __func__, fmt, ##__VA_ARGS__)
-
-#define LOG_WARN(fmt, ...) \
-    core::Logger::instance().log(core::LogLevel::WARN, __FILE__, __LINE__, __func__, fmt, ##__VA_ARGS__)
+// 笔记：先比较编译期常量，条件为假时整条语句是死代码，编译器连同参数一起去掉；
+// 运行时只读一次所属模块的级别，不满足时不调用Logger::instance()，也不对参数求值。
+// 笔记：每个日志语句展开出一个静态的BinaryLogSite，常量初始化，二进制模式下只按编号写参数
+#define CORE_LOG(level, fmt, ...) \
+    do { \
+        CORE_LOG_CHECK_FORMAT(fmt, ##__VA_ARGS__); \
+        if (static_cast<int>(level) >= CORE_LOG_MIN_LEVEL && \
+            core::logEnabled<core::logModuleOf(__FILE__)>(level)) { \
+            if (core::log_detail::g_binary_enabled.load(std::memory_order_relaxed)) { \
+                static core::BinaryLogSite core_log_site_(static_cast<int>(level), __FILE__, __LINE__, __func__, fmt); \
+                core::BinaryLogging::write(&core_log_site_, ##__VA_ARGS__); \
+            } else { \
+                core::Logger::instance().log(level, __FILE__, __LINE__, __func__, fmt, ##__VA_ARGS__); \
+            } \
+        } \
+    } while (0)
 
-#define LOG_ERROR(fmt, ...) \
-    core::Logger::instance().log(core::LogLevel::ERROR, __FILE__, __LINE__, __func__, fmt, ##__VA_ARGS__)
+#define LOG_TRACE(fmt, ...) CORE_LOG(core::LogLevel::TRACE, fmt, ##__VA_ARGS__)
+#define LOG_DEBUG(fmt, ...) CORE_LOG(core::LogLevel::DEBUG, fmt, ##__VA_ARGS__)
+#define LOG_INFO(fmt, ...) CORE_LOG(core::LogLevel::INFO, fmt, ##__VA_ARGS__)
+#define LOG_WARN(fmt, ...) CORE_LOG(core::LogLevel::WARN, fmt, ##__VA_ARGS__)
+#define LOG_ERROR(fmt, ...) CORE_LOG(core::LogLevel::ERROR, fmt, ##__VA_ARGS__)
 
+// FATAL不受级别影响，总是输出并退出
 #define LOG_FATAL(fmt, ...) \
-    core::Logger::instance().log(core::LogLevel::FATAL, __FILE__, __LINE__, __func__, fmt, ##__VA_ARGS__)
+    do { \
+        CORE_LOG_CHECK_FORMAT(fmt, ##__VA_ARGS__); \
+        core::Logger::instance().log(core::LogLevel::FATAL, __FILE__, __LINE__, __func__, fmt, ##__VA_ARGS__); \
+    } while (0)
 
 } // namespace core
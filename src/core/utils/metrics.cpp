@@ -0,0 +1,346 @@
+#include "core/utils/metrics.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unordered_map>
+#include "core/utils/logger.h"
+
+namespace core {
+
+namespace {
+
+std::atomic<uint64_t> g_next_registry_id(1);
+
+// 存在的注册表，线程退出时按id查找，注册表已析构的分片随注册表释放
+std::mutex g_registries_mutex;
+
+std::unordered_map<uint64_t, MetricsRegistry*>& liveRegistries() {
+    // 不析构：分离的线程可能在静态对象析构之后才退出
+    static auto* registries = new std::unordered_map<uint64_t, MetricsRegistry*>();
+    return *registries;
+}
+
+// HELP中转义反斜杠和换行，标签值另外转义双引号
+void appendEscaped(std::string* out, std::string_view s, bool quote) {
+    for (char ch : s) {
+        if (ch == '\\') {
+            out->append("\\\\");
+        } else if (ch == '\n') {
+            out->append("\\n");
+        } else if (ch == '"' && quote) {
+            out->append("\\\"");
+        } else {
+            out->push_back(ch);
+        }
+    }
+}
+
+// 输出一行样本：name{labels,extra} value
+void appendSample(std::string* out, std::string_view name, std::string_view suffix, const std::string& labels,
+                  std::string_view extra, const char* value) {
+    out->append(name.data(), name.size());
+    out->append(suffix.data(), suffix.size());
+    if (!labels.empty() || !extra.empty()) {
+        out->push_back('{');
+        out->append(labels);
+        if (!labels.empty() && !extra.empty()) {
+            out->push_back(',');
+        }
+        out->append(extra.data(), extra.size());
+        out->push_back('}');
+    }
+    out->push_back(' ');
+    out->append(value);
+    out->push_back('\n');
+}
+
+} // namespace
+
+MetricsRegistry::Shard::Shard() {
+    for (size_t i = 0; i < kMaxPages; ++i) {
+        pages[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+MetricsRegistry::Shard::~Shard() {
+    for (size_t i = 0; i < kMaxPages; ++i) {
+        delete[] pages[i].load(std::memory_order_relaxed);
+    }
+}
+
+MetricsRegistry::MetricsRegistry()
+    : id_(g_next_registry_id.fetch_add(1, std::memory_order_relaxed)),
+      next_cell_(0) {
+    std::lock_guard<std::mutex> lock(g_registries_mutex);
+    liveRegistries()[id_] = this;
+}
+
+MetricsRegistry::~MetricsRegistry() {
+    // 之后退出的线程不再访问本注册表的分片
+    std::lock_guard<std::mutex> lock(g_registries_mutex);
+    liveRegistries().erase(id_);
+}
+
+thread_local MetricsRegistry::LocalCache MetricsRegistry::t_cache_ = {0, nullptr};
+thread_local MetricsRegistry::ThreadShards MetricsRegistry::t_shards_;
+
+MetricsRegistry::ThreadShards::~ThreadShards() {
+    t_cache_.id = 0;
+    t_cache_.shard = nullptr;
+    std::lock_guard<std::mutex> lock(g_registries_mutex);
+    for (const auto& item : shards) {
+        auto it = liveRegistries().find(item.first);
+        if (it != liveRegistries().end()) {
+            it->second->retireShard(item.second);
+        }
+    }
+}
+
+MetricsRegistry::Shard* MetricsRegistry::findShard() {
+    Shard* shard = nullptr;
+    for (auto& item : t_shards_.shards) {
+        if (item.first == id_) {
+            shard = item.second;
+            break;
+        }
+    }
+    if (!shard) {
+        // 本线程第一次记录到这个注册表；线程退出时并入retired_，计数不会倒退
+        shard = new Shard();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            shards_.emplace_back(shard);
+        }
+        t_shards_.shards.emplace_back(id_, shard);
+    }
+    t_cache_.id = id_;
+    t_cache_.shard = shard;
+    return shard;
+}
+
+void MetricsRegistry::retireShard(Shard* shard) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < kMaxPages; ++i) {
+        const std::atomic<uint64_t>* page = shard->pages[i].load(std::memory_order_acquire);
+        if (!page) {
+            continue;
+        }
+        std::atomic<uint64_t>* total = retired_.pages[i].load(std::memory_order_relaxed);
+        if (!total) {
+            total = allocatePage(&retired_, i);
+        }
+        for (size_t j = 0; j < kPageCells; ++j) {
+            uint64_t n = page[j].load(std::memory_order_relaxed);
+            if (n) {
+                total[j].store(total[j].load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+            }
+        }
+    }
+    for (auto it = shards_.begin(); it != shards_.end(); ++it) {
+        if (it->get() == shard) {
+            shards_.erase(it);
+            break;
+        }
+    }
+}
+
+std::atomic<uint64_t>* MetricsRegistry::allocatePage(Shard* shard, size_t page) {
+    // 值初始化，各槽位为0
+    std::atomic<uint64_t>* cells = new std::atomic<uint64_t>[kPageCells]();
+    shard->pages[page].store(cells, std::memory_order_release);
+    return cells;
+}
+
+uint64_t MetricsRegistry::sum(uint32_t cell) const {
+    const std::atomic<uint64_t>* retired = retired_.pages[cell >> kPageBits].load(std::memory_order_relaxed);
+    uint64_t total = retired ? retired[cell & (kPageCells - 1)].load(std::memory_order_relaxed) : 0;
+    for (const auto& shard : shards_) {
+        const std::atomic<uint64_t>* page = shard->pages[cell >> kPageBits].load(std::memory_order_acquire);
+        if (page) {
+            total += page[cell & (kPageCells - 1)].load(std::memory_order_relaxed);
+        }
+    }
+    return total;
+}
+
+const char* MetricsRegistry::typeName(Type type) {
+    switch (type) {
+        case kHistogram: return "histogram";
+        case kGaugeFunction: return "gauge";
+        default: return "counter";
+    }
+}
+
+uint32_t MetricsRegistry::allocateCells(size_t count) {
+    if (next_cell_ + count > kMaxPages * kPageCells) {
+        LOG_FATAL("MetricsRegistry - too many metrics, {} cells in use", next_cell_);
+    }
+    uint32_t cell = next_cell_;
+    next_cell_ += static_cast<uint32_t>(count);
+    return cell;
+}
+
+MetricsRegistry::Series& MetricsRegistry::addSeries(std::string_view name, std::string_view help, Type type,
+                                                    const Labels& labels) {
+    const char* exposition = typeName(type);
+    Family* family = nullptr;
+    for (auto& f : families_) {
+        if (f->name == name) {
+            family = f.get();
+            break;
+        }
+    }
+    if (!family) {
+        families_.emplace_back(new Family());
+        family = families_.back().get();
+        family->name = std::string(name);
+        family->help = std::string(help);
+        family->type = exposition;
+    } else if (strcmp(family->type, exposition) != 0) {
+        LOG_FATAL("MetricsRegistry - {} registered as both {} and {}", name, family->type, exposition);
+    }
+
+    family->series.emplace_back();
+    Series& series = family->series.back();
+    series.type = type;
+    series.cell = 0;
+    series.size = 0;
+    series.scale = 1;
+    for (const auto& label : labels) {
+        if (!series.labels.empty()) {
+            series.labels.push_back(',');
+        }
+        series.labels.append(label.first);
+        series.labels.append("=\"");
+        appendEscaped(&series.labels, label.second, true);
+        series.labels.push_back('"');
+    }
+    return series;
+}
+
+MetricsRegistry::Counter MetricsRegistry::counter(std::string_view name, std::string_view help, const Labels& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Series& series = addSeries(name, help, kCounter, labels);
+    series.cell = allocateCells(1);
+    return Counter(this, series.cell);
+}
+
+MetricsRegistry::CounterArray MetricsRegistry::counterArray(std::string_view name, std::string_view help,
+                                                            const Labels& labels, std::string_view index_label,
+                                                            size_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Series& series = addSeries(name, help, kCounterArray, labels);
+    series.cell = allocateCells(size);
+    series.size = static_cast<uint32_t>(size);
+    series.index_label = std::string(index_label);
+    return CounterArray(this, series.cell, series.size);
+}
+
+MetricsRegistry::Histogram MetricsRegistry::histogram(std::string_view name, std::string_view help,
+                                                      const Labels& labels, double scale,
+                                                      const std::vector<double>& bounds) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Series& series = addSeries(name, help, kHistogram, labels);
+    // 各桶的计数之后是总和
+    series.cell = allocateCells(kHistogramBuckets + 1);
+    series.scale = scale;
+    series.bounds = bounds;
+    return Histogram(this, series.cell);
+}
+
+void MetricsRegistry::counterFunction(std::string_view name, std::string_view help, const Labels& labels,
+                                      std::function<double()> fn) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    addSeries(name, help, kCounterFunction, labels).fn = std::move(fn);
+}
+
+void MetricsRegistry::gaugeFunction(std::string_view name, std::string_view help, const Labels& labels,
+                                    std::function<double()> fn) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    addSeries(name, help, kGaugeFunction, labels).fn = std::move(fn);
+}
+
+std::string MetricsRegistry::render() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string out;
+    char value[64];
+    char extra[128];
+    std::vector<uint64_t> counts(kHistogramBuckets);
+    for (const auto& family : families_) {
+        out.append("# HELP ");
+        out.append(family->name);
+        out.push_back(' ');
+        appendEscaped(&out, family->help, false);
+        out.append("\n# TYPE ");
+        out.append(family->name);
+        out.push_back(' ');
+        out.append(family->type);
+        out.push_back('\n');
+
+        for (const Series& series : family->series) {
+            switch (series.type) {
+                case kCounter:
+                    snprintf(value, sizeof(value), "%llu", static_cast<unsigned long long>(sum(series.cell)));
+                    appendSample(&out, family->name, "", series.labels, "", value);
+                    break;
+
+                case kCounterArray:
+                    for (uint32_t i = 0; i < series.size; ++i) {
+                        uint64_t n = sum(series.cell + i);
+                        if (n == 0) {
+                            continue;
+                        }
+                        snprintf(value, sizeof(value), "%llu", static_cast<unsigned long long>(n));
+                        snprintf(extra, sizeof(extra), "%s=\"%u\"", series.index_label.c_str(), i);
+                        appendSample(&out, family->name, "", series.labels, extra, value);
+                    }
+                    break;
+
+                case kHistogram: {
+                    for (size_t b = 0; b < kHistogramBuckets; ++b) {
+                        counts[b] = sum(series.cell + static_cast<uint32_t>(b));
+                    }
+                    // 桶的上界不超过边界时计入该边界，最后一个桶还包含更大的值，只计入+Inf
+                    uint64_t cumulative = 0;
+                    size_t b = 0;
+                    for (double bound : series.bounds) {
+                        while (b + 1 < kHistogramBuckets &&
+                               LogLinearHistogram::bucketUpperBound(b) * series.scale <= bound) {
+                            cumulative += counts[b++];
+                        }
+                        snprintf(value, sizeof(value), "%llu", static_cast<unsigned long long>(cumulative));
+                        snprintf(extra, sizeof(extra), "le=\"%g\"", bound);
+                        appendSample(&out, family->name, "_bucket", series.labels, extra, value);
+                    }
+                    for (; b < kHistogramBuckets; ++b) {
+                        cumulative += counts[b];
+                    }
+                    snprintf(value, sizeof(value), "%llu", static_cast<unsigned long long>(cumulative));
+                    appendSample(&out, family->name, "_bucket", series.labels, "le=\"+Inf\"", value);
+                    snprintf(value, sizeof(value), "%.9g",
+                             static_cast<double>(sum(series.cell + static_cast<uint32_t>(kHistogramBuckets))) * series.scale);
+                    appendSample(&out, family->name, "_sum", series.labels, "", value);
+                    snprintf(value, sizeof(value), "%llu", static_cast<unsigned long long>(cumulative));
+                    appendSample(&out, family->name, "_count", series.labels, "", value);
+                    break;
+                }
+
+                case kCounterFunction:
+                case kGaugeFunction:
+                    snprintf(value, sizeof(value), "%.17g", series.fn());
+                    appendSample(&out, family->name, "", series.labels, "", value);
+                    break;
+            }
+        }
+    }
+    return out;
+}
+
+const std::vector<double>& MetricsRegistry::defaultLatencyBounds() {
+    static const std::vector<double> kBounds = {
+        0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10,
+    };
+    return kBounds;
+}
+
+} // namespace core
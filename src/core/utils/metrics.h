@@ -0,0 +1,201 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "core/utils/histogram.h"
+
+namespace core {
+
+// 指标注册表，抓取时输出Prometheus文本格式。
+// 计数器和直方图的数据按线程分片：每个线程第一次记录时分到自己的一组槽位，之后只写本线程的槽位，
+// 单写者不需要原子读改写，记录只是一次普通的加法；抓取时把各线程的槽位相加。
+// 线程退出时它的槽位并入已退出线程的总和后释放，短命的线程不会让分片越积越多。
+// 直方图使用LogLinearHistogram的分桶，导出时按给定的边界汇总成累计桶。
+// 注册在启动阶段进行(加锁)，记录可以在任意线程中进行
+class MetricsRegistry {
+public:
+    using Labels = std::vector<std::pair<std::string, std::string>>;
+
+    // 计数器句柄，可以拷贝，注册表析构后失效
+    class Counter {
+    public:
+        Counter() : registry_(nullptr), cell_(0) {}
+
+        bool valid() const { return registry_ != nullptr; }
+        void inc(uint64_t n = 1) const { registry_->add(registry_->localShard(), cell_, n); }
+
+    private:
+        friend class MetricsRegistry;
+        Counter(MetricsRegistry* registry, uint32_t cell) : registry_(registry), cell_(cell) {}
+
+        MetricsRegistry* registry_;
+        uint32_t cell_;
+    };
+
+    // 按一个整数标签展开的一组计数器，如按状态码计数，导出时省略为0的项
+    class CounterArray {
+    public:
+        CounterArray() : registry_(nullptr), cell_(0), size_(0) {}
+
+        bool valid() const { return registry_ != nullptr; }
+        // index超出范围时忽略
+        void inc(size_t index, uint64_t n = 1) const {
+            if (index < size_) {
+                registry_->add(registry_->localShard(), cell_ + static_cast<uint32_t>(index), n);
+            }
+        }
+
+    private:
+        friend class MetricsRegistry;
+        CounterArray(MetricsRegistry* registry, uint32_t cell, uint32_t size)
+            : registry_(registry), cell_(cell), size_(size) {}
+
+        MetricsRegistry* registry_;
+        uint32_t cell_;
+        uint32_t size_;
+    };
+
+    // 直方图句柄，记录非负整数(如微秒)，超过2^32-1的值计入最后一个桶
+    class Histogram {
+    public:
+        Histogram() : registry_(nullptr), cell_(0) {}
+
+        bool valid() const { return registry_ != nullptr; }
+        void record(uint64_t value) const {
+            size_t bucket = LogLinearHistogram::bucketIndex(value);
+            Shard* shard = registry_->localShard();
+            registry_->add(shard, cell_ + static_cast<uint32_t>(bucket < kHistogramBuckets ? bucket : kHistogramBuckets - 1), 1);
+            registry_->add(shard, cell_ + static_cast<uint32_t>(kHistogramBuckets), value);
+        }
+
+    private:
+        friend class MetricsRegistry;
+        Histogram(MetricsRegistry* registry, uint32_t cell) : registry_(registry), cell_(cell) {}
+
+        MetricsRegistry* registry_;
+        uint32_t cell_;
+    };
+
+    MetricsRegistry();
+    ~MetricsRegistry();
+
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    // 注册指标。同名的指标属于同一个family，须类型和help一致、标签不同；名字和标签名不做校验
+    Counter counter(std::string_view name, std::string_view help, const Labels& labels = Labels());
+    CounterArray counterArray(std::string_view name, std::string_view help, const Labels& labels,
+                              std::string_view index_label, size_t size);
+    // scale把记录的整数换算为导出单位，如记录微秒、导出秒时为1e-6；bounds为导出单位下的桶上界，升序
+    Histogram histogram(std::string_view name, std::string_view help, const Labels& labels,
+                        double scale, const std::vector<double>& bounds);
+    // 抓取时求值的指标，用于已有的统计和瞬时值；fn在抓取的线程中调用
+    void counterFunction(std::string_view name, std::string_view help, const Labels& labels,
+                         std::function<double()> fn);
+    void gaugeFunction(std::string_view name, std::string_view help, const Labels& labels,
+                       std::function<double()> fn);
+
+    // Prometheus文本格式(0.0.4)
+    std::string render() const;
+
+    // 请求延迟的默认桶边界，单位秒
+    static const std::vector<double>& defaultLatencyBounds();
+
+private:
+    // LogLinearHistogram中小于2^32的值所占的桶数，直方图另有一个槽位存总和
+    static const size_t kHistogramBuckets = (32 - LogLinearHistogram::kSubBucketBits + 1) * LogLinearHistogram::kSubBuckets;
+    static const size_t kPageBits = 12;
+    static const size_t kPageCells = size_t(1) << kPageBits;
+    static const size_t kMaxPages = 256;
+
+    enum Type {
+        kCounter,
+        kCounterArray,
+        kHistogram,
+        kCounterFunction,
+        kGaugeFunction,
+    };
+
+    struct Series {
+        Type type;
+        std::string labels;         // 渲染好的标签，如a="1",b="2"，不含括号
+        uint32_t cell;
+        uint32_t size;              // CounterArray的项数
+        std::string index_label;    // CounterArray的整数标签名
+        double scale;
+        std::vector<double> bounds;
+        std::function<double()> fn;
+    };
+
+    struct Family {
+        std::string name;
+        std::string help;
+        const char* type;           // counter、gauge或histogram
+        std::vector<Series> series;
+    };
+
+    // 一个线程的槽位，按页惰性分配；页指针由所属线程发布，抓取线程读取，缺页视为全0
+    struct Shard {
+        std::atomic<std::atomic<uint64_t>*> pages[kMaxPages];
+
+        Shard();
+        ~Shard();
+    };
+
+    // 线程最近使用的注册表及其分片，命中时取分片不需要函数调用
+    struct LocalCache {
+        uint64_t id;
+        Shard* shard;
+    };
+    static thread_local LocalCache t_cache_;
+    // 本线程在各注册表中的分片，线程退出时析构，把分片交还给仍然存在的注册表
+    struct ThreadShards {
+        std::vector<std::pair<uint64_t, Shard*>> shards;
+
+        ~ThreadShards();
+    };
+    static thread_local ThreadShards t_shards_;
+
+    Shard* localShard() {
+        if (__builtin_expect(t_cache_.id == id_, 1)) {
+            return t_cache_.shard;
+        }
+        return findShard();
+    }
+    // 单写者：只有所属线程修改自己的槽位
+    void add(Shard* shard, uint32_t cell, uint64_t n) {
+        std::atomic<uint64_t>* page = shard->pages[cell >> kPageBits].load(std::memory_order_relaxed);
+        if (__builtin_expect(page == nullptr, 0)) {
+            page = allocatePage(shard, cell >> kPageBits);
+        }
+        std::atomic<uint64_t>& slot = page[cell & (kPageCells - 1)];
+        slot.store(slot.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    Shard* findShard();
+    // 线程退出：把分片的槽位加到retired_中并释放分片
+    void retireShard(Shard* shard);
+    static std::atomic<uint64_t>* allocatePage(Shard* shard, size_t page);
+    // 所有线程中该槽位之和
+    uint64_t sum(uint32_t cell) const;
+
+    static const char* typeName(Type type);
+    uint32_t allocateCells(size_t count);
+    Series& addSeries(std::string_view name, std::string_view help, Type type, const Labels& labels);
+
+    const uint64_t id_;                 // 区分注册表，线程本地缓存以它为键
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Family>> families_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    Shard retired_;                     // 已退出线程的槽位之和，持有mutex_时修改
+    uint32_t next_cell_;
+};
+
+} // namespace core
@@ -0,0 +1,372 @@
+// HTTP/1.1与h2c在相同并发下的对比：同样保持C个请求在途，HTTP/1.1需要C个连接(每个连接一个在途请求)，
+// h2c只需要ceil(C/S)个连接(每个连接S个流)。服务器在fork出的子进程中运行(1个IO线程)，
+// 每种协议使用一个新的子进程，比较服务器的连接数、常驻内存和吞吐
+//   h2_bench [-c 在途请求数(默认1000)] [-s 每个h2c连接的流数(默认100)] [-d 每种协议的时长(秒，默认5)]
+//            [-b 响应主体字节数(默认256)] [-P 端口(默认18039)]
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "core/http/hpack.h"
+#include "core/http/http2_session.h"
+#include "core/http/http_request.h"
+#include "core/http/http_response.h"
+#include "core/http/http_server.h"
+#include "core/reactor/event_loop.h"
+#include "core/utils/logger.h"
+
+using namespace core;
+
+namespace {
+
+struct Config {
+    int concurrency = 1000;
+    int streams = 100;
+    double duration = 5;
+    size_t body_size = 256;
+    uint16_t port = 18039;
+};
+
+// 子进程：运行服务器直到被杀死
+pid_t forkServer(const Config& config) {
+    pid_t pid = ::fork();
+    if (pid != 0) {
+        return pid;
+    }
+    Logger::instance().setLevel(LogLevel::WARN);
+    EventLoop loop;
+    HttpServer server(&loop, InetAddress(config.port, true), "h2bench");
+    server.setThreadNum(1);
+    Http2Session::Options options;
+    options.max_concurrent_streams = static_cast<uint32_t>(config.streams);
+    server.enableHttp2(options);
+    std::string body(config.body_size, 'x');
+    server.setHttpCallback([&body](const HttpRequest&, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setContentType("text/plain");
+        resp->setBody(body);
+    });
+    server.start();
+    loop.loop();
+    _exit(0);
+}
+
+// 服务器进程的常驻内存，单位KB
+long residentKb(pid_t pid) {
+    char path[64];
+    snprintf(path, sizeof path, "/proc/%d/status", static_cast<int>(pid));
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        return -1;
+    }
+    char line[256];
+    long kb = -1;
+    while (fgets(line, sizeof line, f)) {
+        if (strncmp(line, "VmRSS:", 6) == 0) {
+            kb = atol(line + 6);
+            break;
+        }
+    }
+    fclose(f);
+    return kb;
+}
+
+int connectTo(uint16_t port) {
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    for (int attempt = 0; attempt < 200; ++attempt) {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) == 0) {
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+            return fd;
+        }
+        ::close(fd);
+        usleep(10000);  // 服务器子进程可能还没开始监听
+    }
+    return -1;
+}
+
+// 全部写出，请求很小且在途数量有限，发送缓冲区满的情况很少，直接等待
+bool writeAll(int fd, const std::string& data) {
+    size_t off = 0;
+    while (off < data.size()) {
+        ssize_t n = ::write(fd, data.data() + off, data.size() - off);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        off += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+struct Client {
+    int fd = -1;
+    std::string input;
+    std::string output;
+    uint32_t next_stream = 1;     // h2c
+    uint32_t unacked_bytes = 0;   // h2c：已收到、尚未归还连接窗口的DATA字节数
+};
+
+// HTTP/1.1：输入中的完整响应数
+int takeHttp1Responses(Client* c) {
+    int done = 0;
+    for (;;) {
+        size_t header_end = c->input.find("\r\n\r\n");
+        if (header_end == std::string::npos) {
+            break;
+        }
+        size_t cl = c->input.find("Content-Length: ");
+        if (cl == std::string::npos || cl > header_end) {
+            return -1;
+        }
+        size_t total = header_end + 4 + static_cast<size_t>(atol(c->input.c_str() + cl + 16));
+        if (c->input.size() < total) {
+            break;
+        }
+        c->input.erase(0, total);
+        ++done;
+    }
+    return done;
+}
+
+void appendFrameHeader(std::string* out, size_t length, uint8_t type, uint8_t flags, uint32_t stream_id) {
+    char h[9];
+    h[0] = static_cast<char>(length >> 16);
+    h[1] = static_cast<char>(length >> 8);
+    h[2] = static_cast<char>(length);
+    h[3] = static_cast<char>(type);
+    h[4] = static_cast<char>(flags);
+    h[5] = static_cast<char>(stream_id >> 24);
+    h[6] = static_cast<char>(stream_id >> 16);
+    h[7] = static_cast<char>(stream_id >> 8);
+    h[8] = static_cast<char>(stream_id);
+    out->append(h, 9);
+}
+
+void appendUInt32(std::string* out, uint32_t v) {
+    char b[4] = {static_cast<char>(v >> 24), static_cast<char>(v >> 16), static_cast<char>(v >> 8),
+                 static_cast<char>(v)};
+    out->append(b, 4);
+}
+
+void appendH2Request(Client* c, const std::string& block) {
+    appendFrameHeader(&c->output, block.size(), 0x1, 0x5, c->next_stream);  // HEADERS, END_STREAM|END_HEADERS
+    c->output += block;
+    c->next_stream += 2;
+}
+
+// h2c：处理输入中的完整帧，返回完成的流数
+int takeHttp2Responses(Client* c, const std::string& block) {
+    int done = 0;
+    size_t off = 0;
+    while (c->input.size() - off >= 9) {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(c->input.data() + off);
+        size_t length = (size_t(p[0]) << 16) | (size_t(p[1]) << 8) | p[2];
+        if (c->input.size() - off < 9 + length) {
+            break;
+        }
+        uint8_t type = p[3];
+        uint8_t flags = p[4];
+        if (type == 0x0) {
+            c->unacked_bytes += static_cast<uint32_t>(length);
+        } else if (type == 0x4 && !(flags & 0x1)) {
+            appendFrameHeader(&c->output, 0, 0x4, 0x1, 0);  // SETTINGS ACK
+        } else if (type == 0x3 || type == 0x7) {
+            fprintf(stderr, "h2c: server sent %s\n", type == 0x3 ? "RST_STREAM" : "GOAWAY");
+            return -1;
+        }
+        if ((type == 0x0 || type == 0x1) && (flags & 0x1)) {
+            ++done;
+            appendH2Request(c, block);
+        }
+        off += 9 + length;
+    }
+    c->input.erase(0, off);
+    if (c->unacked_bytes > (1u << 20)) {
+        appendFrameHeader(&c->output, 4, 0x8, 0, 0);  // 连接级WINDOW_UPDATE
+        appendUInt32(&c->output, c->unacked_bytes);
+        c->unacked_bytes = 0;
+    }
+    return done;
+}
+
+struct Result {
+    int connections = 0;
+    long idle_kb = 0;      // 建立连接前
+    long loaded_kb = 0;    // 压测结束时
+    long requests = 0;
+    double seconds = 0;
+};
+
+bool run(const Config& config, bool h2, Result* result) {
+    pid_t server = forkServer(config);
+    // 等服务器开始监听，再记录没有连接时的内存
+    int probe = connectTo(config.port);
+    if (probe < 0) {
+        kill(server, SIGKILL);
+        waitpid(server, nullptr, 0);
+        return false;
+    }
+    ::close(probe);
+    usleep(100000);
+    result->idle_kb = residentKb(server);
+
+    std::string block;
+    HpackEncoder::encode(":method", "GET", &block);
+    HpackEncoder::encode(":scheme", "http", &block);
+    HpackEncoder::encode(":path", "/", &block);
+    HpackEncoder::encode(":authority", "bench", &block);
+    const std::string http1_request = "GET / HTTP/1.1\r\nHost: bench\r\n\r\n";
+
+    int per_conn = h2 ? config.streams : 1;
+    int connections = (config.concurrency + per_conn - 1) / per_conn;
+    std::vector<Client> clients(connections);
+    int epfd = ::epoll_create1(EPOLL_CLOEXEC);
+    bool ok = true;
+    for (int i = 0; i < connections && ok; ++i) {
+        Client& c = clients[i];
+        c.fd = connectTo(config.port);
+        if (c.fd < 0) {
+            ok = false;
+            break;
+        }
+        epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.u32 = static_cast<uint32_t>(i);
+        ::epoll_ctl(epfd, EPOLL_CTL_ADD, c.fd, &ev);
+        int in_flight = std::min(per_conn, config.concurrency - i * per_conn);
+        if (h2) {
+            c.output.append(Http2Session::kPreface.data(), Http2Session::kPreface.size());
+            appendFrameHeader(&c.output, 6, 0x4, 0, 0);  // SETTINGS_INITIAL_WINDOW_SIZE = 16MB
+            c.output.append("\x00\x04", 2);
+            appendUInt32(&c.output, 1u << 24);
+            appendFrameHeader(&c.output, 4, 0x8, 0, 0);  // 连接窗口加到1GB
+            appendUInt32(&c.output, (1u << 30) - 65535);
+            for (int k = 0; k < in_flight; ++k) {
+                appendH2Request(&c, block);
+            }
+        } else {
+            c.output = http1_request;
+        }
+        ok = writeAll(c.fd, c.output);
+        c.output.clear();
+    }
+    result->connections = connections;
+
+    std::vector<epoll_event> events(1024);
+    char buf[65536];
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::milliseconds(static_cast<long>(config.duration * 1000));
+    while (ok && std::chrono::steady_clock::now() < deadline) {
+        int n = ::epoll_wait(epfd, events.data(), static_cast<int>(events.size()), 100);
+        for (int i = 0; i < n && ok; ++i) {
+            Client& c = clients[events[i].data.u32];
+            ssize_t r = ::read(c.fd, buf, sizeof buf);
+            if (r <= 0) {
+                if (r < 0 && errno == EAGAIN) {
+                    continue;
+                }
+                fprintf(stderr, "connection closed by server\n");
+                ok = false;
+                break;
+            }
+            c.input.append(buf, static_cast<size_t>(r));
+            int done = h2 ? takeHttp2Responses(&c, block) : takeHttp1Responses(&c);
+            if (done < 0) {
+                ok = false;
+                break;
+            }
+            result->requests += done;
+            if (!h2) {
+                for (int k = 0; k < done; ++k) {
+                    c.output += http1_request;
+                }
+            }
+            if (!c.output.empty()) {
+                ok = writeAll(c.fd, c.output);
+                c.output.clear();
+            }
+        }
+    }
+    result->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result->loaded_kb = residentKb(server);
+
+    for (Client& c : clients) {
+        if (c.fd >= 0) {
+            ::close(c.fd);
+        }
+    }
+    ::close(epfd);
+    kill(server, SIGKILL);
+    waitpid(server, nullptr, 0);
+    return ok;
+}
+
+void usage(const char* prog) {
+    fprintf(stderr, "usage: %s [-c in_flight] [-s streams_per_h2_connection] [-d seconds] [-b body_bytes] [-P port]\n",
+            prog);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Config config;
+    int opt;
+    while ((opt = getopt(argc, argv, "c:s:d:b:P:h")) != -1) {
+        switch (opt) {
+            case 'c': config.concurrency = atoi(optarg); break;
+            case 's': config.streams = atoi(optarg); break;
+            case 'd': config.duration = atof(optarg); break;
+            case 'b': config.body_size = static_cast<size_t>(atol(optarg)); break;
+            case 'P': config.port = static_cast<uint16_t>(atoi(optarg)); break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (config.concurrency <= 0 || config.streams <= 0 || config.duration <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    printf("%d requests in flight, %zu-byte responses, %.1fs per protocol, server with 1 IO thread\n",
+           config.concurrency, config.body_size, config.duration);
+    printf("%-8s %11s %12s %12s %14s %12s %11s\n", "protocol", "connections", "idle RSS KB", "load RSS KB",
+           "KB/in-flight", "req/s", "latency ms");
+    for (bool h2 : {false, true}) {
+        Result result;
+        if (!run(config, h2, &result)) {
+            fprintf(stderr, "%s run failed\n", h2 ? "h2c" : "http/1.1");
+            return 1;
+        }
+        double rate = result.requests / result.seconds;
+        // 闭环压测，平均延迟按Little定律由在途请求数和吞吐得出
+        printf("%-8s %11d %12ld %12ld %14.2f %12.0f %11.3f\n", h2 ? "h2c" : "http/1.1", result.connections,
+               result.idle_kb, result.loaded_kb,
+               static_cast<double>(result.loaded_kb - result.idle_kb) / config.concurrency, rate,
+               config.concurrency / rate * 1000);
+    }
+    return 0;
+}
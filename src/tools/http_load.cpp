@@ -0,0 +1,157 @@
+// HTTP压测工具
+//   http_load [选项]
+//     -c, --connections N   连接数(默认64)
+//     -t, --threads N       IO线程数(默认2)
+//     -p, --pipeline N      每个连接同时在途的请求数(默认1)
+//     -d, --duration SEC    压测时长(默认10)
+//     -w, --warmup SEC      预热时长，不计入结果(默认0)
+//     -R, --rate N          总目标速率(请求/秒)，延迟按计划发送时刻计算；不指定时为闭环压测
+//     -r, --requests FILE   请求混合，每行"[权重] 方法 路径 [主体]"
+//     -H, --host HOST       服务器地址(默认127.0.0.1)
+//     -P, --port PORT       服务器端口(默认8080)
+//         --self N          在进程内启动一个N个IO线程的HttpServer并压测它，用于可重复的基准测试
+//     -u, --url PATH        不使用请求文件时请求的路径(默认/)
+// 例如HttpServer处理pipelining的吞吐：http_load --self 1 -t 1 -c 32 -p 16 -d 3 -w 1，
+// 与-p 1比较；服务端把同一批请求的响应合并成一次发送，-p越大收益越明显
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory>
+#include <future>
+#include <string>
+#include <thread>
+#include "core/http/http_load_generator.h"
+#include "core/http/http_request.h"
+#include "core/http/http_response.h"
+#include "core/http/http_server.h"
+#include "core/reactor/event_loop.h"
+#include "core/thread/eventloop_thread.h"
+#include "core/utils/logger.h"
+
+using namespace core;
+
+namespace {
+
+void usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s [-c connections] [-t threads] [-p pipeline] [-d seconds] [-w seconds]\n"
+            "          [-R rate] [-r requests_file] [-u path] [-H host] [-P port] [--self io_threads]\n",
+            prog);
+}
+
+// 进程内的基准服务器：对任意路径返回固定的小响应，只测框架本身的开销
+std::unique_ptr<HttpServer> startSelfServer(EventLoop* loop, uint16_t port, int io_threads) {
+    std::unique_ptr<HttpServer> server(new HttpServer(loop, InetAddress(port, true), "bench"));
+    server->setThreadNum(io_threads);
+    server->setHttpCallback([](const HttpRequest&, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setContentType("text/plain");
+        resp->setBody("Hello, World!");
+    });
+    server->start();
+    return server;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    HttpLoadGenerator::Options options;
+    std::string requests_file;
+    std::string url = "/";
+    int self_threads = -1;
+
+    static const struct option kLongOptions[] = {
+        {"connections", required_argument, nullptr, 'c'},
+        {"threads", required_argument, nullptr, 't'},
+        {"pipeline", required_argument, nullptr, 'p'},
+        {"duration", required_argument, nullptr, 'd'},
+        {"warmup", required_argument, nullptr, 'w'},
+        {"rate", required_argument, nullptr, 'R'},
+        {"requests", required_argument, nullptr, 'r'},
+        {"url", required_argument, nullptr, 'u'},
+        {"host", required_argument, nullptr, 'H'},
+        {"port", required_argument, nullptr, 'P'},
+        {"self", required_argument, nullptr, 's'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0},
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "c:t:p:d:w:R:r:u:H:P:h", kLongOptions, nullptr)) != -1) {
+        switch (opt) {
+            case 'c': options.connections = atoi(optarg); break;
+            case 't': options.threads = atoi(optarg); break;
+            case 'p': options.pipeline = atoi(optarg); break;
+            case 'd': options.duration = std::chrono::milliseconds(static_cast<int64_t>(atof(optarg) * 1000)); break;
+            case 'w': options.warmup = std::chrono::milliseconds(static_cast<int64_t>(atof(optarg) * 1000)); break;
+            case 'R': options.rate = atof(optarg); break;
+            case 'r': requests_file = optarg; break;
+            case 'u': url = optarg; break;
+            case 'H': options.host = optarg; break;
+            case 'P': options.port = static_cast<uint16_t>(atoi(optarg)); break;
+            case 's': self_threads = atoi(optarg); break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (options.connections <= 0 || options.duration.count() <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    Logger::instance().setLevel(LogLevel::WARN);
+    if (self_threads >= 0) {
+        options.host = "127.0.0.1";
+    }
+
+    HttpLoadGenerator generator(options);
+    if (!requests_file.empty()) {
+        if (!generator.loadRequests(requests_file)) {
+            fprintf(stderr, "failed to load requests from %s\n", requests_file.c_str());
+            return 1;
+        }
+    } else {
+        generator.addRequest("GET", url);
+    }
+
+    // 基准服务器运行在独立的线程中，和压测线程互不干扰
+    std::unique_ptr<EventLoopThread> server_thread;
+    std::unique_ptr<HttpServer> server;
+    EventLoop* server_loop = nullptr;
+    if (self_threads >= 0) {
+        server_thread.reset(new EventLoopThread());
+        server_loop = server_thread->startLoop();
+        std::promise<void> started;
+        server_loop->runInLoop([&]() {
+            server = startSelfServer(server_loop, options.port, self_threads);
+            started.set_value();
+        });
+        started.get_future().wait();
+    }
+
+    if (options.rate > 0) {
+        printf("Running %.1fs test @ %s:%u, %d threads, %d connections, pipeline %d, %.0f req/s\n",
+               options.duration.count() / 1000.0, options.host.c_str(), options.port, options.threads,
+               options.connections, options.pipeline, options.rate);
+    } else {
+        printf("Running %.1fs test @ %s:%u, %d threads, %d connections, pipeline %d\n",
+               options.duration.count() / 1000.0, options.host.c_str(), options.port, options.threads,
+               options.connections, options.pipeline);
+    }
+    HttpLoadGenerator::Result result = generator.run();
+    printf("%s", HttpLoadGenerator::report(result).c_str());
+
+    if (server) {
+        // 压测端的连接已全部关闭，但服务器处理这些关闭要经过IO线程和主loop之间的几次转发，
+        // TcpServer析构时不等待，稍等片刻再在所属loop线程中析构
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        std::promise<void> stopped;
+        server_loop->runInLoop([&]() {
+            server.reset();
+            stopped.set_value();
+        });
+        stopped.get_future().wait();
+    }
+    return result.requests > 0 ? 0 : 1;
+}
@@ -0,0 +1,124 @@
+// 日志前端开销基准：多个线程写同一条类似连接日志的语句，比较各种后端每次调用的耗时
+//   log_bench [-m text|async|binary] [-t 线程数(默认4)] [-n 每线程条数(默认1000000)] [-o 输出文件]
+//             [-r 滚动大小(MB，默认不滚动)] [-k 保留文件数(默认4)] [-b binary每线程缓冲区(KB)]
+// text为同步文本日志，async为Logger::startAsync，binary为Logger::startBinary(用log_decode解码)。
+// async和binary在缓冲区满时丢弃，丢弃的调用几乎没有开销，所以耗时按写入的条数平均；
+// 有丢弃时结果不代表持续写入的开销，给出警告并以2退出。
+// 紧凑循环写日志比后台线程写文件快，binary的缓冲区默认按每线程的条数取足(每条64字节)，测的是前端本身
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "core/utils/logger.h"
+
+using namespace core;
+
+int main(int argc, char* argv[]) {
+    std::string mode = "binary";
+    int threads = 4;
+    long calls = 1000000;
+    std::string output = "/tmp/log_bench.log";
+    LogFile::Options file_options;
+    file_options.max_files = 4;
+    size_t ring_kb = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:t:n:o:r:k:b:h")) != -1) {
+        switch (opt) {
+            case 'm': mode = optarg; break;
+            case 't': threads = atoi(optarg); break;
+            case 'n': calls = atol(optarg); break;
+            case 'o': output = optarg; break;
+            case 'r': file_options.roll_size = static_cast<size_t>(atol(optarg)) * 1024 * 1024; break;
+            case 'k': file_options.max_files = static_cast<size_t>(atol(optarg)); break;
+            case 'b': ring_kb = static_cast<size_t>(atol(optarg)); break;
+            default:
+                fprintf(stderr, "usage: %s [-m text|async|binary] [-t threads] [-n calls] [-o file] [-r roll_mb] [-k keep]"
+                        " [-b ring_kb]\n",
+                        argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (threads <= 0 || calls <= 0 || (mode != "text" && mode != "async" && mode != "binary")) {
+        fprintf(stderr, "usage: %s [-m text|async|binary] [-t threads] [-n calls] [-o file] [-r roll_mb] [-k keep]"
+                " [-b ring_kb]\n",
+                argv[0]);
+        return 1;
+    }
+
+    Logger& logger = Logger::instance();
+    logger.setLevel(LogLevel::INFO);
+    if (mode == "binary") {
+        BinaryLogging::Options binary_options;
+        binary_options.ring_size = ring_kb > 0 ? ring_kb * 1024 : static_cast<size_t>(calls) * 64;
+        if (!logger.startBinary(output, binary_options)) {
+            return 1;
+        }
+    } else {
+        logger.setLogFile(output, file_options);
+        if (mode == "async") {
+            logger.startAsync();
+        }
+    }
+
+    using Clock = std::chrono::steady_clock;
+    std::vector<Clock::time_point> starts(threads);
+    std::vector<Clock::time_point> ends(threads);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([t, calls, &starts, &ends]() {
+            std::string name = "bench-127.0.0.1:8080#" + std::to_string(t);
+            // 第一条日志分配本线程的缓冲区，不计入结果
+            LOG_INFO("log_bench thread {} started", t);
+            starts[t] = Clock::now();
+            for (long i = 0; i < calls; ++i) {
+                LOG_INFO("TcpConnection::handleRead [{}] fd={} read {} bytes, input = {}",
+                         name, t + 10, static_cast<size_t>(i & 4095), static_cast<size_t>(i));
+            }
+            ends[t] = Clock::now();
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    uint64_t dropped = 0;
+    if (mode == "binary") {
+        dropped = BinaryLogging::instance().dropped();
+        logger.stopBinary();
+    } else if (mode == "async") {
+        dropped = logger.droppedRecords();
+        logger.stopAsync();
+    }
+
+    // 各线程的耗时之和除以写入的条数，即每条写入的日志在调用线程上的平均开销；
+    // 线程数超过CPU数时各线程的耗时互相重叠，这时看总吞吐
+    double sum = 0;
+    Clock::time_point first = starts[0];
+    Clock::time_point last = ends[0];
+    for (int t = 0; t < threads; ++t) {
+        sum += std::chrono::duration<double, std::nano>(ends[t] - starts[t]).count();
+        first = std::min(first, starts[t]);
+        last = std::max(last, ends[t]);
+    }
+    double wall = std::chrono::duration<double>(last - first).count();
+    uint64_t total = static_cast<uint64_t>(threads) * static_cast<uint64_t>(calls);
+    uint64_t kept = total > dropped ? total - dropped : 0;
+    printf("%s: %d threads x %ld calls, %.1f ns/record, %.2fM records/s, %llu kept, %llu dropped\n", mode.c_str(),
+           threads, calls, kept > 0 ? sum / static_cast<double>(kept) : 0.0,
+           wall > 0 ? static_cast<double>(kept) / wall / 1e6 : 0.0, static_cast<unsigned long long>(kept),
+           static_cast<unsigned long long>(dropped));
+    if (dropped > 0) {
+        fprintf(stderr, "warning: %llu of %llu records dropped (%.1f%%), the result does not reflect sustained logging\n",
+                static_cast<unsigned long long>(dropped), static_cast<unsigned long long>(total),
+                100.0 * static_cast<double>(dropped) / static_cast<double>(total));
+        return 2;
+    }
+    return 0;
+}
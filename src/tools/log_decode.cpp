@@ -0,0 +1,302 @@
+// 二进制日志解码工具：把Logger::startBinary写出的文件还原成和文本日志相同格式的文本
+//   log_decode [文件]      不指定文件时读标准输入，结果写到标准输出
+// 参数的实际类型记录在文件中，按和文本日志相同的规则展开格式串中的{}、{:x}
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "core/net/inet_address_format.h"
+#include "core/utils/binary_logging.h"
+#include "core/utils/log_format.h"
+#include "core/utils/logger.h"
+
+using namespace core;
+
+namespace {
+
+struct Site {
+    int level;
+    uint32_t line;
+    std::string file;
+    std::string func;
+    std::string format;
+    std::vector<uint8_t> types;
+};
+
+// 解码出的参数，按实际类型保存，渲染时交给和文本日志相同的LogFormatter
+struct Arg {
+    int64_t i;          // 有符号整数
+    uint64_t u;         // 无符号整数
+    const void* ptr;
+    double d;
+    bool b;
+    char c;
+    std::string_view s;
+    InetAddress inet;
+    log_detail::FormatArg format;
+};
+
+const char* levelName(int level) {
+    static const char* const kNames[] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL"};
+    return level >= 0 && level < 6 ? kNames[level] : "UNKNOWN";
+}
+
+template <typename T>
+bool readValue(const char** p, const char* end, T* v) {
+    if (end - *p < static_cast<ptrdiff_t>(sizeof(T))) {
+        return false;
+    }
+    memcpy(v, *p, sizeof(T));
+    *p += sizeof(T);
+    return true;
+}
+
+// 按类型读出一个参数，数据不足或类型不认识时返回false
+bool readArg(binlog::ArgType type, const char** p, const char* end, Arg* arg) {
+    switch (type) {
+        case binlog::kInt32: {
+            int32_t v;
+            if (!readValue(p, end, &v)) return false;
+            arg->i = v;
+            arg->format = log_detail::makeFormatArg(arg->i);
+            return true;
+        }
+        case binlog::kUInt32: {
+            uint32_t v;
+            if (!readValue(p, end, &v)) return false;
+            arg->u = v;
+            arg->format = log_detail::makeFormatArg(arg->u);
+            return true;
+        }
+        case binlog::kInt64:
+            if (!readValue(p, end, &arg->i)) return false;
+            arg->format = log_detail::makeFormatArg(arg->i);
+            return true;
+        case binlog::kUInt64:
+            if (!readValue(p, end, &arg->u)) return false;
+            arg->format = log_detail::makeFormatArg(arg->u);
+            return true;
+        case binlog::kPointer: {
+            uint64_t v;
+            if (!readValue(p, end, &v)) return false;
+            arg->ptr = reinterpret_cast<const void*>(static_cast<uintptr_t>(v));
+            arg->format = log_detail::makeFormatArg(arg->ptr);
+            return true;
+        }
+        case binlog::kDouble:
+            if (!readValue(p, end, &arg->d)) return false;
+            arg->format = log_detail::makeFormatArg(arg->d);
+            return true;
+        case binlog::kString: {
+            uint32_t len;
+            if (!readValue(p, end, &len)) return false;
+            if (end - *p < static_cast<ptrdiff_t>(len)) return false;
+            arg->s = std::string_view(*p, len);
+            *p += len;
+            arg->format = log_detail::makeFormatArg(arg->s);
+            return true;
+        }
+        case binlog::kBool: {
+            uint8_t v;
+            if (!readValue(p, end, &v)) return false;
+            arg->b = v != 0;
+            arg->format = log_detail::makeFormatArg(arg->b);
+            return true;
+        }
+        case binlog::kChar:
+            if (!readValue(p, end, &arg->c)) return false;
+            arg->format = log_detail::makeFormatArg(arg->c);
+            return true;
+        case binlog::kInet4: {
+            struct sockaddr_in addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            if (!readValue(p, end, &addr.sin_addr.s_addr) || !readValue(p, end, &addr.sin_port)) return false;
+            arg->inet = InetAddress(addr);
+            arg->format = log_detail::makeFormatArg(arg->inet);
+            return true;
+        }
+    }
+    return false;
+}
+
+// 展开格式串，规则和文本日志相同
+void render(const std::string& format, const std::vector<Arg>& args, std::string* out) {
+    std::vector<log_detail::FormatArg> list;
+    list.reserve(args.size());
+    for (const Arg& arg : args) {
+        list.push_back(arg.format);
+    }
+    LogFormatBuffer& buf = LogFormatBuffer::local();
+    buf.resize(0);
+    log_detail::formatArgs(&buf, format, list.data(), list.size());
+    out->append(buf.data(), buf.size());
+}
+
+void appendPrefix(std::string* out, int64_t time_ns, const char* level) {
+    char time_buf[kLogTimeLength];
+    size_t time_len = formatLogTime(std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(time_ns))), time_buf);
+    out->push_back('[');
+    out->append(time_buf, time_len);
+    out->append("] [");
+    out->append(level);
+    out->append("] ");
+}
+
+// 读出以'\0'结尾的字符串
+bool readCString(const char** p, const char* end, std::string* s) {
+    const char* nul = static_cast<const char*>(memchr(*p, '\0', end - *p));
+    if (!nul) {
+        return false;
+    }
+    s->assign(*p, nul);
+    *p = nul + 1;
+    return true;
+}
+
+bool parseDefinition(const char* p, const char* end, std::unordered_map<uint32_t, Site>* sites) {
+    binlog::SiteDefinition definition;
+    if (end - p < static_cast<ptrdiff_t>(sizeof(definition))) {
+        return false;
+    }
+    memcpy(&definition, p, sizeof(definition));
+    p += sizeof(definition);
+    if (end - p < static_cast<ptrdiff_t>(definition.arg_count)) {
+        return false;
+    }
+    Site site;
+    site.level = static_cast<int>(definition.level);
+    site.line = definition.line;
+    site.types.assign(p, p + definition.arg_count);
+    p += definition.arg_count;
+    if (!readCString(&p, end, &site.file) || !readCString(&p, end, &site.func) ||
+        !readCString(&p, end, &site.format)) {
+        return false;
+    }
+    (*sites)[definition.id] = std::move(site);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc > 2 || (argc == 2 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0))) {
+        fprintf(stderr, "usage: %s [binary_log_file]\n", argv[0]);
+        return argc == 2 ? 0 : 1;
+    }
+    FILE* in = stdin;
+    if (argc == 2) {
+        in = fopen(argv[1], "rb");
+        if (!in) {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+
+    std::unordered_map<uint32_t, Site> sites;
+    std::vector<char> body;
+    std::vector<Arg> args;
+    std::string line;
+    uint64_t offset = 0;
+    uint64_t unknown = 0;
+    bool seen_header = false;
+    int status = 0;
+
+    binlog::RecordHeader header;
+    while (fread(&header, sizeof(header), 1, in) == 1) {
+        if (header.size < sizeof(header) || header.size % 8 != 0) {
+            fprintf(stderr, "corrupt record at offset %llu\n", static_cast<unsigned long long>(offset));
+            status = 1;
+            break;
+        }
+        body.resize(header.size - sizeof(header));
+        if (!body.empty() && fread(body.data(), body.size(), 1, in) != 1) {
+            fprintf(stderr, "truncated record at offset %llu\n", static_cast<unsigned long long>(offset));
+            status = 1;
+            break;
+        }
+        offset += header.size;
+        const char* p = body.data();
+        const char* end = p + body.size();
+
+        if (header.site == binlog::kFileHeader) {
+            if (body.size() < sizeof(binlog::kMagic) || memcmp(p, binlog::kMagic, sizeof(binlog::kMagic)) != 0) {
+                fprintf(stderr, "not a binary log file\n");
+                status = 1;
+                break;
+            }
+            seen_header = true;
+            sites.clear();
+            continue;
+        }
+        if (!seen_header) {
+            fprintf(stderr, "not a binary log file\n");
+            status = 1;
+            break;
+        }
+        if (header.site == binlog::kSiteDefinition) {
+            if (!parseDefinition(p, end, &sites)) {
+                fprintf(stderr, "corrupt site definition at offset %llu\n",
+                        static_cast<unsigned long long>(offset - header.size));
+                status = 1;
+                break;
+            }
+            continue;
+        }
+
+        line.clear();
+        if (header.site == binlog::kDropped) {
+            uint64_t count = 0;
+            memcpy(&count, p, std::min(sizeof(count), body.size()));
+            appendPrefix(&line, header.time, "WARN");
+            line.append("BinaryLogging - dropped ");
+            line.append(std::to_string(count));
+            line.append(" log records\n");
+            fwrite(line.data(), 1, line.size(), stdout);
+            continue;
+        }
+
+        auto it = sites.find(header.site);
+        if (it == sites.end()) {
+            ++unknown;
+            continue;
+        }
+        const Site& site = it->second;
+        args.resize(site.types.size());
+        bool complete = true;
+        for (size_t i = 0; i < site.types.size() && complete; ++i) {
+            complete = readArg(static_cast<binlog::ArgType>(site.types[i]), &p, end, &args[i]);
+        }
+        if (!complete) {
+            ++unknown;
+            continue;
+        }
+
+        appendPrefix(&line, header.time, levelName(site.level));
+        line.append(site.file);
+        line.push_back(':');
+        line.append(std::to_string(site.line));
+        line.append(" (");
+        line.append(site.func);
+        line.append(") ");
+        render(site.format, args, &line);
+        line.push_back('\n');
+        fwrite(line.data(), 1, line.size(), stdout);
+    }
+
+    if (unknown > 0) {
+        fprintf(stderr, "%llu records skipped: unknown site or malformed arguments\n",
+                static_cast<unsigned long long>(unknown));
+    }
+    if (in != stdin) {
+        fclose(in);
+    }
+    return status;
+}
@@ -0,0 +1,85 @@
+// Reactor基准：一个EventLoop上有N个管道首尾相连成环，每个Channel读到一个字节后写入下一个管道，
+// 一次传递经过EPollPoller::poll、Channel::handleEvent和一次read/write，这些都是带LOG_TRACE的热路径。
+// 用不同的CORE_LOG_MIN_LEVEL分别编译，比较日志在运行时关闭和在编译期去掉时的开销：
+//   g++ -O2 -Isrc ... src/tools/reactor_bench.cpp                         # TRACE编译进来，运行时级别为INFO
+//   g++ -O2 -Isrc -DCORE_LOG_MIN_LEVEL=2 ... src/tools/reactor_bench.cpp  # TRACE/DEBUG在编译期去掉
+//   reactor_bench [管道数(默认16)] [传递次数(默认2000000)]
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include "core/net/channel.h"
+#include "core/reactor/event_loop.h"
+#include "core/utils/logger.h"
+
+using namespace core;
+
+int main(int argc, char* argv[]) {
+    int pipes = argc > 1 ? atoi(argv[1]) : 16;
+    long hops = argc > 2 ? atol(argv[2]) : 2000000;
+    if (pipes <= 0 || hops <= 0) {
+        fprintf(stderr, "usage: %s [pipes] [hops]\n", argv[0]);
+        return 1;
+    }
+
+    Logger::instance().setLevel(LogLevel::INFO);
+
+    EventLoop loop;
+    std::vector<int> read_fds(pipes);
+    std::vector<int> write_fds(pipes);
+    for (int i = 0; i < pipes; ++i) {
+        int fds[2];
+        if (::pipe2(fds, O_NONBLOCK | O_CLOEXEC) < 0) {
+            perror("pipe2");
+            return 1;
+        }
+        read_fds[i] = fds[0];
+        write_fds[i] = fds[1];
+    }
+
+    long remaining = hops;
+    std::vector<std::unique_ptr<Channel>> channels;
+    for (int i = 0; i < pipes; ++i) {
+        channels.emplace_back(new Channel(&loop, read_fds[i]));
+        int next = write_fds[(i + 1) % pipes];
+        int fd = read_fds[i];
+        channels.back()->setReadCallback([&loop, &remaining, fd, next]() {
+            char byte;
+            ssize_t n = ::read(fd, &byte, 1);
+            if (n != 1) {
+                return;
+            }
+            if (--remaining <= 0) {
+                loop.quit();
+                return;
+            }
+            n = ::write(next, &byte, 1);
+            (void)n;
+        });
+        channels.back()->enableReading();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    char byte = 'x';
+    ssize_t n = ::write(write_fds[0], &byte, 1);
+    (void)n;
+    loop.loop();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("CORE_LOG_MIN_LEVEL=%d: %ld hops over %d pipes in %.3fs, %.1f ns/hop\n",
+           CORE_LOG_MIN_LEVEL, hops, pipes, seconds, seconds * 1e9 / hops);
+
+    for (auto& channel : channels) {
+        channel->disableAll();
+        channel->remove();
+    }
+    for (int i = 0; i < pipes; ++i) {
+        ::close(read_fds[i]);
+        ::close(write_fds[i]);
+    }
+    return 0;
+}
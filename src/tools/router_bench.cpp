@@ -0,0 +1,169 @@
+// 路由查找基准：注册500条路由(静态、":id"参数和"*path"通配混合)，对一组命中/未命中的路径反复查找，
+// 比较HttpRouter::match与逐条比较路由模式的线性匹配(不用路由表时处理函数里的if/else链)，
+// 并统计查找过程中的内存分配次数(应为0)
+//   router_bench [资源数(默认50，每个资源10条路由)] [查找轮数(默认20000)]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "core/http/http_router.h"
+
+using namespace core;
+
+namespace {
+
+std::atomic<long> g_allocations{0};
+
+} // namespace
+
+// 统计全局分配次数，用于确认查找不分配内存
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+namespace {
+
+struct Route {
+    HttpRequest::Method method;
+    std::string pattern;
+};
+
+struct Lookup {
+    HttpRequest::Method method;
+    std::string path;
+};
+
+// 每个资源10条路由，与游戏后台常见的REST接口相似
+std::vector<Route> makeRoutes(int resources) {
+    std::vector<Route> routes;
+    for (int r = 0; r < resources; ++r) {
+        std::string base = "/api/v1/res" + std::to_string(r);
+        routes.push_back({HttpRequest::GET, base});
+        routes.push_back({HttpRequest::POST, base});
+        routes.push_back({HttpRequest::GET, base + "/:id"});
+        routes.push_back({HttpRequest::PUT, base + "/:id"});
+        routes.push_back({HttpRequest::DELETE, base + "/:id"});
+        routes.push_back({HttpRequest::GET, base + "/:id/items"});
+        routes.push_back({HttpRequest::GET, base + "/:id/items/:item"});
+        routes.push_back({HttpRequest::GET, base + "/stats/daily"});
+        routes.push_back({HttpRequest::GET, base + "/search"});
+        routes.push_back({HttpRequest::GET, "/static" + std::to_string(r) + "/*path"});
+    }
+    return routes;
+}
+
+// 请求的资源按固定步长打散，避免总是命中相邻的路由
+std::vector<Lookup> makeLookups(int resources) {
+    std::vector<Lookup> lookups;
+    for (int i = 0; i < resources; ++i) {
+        int r = (i * 37) % resources;
+        std::string base = "/api/v1/res" + std::to_string(r);
+        lookups.push_back({HttpRequest::GET, base});
+        lookups.push_back({HttpRequest::GET, base + "/10086"});
+        lookups.push_back({HttpRequest::PUT, base + "/10086"});
+        lookups.push_back({HttpRequest::GET, base + "/10086/items/7"});
+        lookups.push_back({HttpRequest::GET, base + "/stats/daily"});
+        lookups.push_back({HttpRequest::GET, "/static" + std::to_string(r) + "/js/app.min.js"});
+        lookups.push_back({HttpRequest::GET, base + "/10086/unknown"});  // 404
+        lookups.push_back({HttpRequest::POST, base + "/search"});        // 405
+    }
+    return lookups;
+}
+
+// 线性匹配：逐条路由按'/'分段比较，":"段匹配任意一段，"*"段匹配剩余路径
+bool matchPattern(std::string_view pattern, std::string_view path) {
+    while (!pattern.empty() && !path.empty()) {
+        size_t pe = pattern.find('/', 1);
+        std::string_view pseg = pattern.substr(0, pe);
+        if (pseg.size() > 1 && pseg[1] == '*') {
+            return true;
+        }
+        size_t e = path.find('/', 1);
+        std::string_view seg = path.substr(0, e);
+        if (!(pseg.size() > 1 && pseg[1] == ':') && pseg != seg) {
+            return false;
+        }
+        pattern.remove_prefix(pseg.size());
+        path.remove_prefix(seg.size());
+    }
+    return pattern.empty() && path.empty();
+}
+
+int linearMatch(const std::vector<Route>& routes, HttpRequest::Method method, std::string_view path) {
+    for (size_t i = 0; i < routes.size(); ++i) {
+        if (routes[i].method == method && matchPattern(routes[i].pattern, path)) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+volatile long g_sink;
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int resources = argc > 1 ? atoi(argv[1]) : 50;
+    long rounds = argc > 2 ? atol(argv[2]) : 20000;
+    if (resources <= 0 || rounds <= 0) {
+        fprintf(stderr, "usage: %s [resources] [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<Route> routes = makeRoutes(resources);
+    std::vector<Lookup> lookups = makeLookups(resources);
+
+    HttpRouter router;
+    for (const Route& route : routes) {
+        router.addRoute(route.method, route.pattern, [](const HttpRequest&, const RouteParams&, HttpResponse*) {});
+    }
+    router.freeze();
+
+    long lookups_total = rounds * static_cast<long>(lookups.size());
+
+    long allocations = g_allocations.load();
+    long matched = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < rounds; ++i) {
+        for (const Lookup& lookup : lookups) {
+            const HttpRouter::Handler* handler = nullptr;
+            RouteParams params;
+            if (router.match(lookup.method, lookup.path, &handler, &params) == HttpRouter::kMatched) {
+                matched += static_cast<long>(params.size()) + 1;
+            }
+        }
+    }
+    double router_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count()
+        / lookups_total;
+    allocations = g_allocations.load() - allocations;
+    g_sink = matched;
+
+    // 线性匹配慢得多，轮数减少到1/10
+    long linear_rounds = rounds / 10 > 0 ? rounds / 10 : 1;
+    start = std::chrono::steady_clock::now();
+    for (long i = 0; i < linear_rounds; ++i) {
+        for (const Lookup& lookup : lookups) {
+            g_sink = linearMatch(routes, lookup.method, lookup.path);
+        }
+    }
+    double linear_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count()
+        / (linear_rounds * static_cast<long>(lookups.size()));
+
+    printf("%zu routes, %zu paths (6/8 matched, 1 404, 1 405 per resource)\n", routes.size(), lookups.size());
+    printf("HttpRouter::match  %8.1f ns/lookup, %ld allocations in %ld lookups\n",
+           router_ns, allocations, lookups_total);
+    printf("linear matching    %8.1f ns/lookup (%.1fx)\n", linear_ns, linear_ns / router_ns);
+    return allocations == 0 ? 0 : 1;
+}
@@ -0,0 +1,168 @@
+// WebSocket帧解析的回归检查：在进程内启动一个HttpServer，用原始socket发送畸形或超长的帧，
+// 检查服务器以预期的关闭码关闭连接，而不是越界读写或崩溃。建议用-fsanitize=address编译运行。
+//   websocket_check [端口(默认18040)]
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <future>
+#include <memory>
+#include <string>
+#include "core/http/http_request.h"
+#include "core/http/http_response.h"
+#include "core/http/http_server.h"
+#include "core/http/websocket.h"
+#include "core/reactor/event_loop.h"
+#include "core/thread/eventloop_thread.h"
+#include "core/utils/logger.h"
+
+using namespace core;
+
+namespace {
+
+const size_t kMaxMessageSize = 1024;
+
+// 客户端帧：FIN/opcode、带掩码的长度(7位、16位或64位形式)，掩码为0，负载原样发送
+std::string frame(uint8_t first, uint64_t len, const std::string& payload, int length_form = 0) {
+    std::string out(1, static_cast<char>(first));
+    if (length_form == 0 && len < 126) {
+        out += static_cast<char>(0x80 | len);
+    } else if (length_form == 0 && len <= 0xFFFF) {
+        out += static_cast<char>(0x80 | 126);
+        out += static_cast<char>(len >> 8);
+        out += static_cast<char>(len);
+    } else {
+        out += static_cast<char>(0x80 | 127);
+        for (int i = 7; i >= 0; --i) {
+            out += static_cast<char>(len >> (i * 8));
+        }
+    }
+    out.append(4, '\0');
+    return out + payload;
+}
+
+// 完成握手后发送frames，返回服务器close帧中的关闭码；连接被直接断开时返回0
+int sendFrames(uint16_t port, const std::string& frames) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) < 0) {
+        perror("connect");
+        ::close(fd);
+        return -1;
+    }
+    struct timeval tv = {3, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv);
+
+    std::string request =
+        "GET /ws HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    request += frames;
+    ssize_t n = ::send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+    (void)n;
+
+    std::string input;
+    char buf[4096];
+    int code = 0;
+    while ((n = ::recv(fd, buf, sizeof buf, 0)) > 0) {
+        input.append(buf, static_cast<size_t>(n));
+        size_t end = input.find("\r\n\r\n");
+        if (end == std::string::npos) {
+            continue;
+        }
+        // 跳过回显的数据帧(服务端的帧不加掩码)，找到close帧：0x88、长度、2字节关闭码
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(input.data()) + end + 4;
+        size_t left = input.size() - end - 4;
+        while (left >= 2) {
+            size_t header_len = (p[1] & 0x7F) == 126 ? 4 : (p[1] & 0x7F) == 127 ? 10 : 2;
+            if (left < header_len) {
+                break;
+            }
+            size_t len = p[1] & 0x7F;
+            for (size_t i = 2; i < header_len; ++i) {
+                len = (i == 2 ? 0 : len << 8) | p[i];
+            }
+            if (left - header_len < len) {
+                break;
+            }
+            if (p[0] == 0x88 && len >= 2) {
+                code = p[header_len] << 8 | p[header_len + 1];
+                break;
+            }
+            p += header_len + len;
+            left -= header_len + len;
+        }
+        if (code != 0) {
+            break;
+        }
+    }
+    ::close(fd);
+    return code;
+}
+
+struct Case {
+    const char* name;
+    std::string frames;
+    int expected_code;
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    uint16_t port = static_cast<uint16_t>(argc > 1 ? atoi(argv[1]) : 18040);
+    Logger::instance().setLevel(LogLevel::ERROR);
+
+    EventLoopThread server_thread;
+    EventLoop* server_loop = server_thread.startLoop();
+    std::unique_ptr<HttpServer> server;
+    std::promise<void> started;
+    server_loop->runInLoop([&]() {
+        server.reset(new HttpServer(server_loop, InetAddress(port, true), "websocket_check"));
+        server->router().get("/ws", [](const HttpRequest&, const RouteParams&, HttpResponse* resp) {
+            WebSocketCallbacks callbacks;
+            callbacks.max_message_size = kMaxMessageSize;
+            callbacks.on_message = [](const WebSocketConnection::Ptr& ws, int opcode, std::string_view data) {
+                ws->send(data, static_cast<WebSocketConnection::Opcode>(opcode));
+            };
+            resp->upgradeWebSocket(std::move(callbacks));
+        });
+        server->start();
+        started.set_value();
+    });
+    started.get_future().wait();
+
+    // 首个分片1字节，使message_非空；之后的续帧长度与message_.size()相加会溢出
+    std::string first = frame(0x01, 1, "a");
+    const Case kCases[] = {
+        {"64-bit length with MSB set", frame(0x82, ~0ULL, std::string(32, 'x'), 8), 1002},
+        {"continuation of 2^64-1 after 1-byte fragment", first + frame(0x80, ~0ULL, std::string(32, 'x'), 8), 1002},
+        {"continuation of 2^63-1 after 1-byte fragment", first + frame(0x80, ~0ULL >> 1, std::string(32, 'x'), 8), 1009},
+        {"single frame of 2^62", frame(0x82, 1ULL << 62, std::string(32, 'x'), 8), 1009},
+        {"fragments exceeding max_message_size", frame(0x02, 1000, std::string(1000, 'x')) + frame(0x80, 100, std::string(100, 'x')), 1009},
+        {"fragments exactly max_message_size", frame(0x02, 1000, std::string(1000, 'x')) + frame(0x80, 24, std::string(24, 'x')) +
+                                                   frame(0x88, 2, "\x03\xe8"), 1000},
+    };
+
+    int failed = 0;
+    for (const Case& c : kCases) {
+        int code = sendFrames(port, c.frames);
+        bool ok = code == c.expected_code;
+        printf("%-50s close %d, expected %d: %s\n", c.name, code, c.expected_code, ok ? "ok" : "FAILED");
+        failed += ok ? 0 : 1;
+    }
+
+    std::promise<void> stopped;
+    server_loop->runInLoop([&]() {
+        server.reset();
+        stopped.set_value();
+    });
+    stopped.get_future().wait();
+    return failed == 0 ? 0 : 1;
+}